@@ -2,23 +2,14 @@
 
 #include <string.h>
 
+#include "request_ecu.h"
+#include "sdkconfig.h"
+
 void app_context_deinit(app_context_t* ctx) {
   if (ctx == NULL) {
     return;
   }
 
-  if (ctx->can_rx_queue != NULL) {
-    vQueueDelete(ctx->can_rx_queue);
-    ctx->can_rx_queue = NULL;
-  }
-  if (ctx->ecu_can_frames != NULL) {
-    vQueueDelete(ctx->ecu_can_frames);
-    ctx->ecu_can_frames = NULL;
-  }
-  if (ctx->vdc_can_frames != NULL) {
-    vQueueDelete(ctx->vdc_can_frames);
-    ctx->vdc_can_frames = NULL;
-  }
   if (ctx->vehicle_state_mutex != NULL) {
     vSemaphoreDelete(ctx->vehicle_state_mutex);
     ctx->vehicle_state_mutex = NULL;
@@ -32,17 +23,60 @@ bool app_context_init(app_context_t* ctx, twai_node_handle_t node_hdl) {
 
   memset(ctx, 0, sizeof(*ctx));
   ctx->node_hdl = node_hdl;
+  telemetry_sample_batch_init(&ctx->oil_samples, (1UL << TELEMETRY_CHANNEL_oil_pressure) |
+                                                     (1UL << TELEMETRY_CHANNEL_oil_pressure_raw));
+  ctx->settings = (hub_settings_t){
+#ifdef CONFIG_DH_UART_ENABLED
+      .emit_period_ms = CONFIG_DH_UART_EMIT_PERIOD_MS,
+#endif
+      .ecu_poll_period_ms = CONFIG_DH_ECU_POLL_PERIOD_MS,
+      .vdc_poll_period_ms = CONFIG_DH_VDC_POLL_PERIOD_MS,
+      .ecu_field_mask = REQUEST_ECU_ALL_FIELDS,
+  };
 
-  ctx->can_rx_queue = xQueueCreate(16, sizeof(can_rx_frame_t));
-  ctx->ecu_can_frames = xQueueCreate(16, sizeof(can_rx_frame_t));
-  ctx->vdc_can_frames = xQueueCreate(16, sizeof(can_rx_frame_t));
   ctx->vehicle_state_mutex = xSemaphoreCreateMutex();
 
-  if (ctx->can_rx_queue == NULL || ctx->ecu_can_frames == NULL || ctx->vdc_can_frames == NULL ||
-      ctx->vehicle_state_mutex == NULL) {
+  if (!can_transport_sink_init(&ctx->ecu_rx, "ECU") || !can_transport_sink_init(&ctx->vdc_rx, "VDC") ||
+      !can_transport_sink_init(&ctx->chassis_rx, "chassis") || ctx->vehicle_state_mutex == NULL) {
     app_context_deinit(ctx);
     return false;
   }
 
+  // Response flow control goes out from the RX ISR, ahead of the engine.
+  can_transport_sink_auto_flow_control(&ctx->ecu_rx, ECU_REQ_ID);
+  can_transport_sink_auto_flow_control(&ctx->vdc_rx, VDC_REQ_ID);
+  if (!isotp_session_init(&ctx->ecu_isotp, "ECU", node_hdl, ECU_REQ_ID, &ctx->ecu_rx) ||
+      !isotp_session_init(&ctx->vdc_isotp, "VDC", node_hdl, VDC_REQ_ID, &ctx->vdc_rx)) {
+    app_context_deinit(ctx);
+    return false;
+  }
+
+  return true;
+}
+
+bool app_context_get_settings(app_context_t* ctx, hub_settings_t* out) {
+  if (ctx == NULL || out == NULL || xSemaphoreTake(ctx->vehicle_state_mutex, pdMS_TO_TICKS(5)) != pdTRUE) {
+    return false;
+  }
+  *out = ctx->settings;
+  xSemaphoreGive(ctx->vehicle_state_mutex);
+  return true;
+}
+
+uint32_t app_context_get_broadcast_fields(app_context_t* ctx) {
+  if (ctx == NULL || xSemaphoreTake(ctx->vehicle_state_mutex, pdMS_TO_TICKS(5)) != pdTRUE) {
+    return 0;
+  }
+  const uint32_t fields = ctx->broadcast_fields;
+  xSemaphoreGive(ctx->vehicle_state_mutex);
+  return fields;
+}
+
+bool app_context_get_bus_report(app_context_t* ctx, can_bus_report_t* out) {
+  if (ctx == NULL || out == NULL || xSemaphoreTake(ctx->vehicle_state_mutex, pdMS_TO_TICKS(5)) != pdTRUE) {
+    return false;
+  }
+  *out = ctx->bus_report;
+  xSemaphoreGive(ctx->vehicle_state_mutex);
   return true;
 }
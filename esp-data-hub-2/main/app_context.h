@@ -1,21 +1,41 @@
 #pragma once
 
+#include "can_transport.h"
 #include "can_types.h"
 #include "esp_twai.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/queue.h"
 #include "freertos/semphr.h"
 #include "freertos/task.h"
+#include "hub_settings.h"
+#include "isotp.h"
+#include "telemetry_protocol.h"
 #include "telemetry_types.h"
 
 typedef struct {
   twai_node_handle_t node_hdl;
   vehicle_state_t vehicle_state;
   SemaphoreHandle_t vehicle_state_mutex;
-  QueueHandle_t can_rx_queue;
-  QueueHandle_t ecu_can_frames;
-  QueueHandle_t vdc_can_frames;
+  telemetry_sample_batch_t oil_samples;  // analog readings not yet sent, guarded by vehicle_state_mutex
+  hub_settings_t settings;               // set by the display at runtime, guarded by vehicle_state_mutex
+  can_rx_sink_t ecu_rx;  // frames from ECU_RES_ID, read by task_isotp
+  can_rx_sink_t vdc_rx;  // frames from VDC_RES_ID, read by task_isotp
+  isotp_session_t ecu_isotp;  // SSM exchanges, owned by task_ecu_ssm
+  isotp_session_t vdc_isotp;  // UDS exchanges, owned by task_vdc_uds
+  can_rx_sink_t chassis_rx;  // broadcast frames in can_broadcast_signals, read by task_can_broadcast
+  uint32_t broadcast_fields;  // channels kept fresh by broadcasts, guarded by vehicle_state_mutex
+  can_bus_report_t bus_report;  // written by task_twai_monitor, guarded by vehicle_state_mutex
 } app_context_t;
 
 bool app_context_init(app_context_t* ctx, twai_node_handle_t node_hdl);
 void app_context_deinit(app_context_t* ctx);
+
+// Copies the current runtime settings. Returns false if the mutex is busy.
+bool app_context_get_settings(app_context_t* ctx, hub_settings_t* out);
+
+// Channels currently decoded from broadcast frames, which the poll tasks
+// leave out. Returns 0 if the mutex is busy, so they are polled once more.
+uint32_t app_context_get_broadcast_fields(app_context_t* ctx);
+
+// Copies the latest CAN bus report. Returns false if the mutex is busy.
+bool app_context_get_bus_report(app_context_t* ctx, can_bus_report_t* out);
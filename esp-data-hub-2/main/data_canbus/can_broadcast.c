@@ -0,0 +1,106 @@
+#include "can_broadcast.h"
+
+#include <stddef.h>
+
+// Layouts follow the community subaru_global_2017 DBC (opendbc). They have not
+// been checked against a trace of this car yet, which is why
+// CONFIG_DH_CAN_BROADCAST defaults to off.
+const can_broadcast_signal_t can_broadcast_signals[] = {
+    // 0x002 steering: angle in 0.1 deg, sign as in the DBC.
+    {.can_id = 0x002, .start_bit = 16, .bit_length = 16, .is_signed = true, .scale = -0.1f,
+     .channel = TELEMETRY_CHANNEL_steering_angle_deg},
+    // 0x040 throttle: engine speed and accelerator pedal (0-255 = 0-100%).
+    {.can_id = 0x040, .start_bit = 16, .bit_length = 14, .scale = 1.0f, .channel = TELEMETRY_CHANNEL_engine_rpm},
+    {.can_id = 0x040, .start_bit = 32, .bit_length = 8, .scale = 100.0f / 255.0f,
+     .channel = TELEMETRY_CHANNEL_throttle_pos},
+    // 0x138 brake pressure, left front circuit, in the same raw units as VDC
+    // DID 0x102B.
+    {.can_id = 0x138, .start_bit = 48, .bit_length = 8, .scale = 1.0f,
+     .channel = TELEMETRY_CHANNEL_brake_pressure_bar},
+};
+const size_t can_broadcast_signal_count = sizeof(can_broadcast_signals) / sizeof(can_broadcast_signals[0]);
+
+#define CHANNEL_OFFSET(name, ...) offsetof(vehicle_state_t, name),
+static const size_t k_channel_offsets[TELEMETRY_CHANNEL_COUNT] = {TELEMETRY_CHANNELS(CHANNEL_OFFSET)};
+#undef CHANNEL_OFFSET
+
+static float* channel_value(vehicle_state_t* state, telemetry_channel_t channel) {
+  return (float*)((uint8_t*)state + k_channel_offsets[channel]);
+}
+
+static float channel_get(const vehicle_state_t* state, telemetry_channel_t channel) {
+  return *(const float*)((const uint8_t*)state + k_channel_offsets[channel]);
+}
+
+int32_t can_broadcast_extract(const can_broadcast_signal_t* signal, const uint8_t* data, uint8_t data_len) {
+  const uint32_t end_bit = (uint32_t)signal->start_bit + signal->bit_length;
+  if (signal->bit_length == 0 || signal->bit_length > 32 || end_bit > 8U * data_len) {
+    return 0;
+  }
+  // At most five bytes hold the signal; gather them little-endian.
+  uint64_t bits = 0;
+  for (uint32_t byte = (end_bit - 1) / 8 + 1; byte-- > signal->start_bit / 8U;) {
+    bits = bits << 8 | data[byte];
+  }
+  bits >>= signal->start_bit % 8U;
+  const uint64_t mask = (1ULL << signal->bit_length) - 1U;
+  uint32_t raw = (uint32_t)(bits & mask);
+  if (signal->is_signed && signal->bit_length < 32 && (raw >> (signal->bit_length - 1)) != 0) {
+    raw |= ~(uint32_t)mask;
+  }
+  return (int32_t)raw;
+}
+
+uint32_t can_broadcast_decode(const can_broadcast_signal_t* table, size_t count, uint32_t id, bool ide,
+                              const uint8_t* data, uint8_t data_len, vehicle_state_t* state) {
+  if (table == NULL || data == NULL || state == NULL || ide) {
+    return 0;
+  }
+  uint32_t decoded = 0;
+  for (size_t i = 0; i < count; ++i) {
+    const can_broadcast_signal_t* signal = &table[i];
+    if (signal->can_id != id || (uint32_t)signal->start_bit + signal->bit_length > 8U * data_len) {
+      continue;
+    }
+    const int32_t raw = can_broadcast_extract(signal, data, data_len);
+    const float value = signal->offset + (signal->is_signed ? (float)raw : (float)(uint32_t)raw) * signal->scale;
+    *channel_value(state, signal->channel) = value;
+    decoded |= 1UL << signal->channel;
+  }
+  return decoded;
+}
+
+uint32_t can_broadcast_channel_mask(const can_broadcast_signal_t* table, size_t count) {
+  uint32_t mask = 0;
+  for (size_t i = 0; table != NULL && i < count; ++i) {
+    mask |= 1UL << table[i].channel;
+  }
+  return mask;
+}
+
+void can_broadcast_copy_channels(uint32_t channel_mask, const vehicle_state_t* from, vehicle_state_t* to) {
+  for (int channel = 0; channel < TELEMETRY_CHANNEL_COUNT; ++channel) {
+    if (channel_mask & (1UL << channel)) {
+      *channel_value(to, (telemetry_channel_t)channel) = channel_get(from, (telemetry_channel_t)channel);
+    }
+  }
+}
+
+void can_broadcast_tracker_note(can_broadcast_tracker_t* tracker, uint32_t channel_mask, uint32_t now_ms) {
+  for (int channel = 0; channel < TELEMETRY_CHANNEL_COUNT; ++channel) {
+    if (channel_mask & (1UL << channel)) {
+      tracker->last_ms[channel] = now_ms;
+    }
+  }
+  tracker->seen_mask |= channel_mask;
+}
+
+uint32_t can_broadcast_tracker_fresh(const can_broadcast_tracker_t* tracker, uint32_t now_ms, uint32_t timeout_ms) {
+  uint32_t fresh = 0;
+  for (int channel = 0; channel < TELEMETRY_CHANNEL_COUNT; ++channel) {
+    if ((tracker->seen_mask & (1UL << channel)) && now_ms - tracker->last_ms[channel] <= timeout_ms) {
+      fresh |= 1UL << channel;
+    }
+  }
+  return fresh;
+}
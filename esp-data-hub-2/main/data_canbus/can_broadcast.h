@@ -0,0 +1,60 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "telemetry_types.h"
+
+// Decodes telemetry channels from frames the car broadcasts on its own, so
+// they need no request/response round trip.
+//
+// A signal is an unsigned or two's-complement field of 1 to 32 bits laid out
+// little-endian (Intel, "@1" in a DBC): start_bit is the position of its least
+// significant bit, counting bit 0 of data[0] as 0 and bit 0 of data[1] as 8.
+// The channel value is offset + raw * scale.
+//
+// A channel decoded recently is reported as covered, and the poll tasks
+// leave covered channels out of their requests. When broadcasts stop (wrong
+// car, unplugged gateway) the channel times out and polling takes over again.
+
+typedef struct {
+  uint16_t can_id;  // standard ID
+  uint8_t start_bit;
+  uint8_t bit_length;
+  bool is_signed;
+  float scale;
+  float offset;
+  telemetry_channel_t channel;
+} can_broadcast_signal_t;
+
+// Signals the hub decodes; see can_broadcast.c for where each comes from.
+extern const can_broadcast_signal_t can_broadcast_signals[];
+extern const size_t can_broadcast_signal_count;
+
+// When each channel was last decoded.
+typedef struct {
+  uint32_t seen_mask;  // channels decoded at least once
+  uint32_t last_ms[TELEMETRY_CHANNEL_COUNT];
+} can_broadcast_tracker_t;
+
+// Raw signal value, sign-extended when the signal is signed. 0 when the frame
+// is too short for it.
+int32_t can_broadcast_extract(const can_broadcast_signal_t* signal, const uint8_t* data, uint8_t data_len);
+
+// Decodes every signal of `table` carried by the frame into `state` and
+// returns their TELEMETRY_CHANNEL_* bits. Extended frames, unknown IDs and
+// frames too short for a signal decode nothing for it.
+uint32_t can_broadcast_decode(const can_broadcast_signal_t* table, size_t count, uint32_t id, bool ide,
+                              const uint8_t* data, uint8_t data_len, vehicle_state_t* state);
+
+// TELEMETRY_CHANNEL_* bits of every channel in `table`.
+uint32_t can_broadcast_channel_mask(const can_broadcast_signal_t* table, size_t count);
+
+// Copies the channels in `channel_mask` from `from` to `to`.
+void can_broadcast_copy_channels(uint32_t channel_mask, const vehicle_state_t* from, vehicle_state_t* to);
+
+void can_broadcast_tracker_note(can_broadcast_tracker_t* tracker, uint32_t channel_mask, uint32_t now_ms);
+
+// Channels decoded within the last `timeout_ms`.
+uint32_t can_broadcast_tracker_fresh(const can_broadcast_tracker_t* tracker, uint32_t now_ms, uint32_t timeout_ms);
@@ -0,0 +1,236 @@
+#include "can_bus_stats.h"
+
+#include <string.h>
+
+_Static_assert((CAN_BUS_STATS_MAX_IDS & (CAN_BUS_STATS_MAX_IDS - 1)) == 0,
+               "CAN_BUS_STATS_MAX_IDS must be a power of two");
+_Static_assert((CAN_BUS_STATS_STATE_QUEUE & (CAN_BUS_STATS_STATE_QUEUE - 1)) == 0,
+               "CAN_BUS_STATS_STATE_QUEUE must be a power of two");
+
+void can_bus_stats_init(can_bus_stats_t* stats) {
+  if (stats == NULL) {
+    return;
+  }
+  memset(stats, 0, sizeof(*stats));
+  for (size_t i = 0; i < CAN_BUS_STATS_MAX_IDS; ++i) {
+    atomic_init(&stats->ids[i].key, 0);
+    atomic_init(&stats->ids[i].frames, 0);
+    atomic_init(&stats->ids[i].bytes, 0);
+  }
+  atomic_init(&stats->other_frames, 0);
+  atomic_init(&stats->other_bytes, 0);
+  atomic_init(&stats->frames, 0);
+  atomic_init(&stats->bytes, 0);
+  atomic_init(&stats->bits, 0);
+  atomic_init(&stats->tx_done, 0);
+  atomic_init(&stats->tx_failed, 0);
+  atomic_init(&stats->tx_latency_sum_us, 0);
+  atomic_init(&stats->tx_latency_max_us, 0);
+  atomic_init(&stats->error_frames, 0);
+  atomic_init(&stats->error_flags, 0);
+  atomic_init(&stats->bus_off_count, 0);
+  atomic_init(&stats->state_head, 0);
+  atomic_init(&stats->state_tail, 0);
+  atomic_init(&stats->state_dropped, 0);
+}
+
+uint32_t can_bus_frame_bits(uint8_t dlc, bool ide) {
+  const uint32_t data_bits = 8U * (dlc > 8 ? 8U : dlc);
+  // SOF through CRC can be stuffed, one bit after every four after the first;
+  // CRC delimiter, ACK, EOF and interframe space cannot.
+  const uint32_t stuffable = (ide ? 54U : 34U) + data_bits;
+  return stuffable + (stuffable - 1U) / 4U + 13U;
+}
+
+// Only the ISR writes, so a load and store is enough.
+static void add_relaxed(atomic_uint_least32_t* counter, uint32_t value) {
+  atomic_store_explicit(counter, atomic_load_explicit(counter, memory_order_relaxed) + value, memory_order_relaxed);
+}
+
+static can_bus_id_counter_t* find_or_claim(can_bus_stats_t* stats, uint32_t key) {
+  // Fibonacci hash; the middle bits mix in both the low and high ID bits.
+  size_t slot = (size_t)(((uint32_t)(key * 2654435761UL)) >> 16) & (CAN_BUS_STATS_MAX_IDS - 1);
+  for (size_t probe = 0; probe < CAN_BUS_STATS_MAX_IDS; ++probe) {
+    can_bus_id_counter_t* entry = &stats->ids[slot];
+    const uint32_t current = atomic_load_explicit(&entry->key, memory_order_relaxed);
+    if (current == key) {
+      return entry;
+    }
+    if (current == 0) {
+      atomic_store_explicit(&entry->key, key, memory_order_release);
+      return entry;
+    }
+    slot = (slot + 1) & (CAN_BUS_STATS_MAX_IDS - 1);
+  }
+  return NULL;
+}
+
+void can_bus_stats_record_frame(can_bus_stats_t* stats, uint32_t id, bool ide, bool tx, uint8_t dlc) {
+  const uint32_t bytes = dlc > 8 ? 8U : dlc;
+  const uint32_t key = ((id & 0x1FFFFFFFUL) << 2 | (ide ? 2U : 0U) | (tx ? 1U : 0U)) + 1U;
+  can_bus_id_counter_t* entry = find_or_claim(stats, key);
+  if (entry != NULL) {
+    add_relaxed(&entry->frames, 1);
+    add_relaxed(&entry->bytes, bytes);
+  } else {
+    add_relaxed(&stats->other_frames, 1);
+    add_relaxed(&stats->other_bytes, bytes);
+  }
+  add_relaxed(&stats->frames, 1);
+  add_relaxed(&stats->bytes, bytes);
+  add_relaxed(&stats->bits, can_bus_frame_bits(dlc, ide));
+}
+
+void can_bus_stats_record_tx_done(can_bus_stats_t* stats, bool success, uint32_t latency_us) {
+  if (!success) {
+    add_relaxed(&stats->tx_failed, 1);
+    return;
+  }
+  add_relaxed(&stats->tx_done, 1);
+  add_relaxed(&stats->tx_latency_sum_us, latency_us);
+  // The sampling task resets the maximum, so this one needs a CAS.
+  uint32_t max = atomic_load_explicit(&stats->tx_latency_max_us, memory_order_relaxed);
+  while (latency_us > max && !atomic_compare_exchange_weak_explicit(&stats->tx_latency_max_us, &max, latency_us,
+                                                                    memory_order_relaxed, memory_order_relaxed)) {
+  }
+}
+
+void can_bus_stats_record_error(can_bus_stats_t* stats, uint32_t flags) {
+  add_relaxed(&stats->error_frames, 1);
+  atomic_fetch_or_explicit(&stats->error_flags, flags, memory_order_relaxed);
+}
+
+void can_bus_stats_record_state(can_bus_stats_t* stats, uint32_t t_ms, can_bus_state_t old_state,
+                                can_bus_state_t new_state) {
+  if (new_state == CAN_BUS_STATE_BUS_OFF) {
+    add_relaxed(&stats->bus_off_count, 1);
+  }
+  const uint32_t head = atomic_load_explicit(&stats->state_head, memory_order_relaxed);
+  const uint32_t tail = atomic_load_explicit(&stats->state_tail, memory_order_acquire);
+  if (head - tail >= CAN_BUS_STATS_STATE_QUEUE) {
+    add_relaxed(&stats->state_dropped, 1);
+    return;
+  }
+  stats->states[head & (CAN_BUS_STATS_STATE_QUEUE - 1)] = (can_bus_state_change_t){
+      .t_ms = t_ms,
+      .old_state = (uint8_t)old_state,
+      .new_state = (uint8_t)new_state,
+  };
+  atomic_store_explicit(&stats->state_head, head + 1, memory_order_release);
+}
+
+void can_bus_stats_sample(can_bus_stats_t* stats, can_bus_sample_t* out) {
+  if (stats == NULL || out == NULL) {
+    return;
+  }
+  memset(out, 0, sizeof(*out));
+  for (size_t i = 0; i < CAN_BUS_STATS_MAX_IDS; ++i) {
+    // The acquire pairs with the claim, so the counters read are this key's.
+    out->ids[i].key = atomic_load_explicit(&stats->ids[i].key, memory_order_acquire);
+    if (out->ids[i].key != 0) {
+      out->ids[i].frames = atomic_load_explicit(&stats->ids[i].frames, memory_order_relaxed);
+      out->ids[i].bytes = atomic_load_explicit(&stats->ids[i].bytes, memory_order_relaxed);
+    }
+  }
+  out->other_frames = atomic_load_explicit(&stats->other_frames, memory_order_relaxed);
+  out->other_bytes = atomic_load_explicit(&stats->other_bytes, memory_order_relaxed);
+  out->frames = atomic_load_explicit(&stats->frames, memory_order_relaxed);
+  out->bytes = atomic_load_explicit(&stats->bytes, memory_order_relaxed);
+  out->bits = atomic_load_explicit(&stats->bits, memory_order_relaxed);
+  out->tx_done = atomic_load_explicit(&stats->tx_done, memory_order_relaxed);
+  out->tx_failed = atomic_load_explicit(&stats->tx_failed, memory_order_relaxed);
+  out->tx_latency_sum_us = atomic_load_explicit(&stats->tx_latency_sum_us, memory_order_relaxed);
+  out->tx_latency_max_us = atomic_exchange_explicit(&stats->tx_latency_max_us, 0, memory_order_relaxed);
+  out->error_frames = atomic_load_explicit(&stats->error_frames, memory_order_relaxed);
+  out->error_flags = atomic_exchange_explicit(&stats->error_flags, 0, memory_order_relaxed);
+  out->bus_off_count = atomic_load_explicit(&stats->bus_off_count, memory_order_relaxed);
+  out->state_dropped = atomic_load_explicit(&stats->state_dropped, memory_order_relaxed);
+
+  uint32_t tail = atomic_load_explicit(&stats->state_tail, memory_order_relaxed);
+  const uint32_t head = atomic_load_explicit(&stats->state_head, memory_order_acquire);
+  while (tail != head && out->state_count < CAN_BUS_STATS_STATE_QUEUE) {
+    out->states[out->state_count++] = stats->states[tail & (CAN_BUS_STATS_STATE_QUEUE - 1)];
+    tail++;
+  }
+  atomic_store_explicit(&stats->state_tail, tail, memory_order_release);
+}
+
+static uint32_t per_second(uint32_t delta, uint32_t window_ms) {
+  return (uint32_t)((uint64_t)delta * 1000U / window_ms);
+}
+
+static void push_event(can_bus_report_t* report, const can_bus_event_t* event) {
+  if (report->event_count == CAN_BUS_REPORT_EVENTS) {
+    memmove(&report->events[0], &report->events[1], (CAN_BUS_REPORT_EVENTS - 1) * sizeof(report->events[0]));
+    report->event_count--;
+  }
+  report->events[report->event_count++] = *event;
+}
+
+void can_bus_report_update(can_bus_report_t* report, const can_bus_sample_t* prev, const can_bus_sample_t* now,
+                           uint32_t now_ms, uint32_t window_ms, uint32_t bitrate) {
+  if (report == NULL || prev == NULL || now == NULL || window_ms == 0 || bitrate == 0) {
+    return;
+  }
+  report->t_ms = now_ms;
+  report->window_ms = window_ms;
+  report->bitrate = bitrate;
+  report->frames_per_s = per_second(now->frames - prev->frames, window_ms);
+  report->bytes_per_s = per_second(now->bytes - prev->bytes, window_ms);
+  report->bits_per_s = per_second(now->bits - prev->bits, window_ms);
+  const uint32_t load = (uint32_t)((uint64_t)report->bits_per_s * 1000U / bitrate);
+  report->load_permille = (uint16_t)(load > UINT16_MAX ? UINT16_MAX : load);
+
+  report->id_count = 0;
+  for (size_t i = 0; i < CAN_BUS_STATS_MAX_IDS; ++i) {
+    const can_bus_id_sample_t* cur = &now->ids[i];
+    if (cur->key == 0) {
+      continue;
+    }
+    // A slot is claimed once and never reused, so an empty slot last time
+    // means the ID is new in this window.
+    const can_bus_id_sample_t* last = &prev->ids[i];
+    const uint32_t last_frames = last->key == cur->key ? last->frames : 0;
+    const uint32_t last_bytes = last->key == cur->key ? last->bytes : 0;
+    const uint32_t key = cur->key - 1U;
+    report->ids[report->id_count++] = (can_bus_id_rate_t){
+        .id = key >> 2,
+        .ide = (key & 2U) != 0,
+        .tx = (key & 1U) != 0,
+        .frames_per_s = per_second(cur->frames - last_frames, window_ms),
+        .bytes_per_s = per_second(cur->bytes - last_bytes, window_ms),
+    };
+  }
+  report->other_frames_per_s = per_second(now->other_frames - prev->other_frames, window_ms);
+
+  report->tx_frames = now->tx_done - prev->tx_done;
+  report->tx_failed = now->tx_failed - prev->tx_failed;
+  report->tx_latency_avg_us =
+      report->tx_frames > 0 ? (now->tx_latency_sum_us - prev->tx_latency_sum_us) / report->tx_frames : 0;
+  report->tx_latency_max_us = now->tx_latency_max_us;
+
+  report->error_frames = now->error_frames - prev->error_frames;
+  report->bus_off_count = now->bus_off_count;
+  report->state_dropped = now->state_dropped;
+
+  // State changes carry their own time; error frames are stamped with the end
+  // of the window they fell in.
+  for (size_t i = 0; i < now->state_count; ++i) {
+    const can_bus_event_t event = {
+        .t_ms = now->states[i].t_ms,
+        .kind = CAN_BUS_EVENT_STATE,
+        .old_state = now->states[i].old_state,
+        .new_state = now->states[i].new_state,
+    };
+    push_event(report, &event);
+  }
+  if (report->error_frames > 0) {
+    const can_bus_event_t event = {
+        .t_ms = now_ms,
+        .kind = CAN_BUS_EVENT_ERRORS,
+        .error_frames = report->error_frames,
+        .error_flags = now->error_flags,
+    };
+    push_event(report, &event);
+  }
+}
@@ -0,0 +1,176 @@
+#pragma once
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Bus traffic counters kept by the TWAI callbacks, and the per-window report
+// built from them.
+//
+// Every counter is written only from the TWAI ISR and only grows, so a task
+// reads them without a lock and takes rates from the difference between two
+// samples. Frames are counted per ID in a small open-addressed table; an ID
+// that finds the table full is counted under "other". Wire time is estimated
+// with worst-case bit stuffing, so the load is an upper bound.
+//
+// Only frames the node sees are counted: its own transmissions and received
+// frames that passed the acceptance filter. With the hardware filter on, the
+// rest of the bus is invisible; the startup survey (can_transport.h) gives an
+// estimate of the open bus load instead.
+//
+// Error frames are counted with the OR of their error flags, and error-state
+// changes go into a small lock-free queue, so the report can keep a timeline
+// of both.
+
+#define CAN_BUS_STATS_MAX_IDS 32U     // power of two
+#define CAN_BUS_STATS_STATE_QUEUE 8U  // power of two
+#define CAN_BUS_REPORT_EVENTS 16U
+
+// Error states, same order as twai_error_state_t.
+typedef enum {
+  CAN_BUS_STATE_ACTIVE = 0,
+  CAN_BUS_STATE_WARNING,
+  CAN_BUS_STATE_PASSIVE,
+  CAN_BUS_STATE_BUS_OFF,
+} can_bus_state_t;
+
+typedef struct {
+  uint32_t t_ms;
+  uint8_t old_state;
+  uint8_t new_state;
+} can_bus_state_change_t;
+
+typedef struct {
+  // (id << 2 | ide << 1 | tx) + 1, 0 while the entry is free. Set once with
+  // release order; an entry is never reused.
+  atomic_uint_least32_t key;
+  atomic_uint_least32_t frames;
+  atomic_uint_least32_t bytes;
+} can_bus_id_counter_t;
+
+typedef struct {
+  can_bus_id_counter_t ids[CAN_BUS_STATS_MAX_IDS];
+  atomic_uint_least32_t other_frames;
+  atomic_uint_least32_t other_bytes;
+  atomic_uint_least32_t frames;
+  atomic_uint_least32_t bytes;
+  atomic_uint_least32_t bits;
+
+  atomic_uint_least32_t tx_done;
+  atomic_uint_least32_t tx_failed;
+  atomic_uint_least32_t tx_latency_sum_us;
+  atomic_uint_least32_t tx_latency_max_us;  // since the last sample
+
+  atomic_uint_least32_t error_frames;
+  atomic_uint_least32_t error_flags;  // OR of flags since the last sample
+  atomic_uint_least32_t bus_off_count;
+
+  // Error-state changes, ISR to sampling task; see can_rx_ring.h.
+  atomic_uint_least32_t state_head;
+  atomic_uint_least32_t state_tail;
+  atomic_uint_least32_t state_dropped;
+  can_bus_state_change_t states[CAN_BUS_STATS_STATE_QUEUE];
+} can_bus_stats_t;
+
+typedef struct {
+  uint32_t key;  // as in can_bus_id_counter_t, 0 = unused
+  uint32_t frames;
+  uint32_t bytes;
+} can_bus_id_sample_t;
+
+// One sample of the counters. The ids[] slots keep their position between
+// samples, so two samples compare slot by slot.
+typedef struct {
+  can_bus_id_sample_t ids[CAN_BUS_STATS_MAX_IDS];
+  uint32_t other_frames;
+  uint32_t other_bytes;
+  uint32_t frames;
+  uint32_t bytes;
+  uint32_t bits;
+  uint32_t tx_done;
+  uint32_t tx_failed;
+  uint32_t tx_latency_sum_us;
+  uint32_t tx_latency_max_us;
+  uint32_t error_frames;
+  uint32_t error_flags;
+  uint32_t bus_off_count;
+  uint32_t state_dropped;
+  size_t state_count;
+  can_bus_state_change_t states[CAN_BUS_STATS_STATE_QUEUE];
+} can_bus_sample_t;
+
+typedef struct {
+  uint32_t id;
+  bool ide;
+  bool tx;
+  uint32_t frames_per_s;
+  uint32_t bytes_per_s;
+} can_bus_id_rate_t;
+
+typedef enum {
+  CAN_BUS_EVENT_ERRORS = 0,  // error frames seen during a window
+  CAN_BUS_EVENT_STATE,       // error state changed
+} can_bus_event_kind_t;
+
+typedef struct {
+  uint32_t t_ms;  // end of the window, or when the state changed
+  uint8_t kind;   // can_bus_event_kind_t
+  uint8_t old_state;
+  uint8_t new_state;
+  uint32_t error_frames;
+  uint32_t error_flags;
+} can_bus_event_t;
+
+// Traffic over the last window plus the latest events. Plain data, so tasks
+// can copy it and ship it as is.
+typedef struct {
+  uint32_t t_ms;       // end of the window
+  uint32_t window_ms;  // 0 until two samples have been taken
+  uint32_t bitrate;
+
+  uint32_t frames_per_s;
+  uint32_t bytes_per_s;
+  uint32_t bits_per_s;
+  uint16_t load_permille;  // bits_per_s / bitrate, worst-case stuffing
+
+  size_t id_count;
+  can_bus_id_rate_t ids[CAN_BUS_STATS_MAX_IDS];  // in table order
+  uint32_t other_frames_per_s;
+
+  // Submit to on_tx_done, over the window.
+  uint32_t tx_frames;
+  uint32_t tx_failed;
+  uint32_t tx_latency_avg_us;
+  uint32_t tx_latency_max_us;
+
+  uint32_t error_frames;   // over the window
+  uint32_t bus_off_count;  // since boot
+  uint32_t state_dropped;  // state changes lost to a full queue, since boot
+
+  // Oldest first; the oldest entry is dropped once full.
+  size_t event_count;
+  can_bus_event_t events[CAN_BUS_REPORT_EVENTS];
+} can_bus_report_t;
+
+void can_bus_stats_init(can_bus_stats_t* stats);
+
+// Bits a data frame takes on the wire with worst-case stuffing, including the
+// 3-bit interframe space. DLC above 8 counts as 8.
+uint32_t can_bus_frame_bits(uint8_t dlc, bool ide);
+
+// ISR side.
+void can_bus_stats_record_frame(can_bus_stats_t* stats, uint32_t id, bool ide, bool tx, uint8_t dlc);
+void can_bus_stats_record_tx_done(can_bus_stats_t* stats, bool success, uint32_t latency_us);
+void can_bus_stats_record_error(can_bus_stats_t* stats, uint32_t flags);
+void can_bus_stats_record_state(can_bus_stats_t* stats, uint32_t t_ms, can_bus_state_t old_state,
+                                can_bus_state_t new_state);
+
+// Sampling side, one task only: it also resets the window maximum and error
+// flags and drains the state changes.
+void can_bus_stats_sample(can_bus_stats_t* stats, can_bus_sample_t* out);
+
+// Fills the rates in `report` from two samples `window_ms` apart and appends
+// their events to its timeline. Pass the same report every time.
+void can_bus_report_update(can_bus_report_t* report, const can_bus_sample_t* prev, const can_bus_sample_t* now,
+                           uint32_t now_ms, uint32_t window_ms, uint32_t bitrate);
@@ -0,0 +1,91 @@
+#include "can_routes.h"
+
+#include <string.h>
+
+void can_routes_init(can_routes_t* table) {
+  if (table != NULL) {
+    memset(table, 0, sizeof(*table));
+  }
+}
+
+bool can_routes_add(can_routes_t* table, uint32_t id, uint32_t mask, void* sink) {
+  if (table == NULL || sink == NULL || table->count >= CAN_ROUTES_MAX || (mask & ~CAN_ROUTES_STD_MASK) != 0 ||
+      (id & ~mask) != 0) {
+    return false;
+  }
+  table->routes[table->count++] = (can_route_t){.id = id, .mask = mask, .sink = sink};
+  return true;
+}
+
+void* can_routes_find(const can_routes_t* table, uint32_t id, bool ide) {
+  if (table == NULL || ide || (id & ~CAN_ROUTES_STD_MASK) != 0) {
+    return NULL;
+  }
+  for (size_t i = 0; i < table->count; ++i) {
+    const can_route_t* route = &table->routes[i];
+    if ((id & route->mask) == route->id) {
+      return route->sink;
+    }
+  }
+  return NULL;
+}
+
+uint32_t can_filter_id_count(const can_filter_t* filter) {
+  uint32_t dont_care = 0;
+  for (uint32_t bit = 0; bit < 11; ++bit) {
+    dont_care += ((filter->mask >> bit) & 1U) == 0 ? 1U : 0U;
+  }
+  return 1UL << dont_care;
+}
+
+static can_filter_t merge_filters(const can_filter_t* a, const can_filter_t* b) {
+  const uint32_t mask = a->mask & b->mask & ~(a->id ^ b->id);
+  return (can_filter_t){.id = a->id & mask, .mask = mask};
+}
+
+size_t can_routes_build_filters(const can_routes_t* table, can_filter_t* filters, size_t max_filters) {
+  if (table == NULL || filters == NULL || max_filters == 0 || table->count == 0) {
+    return 0;
+  }
+  // Start from one filter per route and merge the cheapest pair until they
+  // fit; at most CAN_ROUTES_MAX^3 / 2 steps.
+  can_filter_t work[CAN_ROUTES_MAX];
+  size_t count = table->count;
+  for (size_t i = 0; i < count; ++i) {
+    work[i] = (can_filter_t){.id = table->routes[i].id, .mask = table->routes[i].mask};
+  }
+  while (count > max_filters) {
+    size_t best_a = 0;
+    size_t best_b = 1;
+    uint32_t best_ids = UINT32_MAX;
+    for (size_t a = 0; a < count; ++a) {
+      for (size_t b = a + 1; b < count; ++b) {
+        const can_filter_t merged = merge_filters(&work[a], &work[b]);
+        const uint32_t ids = can_filter_id_count(&merged);
+        if (ids < best_ids) {
+          best_ids = ids;
+          best_a = a;
+          best_b = b;
+        }
+      }
+    }
+    work[best_a] = merge_filters(&work[best_a], &work[best_b]);
+    work[best_b] = work[--count];
+  }
+  for (size_t i = 0; i < count; ++i) {
+    filters[i] = work[i];
+  }
+  return count;
+}
+
+bool can_filter_accepts(const can_filter_t* filters, size_t count, uint32_t id, bool ide) {
+  if (filters == NULL || ide || (id & ~CAN_ROUTES_STD_MASK) != 0) {
+    return false;
+  }
+  for (size_t i = 0; i < count; ++i) {
+    if ((id & filters[i].mask) == filters[i].id) {
+      return true;
+    }
+  }
+  return false;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Maps received standard (11-bit) CAN IDs to the sink that owns them. A route
+// matches a frame when (frame id & mask) == id; routes are tried in the order
+// they were added and the first match wins. Extended frames match no route.
+//
+// The table is read from the TWAI RX ISR without a lock, so routes must all be
+// added before the node is enabled.
+//
+// The routes also give the TWAI acceptance filters. A hardware mask filter
+// accepts (id & mask) == (filter id & mask), like a route, but there are fewer
+// filters than routes, so routes are merged: two filters become one keeping
+// only the bits both agree on, and the pair merged each time is the one whose
+// result accepts the fewest IDs. What a merged filter lets through beyond the
+// routes is dropped by can_routes_find() in software.
+
+#define CAN_ROUTES_MAX 8U
+#define CAN_ROUTES_STD_MASK 0x7FFU
+
+typedef struct {
+  uint32_t id;
+  uint32_t mask;
+  void* sink;
+} can_route_t;
+
+typedef struct {
+  can_route_t routes[CAN_ROUTES_MAX];
+  size_t count;
+} can_routes_t;
+
+typedef struct {
+  uint32_t id;
+  uint32_t mask;  // 1 = bit must match
+} can_filter_t;
+
+void can_routes_init(can_routes_t* table);
+
+// Returns false when the table is full, `sink` is NULL, or id or mask do not
+// fit an 11-bit ID or id has bits outside mask.
+bool can_routes_add(can_routes_t* table, uint32_t id, uint32_t mask, void* sink);
+
+// Returns the sink of the first route matching a standard frame, or NULL.
+void* can_routes_find(const can_routes_t* table, uint32_t id, bool ide);
+
+// Fills up to `max_filters` standard-ID filters that together accept every
+// routed ID and returns how many were used; 0 when there are no routes.
+size_t can_routes_build_filters(const can_routes_t* table, can_filter_t* filters, size_t max_filters);
+
+// Whether any of `count` filters accepts the frame. Extended frames never pass.
+bool can_filter_accepts(const can_filter_t* filters, size_t count, uint32_t id, bool ide);
+
+// Standard IDs a filter accepts, 1 to 2048.
+uint32_t can_filter_id_count(const can_filter_t* filter);
@@ -0,0 +1,71 @@
+#include "can_rx_ring.h"
+
+#include <string.h>
+
+bool can_rx_ring_init(can_rx_ring_t* ring, can_rx_frame_t* storage, size_t capacity) {
+  if (ring == NULL || storage == NULL || capacity < 2 || capacity > (1UL << 31) || (capacity & (capacity - 1)) != 0) {
+    return false;
+  }
+  memset(ring, 0, sizeof(*ring));
+  atomic_init(&ring->head, 0);
+  atomic_init(&ring->overruns, 0);
+  atomic_init(&ring->high_water, 0);
+  atomic_init(&ring->tail, 0);
+  ring->slots = storage;
+  ring->mask = (uint32_t)(capacity - 1);
+  return true;
+}
+
+bool can_rx_ring_push(can_rx_ring_t* ring, const can_rx_frame_t* frame) {
+  // Only this side writes head, so it needs no ordering against itself.
+  const uint32_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+  const uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+  const uint32_t used = head - tail;
+  if (used > ring->mask) {
+    atomic_store_explicit(&ring->overruns, atomic_load_explicit(&ring->overruns, memory_order_relaxed) + 1,
+                          memory_order_relaxed);
+    return false;
+  }
+
+  ring->slots[head & ring->mask] = *frame;
+  atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+  if (used + 1 > atomic_load_explicit(&ring->high_water, memory_order_relaxed)) {
+    atomic_store_explicit(&ring->high_water, used + 1, memory_order_relaxed);
+  }
+  return true;
+}
+
+bool can_rx_ring_full(const can_rx_ring_t* ring) {
+  const uint32_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+  const uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+  return head - tail > ring->mask;
+}
+
+bool can_rx_ring_pop(can_rx_ring_t* ring, can_rx_frame_t* frame) {
+  const uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+  const uint32_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+  if (head == tail) {
+    return false;
+  }
+  *frame = ring->slots[tail & ring->mask];
+  atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);
+  return true;
+}
+
+size_t can_rx_ring_count(const can_rx_ring_t* ring) {
+  const uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+  const uint32_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+  return head - tail;
+}
+
+void can_rx_ring_get_stats(const can_rx_ring_t* ring, can_rx_ring_stats_t* out) {
+  if (ring == NULL || out == NULL) {
+    return;
+  }
+  *out = (can_rx_ring_stats_t){
+      .pushed = atomic_load_explicit(&ring->head, memory_order_relaxed),
+      .overruns = atomic_load_explicit(&ring->overruns, memory_order_relaxed),
+      .high_water = atomic_load_explicit(&ring->high_water, memory_order_relaxed),
+      .capacity = ring->mask + 1,
+  };
+}
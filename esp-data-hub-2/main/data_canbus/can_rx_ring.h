@@ -0,0 +1,65 @@
+#pragma once
+
+#include <stdalign.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "can_types.h"
+
+// Single-producer/single-consumer ring of received CAN frames, filled by the
+// TWAI RX ISR and drained by the one task that owns the ring.
+//
+// head and tail are free-running 32-bit counters; a slot is counter & mask, so
+// the capacity must be a power of two and the ring is full when
+// head - tail == capacity. The producer publishes a frame by storing head with
+// release order after copying it in, and the consumer frees its slot by storing
+// tail the same way, so neither side takes a lock or calls into the kernel.
+// Fields written by each side sit on their own cache line.
+//
+// A frame that arrives while the ring is full is dropped and counted in
+// overruns; the frames already queued are kept.
+
+#define CAN_RX_RING_CACHE_LINE 64
+
+typedef struct {
+  uint32_t pushed;      // frames queued
+  uint32_t overruns;    // frames dropped because the ring was full
+  uint32_t high_water;  // most frames queued at once
+  uint32_t capacity;
+} can_rx_ring_stats_t;
+
+typedef struct {
+  // Written by the producer.
+  alignas(CAN_RX_RING_CACHE_LINE) atomic_uint_least32_t head;
+  atomic_uint_least32_t overruns;
+  atomic_uint_least32_t high_water;
+
+  // Written by the consumer.
+  alignas(CAN_RX_RING_CACHE_LINE) atomic_uint_least32_t tail;
+
+  // Set once by can_rx_ring_init().
+  alignas(CAN_RX_RING_CACHE_LINE) can_rx_frame_t* slots;
+  uint32_t mask;
+} can_rx_ring_t;
+
+// Uses `storage` for `capacity` frames. Returns false unless capacity is a
+// power of two of at least 2.
+bool can_rx_ring_init(can_rx_ring_t* ring, can_rx_frame_t* storage, size_t capacity);
+
+// Producer side. Returns false and counts an overrun when the ring is full.
+bool can_rx_ring_push(can_rx_ring_t* ring, const can_rx_frame_t* frame);
+
+// Producer side: whether a push now would fail. The consumer can only make
+// room meanwhile, so a push after a false answer succeeds.
+bool can_rx_ring_full(const can_rx_ring_t* ring);
+
+// Consumer side. Returns false when the ring is empty.
+bool can_rx_ring_pop(can_rx_ring_t* ring, can_rx_frame_t* frame);
+
+// Frames queued; exact only when called from the producer or consumer.
+size_t can_rx_ring_count(const can_rx_ring_t* ring);
+
+// Safe from any task; each counter is read on its own.
+void can_rx_ring_get_stats(const can_rx_ring_t* ring, can_rx_ring_stats_t* out);
@@ -0,0 +1,229 @@
+#include "can_trace.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+bool can_trace_init(can_trace_t* trace, can_trace_record_t* storage, size_t capacity) {
+  if (trace == NULL || storage == NULL || capacity == 0 || (capacity & (capacity - 1)) != 0 ||
+      capacity > UINT32_MAX / 2) {
+    return false;
+  }
+  trace->records = storage;
+  trace->mask = (uint32_t)capacity - 1U;
+  trace->written = 0;
+  trace->enabled = true;
+  return true;
+}
+
+void can_trace_record(can_trace_t* trace, uint64_t t_us, uint32_t id, uint8_t flags, const uint8_t* data,
+                      uint8_t dlc) {
+  if (!trace->enabled) {
+    return;
+  }
+  can_trace_record_t* record = &trace->records[trace->written & trace->mask];
+  record->t_us = t_us;
+  record->id = id;
+  record->flags = flags;
+  record->dlc = dlc > sizeof(record->data) ? sizeof(record->data) : dlc;
+  memcpy(record->data, data, record->dlc);
+  trace->written++;
+}
+
+void can_trace_clear(can_trace_t* trace) {
+  trace->written = 0;
+}
+
+size_t can_trace_count(const can_trace_t* trace) {
+  return trace->written > trace->mask ? (size_t)trace->mask + 1U : trace->written;
+}
+
+uint32_t can_trace_overwritten(const can_trace_t* trace) {
+  return trace->written - (uint32_t)can_trace_count(trace);
+}
+
+const can_trace_record_t* can_trace_get(const can_trace_t* trace, size_t index) {
+  if (index >= can_trace_count(trace)) {
+    return NULL;
+  }
+  return &trace->records[(can_trace_overwritten(trace) + (uint32_t)index) & trace->mask];
+}
+
+size_t can_trace_format_line(const can_trace_record_t* record, uint64_t t0_us, char* out, size_t out_len) {
+  if (record == NULL || out == NULL || out_len < CAN_TRACE_LINE_MAX) {
+    return 0;
+  }
+  // CANHacker writes milliseconds.
+  const uint64_t t_ms = (record->t_us - t0_us) / 1000U;
+  const uint8_t dlc = record->dlc > 8 ? 8 : record->dlc;
+  int len = (record->flags & CAN_TRACE_FLAG_IDE)
+                ? snprintf(out, out_len, "%" PRIu64 ".%03u %08X %u", t_ms / 1000U, (unsigned)(t_ms % 1000U),
+                           (unsigned)(record->id & 0x1FFFFFFFU), (unsigned)dlc)
+                : snprintf(out, out_len, "%" PRIu64 ".%03u %03X %u", t_ms / 1000U, (unsigned)(t_ms % 1000U),
+                           (unsigned)(record->id & 0x7FFU), (unsigned)dlc);
+  for (uint8_t i = 0; i < dlc; ++i) {
+    len += snprintf(out + len, out_len - (size_t)len, " %02X", record->data[i]);
+  }
+  out[len++] = '\n';
+  out[len] = '\0';
+  return (size_t)len;
+}
+
+static int hex_digit(char c) {
+  if (c >= '0' && c <= '9') {
+    return c - '0';
+  }
+  if (c >= 'A' && c <= 'F') {
+    return c - 'A' + 10;
+  }
+  if (c >= 'a' && c <= 'f') {
+    return c - 'a' + 10;
+  }
+  return -1;
+}
+
+static bool is_space(char c) {
+  return c == ' ' || c == '\t' || c == '\r';
+}
+
+// Reads one field of up to `max_digits` digits in `base`, then skips spaces.
+static bool read_field(const char** p, const char* end, unsigned base, size_t max_digits, uint64_t* value,
+                       size_t* digits) {
+  uint64_t v = 0;
+  size_t n = 0;
+  int d;
+  while (*p < end && (d = hex_digit(**p)) >= 0 && (unsigned)d < base) {
+    if (++n > max_digits) {
+      return false;
+    }
+    v = v * base + (uint64_t)d;
+    (*p)++;
+  }
+  if (n == 0 || (*p < end && !is_space(**p) && **p != '.')) {
+    return false;
+  }
+  *value = v;
+  if (digits != NULL) {
+    *digits = n;
+  }
+  return true;
+}
+
+static void skip_spaces(const char** p, const char* end) {
+  while (*p < end && is_space(**p)) {
+    (*p)++;
+  }
+}
+
+can_trace_line_t can_trace_parse_line(const char* line, size_t len, can_trace_record_t* out) {
+  const char* p = line;
+  const char* end = line + len;
+  skip_spaces(&p, end);
+  if (p == end) {
+    return CAN_TRACE_LINE_SKIPPED;
+  }
+  if (hex_digit(*p) < 0 || hex_digit(*p) > 9) {
+    // The header, or any other text line a capture tool adds.
+    return CAN_TRACE_LINE_SKIPPED;
+  }
+
+  // Time stamp: seconds, optionally with up to six decimals.
+  uint64_t seconds = 0;
+  uint64_t fraction = 0;
+  size_t fraction_digits = 0;
+  if (!read_field(&p, end, 10, 10, &seconds, NULL)) {
+    return CAN_TRACE_LINE_MALFORMED;
+  }
+  if (p < end && *p == '.') {
+    p++;
+    if (!read_field(&p, end, 10, 6, &fraction, &fraction_digits) || (p < end && *p == '.')) {
+      return CAN_TRACE_LINE_MALFORMED;
+    }
+  }
+  for (size_t i = fraction_digits; i < 6; ++i) {
+    fraction *= 10U;
+  }
+  skip_spaces(&p, end);
+
+  uint64_t id = 0;
+  size_t id_digits = 0;
+  uint64_t dlc = 0;
+  if (!read_field(&p, end, 16, 8, &id, &id_digits) || (p < end && *p == '.')) {
+    return CAN_TRACE_LINE_MALFORMED;
+  }
+  skip_spaces(&p, end);
+  if (!read_field(&p, end, 10, 1, &dlc, NULL) || dlc > 8 || (p < end && *p == '.')) {
+    return CAN_TRACE_LINE_MALFORMED;
+  }
+  const bool ide = id_digits > 3 || id > 0x7FFU;
+  if (id > 0x1FFFFFFFU) {
+    return CAN_TRACE_LINE_MALFORMED;
+  }
+
+  can_trace_record_t record = {
+      .t_us = seconds * 1000000U + fraction,
+      .id = (uint32_t)id,
+      .flags = ide ? CAN_TRACE_FLAG_IDE : 0,
+      .dlc = (uint8_t)dlc,
+  };
+  for (uint32_t i = 0; i < dlc; ++i) {
+    skip_spaces(&p, end);
+    uint64_t byte = 0;
+    if (!read_field(&p, end, 16, 2, &byte, NULL) || (p < end && *p == '.')) {
+      return CAN_TRACE_LINE_MALFORMED;
+    }
+    record.data[i] = (uint8_t)byte;
+  }
+  skip_spaces(&p, end);
+  if (p != end) {
+    return CAN_TRACE_LINE_MALFORMED;
+  }
+  if (out != NULL) {
+    *out = record;
+  }
+  return CAN_TRACE_LINE_FRAME;
+}
+
+void can_trace_replay_init(can_trace_replay_t* replay, const char* text, size_t len) {
+  memset(replay, 0, sizeof(*replay));
+  replay->text = text;
+  replay->len = text != NULL ? len : 0;
+}
+
+bool can_trace_replay_next(can_trace_replay_t* replay, can_trace_record_t* out, uint64_t* due_us) {
+  while (replay->pos < replay->len && replay->text[replay->pos] != '\0') {
+    const char* line = &replay->text[replay->pos];
+    size_t line_len = 0;
+    while (replay->pos + line_len < replay->len && line[line_len] != '\n' && line[line_len] != '\0') {
+      line_len++;
+    }
+    replay->pos += line_len;
+    if (replay->pos < replay->len && replay->text[replay->pos] == '\n') {
+      replay->pos++;
+    }
+
+    can_trace_record_t record;
+    const can_trace_line_t kind = can_trace_parse_line(line, line_len, &record);
+    if (kind == CAN_TRACE_LINE_MALFORMED) {
+      replay->malformed++;
+    }
+    if (kind != CAN_TRACE_LINE_FRAME) {
+      continue;
+    }
+    if (!replay->started || record.t_us < replay->origin_us + replay->due_us) {
+      // First frame, or time went backwards: this frame is due now.
+      replay->origin_us = record.t_us - replay->due_us;
+    }
+    replay->started = true;
+    replay->due_us = record.t_us - replay->origin_us;
+    replay->frames++;
+    if (out != NULL) {
+      *out = record;
+    }
+    if (due_us != NULL) {
+      *due_us = replay->due_us;
+    }
+    return true;
+  }
+  return false;
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// CAN frame capture and CANHacker .trc text, for reproducing a session at the
+// desk.
+//
+// The capture buffer keeps the newest `capacity` frames, overwriting the
+// oldest. It takes no lock itself: the caller serializes writers (the TWAI
+// callbacks and the replay task, see can_transport.c) and stops capture before
+// reading, so a reader never sees a record being written.
+//
+// A .trc line is "<seconds>.<ms> <ID> <DLC> <data bytes>" in hex, with
+// standard IDs as 3 digits and extended IDs as 8, as read by
+// scripts/subaru-decode/main.py. The format has no direction column, so
+// transmitted frames are dumped like received ones.
+
+#define CAN_TRACE_FLAG_TX 0x01U
+#define CAN_TRACE_FLAG_IDE 0x02U
+
+// Longest line can_trace_format_line() writes, with its newline and NUL: ten
+// digits of seconds, an extended ID and eight data bytes.
+#define CAN_TRACE_LINE_MAX 52U
+
+#define CAN_TRACE_HEADER "Time   ID     DLC Data\n"
+
+typedef struct {
+  uint64_t t_us;  // esp_timer when captured; after parsing, trace time
+  uint32_t id;
+  uint8_t flags;  // CAN_TRACE_FLAG_*
+  uint8_t dlc;    // 0-8
+  uint8_t data[8];
+} can_trace_record_t;
+
+typedef struct {
+  can_trace_record_t* records;
+  uint32_t mask;     // capacity - 1
+  uint32_t written;  // records ever written; the newest is written - 1
+  bool enabled;
+} can_trace_t;
+
+// `capacity` must be a power of two. Capture starts enabled.
+bool can_trace_init(can_trace_t* trace, can_trace_record_t* storage, size_t capacity);
+// Appends a frame unless capture is stopped. Writers serialized by the caller.
+void can_trace_record(can_trace_t* trace, uint64_t t_us, uint32_t id, uint8_t flags, const uint8_t* data,
+                      uint8_t dlc);
+void can_trace_clear(can_trace_t* trace);
+
+// Frames held, and frames overwritten since the last clear.
+size_t can_trace_count(const can_trace_t* trace);
+uint32_t can_trace_overwritten(const can_trace_t* trace);
+// The `index`th frame held, oldest first. Stop capture while reading.
+const can_trace_record_t* can_trace_get(const can_trace_t* trace, size_t index);
+
+// Writes `record` as one .trc line with its time relative to `t0_us`, and
+// returns its length (0 if `out_len` is under CAN_TRACE_LINE_MAX).
+size_t can_trace_format_line(const can_trace_record_t* record, uint64_t t0_us, char* out, size_t out_len);
+
+typedef enum {
+  CAN_TRACE_LINE_FRAME = 0,
+  CAN_TRACE_LINE_SKIPPED,    // blank line or header
+  CAN_TRACE_LINE_MALFORMED,  // not a frame, or more bytes than its DLC
+} can_trace_line_t;
+
+// Parses one .trc line of `len` characters, no newline needed. A frame's
+// t_us is its time stamp, up to ten digits of seconds, in microseconds and
+// flags carries only CAN_TRACE_FLAG_IDE.
+can_trace_line_t can_trace_parse_line(const char* line, size_t len, can_trace_record_t* out);
+
+// Walks the frames of a .trc text for replay. Due times are relative to the
+// first frame and never go backwards: a time stamp lower than the previous
+// one (a wrapped or concatenated capture) is due at once, and later frames
+// keep their spacing from it.
+typedef struct {
+  const char* text;
+  size_t len;
+  size_t pos;
+  bool started;
+  uint64_t origin_us;  // trace time that is due at 0
+  uint64_t due_us;
+  uint32_t frames;
+  uint32_t malformed;  // lines skipped as malformed
+} can_trace_replay_t;
+
+void can_trace_replay_init(can_trace_replay_t* replay, const char* text, size_t len);
+// Next frame and its due time; false at the end of the text (or a NUL).
+bool can_trace_replay_next(can_trace_replay_t* replay, can_trace_record_t* out, uint64_t* due_us);
@@ -1,34 +1,104 @@
 #include "can_transport.h"
 
+#include <inttypes.h>
+#include <stdatomic.h>
 #include <string.h>
 
+#include "can_routes.h"
+#include "can_trace.h"
 #include "can_types.h"
 #include "esp_err.h"
+#include "esp_heap_caps.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "freertos/queue.h"
+#include "isotp_codec.h"
+#include "soc/soc_caps.h"
 
 static const char* TAG = "can_transport";
 
+#ifdef SOC_TWAI_MASK_FILTER_NUM
+#define CAN_HW_FILTER_COUNT SOC_TWAI_MASK_FILTER_NUM
+#else
+#define CAN_HW_FILTER_COUNT 1
+#endif
+
 #define CAN_TX_SLOT_COUNT 9
 
 typedef struct {
-  twai_frame_t frame;
-  uint8_t data[8];
+  twai_frame_t frame;  // first, see can_transport_tx_done_callback()
+  uint8_t data[CAN_TX_SLOT_DATA_SIZE];
 } can_tx_slot_t;
 
+_Static_assert((CONFIG_DH_TWAI_RX_RING_SIZE & (CONFIG_DH_TWAI_RX_RING_SIZE - 1)) == 0,
+               "CONFIG_DH_TWAI_RX_RING_SIZE must be a power of two");
+
 static can_tx_slot_t s_tx_slots[CAN_TX_SLOT_COUNT];
+static uint32_t s_tx_submit_us[CAN_TX_SLOT_COUNT];  // esp_timer when each slot was queued
 static QueueHandle_t s_tx_free_slots;
 
+static twai_node_handle_t s_node;  // for flow control sent from the RX ISR
+
+static can_routes_t s_routes;
+static can_filter_t s_filters[CAN_HW_FILTER_COUNT];
+static size_t s_filter_count;
+// While set, the hardware filter is open and the ISR counts what the filters
+// would have rejected instead of routing.
+static volatile bool s_surveying;
+static uint32_t s_survey_ms;
+
+// Written only by the RX ISR.
+static atomic_uint_least32_t s_rx_receive_errors;
+static atomic_uint_least32_t s_rx_routed;
+static atomic_uint_least32_t s_rx_unrouted;
+static atomic_uint_least32_t s_survey_frames;
+static atomic_uint_least32_t s_survey_rejected;
+static atomic_uint_least32_t s_survey_bits;
+
+// Written only by the TWAI callbacks, or by the replay task in a replay build.
+static can_bus_stats_t s_bus_stats;
+
+#ifdef CONFIG_DH_CAN_TRACE
+_Static_assert((CONFIG_DH_CAN_TRACE_FRAMES & (CONFIG_DH_CAN_TRACE_FRAMES - 1)) == 0,
+               "CONFIG_DH_CAN_TRACE_FRAMES must be a power of two");
+
+// Frames captured for a .trc dump. The TWAI callbacks and the task side
+// (replayed frames, dump, clear) all take s_trace_lock.
+static can_trace_t s_trace;
+static bool s_trace_ready;
+static portMUX_TYPE s_trace_lock = portMUX_INITIALIZER_UNLOCKED;
+#endif
+
 bool can_transport_init(void) {
-  s_tx_free_slots = xQueueCreate(CAN_TX_SLOT_COUNT, sizeof(can_tx_slot_t*));
+  can_routes_init(&s_routes);
+  atomic_init(&s_rx_receive_errors, 0);
+  atomic_init(&s_rx_routed, 0);
+  atomic_init(&s_rx_unrouted, 0);
+  atomic_init(&s_survey_frames, 0);
+  atomic_init(&s_survey_rejected, 0);
+  atomic_init(&s_survey_bits, 0);
+  can_bus_stats_init(&s_bus_stats);
+
+#ifdef CONFIG_DH_CAN_TRACE
+  // PSRAM when the board has it, else internal RAM. The TWAI ISR is not
+  // cache-safe, so it never runs while PSRAM is unreachable.
+  can_trace_record_t* storage = heap_caps_malloc_prefer(CONFIG_DH_CAN_TRACE_FRAMES * sizeof(can_trace_record_t), 2,
+                                                        MALLOC_CAP_SPIRAM, MALLOC_CAP_8BIT);
+  s_trace_ready = storage != NULL && can_trace_init(&s_trace, storage, CONFIG_DH_CAN_TRACE_FRAMES);
+  if (!s_trace_ready) {
+    ESP_LOGW(TAG, "No memory for %d trace frames, CAN capture is off", CONFIG_DH_CAN_TRACE_FRAMES);
+  }
+#endif
+
+  // The free list holds slot indices, so a release is one byte queued.
+  s_tx_free_slots = xQueueCreate(CAN_TX_SLOT_COUNT, sizeof(uint8_t));
   if (s_tx_free_slots == NULL) {
     ESP_LOGE(TAG, "Failed to create TX frame pool");
     return false;
   }
 
-  for (size_t i = 0; i < CAN_TX_SLOT_COUNT; ++i) {
-    can_tx_slot_t* slot = &s_tx_slots[i];
-    if (xQueueSend(s_tx_free_slots, &slot, 0) != pdTRUE) {
+  for (uint8_t i = 0; i < CAN_TX_SLOT_COUNT; ++i) {
+    if (xQueueSend(s_tx_free_slots, &i, 0) != pdTRUE) {
       ESP_LOGE(TAG, "Failed to populate TX frame pool");
       vQueueDelete(s_tx_free_slots);
       s_tx_free_slots = NULL;
@@ -38,14 +108,122 @@ bool can_transport_init(void) {
   return true;
 }
 
-bool can_transport_rx_callback(twai_node_handle_t handle, const twai_rx_done_event_data_t* edata, void* user_ctx) {
-  (void)edata;
-  app_context_t* app = (app_context_t*)user_ctx;
-  BaseType_t high_task_woken = pdFALSE;
+static void count_from_isr(atomic_uint_least32_t* counter) {
+  atomic_store_explicit(counter, atomic_load_explicit(counter, memory_order_relaxed) + 1, memory_order_relaxed);
+}
+
+// Safe from the TWAI callbacks and from tasks. `t_us` is the low 32 bits of
+// esp_timer, taken moments ago; the capture keeps the full time.
+static void trace_frame(uint32_t t_us, uint32_t id, bool ide, bool tx, const uint8_t* data, uint8_t dlc) {
+#ifdef CONFIG_DH_CAN_TRACE
+  if (!s_trace_ready) {
+    return;
+  }
+  const uint64_t now_us = (uint64_t)esp_timer_get_time();
+  const uint64_t trace_us = now_us - (uint32_t)((uint32_t)now_us - t_us);
+  const uint8_t flags = (uint8_t)((tx ? CAN_TRACE_FLAG_TX : 0U) | (ide ? CAN_TRACE_FLAG_IDE : 0U));
+  portENTER_CRITICAL_SAFE(&s_trace_lock);
+  can_trace_record(&s_trace, trace_us, id, flags, data, dlc);
+  portEXIT_CRITICAL_SAFE(&s_trace_lock);
+#else
+  (void)t_us;
+  (void)id;
+  (void)ide;
+  (void)tx;
+  (void)data;
+  (void)dlc;
+#endif
+}
+
+// Fills in a slot's frame and queues it. The slot stays the caller's on failure.
+static esp_err_t queue_slot(twai_node_handle_t node, uint8_t index, uint16_t dest, size_t payload_len,
+                            int timeout_ms) {
+  can_tx_slot_t* slot = &s_tx_slots[index];
+  slot->frame = (twai_frame_t){
+      .header.id = dest,
+      .header.ide = false,
+      .buffer = slot->data,
+      .buffer_len = payload_len,
+  };
+  s_tx_submit_us[index] = (uint32_t)esp_timer_get_time();
+  return twai_node_transmit(node, &slot->frame, timeout_ms);
+}
+
+// Clear to send, no block limit, no separation time (ISO 15765-2 flow status 0).
+static const uint8_t k_flow_control_cts[3] = {ISOTP_FLOW_CONTROL_FRAME, 0x00, 0x00};
+
+// Answers a response first frame straight away, so the node need not wait
+// for the owning task to be scheduled. `high_task_woken` is NULL from a task.
+static bool send_flow_control(uint16_t dest, BaseType_t* high_task_woken) {
+  if (high_task_woken == NULL) {
+    can_tx_buffer_t tx;
+    if (!can_transport_tx_acquire(&tx, 0)) {
+      return false;
+    }
+    memcpy(tx.data, k_flow_control_cts, sizeof(k_flow_control_cts));
+    return can_transport_tx_submit(s_node, &tx, dest, sizeof(k_flow_control_cts));
+  }
+
+  uint8_t index;
+  if (s_tx_free_slots == NULL || s_node == NULL ||
+      xQueueReceiveFromISR(s_tx_free_slots, &index, high_task_woken) != pdTRUE) {
+    return false;
+  }
+  memcpy(s_tx_slots[index].data, k_flow_control_cts, sizeof(k_flow_control_cts));
+  if (queue_slot(s_node, index, dest, sizeof(k_flow_control_cts), 0) != ESP_OK) {
+    xQueueSendFromISR(s_tx_free_slots, &index, high_task_woken);
+    return false;
+  }
+  return true;
+}
+
+// Counts, captures and routes one received frame. Called by the RX ISR, or by
+// the replay task while the node is off, so each sink ring still has one
+// producer. `high_task_woken` is NULL from a task. Returns false only when the
+// sink's ring is full.
+static bool deliver_frame(const can_rx_frame_t* frame, BaseType_t* high_task_woken) {
+  can_bus_stats_record_frame(&s_bus_stats, frame->id, frame->ide, false, frame->data_len);
+  trace_frame(frame->rx_us, frame->id, frame->ide, false, frame->data, frame->data_len);
 
-  if (app == NULL || app->can_rx_queue == NULL) {
+  can_rx_sink_t* sink = can_routes_find(&s_routes, frame->id, frame->ide);
+  if (sink == NULL) {
+    count_from_isr(&s_rx_unrouted);
+    return true;
+  }
+  if (sink->fc_tx_id != 0 && frame->data_len > 0 && (frame->data[0] & 0xF0) == ISOTP_FIRST_FRAME &&
+      atomic_load_explicit(&sink->fc_armed, memory_order_acquire)) {
+    // Only tell the node to stream consecutive frames for an exchange that
+    // is waiting and will see this first frame.
+    can_rx_frame_t first = *frame;
+    if (!can_rx_ring_full(&sink->ring) && send_flow_control(sink->fc_tx_id, high_task_woken)) {
+      atomic_store_explicit(&sink->fc_armed, false, memory_order_relaxed);
+      first.flags |= CAN_RX_FLAG_FC_SENT;
+    }
+    if (!can_rx_ring_push(&sink->ring, &first)) {
+      return false;
+    }
+  } else if (!can_rx_ring_push(&sink->ring, frame)) {
     return false;
   }
+  count_from_isr(&s_rx_routed);
+
+  // The notification is the only kernel call here: it bumps a counter on the
+  // owning task's TCB, which stays pending if the task is busy.
+  TaskHandle_t task = sink->task;
+  if (task != NULL) {
+    if (high_task_woken != NULL) {
+      vTaskNotifyGiveFromISR(task, high_task_woken);
+    } else {
+      xTaskNotifyGive(task);
+    }
+  }
+  return true;
+}
+
+bool can_transport_rx_callback(twai_node_handle_t handle, const twai_rx_done_event_data_t* edata, void* user_ctx) {
+  (void)edata;
+  (void)user_ctx;
+  BaseType_t high_task_woken = pdFALSE;
 
   uint8_t rx_buf[8] = {0};
   twai_frame_t rx_frame = {
@@ -53,26 +231,283 @@ bool can_transport_rx_callback(twai_node_handle_t handle, const twai_rx_done_eve
       .buffer_len = sizeof(rx_buf),
   };
   if (twai_node_receive_from_isr(handle, &rx_frame) != ESP_OK) {
-    // TODO some mechanism of reporting errors/dropped frames
+    count_from_isr(&s_rx_receive_errors);
     return false;
   }
 
-  if (rx_frame.header.id != ECU_RES_ID && rx_frame.header.id != VDC_RES_ID) {
-    // not an id we care about
+  if (s_surveying) {
+    count_from_isr(&s_survey_frames);
+    atomic_store_explicit(&s_survey_bits,
+                          atomic_load_explicit(&s_survey_bits, memory_order_relaxed) +
+                              can_bus_frame_bits(rx_frame.header.dlc, rx_frame.header.ide),
+                          memory_order_relaxed);
+    if (!can_filter_accepts(s_filters, s_filter_count, rx_frame.header.id, rx_frame.header.ide)) {
+      count_from_isr(&s_survey_rejected);
+    }
     return false;
   }
 
   can_rx_frame_t out = {
       .id = rx_frame.header.id,
       .ide = rx_frame.header.ide,
-      .data_len = rx_frame.header.dlc,
+      .data_len = rx_frame.header.dlc > sizeof(rx_buf) ? sizeof(rx_buf) : rx_frame.header.dlc,
+      .rx_us = (uint32_t)esp_timer_get_time(),
   };
   memcpy(out.data, rx_buf, out.data_len);
-  xQueueSendFromISR(app->can_rx_queue, &out, &high_task_woken);
-
+  deliver_frame(&out, &high_task_woken);
   return (high_task_woken == pdTRUE);
 }
 
+#ifdef CONFIG_DH_CAN_REPLAY
+bool can_transport_inject_frame(const can_rx_frame_t* frame) {
+  if (frame == NULL) {
+    return false;
+  }
+  can_rx_frame_t out = *frame;
+  out.rx_us = (uint32_t)esp_timer_get_time();
+  return deliver_frame(&out, NULL);
+}
+#endif
+
+bool can_transport_error_callback(twai_node_handle_t handle, const twai_error_event_data_t* edata, void* user_ctx) {
+  (void)handle;
+  (void)user_ctx;
+  if (edata != NULL) {
+    can_bus_stats_record_error(&s_bus_stats, edata->err_flags.val);
+  }
+  return false;
+}
+
+bool can_transport_state_callback(twai_node_handle_t handle, const twai_state_change_event_data_t* edata,
+                                  void* user_ctx) {
+  (void)handle;
+  (void)user_ctx;
+  if (edata != NULL) {
+    can_bus_stats_record_state(&s_bus_stats, (uint32_t)(esp_timer_get_time() / 1000), (can_bus_state_t)edata->old_sta,
+                               (can_bus_state_t)edata->new_sta);
+  }
+  return false;
+}
+
+bool can_transport_register(uint32_t id, uint32_t mask, can_rx_sink_t* sink) {
+  if (sink == NULL || !can_routes_add(&s_routes, id, mask, sink)) {
+    ESP_LOGE(TAG, "Failed to register RX route 0x%03" PRIX32 "/0x%03" PRIX32, id, mask);
+    return false;
+  }
+  return true;
+}
+
+static bool apply_filters(twai_node_handle_t node) {
+  for (size_t i = 0; i < s_filter_count; ++i) {
+    const twai_mask_filter_config_t cfg = {
+        .id = s_filters[i].id,
+        .mask = s_filters[i].mask,
+        .is_ext = false,
+    };
+    esp_err_t err = twai_node_config_mask_filter(node, (uint8_t)i, &cfg);
+    if (err != ESP_OK) {
+      ESP_LOGW(TAG, "acceptance filter %u failed: %s", (unsigned)i, esp_err_to_name(err));
+      // Filters are OR-ed, so opening the first one accepts everything again.
+      const twai_mask_filter_config_t open = {.id = 0, .mask = 0, .is_ext = false};
+      twai_node_config_mask_filter(node, 0, &open);
+      return false;
+    }
+    ESP_LOGI(TAG, "acceptance filter %u: id 0x%03" PRIX32 " mask 0x%03" PRIX32 " (%" PRIu32 " IDs)", (unsigned)i,
+             s_filters[i].id, s_filters[i].mask, can_filter_id_count(&s_filters[i]));
+  }
+  return true;
+}
+
+bool can_transport_start(twai_node_handle_t node) {
+  s_node = node;
+#ifdef CONFIG_DH_CAN_REPLAY
+  // The replay task stands in for the bus.
+  (void)node;
+  ESP_LOGW(TAG, "CAN replay build: the TWAI node stays off");
+  return true;
+#endif
+
+#ifdef CONFIG_DH_TWAI_HW_FILTER
+  s_filter_count = can_routes_build_filters(&s_routes, s_filters, CAN_HW_FILTER_COUNT);
+  if (s_filter_count > 0 && CONFIG_DH_TWAI_FILTER_SURVEY_MS > 0) {
+    // Hardware does not count the frames it rejects, so sample the open bus
+    // once and estimate the rate from what the filters would have dropped.
+    s_surveying = true;
+    esp_err_t err = twai_node_enable(node);
+    if (err == ESP_OK) {
+      vTaskDelay(pdMS_TO_TICKS(CONFIG_DH_TWAI_FILTER_SURVEY_MS));
+      err = twai_node_disable(node);
+    }
+    s_surveying = false;
+    if (err != ESP_OK) {
+      ESP_LOGW(TAG, "RX filter survey failed: %s", esp_err_to_name(err));
+      return false;
+    }
+    s_survey_ms = CONFIG_DH_TWAI_FILTER_SURVEY_MS;
+  }
+  if (s_filter_count > 0 && !apply_filters(node)) {
+    // Software routing still drops everything unclaimed.
+    s_filter_count = 0;
+  }
+#endif
+
+  esp_err_t err = twai_node_enable(node);
+  if (err != ESP_OK) {
+    ESP_LOGE(TAG, "twai_node_enable failed: %s", esp_err_to_name(err));
+    return false;
+  }
+  return true;
+}
+
+void can_transport_get_rx_stats(can_transport_rx_stats_t* out) {
+  if (out == NULL) {
+    return;
+  }
+  *out = (can_transport_rx_stats_t){
+      .receive_errors = atomic_load_explicit(&s_rx_receive_errors, memory_order_relaxed),
+      .routed = atomic_load_explicit(&s_rx_routed, memory_order_relaxed),
+      .unrouted = atomic_load_explicit(&s_rx_unrouted, memory_order_relaxed),
+      .hw_filters = (uint32_t)s_filter_count,
+      .survey_ms = s_survey_ms,
+      .survey_frames = atomic_load_explicit(&s_survey_frames, memory_order_relaxed),
+      .survey_hw_rejected = atomic_load_explicit(&s_survey_rejected, memory_order_relaxed),
+      .survey_bits = atomic_load_explicit(&s_survey_bits, memory_order_relaxed),
+  };
+}
+
+void can_transport_sample_bus_stats(can_bus_sample_t* out) {
+  can_bus_stats_sample(&s_bus_stats, out);
+}
+
+#ifdef CONFIG_DH_CAN_TRACE
+void can_transport_get_trace_stats(can_transport_trace_stats_t* out) {
+  if (out == NULL) {
+    return;
+  }
+  *out = (can_transport_trace_stats_t){0};
+  if (!s_trace_ready) {
+    return;
+  }
+  portENTER_CRITICAL_SAFE(&s_trace_lock);
+  out->capacity = s_trace.mask + 1U;
+  out->frames = (uint32_t)can_trace_count(&s_trace);
+  out->overwritten = can_trace_overwritten(&s_trace);
+  out->enabled = s_trace.enabled;
+  portEXIT_CRITICAL_SAFE(&s_trace_lock);
+}
+
+bool can_transport_trace_set_enabled(bool enabled) {
+  if (!s_trace_ready) {
+    return false;
+  }
+  portENTER_CRITICAL_SAFE(&s_trace_lock);
+  const bool was_enabled = s_trace.enabled;
+  s_trace.enabled = enabled;
+  portEXIT_CRITICAL_SAFE(&s_trace_lock);
+  return was_enabled;
+}
+
+void can_transport_trace_clear(void) {
+  if (s_trace_ready) {
+    portENTER_CRITICAL_SAFE(&s_trace_lock);
+    can_trace_clear(&s_trace);
+    portEXIT_CRITICAL_SAFE(&s_trace_lock);
+  }
+}
+
+size_t can_transport_trace_dump(can_transport_trace_write_t write, void* ctx) {
+  if (!s_trace_ready || write == NULL) {
+    return 0;
+  }
+  // Stopped capture has no writer, so the records can be read without the lock.
+  const bool was_enabled = can_transport_trace_set_enabled(false);
+  const size_t count = can_trace_count(&s_trace);
+  write(CAN_TRACE_HEADER, sizeof(CAN_TRACE_HEADER) - 1, ctx);
+  char line[CAN_TRACE_LINE_MAX];
+  for (size_t i = 0; i < count; ++i) {
+    const size_t len = can_trace_format_line(can_trace_get(&s_trace, i), can_trace_get(&s_trace, 0)->t_us, line,
+                                             sizeof(line));
+    write(line, len, ctx);
+  }
+  can_transport_trace_set_enabled(was_enabled);
+  return count;
+}
+#endif
+
+bool can_transport_sink_init(can_rx_sink_t* sink, const char* name) {
+  if (sink == NULL) {
+    return false;
+  }
+  memset(sink, 0, sizeof(*sink));
+  sink->name = name;
+  sink->latency_min_us = UINT32_MAX;
+  return can_rx_ring_init(&sink->ring, sink->frames, CONFIG_DH_TWAI_RX_RING_SIZE);
+}
+
+void can_transport_sink_auto_flow_control(can_rx_sink_t* sink, uint16_t tx_id) {
+  if (sink != NULL) {
+    sink->fc_tx_id = tx_id;
+  }
+}
+
+void can_transport_sink_arm_flow_control(can_rx_sink_t* sink, bool armed) {
+  if (sink != NULL) {
+    atomic_store_explicit(&sink->fc_armed, armed, memory_order_release);
+  }
+}
+
+void can_transport_sink_attach(can_rx_sink_t* sink) {
+  if (sink != NULL) {
+    sink->task = xTaskGetCurrentTaskHandle();
+  }
+}
+
+static void record_latency(can_rx_sink_t* sink, const can_rx_frame_t* frame) {
+  const int32_t latency = (int32_t)((uint32_t)esp_timer_get_time() - frame->rx_us);
+  const uint32_t latency_us = latency > 0 ? (uint32_t)latency : 0;
+  if (latency_us < sink->latency_min_us) {
+    sink->latency_min_us = latency_us;
+  }
+  if (latency_us > sink->latency_max_us) {
+    sink->latency_max_us = latency_us;
+  }
+  // avg += (latency - avg) / 16, starting at the first latency.
+  if (sink->received == 0) {
+    sink->latency_avg_q4 = latency_us << 4;
+  } else {
+    sink->latency_avg_q4 = sink->latency_avg_q4 + latency_us - (sink->latency_avg_q4 >> 4);
+  }
+  sink->latency_avg_us = sink->latency_avg_q4 >> 4;
+  sink->received++;
+}
+
+bool can_transport_sink_receive(can_rx_sink_t* sink, can_rx_frame_t* frame, TickType_t timeout) {
+  if (sink == NULL || frame == NULL) {
+    return false;
+  }
+  TimeOut_t start;
+  vTaskSetTimeOutState(&start);
+  while (!can_rx_ring_pop(&sink->ring, frame)) {
+    // A notification left over from a frame already taken only costs one more
+    // pass; one given after the pop above is never lost.
+    if (xTaskCheckForTimeOut(&start, &timeout) == pdTRUE) {
+      return false;
+    }
+    ulTaskNotifyTake(pdTRUE, timeout);
+  }
+  record_latency(sink, frame);
+  return true;
+}
+
+size_t can_transport_sink_flush(can_rx_sink_t* sink) {
+  can_rx_frame_t frame;
+  size_t dropped = 0;
+  while (sink != NULL && can_rx_ring_pop(&sink->ring, &frame)) {
+    dropped++;
+  }
+  return dropped;
+}
+
 bool can_transport_tx_done_callback(twai_node_handle_t handle, const twai_tx_done_event_data_t* edata, void* user_ctx) {
   (void)handle;
   (void)user_ctx;
@@ -82,40 +517,78 @@ bool can_transport_tx_done_callback(twai_node_handle_t handle, const twai_tx_don
     return false;
   }
 
-  for (size_t i = 0; i < CAN_TX_SLOT_COUNT; ++i) {
-    can_tx_slot_t* slot = &s_tx_slots[i];
-    if (edata->done_tx_frame == &slot->frame) {
-      xQueueSendFromISR(s_tx_free_slots, &slot, &high_task_woken);
-      return high_task_woken == pdTRUE;
-    }
+  // The frame is the first member of its slot, so its address gives the index.
+  const uintptr_t offset = (uintptr_t)edata->done_tx_frame - (uintptr_t)&s_tx_slots[0].frame;
+  if (offset % sizeof(can_tx_slot_t) != 0 || offset / sizeof(can_tx_slot_t) >= CAN_TX_SLOT_COUNT) {
+    return false;
   }
-  return false;
+  const uint8_t index = (uint8_t)(offset / sizeof(can_tx_slot_t));
+  const can_tx_slot_t* slot = &s_tx_slots[index];
+  can_bus_stats_record_tx_done(&s_bus_stats, edata->is_tx_success,
+                               (uint32_t)esp_timer_get_time() - s_tx_submit_us[index]);
+  if (edata->is_tx_success) {
+    can_bus_stats_record_frame(&s_bus_stats, slot->frame.header.id, slot->frame.header.ide, true,
+                               (uint8_t)slot->frame.buffer_len);
+    trace_frame((uint32_t)esp_timer_get_time(), slot->frame.header.id, slot->frame.header.ide, true, slot->data,
+                (uint8_t)slot->frame.buffer_len);
+  }
+  xQueueSendFromISR(s_tx_free_slots, &index, &high_task_woken);
+  return high_task_woken == pdTRUE;
 }
 
-bool can_transport_transmit_frame(twai_node_handle_t node_hdl, uint16_t dest, const uint8_t* buffer, size_t payload_len) {
-  if (s_tx_free_slots == NULL || buffer == NULL || payload_len > sizeof(s_tx_slots[0].data)) {
-    ESP_LOGW(TAG, "Invalid or uninitialized TX frame request");
+bool can_transport_tx_acquire(can_tx_buffer_t* out, TickType_t timeout) {
+  uint8_t index;
+  if (s_tx_free_slots == NULL || out == NULL || xQueueReceive(s_tx_free_slots, &index, timeout) != pdTRUE) {
     return false;
   }
+  *out = (can_tx_buffer_t){.index = index, .data = s_tx_slots[index].data};
+  return true;
+}
 
-  can_tx_slot_t* slot = NULL;
-  if (xQueueReceive(s_tx_free_slots, &slot, pdMS_TO_TICKS(100)) != pdTRUE) {
-    ESP_LOGW(TAG, "No persistent TX frame slots available");
+void can_transport_tx_release(const can_tx_buffer_t* buffer) {
+  if (buffer != NULL && buffer->index < CAN_TX_SLOT_COUNT) {
+    xQueueSend(s_tx_free_slots, &buffer->index, 0);
+  }
+}
+
+bool can_transport_tx_submit(twai_node_handle_t node_hdl, const can_tx_buffer_t* buffer, uint16_t dest,
+                             size_t payload_len) {
+  if (buffer == NULL || buffer->index >= CAN_TX_SLOT_COUNT) {
+    return false;
+  }
+  if (payload_len > CAN_TX_SLOT_DATA_SIZE) {
+    can_transport_tx_release(buffer);
     return false;
   }
 
-  memcpy(slot->data, buffer, payload_len);
-  slot->frame = (twai_frame_t){
-      .header.id = dest,
-      .header.ide = false,
-      .buffer = slot->data,
-      .buffer_len = payload_len,
-  };
-  esp_err_t err = twai_node_transmit(node_hdl, &slot->frame, 100);
+#ifdef CONFIG_DH_CAN_REPLAY
+  // Nothing goes on the wire: capture the frame and free the slot at once.
+  // The bus counters are left alone, since several tasks submit.
+  (void)node_hdl;
+  trace_frame((uint32_t)esp_timer_get_time(), dest, false, true, buffer->data, (uint8_t)payload_len);
+  can_transport_tx_release(buffer);
+  return true;
+#endif
+  esp_err_t err = queue_slot(node_hdl, buffer->index, dest, payload_len, 100);
   if (err != ESP_OK) {
     ESP_LOGW(TAG, "transmit to 0x%03X failed: %s", dest, esp_err_to_name(err));
-    xQueueSend(s_tx_free_slots, &slot, 0);
+    can_transport_tx_release(buffer);
     return false;
   }
   return true;
 }
+
+bool can_transport_transmit_frame(twai_node_handle_t node_hdl, uint16_t dest, const uint8_t* buffer, size_t payload_len) {
+  if (buffer == NULL || payload_len > CAN_TX_SLOT_DATA_SIZE) {
+    ESP_LOGW(TAG, "Invalid TX frame request");
+    return false;
+  }
+
+  can_tx_buffer_t tx;
+  if (!can_transport_tx_acquire(&tx, pdMS_TO_TICKS(100))) {
+    ESP_LOGW(TAG, "No persistent TX frame slots available");
+    return false;
+  }
+  memcpy(tx.data, buffer, payload_len);
+  return can_transport_tx_submit(node_hdl, &tx, dest, payload_len);
+}
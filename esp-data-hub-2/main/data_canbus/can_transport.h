@@ -3,12 +3,145 @@
 #include <stddef.h>
 #include <stdint.h>
 
-#include "app_context.h"
+#include "can_bus_stats.h"
+#include "can_rx_ring.h"
+#include "can_types.h"
 #include "esp_twai.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "sdkconfig.h"
+
+// Received frames go straight from the TWAI RX ISR to the session that owns
+// their ID. Each session owns a sink: a lock-free ring (can_rx_ring.h) of
+// CONFIG_DH_TWAI_RX_RING_SIZE frames plus the task the ISR notifies after
+// each frame. Frames matching no registered route are counted and dropped.
+typedef struct {
+  can_rx_ring_t ring;
+  can_rx_frame_t frames[CONFIG_DH_TWAI_RX_RING_SIZE];
+  const char* name;
+  TaskHandle_t volatile task;
+  uint16_t fc_tx_id;  // 0, or where the ISR sends flow control; see below
+  atomic_bool fc_armed;  // the owner awaits a response; see below
+
+  // ISR-to-task latency of frames taken by can_transport_sink_receive(),
+  // written by the owning task.
+  uint32_t received;
+  uint32_t latency_min_us;
+  uint32_t latency_avg_us;  // smoothed, avg += (latency - avg) / 16
+  uint32_t latency_max_us;
+  uint32_t latency_avg_q4;  // latency_avg_us * 16, private
+} can_rx_sink_t;
+
+typedef struct {
+  uint32_t receive_errors;  // twai_node_receive_from_isr() failures
+  uint32_t routed;          // frames queued to a sink
+  uint32_t unrouted;        // frames past the hardware filter that no route claims
+  uint32_t hw_filters;      // acceptance filters in use; 0 = hardware accepts everything
+
+  // Startup survey of the open bus: frames seen and how many the acceptance
+  // filters would have rejected, over survey_ms (0 = no survey).
+  uint32_t survey_ms;
+  uint32_t survey_frames;
+  uint32_t survey_hw_rejected;
+  uint32_t survey_bits;  // worst-case wire bits of survey_frames
+} can_transport_rx_stats_t;
 
 // The TWAI driver queues frame pointers rather than copying frames. Initialize
 // the persistent TX frame pool before submitting any frames.
 bool can_transport_init(void);
 bool can_transport_rx_callback(twai_node_handle_t handle, const twai_rx_done_event_data_t* edata, void* user_ctx);
+// Count error frames and error-state changes for the bus statistics.
+bool can_transport_error_callback(twai_node_handle_t handle, const twai_error_event_data_t* edata, void* user_ctx);
+bool can_transport_state_callback(twai_node_handle_t handle, const twai_state_change_event_data_t* edata,
+                                  void* user_ctx);
+
+#ifdef CONFIG_DH_CAN_REPLAY
+// Replay builds never enable the node: the replay task feeds recorded frames
+// through the same counting, capture and routing as the RX ISR, and submitted
+// frames are captured and dropped. Returns false, queuing nothing, when the
+// frame's sink is full. One task only.
+bool can_transport_inject_frame(const can_rx_frame_t* frame);
+#endif
+
+// Routes standard IDs with (id & mask) == `id` to `sink`; see can_routes.h.
+// Register every route after can_transport_init() and before
+// can_transport_start().
+bool can_transport_register(uint32_t id, uint32_t mask, can_rx_sink_t* sink);
+
+// Programs the TWAI acceptance filters from the registered routes and enables
+// the node. With CONFIG_DH_TWAI_FILTER_SURVEY_MS > 0 the node first listens
+// with the filters open for that long, to estimate how much traffic they
+// reject. If the filters cannot be set, the node accepts everything and
+// routing alone drops unclaimed frames. Needs the RX callback registered.
+bool can_transport_start(twai_node_handle_t node);
+void can_transport_get_rx_stats(can_transport_rx_stats_t* out);
+// Samples the bus counters (can_bus_stats.h): every frame received past the
+// acceptance filter and every frame sent. One task only, since sampling
+// resets the per-window maximum and drains the state changes.
+void can_transport_sample_bus_stats(can_bus_sample_t* out);
+
+#ifdef CONFIG_DH_CAN_TRACE
+// Capture of every frame received past the acceptance filter and every frame
+// sent, newest CONFIG_DH_CAN_TRACE_FRAMES kept; see can_trace.h. Capture
+// starts at can_transport_init().
+typedef struct {
+  uint32_t capacity;  // 0 when the buffer could not be allocated
+  uint32_t frames;
+  uint32_t overwritten;
+  bool enabled;
+} can_transport_trace_stats_t;
+
+typedef void (*can_transport_trace_write_t)(const char* text, size_t len, void* ctx);
+
+void can_transport_get_trace_stats(can_transport_trace_stats_t* out);
+// Starts or stops capture and returns whether it was on.
+bool can_transport_trace_set_enabled(bool enabled);
+void can_transport_trace_clear(void);
+// Writes the capture as .trc text, header first, one `write` call per line,
+// with times relative to the oldest frame. Capture stops meanwhile. Returns
+// the frames written.
+size_t can_transport_trace_dump(can_transport_trace_write_t write, void* ctx);
+#endif
+
+bool can_transport_sink_init(can_rx_sink_t* sink, const char* name);
+// Has the RX ISR answer an ISO-TP first frame routed to `sink` with a
+// clear-to-send flow control to `tx_id` before queuing the frame, which then
+// carries CAN_RX_FLAG_FC_SENT. The ISR only does so while the sink is armed
+// and its ring has room for the frame, and disarms it once it has; otherwise
+// the flag stays clear and the owner sends the flow control itself, if it
+// wants the response. Call before can_transport_start().
+void can_transport_sink_auto_flow_control(can_rx_sink_t* sink, uint16_t tx_id);
+// Arms the sink's ISR flow control while the owner waits for a response
+// first frame, and disarms it otherwise. Owning task only.
+void can_transport_sink_arm_flow_control(can_rx_sink_t* sink, bool armed);
+// Makes the calling task the one notified of new frames. Call once from the
+// owning task before it first receives.
+void can_transport_sink_attach(can_rx_sink_t* sink);
+// Takes the oldest frame, blocking up to `timeout` for one. Owning task only.
+bool can_transport_sink_receive(can_rx_sink_t* sink, can_rx_frame_t* frame, TickType_t timeout);
+// Drops every queued frame and returns how many. Owning task only.
+size_t can_transport_sink_flush(can_rx_sink_t* sink);
+
+#define CAN_TX_SLOT_DATA_SIZE 8U
+
+// A TX slot's payload buffer, filled in place between acquire and submit. The
+// driver reads it until the frame is sent, so it belongs to the transport
+// after submit.
+typedef struct {
+  uint8_t index;
+  uint8_t* data;  // CAN_TX_SLOT_DATA_SIZE bytes
+} can_tx_buffer_t;
+
 bool can_transport_tx_done_callback(twai_node_handle_t handle, const twai_tx_done_event_data_t* edata, void* user_ctx);
+
+// Takes a free TX slot, waiting up to `timeout` for one.
+bool can_transport_tx_acquire(can_tx_buffer_t* out, TickType_t timeout);
+// Queues the first `payload_len` bytes of the slot to `dest`. The slot is
+// released when the frame is sent, or at once if it cannot be queued.
+bool can_transport_tx_submit(twai_node_handle_t node_hdl, const can_tx_buffer_t* buffer, uint16_t dest,
+                             size_t payload_len);
+// Returns an acquired slot that will not be submitted.
+void can_transport_tx_release(const can_tx_buffer_t* buffer);
+
+// Copies `buffer` into a slot and submits it.
 bool can_transport_transmit_frame(twai_node_handle_t node_hdl, uint16_t dest, const uint8_t* buffer, size_t payload_len);
@@ -9,9 +9,16 @@
 #define VDC_REQ_ID 0x7B0
 #define VDC_RES_ID 0x7B8
 
+#define CAN_BUS_BITRATE 500000U
+
+// The RX ISR already answered this ISO-TP first frame with a flow control.
+#define CAN_RX_FLAG_FC_SENT 0x01U
+
 typedef struct {
   uint32_t id;
   bool ide;
   uint8_t data[8];
   uint8_t data_len;
+  uint8_t flags;   // CAN_RX_FLAG_*
+  uint32_t rx_us;  // low 32 bits of esp_timer when the RX ISR read the frame
 } can_rx_frame_t;
@@ -1,69 +1,160 @@
 #include "isotp.h"
 
-#include "can_transport.h"
+#include <string.h>
+
 #include "esp_log.h"
-#include "esp_rom_sys.h"
 #include "freertos/task.h"
+#include "sdkconfig.h"
 
-void isotp_wait_stmin(uint8_t stmin_raw) {
-  if (stmin_raw <= 0x7F) {
-    if (stmin_raw == 0) {
-      return;
-    }
+static const char* TAG = "isotp";
 
-    TickType_t ticks = pdMS_TO_TICKS(stmin_raw);
-    if (ticks > 0) {
-      vTaskDelay(ticks);
-    } else {
-      esp_rom_delay_us((uint32_t)stmin_raw * 1000U);
-    }
-    return;
+#define ISOTP_FC_TIMEOUT_MS 1000
+#define ISOTP_RESPONSE_TIMEOUT_MS 200
+#define ISOTP_CF_TIMEOUT_MS 200
+#define ISOTP_FC_WAIT_MAX 10
+// A consecutive frame that finds no free TX slot is retried each tick, this
+// many times.
+#define ISOTP_TX_RETRIES 10
+
+static isotp_session_t* s_sessions[ISOTP_MAX_SESSIONS];
+static size_t s_session_count;
+static TaskHandle_t volatile s_engine_task;
+
+// The engine must not block, so it takes a TX slot only if one is free.
+static bool send_frame(void* ctx, uint32_t id, const uint8_t* data, uint8_t len) {
+  can_tx_buffer_t tx;
+  if (!can_transport_tx_acquire(&tx, 0)) {
+    return false;
   }
+  memcpy(tx.data, data, len);
+  return can_transport_tx_submit((twai_node_handle_t)ctx, &tx, (uint16_t)id, len);
+}
 
-  // ISO-TP sub-ms STmin encoding: 0xF1..0xF9 => 100..900us
-  if (stmin_raw >= 0xF1 && stmin_raw <= 0xF9) {
-    esp_rom_delay_us((uint32_t)(stmin_raw - 0xF0U) * 100U);
+bool isotp_session_init(isotp_session_t* session, const char* name, twai_node_handle_t node_hdl, uint32_t tx_id,
+                        can_rx_sink_t* rx) {
+  if (session == NULL || rx == NULL || s_session_count >= ISOTP_MAX_SESSIONS) {
+    return false;
   }
+  memset(session, 0, sizeof(*session));
+  session->name = name;
+  session->rx = rx;
+  session->done = xSemaphoreCreateBinary();
+  if (session->done == NULL) {
+    return false;
+  }
+  atomic_init(&session->submitted, false);
+  atomic_init(&session->busy, false);
+
+  const isotp_channel_config_t config = {
+      .tx_id = tx_id,
+      .send = send_frame,
+      .send_ctx = node_hdl,
+      .rx_buffer = session->response,
+      .rx_capacity = sizeof(session->response),
+      .fc_timeout_us = ISOTP_FC_TIMEOUT_MS * 1000U,
+      .response_timeout_us = ISOTP_RESPONSE_TIMEOUT_MS * 1000U,
+      .cf_timeout_us = ISOTP_CF_TIMEOUT_MS * 1000U,
+      .cf_gap_us = CONFIG_DH_TWAI_ISOTP_CF_GAP_US,
+      .tx_retry_us = portTICK_PERIOD_MS * 1000U,
+      .tx_retries = ISOTP_TX_RETRIES,
+      .fc_wait_max = ISOTP_FC_WAIT_MAX,
+  };
+  isotp_channel_init(&session->channel, &config);
+  s_sessions[s_session_count++] = session;
+  return true;
 }
 
-bool isotp_wait_for_fc(QueueHandle_t queue, TickType_t timeout, uint8_t* out_bs, uint8_t* out_stmin, const char* tag) {
-  can_rx_frame_t frame = {0};
-  while (1) {
-    if (xQueueReceive(queue, &frame, timeout) != pdTRUE) {
-      ESP_LOGW(tag, "Didn't receive FC frame from ECU");
-      return false;
-    }
+bool isotp_session_submit(isotp_session_t* session, const uint8_t (*frames)[8], size_t frame_count) {
+  TaskHandle_t engine = s_engine_task;
+  if (session == NULL || frames == NULL || frame_count == 0 || engine == NULL) {
+    return false;
+  }
+  bool idle = false;
+  if (!atomic_compare_exchange_strong(&session->busy, &idle, true)) {
+    return false;
+  }
+  // Drop a completion left by a wait that timed out.
+  xSemaphoreTake(session->done, 0);
+  session->frames = frames;
+  session->frame_count = frame_count;
+  atomic_store_explicit(&session->submitted, true, memory_order_release);
+  xTaskNotifyGive(engine);
+  return true;
+}
 
-    if ((frame.data[0] & 0xF0) != ISOTP_FLOW_CONTROL_FRAME) {
-      ESP_LOGW(tag, "Unexpected frame from ECU while waiting for FC: 0x%02X", frame.data[0]);
-      continue;
-    }
+void isotp_session_set_cf_gap(isotp_session_t* session, uint32_t gap_us) {
+  if (session != NULL) {
+    session->channel.config.cf_gap_us = gap_us;
+  }
+}
 
-    uint8_t flow_status = frame.data[0] & 0x0F;
-    if (flow_status == ISOTP_FC_BS_WAIT) {
-      ESP_LOGW(tag, "ECU requested FC WAIT, still waiting");
-      continue;
+uint32_t isotp_session_cf_gap(const isotp_session_t* session) {
+  return session != NULL ? session->channel.config.cf_gap_us : 0;
+}
+
+isotp_result_t isotp_session_wait(isotp_session_t* session, TickType_t timeout) {
+  if (session == NULL || xSemaphoreTake(session->done, timeout) != pdTRUE) {
+    return ISOTP_PENDING;
+  }
+  return session->result;
+}
+
+void isotp_engine_attach(void) {
+  for (size_t i = 0; i < s_session_count; ++i) {
+    can_transport_sink_attach(s_sessions[i]->rx);
+  }
+  s_engine_task = xTaskGetCurrentTaskHandle();
+}
+
+static void complete(isotp_session_t* session) {
+  isotp_channel_t* channel = &session->channel;
+  session->result = channel->result;
+  session->response_len = channel->result == ISOTP_OK ? channel->rx.len : 0;
+  if (channel->result == ISOTP_OK) {
+    session->completed++;
+  } else {
+    session->failed++;
+    ESP_LOGW(TAG, "%s exchange failed: %s", session->name, isotp_result_name(channel->result));
+  }
+  isotp_channel_reset(channel);
+  // Give before going idle: a submit that sees the session idle then drains
+  // this completion, so it cannot answer the next exchange's wait. An owner
+  // that wakes in between just finds the session still busy and retries.
+  xSemaphoreGive(session->done);
+  atomic_store_explicit(&session->busy, false, memory_order_release);
+}
+
+uint32_t isotp_engine_service(uint32_t now_us) {
+  uint32_t wait_us = UINT32_MAX;
+  for (size_t i = 0; i < s_session_count; ++i) {
+    isotp_session_t* session = s_sessions[i];
+    isotp_channel_t* channel = &session->channel;
+
+    // Frames first: anything queued before a submission is stale.
+    can_rx_frame_t frame;
+    while (can_transport_sink_receive(session->rx, &frame, 0)) {
+      isotp_channel_on_frame(channel, &frame, now_us);
     }
-    if (flow_status == ISOTP_FC_BS_ABORT) {
-      ESP_LOGW(tag, "ECU requested FC ABORT");
-      return false;
+    if (atomic_load_explicit(&session->submitted, memory_order_acquire)) {
+      atomic_store_explicit(&session->submitted, false, memory_order_relaxed);
+      isotp_channel_submit(channel, session->frames, session->frame_count, now_us);
     }
-    if (flow_status != ISOTP_FC_BS_LET_ER_EAT_BUD) {
-      ESP_LOGW(tag, "Unexpected FC status from ECU: 0x%02X", flow_status);
-      continue;
+    isotp_channel_on_time(channel, now_us);
+    if (channel->state == ISOTP_CHANNEL_DONE) {
+      complete(session);
     }
-
-    if (out_bs != NULL) {
-      *out_bs = frame.data[1];
+    const bool awaiting_response = channel->state == ISOTP_CHANNEL_WAIT_RESPONSE;
+    if (awaiting_response != session->fc_armed) {
+      session->fc_armed = awaiting_response;
+      can_transport_sink_arm_flow_control(session->rx, awaiting_response);
     }
-    if (out_stmin != NULL) {
-      *out_stmin = frame.data[2];
+
+    uint32_t deadline_us = 0;
+    if (isotp_channel_next_deadline(channel, &deadline_us)) {
+      const int32_t left = (int32_t)(deadline_us - now_us);
+      const uint32_t left_us = left > 0 ? (uint32_t)left : 0;
+      wait_us = left_us < wait_us ? left_us : wait_us;
     }
-    return true;
   }
-}
-
-bool isotp_send_flow_control(twai_node_handle_t node_hdl, uint32_t to) {
-  uint8_t fc_data[3] = {ISOTP_FLOW_CONTROL_FRAME, 0, 0};  // let 'er eat bud
-  return can_transport_transmit_frame(node_hdl, to, fc_data, sizeof(fc_data));
+  return wait_us;
 }
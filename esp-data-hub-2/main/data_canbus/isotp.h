@@ -1,17 +1,77 @@
 #pragma once
 
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
+#include "can_transport.h"
 #include "esp_twai.h"
 #include "freertos/FreeRTOS.h"
-#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "isotp_channel.h"
 #include "isotp_codec.h"
 
-#define ISOTP_FC_BS_LET_ER_EAT_BUD 0x00
-#define ISOTP_FC_BS_CONTINUE 0x01
-#define ISOTP_FC_BS_WAIT 0x02
-#define ISOTP_FC_BS_ABORT 0x03
+// ISO-TP sessions driven by one engine task (task_isotp), so the ECU and VDC
+// exchanges run side by side without either poll task blocking on frames.
+//
+// A poll task submits a segmented request and later waits for completion.
+// The engine owns each session's RX sink: it wakes on a frame notification,
+// a submission or the earliest channel deadline (an esp_timer, so STmin is
+// kept to the microsecond without spinning), feeds frames and time to
+// every channel (isotp_channel.h), and signals the owner when its exchange
+// ends. Sinks set up with can_transport_sink_auto_flow_control() get their
+// response flow control from the RX ISR, the moment the first frame arrives;
+// the engine arms it only while a channel waits for its response.
 
-void isotp_wait_stmin(uint8_t stmin_raw);
-bool isotp_wait_for_fc(QueueHandle_t queue, TickType_t timeout, uint8_t* out_bs, uint8_t* out_stmin, const char* tag);
-bool isotp_send_flow_control(twai_node_handle_t node_hdl, uint32_t to);
+#define ISOTP_MAX_SESSIONS 4U
+#define ISOTP_SESSION_RX_SIZE ISOTP_MAX_PAYLOAD
+
+typedef struct {
+  const char* name;
+  can_rx_sink_t* rx;
+  SemaphoreHandle_t done;
+  isotp_channel_t channel;  // engine task only
+  bool fc_armed;            // engine task only: last state given to the sink
+
+  // Owner to engine.
+  atomic_bool submitted;
+  atomic_bool busy;  // submitted and not yet completed
+  const uint8_t (*frames)[8];
+  size_t frame_count;
+
+  // Engine to owner, valid after isotp_session_wait() returns.
+  isotp_result_t result;
+  size_t response_len;
+  uint8_t response[ISOTP_SESSION_RX_SIZE];
+
+  uint32_t completed;  // engine task only
+  uint32_t failed;
+} isotp_session_t;
+
+// Sets up a session sending to `tx_id` and taking the responses routed to
+// `rx`, and registers it with the engine. Call before task_isotp starts.
+bool isotp_session_init(isotp_session_t* session, const char* name, twai_node_handle_t node_hdl, uint32_t tx_id,
+                        can_rx_sink_t* rx);
+
+// Starts an exchange and returns at once. `frames` (isotp_wrap_payload())
+// must stay untouched until the exchange completes. False while the previous
+// exchange is still running or before the engine has started.
+bool isotp_session_submit(isotp_session_t* session, const uint8_t (*frames)[8], size_t frame_count);
+
+// Waits up to `timeout` for the submitted exchange. On ISOTP_OK the response
+// is in session->response. ISOTP_PENDING on timeout; every exchange ends
+// within the channel timeouts, so portMAX_DELAY is safe. Owner only.
+isotp_result_t isotp_session_wait(isotp_session_t* session, TickType_t timeout);
+
+// Extra gap added to the node's STmin between request consecutive frames,
+// CONFIG_DH_TWAI_ISOTP_CF_GAP_US at init. Set it only between exchanges;
+// owner only.
+void isotp_session_set_cf_gap(isotp_session_t* session, uint32_t gap_us);
+uint32_t isotp_session_cf_gap(const isotp_session_t* session);
+
+// Engine task side: isotp_engine_attach() once, then isotp_engine_service()
+// after each wake-up. It returns how long until a channel next needs time,
+// UINT32_MAX when none does.
+void isotp_engine_attach(void);
+uint32_t isotp_engine_service(uint32_t now_us);
@@ -0,0 +1,258 @@
+#include "isotp_channel.h"
+
+#include <string.h>
+
+static bool reached(uint32_t now_us, uint32_t deadline_us) {
+  return (int32_t)(now_us - deadline_us) >= 0;
+}
+
+static void finish(isotp_channel_t* channel, isotp_result_t result) {
+  channel->state = ISOTP_CHANNEL_DONE;
+  channel->result = result;
+}
+
+static void wait_for(isotp_channel_t* channel, isotp_channel_state_t state, uint32_t now_us, uint32_t timeout_us) {
+  channel->state = state;
+  channel->deadline_us = now_us + timeout_us;
+}
+
+void isotp_channel_init(isotp_channel_t* channel, const isotp_channel_config_t* config) {
+  memset(channel, 0, sizeof(*channel));
+  channel->config = *config;
+  isotp_reassembler_init(&channel->rx, config->rx_buffer, config->rx_capacity);
+}
+
+void isotp_channel_reset(isotp_channel_t* channel) {
+  channel->state = ISOTP_CHANNEL_IDLE;
+  channel->result = ISOTP_PENDING;
+  channel->frames = NULL;
+  channel->frame_count = 0;
+}
+
+uint32_t isotp_stmin_us(uint8_t stmin_raw) {
+  if (stmin_raw <= 0x7F) {
+    return (uint32_t)stmin_raw * 1000U;
+  }
+  if (stmin_raw >= 0xF1 && stmin_raw <= 0xF9) {
+    return (uint32_t)(stmin_raw - 0xF0U) * 100U;
+  }
+  return 127000U;
+}
+
+bool isotp_channel_submit(isotp_channel_t* channel, const uint8_t (*frames)[8], size_t frame_count,
+                          uint32_t now_us) {
+  if (channel->state != ISOTP_CHANNEL_IDLE || frames == NULL || frame_count == 0) {
+    return false;
+  }
+  channel->frames = frames;
+  channel->frame_count = frame_count;
+  channel->next_frame = 1;
+  channel->block_size = 0;
+  channel->block_sent = 0;
+  channel->fc_waits = 0;
+  channel->tx_failures = 0;
+  channel->separation_us = 0;
+  isotp_reassembler_init(&channel->rx, channel->config.rx_buffer, channel->config.rx_capacity);
+  channel->result = ISOTP_PENDING;
+
+  // Requests are padded to 8 bytes, like every frame the hub sends.
+  if (!channel->config.send(channel->config.send_ctx, channel->config.tx_id, frames[0], 8)) {
+    finish(channel, ISOTP_ERR_TX);
+    return true;
+  }
+  if ((frames[0][0] & 0xF0) == ISOTP_FIRST_FRAME && frame_count > 1) {
+    wait_for(channel, ISOTP_CHANNEL_WAIT_FC, now_us, channel->config.fc_timeout_us);
+  } else {
+    wait_for(channel, ISOTP_CHANNEL_WAIT_RESPONSE, now_us, channel->config.response_timeout_us);
+  }
+  return true;
+}
+
+static void on_flow_control(isotp_channel_t* channel, const can_rx_frame_t* frame, uint32_t now_us) {
+  if (frame->data_len < 3) {
+    finish(channel, ISOTP_ERR_MALFORMED);
+    return;
+  }
+  switch (frame->data[0] & 0x0F) {
+    case ISOTP_FC_STATUS_CTS:
+      channel->block_size = frame->data[1];
+      channel->block_sent = 0;
+      channel->fc_waits = 0;
+      channel->separation_us = isotp_stmin_us(frame->data[2]) + channel->config.cf_gap_us;
+      // The first consecutive frame may follow the flow control at once.
+      channel->state = ISOTP_CHANNEL_SEND_CF;
+      channel->deadline_us = now_us;
+      isotp_channel_on_time(channel, now_us);
+      break;
+    case ISOTP_FC_STATUS_WAIT:
+      if (++channel->fc_waits > channel->config.fc_wait_max) {
+        finish(channel, ISOTP_ERR_FLOW_CONTROL);
+      } else {
+        wait_for(channel, ISOTP_CHANNEL_WAIT_FC, now_us, channel->config.fc_timeout_us);
+      }
+      break;
+    default:  // overflow, or a status ISO 15765-2 does not define
+      finish(channel, ISOTP_ERR_FLOW_CONTROL);
+      break;
+  }
+}
+
+// Ends the exchange on a finished or failed reassembly; true when it did.
+static bool finish_on_rx(isotp_channel_t* channel, isotp_rx_status_t status) {
+  switch (status) {
+    case ISOTP_RX_IN_PROGRESS:
+      return false;
+    case ISOTP_RX_COMPLETE:
+      // An empty single frame carries nothing to answer with.
+      finish(channel, channel->rx.len > 0 ? ISOTP_OK : ISOTP_ERR_MALFORMED);
+      return true;
+    case ISOTP_RX_ERR_SEQUENCE:
+      finish(channel, ISOTP_ERR_SEQUENCE);
+      return true;
+    case ISOTP_RX_ERR_OVERFLOW:
+      finish(channel, ISOTP_ERR_OVERFLOW);
+      return true;
+    case ISOTP_RX_ERR_MALFORMED:
+      break;
+  }
+  finish(channel, ISOTP_ERR_MALFORMED);
+  return true;
+}
+
+static void on_response_start(isotp_channel_t* channel, const can_rx_frame_t* frame, uint32_t now_us) {
+  if (finish_on_rx(channel, isotp_reassembler_start(&channel->rx, frame))) {
+    return;
+  }
+  // First frame.
+  if ((frame->flags & CAN_RX_FLAG_FC_SENT) == 0) {
+    static const uint8_t k_clear_to_send[8] = {ISOTP_FLOW_CONTROL_FRAME | ISOTP_FC_STATUS_CTS, 0, 0};
+    if (!channel->config.send(channel->config.send_ctx, channel->config.tx_id, k_clear_to_send, 3)) {
+      finish(channel, ISOTP_ERR_TX);
+      return;
+    }
+  }
+  wait_for(channel, ISOTP_CHANNEL_RECEIVE_CF, now_us, channel->config.cf_timeout_us);
+}
+
+static void on_consecutive_frame(isotp_channel_t* channel, const can_rx_frame_t* frame, uint32_t now_us) {
+  if (!finish_on_rx(channel, isotp_reassembler_consecutive(&channel->rx, frame))) {
+    wait_for(channel, ISOTP_CHANNEL_RECEIVE_CF, now_us, channel->config.cf_timeout_us);
+  }
+}
+
+void isotp_channel_on_frame(isotp_channel_t* channel, const can_rx_frame_t* frame, uint32_t now_us) {
+  if (frame == NULL || frame->data_len == 0) {
+    channel->ignored_frames++;
+    return;
+  }
+  const uint8_t type = frame->data[0] & 0xF0;
+  switch (channel->state) {
+    case ISOTP_CHANNEL_WAIT_FC:
+      if (type == ISOTP_FLOW_CONTROL_FRAME) {
+        on_flow_control(channel, frame, now_us);
+        return;
+      }
+      break;
+    case ISOTP_CHANNEL_WAIT_RESPONSE:
+      if (type == ISOTP_SINGLE_FRAME || type == ISOTP_FIRST_FRAME) {
+        on_response_start(channel, frame, now_us);
+        return;
+      }
+      break;
+    case ISOTP_CHANNEL_RECEIVE_CF:
+      if (type == ISOTP_CONSECUTIVE_FRAME) {
+        on_consecutive_frame(channel, frame, now_us);
+        return;
+      }
+      if (type == ISOTP_SINGLE_FRAME || type == ISOTP_FIRST_FRAME) {
+        // A new message replaces the one in progress (ISO 15765-2 9.8.3).
+        on_response_start(channel, frame, now_us);
+        return;
+      }
+      break;
+    default:
+      break;
+  }
+  channel->ignored_frames++;
+}
+
+void isotp_channel_on_time(isotp_channel_t* channel, uint32_t now_us) {
+  switch (channel->state) {
+    case ISOTP_CHANNEL_SEND_CF:
+      while (channel->state == ISOTP_CHANNEL_SEND_CF && reached(now_us, channel->deadline_us)) {
+        if (!channel->config.send(channel->config.send_ctx, channel->config.tx_id,
+                                  channel->frames[channel->next_frame], 8)) {
+          if (++channel->tx_failures > channel->config.tx_retries) {
+            finish(channel, ISOTP_ERR_TX);
+          } else {
+            channel->deadline_us = now_us + channel->config.tx_retry_us;
+          }
+          return;
+        }
+        channel->tx_failures = 0;
+        channel->next_frame++;
+        channel->block_sent++;
+        if (channel->next_frame >= channel->frame_count) {
+          wait_for(channel, ISOTP_CHANNEL_WAIT_RESPONSE, now_us, channel->config.response_timeout_us);
+        } else if (channel->block_size > 0 && channel->block_sent >= channel->block_size) {
+          wait_for(channel, ISOTP_CHANNEL_WAIT_FC, now_us, channel->config.fc_timeout_us);
+        } else {
+          channel->deadline_us = now_us + channel->separation_us;
+        }
+      }
+      break;
+    case ISOTP_CHANNEL_WAIT_FC:
+      if (reached(now_us, channel->deadline_us)) {
+        finish(channel, ISOTP_ERR_FC_TIMEOUT);
+      }
+      break;
+    case ISOTP_CHANNEL_WAIT_RESPONSE:
+      if (reached(now_us, channel->deadline_us)) {
+        finish(channel, ISOTP_ERR_RESPONSE_TIMEOUT);
+      }
+      break;
+    case ISOTP_CHANNEL_RECEIVE_CF:
+      if (reached(now_us, channel->deadline_us)) {
+        finish(channel, ISOTP_ERR_CF_TIMEOUT);
+      }
+      break;
+    default:
+      break;
+  }
+}
+
+bool isotp_channel_next_deadline(const isotp_channel_t* channel, uint32_t* out_us) {
+  if (channel->state == ISOTP_CHANNEL_IDLE || channel->state == ISOTP_CHANNEL_DONE) {
+    return false;
+  }
+  if (out_us != NULL) {
+    *out_us = channel->deadline_us;
+  }
+  return true;
+}
+
+const char* isotp_result_name(isotp_result_t result) {
+  switch (result) {
+    case ISOTP_OK:
+      return "ok";
+    case ISOTP_PENDING:
+      return "pending";
+    case ISOTP_ERR_TX:
+      return "TX failed";
+    case ISOTP_ERR_FC_TIMEOUT:
+      return "no flow control";
+    case ISOTP_ERR_FLOW_CONTROL:
+      return "flow control refused";
+    case ISOTP_ERR_RESPONSE_TIMEOUT:
+      return "no response";
+    case ISOTP_ERR_CF_TIMEOUT:
+      return "response stalled";
+    case ISOTP_ERR_SEQUENCE:
+      return "sequence error";
+    case ISOTP_ERR_OVERFLOW:
+      return "response too long";
+    case ISOTP_ERR_MALFORMED:
+      return "malformed frame";
+  }
+  return "?";
+}
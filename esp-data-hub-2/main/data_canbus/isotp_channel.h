@@ -0,0 +1,121 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "can_types.h"
+#include "isotp_codec.h"
+
+// One ISO-TP request/response exchange with one node, as a state machine
+// driven by two events: a frame from the node, and time passing. It never
+// blocks or sleeps; it sends frames through a callback and reports the next
+// time it needs to run, so one task can drive any number of channels at once
+// (see isotp.h).
+//
+//   submit -> SF sent ----------------------------> WAIT_RESPONSE
+//          -> FF sent -> WAIT_FC -> FC CTS -> SEND_CF -> WAIT_RESPONSE
+//                          ^    (FC WAIT)      |  (block full)
+//                          +-------------------+
+//   WAIT_RESPONSE -> SF -> DONE
+//                 -> FF -> (FC) -> RECEIVE_CF -> ... -> DONE
+//
+// Every waiting state has a deadline, so each exchange ends in DONE with a
+// result.
+
+// Flow status of a flow control frame (low nibble of its PCI byte).
+#define ISOTP_FC_STATUS_CTS 0x00
+#define ISOTP_FC_STATUS_WAIT 0x01
+#define ISOTP_FC_STATUS_OVERFLOW 0x02
+
+typedef enum {
+  ISOTP_CHANNEL_IDLE = 0,
+  ISOTP_CHANNEL_WAIT_FC,        // first frame or a full block sent
+  ISOTP_CHANNEL_SEND_CF,        // next consecutive frame due at deadline_us
+  ISOTP_CHANNEL_WAIT_RESPONSE,  // request sent
+  ISOTP_CHANNEL_RECEIVE_CF,     // response first frame taken
+  ISOTP_CHANNEL_DONE,
+} isotp_channel_state_t;
+
+typedef enum {
+  ISOTP_OK = 0,
+  ISOTP_PENDING,
+  ISOTP_ERR_TX,                // a frame could not be queued
+  ISOTP_ERR_FC_TIMEOUT,        // no flow control (N_Bs)
+  ISOTP_ERR_FLOW_CONTROL,      // overflow, unknown flow status, or too many WAITs
+  ISOTP_ERR_RESPONSE_TIMEOUT,  // no response
+  ISOTP_ERR_CF_TIMEOUT,        // response stalled (N_Cr)
+  ISOTP_ERR_SEQUENCE,          // consecutive frame out of order
+  ISOTP_ERR_OVERFLOW,          // response larger than the buffer
+  ISOTP_ERR_MALFORMED,         // bad length or short frame
+} isotp_result_t;
+
+// Queues one frame of `len` bytes to `id`; false when it cannot be queued
+// now. The channel retries a consecutive frame after tx_retry_us.
+typedef bool (*isotp_channel_send_t)(void* ctx, uint32_t id, const uint8_t* data, uint8_t len);
+
+typedef struct {
+  uint32_t tx_id;
+  isotp_channel_send_t send;
+  void* send_ctx;
+  uint8_t* rx_buffer;
+  size_t rx_capacity;
+
+  uint32_t fc_timeout_us;        // N_Bs
+  uint32_t response_timeout_us;  // request sent to response first frame
+  uint32_t cf_timeout_us;        // N_Cr
+  uint32_t cf_gap_us;            // added to the node's STmin
+  uint32_t tx_retry_us;
+  uint8_t tx_retries;  // consecutive failed sends before ISOTP_ERR_TX
+  uint8_t fc_wait_max;  // N_WFTmax
+} isotp_channel_config_t;
+
+typedef struct {
+  isotp_channel_config_t config;
+  isotp_channel_state_t state;
+  isotp_result_t result;
+  uint32_t deadline_us;
+
+  // Request, owned by the submitter until DONE.
+  const uint8_t (*frames)[8];
+  size_t frame_count;
+  size_t next_frame;
+  uint8_t block_size;  // 0 = no limit
+  uint8_t block_sent;
+  uint8_t fc_waits;
+  uint8_t tx_failures;
+  uint32_t separation_us;
+
+  // Response, reassembled straight into config.rx_buffer; rx.len bytes.
+  isotp_reassembler_t rx;
+
+  uint32_t ignored_frames;  // frames no state expected, since init
+} isotp_channel_t;
+
+void isotp_channel_init(isotp_channel_t* channel, const isotp_channel_config_t* config);
+
+// Sends frames[0] and starts the exchange. `frames` is an ISO-TP segmented
+// request (isotp_wrap_payload()) that must stay valid until DONE. False, with
+// nothing sent, unless the channel is IDLE; DONE with ISOTP_ERR_TX when the
+// first frame cannot be queued.
+bool isotp_channel_submit(isotp_channel_t* channel, const uint8_t (*frames)[8], size_t frame_count,
+                          uint32_t now_us);
+
+// A frame from the node. Frames with CAN_RX_FLAG_FC_SENT were already
+// answered with a flow control, so a response first frame sends none.
+void isotp_channel_on_frame(isotp_channel_t* channel, const can_rx_frame_t* frame, uint32_t now_us);
+
+// Sends consecutive frames that are due and fails the exchange when a wait
+// has passed its deadline.
+void isotp_channel_on_time(isotp_channel_t* channel, uint32_t now_us);
+
+// When on_time() must next run; false when nothing is pending.
+bool isotp_channel_next_deadline(const isotp_channel_t* channel, uint32_t* out_us);
+
+// Back to IDLE after DONE, keeping the statistics.
+void isotp_channel_reset(isotp_channel_t* channel);
+
+// STmin byte to microseconds; reserved values count as 127 ms.
+uint32_t isotp_stmin_us(uint8_t stmin_raw);
+
+const char* isotp_result_name(isotp_result_t result);
@@ -5,7 +5,6 @@
 #define ISOTP_CLASSIC_SINGLE_FRAME_MAX_PAYLOAD 7U
 #define ISOTP_FIRST_FRAME_PAYLOAD_SIZE 6U
 #define ISOTP_CONSECUTIVE_FRAME_PAYLOAD_SIZE 7U
-#define ISOTP_CLASSIC_MAX_PAYLOAD 4095U
 
 bool isotp_wrap_payload(const uint8_t* payload, uint16_t payload_len, uint8_t frames[][8], size_t max_frames,
                         size_t* out_frame_count) {
@@ -22,7 +21,7 @@ bool isotp_wrap_payload(const uint8_t* payload, uint16_t payload_len, uint8_t fr
     return true;
   }
 
-  if (payload_len > ISOTP_CLASSIC_MAX_PAYLOAD) {
+  if (payload_len > ISOTP_MAX_PAYLOAD) {
     return false;
   }
 
@@ -50,71 +49,95 @@ bool isotp_wrap_payload(const uint8_t* payload, uint16_t payload_len, uint8_t fr
   return (offset >= payload_len);
 }
 
-bool isotp_unwrap_frames(const can_rx_frame_t frames[], size_t frame_count, uint8_t* out_payload,
-                         size_t out_payload_size, size_t* out_payload_len) {
-  if (!frames || !out_payload || !out_payload_len || frame_count == 0 || frames[0].data_len == 0) {
-    return false;
-  }
-
-  const uint8_t pci = frames[0].data[0];
-  const uint8_t type = pci & 0xF0;
+void isotp_reassembler_init(isotp_reassembler_t* rx, uint8_t* buffer, size_t capacity) {
+  memset(rx, 0, sizeof(*rx));
+  rx->buffer = buffer;
+  rx->capacity = capacity;
+}
 
-  if (type == ISOTP_SINGLE_FRAME) {
-    const uint8_t payload_len = pci & 0x0F;
-    if (payload_len > ISOTP_CLASSIC_SINGLE_FRAME_MAX_PAYLOAD || out_payload_size < payload_len ||
-        frames[0].data_len < (size_t)payload_len + 1U) {
-      return false;
-    }
-    memcpy(out_payload, &frames[0].data[1], payload_len);
-    *out_payload_len = payload_len;
-    return true;
+isotp_rx_status_t isotp_reassembler_start(isotp_reassembler_t* rx, const can_rx_frame_t* frame) {
+  rx->active = false;
+  rx->len = 0;
+  rx->expected = 0;
+  if (frame->data_len == 0) {
+    return ISOTP_RX_ERR_MALFORMED;
   }
+  const uint8_t pci = frame->data[0];
 
-  if (type == ISOTP_FIRST_FRAME) {
-    const uint16_t payload_len = (uint16_t)(((uint16_t)(pci & 0x0F) << 8) | frames[0].data[1]);
-    if (payload_len <= ISOTP_CLASSIC_SINGLE_FRAME_MAX_PAYLOAD || out_payload_size < payload_len ||
-        frames[0].data_len < 8U) {
-      return false;
+  if ((pci & 0xF0) == ISOTP_SINGLE_FRAME) {
+    const size_t payload_len = pci & 0x0F;
+    if (payload_len > ISOTP_CLASSIC_SINGLE_FRAME_MAX_PAYLOAD || frame->data_len < payload_len + 1U) {
+      return ISOTP_RX_ERR_MALFORMED;
     }
-
-    size_t offset = 0;
-    memcpy(out_payload, &frames[0].data[2], ISOTP_FIRST_FRAME_PAYLOAD_SIZE);
-    offset += ISOTP_FIRST_FRAME_PAYLOAD_SIZE;
-
-    uint8_t expected_seq = 1;
-    for (size_t i = 1; i < frame_count && offset < payload_len; i++) {
-      if (frames[i].data_len == 0) {
-        return false;
-      }
-
-      const uint8_t cf_pci = frames[i].data[0];
-      if ((cf_pci & 0xF0) != ISOTP_CONSECUTIVE_FRAME) {
-        return false;
-      }
-      const uint8_t seq = cf_pci & 0x0F;
-      if (seq != expected_seq) {
-        return false;
-      }
-
-      const size_t remaining = payload_len - offset;
-      const size_t chunk =
-          (remaining > ISOTP_CONSECUTIVE_FRAME_PAYLOAD_SIZE) ? ISOTP_CONSECUTIVE_FRAME_PAYLOAD_SIZE : remaining;
-      if (frames[i].data_len < chunk + 1U) {
-        return false;
-      }
-      memcpy(out_payload + offset, &frames[i].data[1], chunk);
-      offset += chunk;
-
-      expected_seq = (expected_seq + 1) & 0x0F;
+    if (payload_len > rx->capacity) {
+      return ISOTP_RX_ERR_OVERFLOW;
     }
+    memcpy(rx->buffer, &frame->data[1], payload_len);
+    rx->expected = payload_len;
+    rx->len = payload_len;
+    return ISOTP_RX_COMPLETE;
+  }
 
-    if (offset != payload_len) {
-      return false;
-    }
+  if ((pci & 0xF0) != ISOTP_FIRST_FRAME || frame->data_len < 8U) {
+    return ISOTP_RX_ERR_MALFORMED;
+  }
+  const size_t payload_len = ((size_t)(pci & 0x0F) << 8) | frame->data[1];
+  if (payload_len <= ISOTP_CLASSIC_SINGLE_FRAME_MAX_PAYLOAD) {
+    return ISOTP_RX_ERR_MALFORMED;
+  }
+  if (payload_len > rx->capacity) {
+    return ISOTP_RX_ERR_OVERFLOW;
+  }
+  memcpy(rx->buffer, &frame->data[2], ISOTP_FIRST_FRAME_PAYLOAD_SIZE);
+  rx->expected = payload_len;
+  rx->len = ISOTP_FIRST_FRAME_PAYLOAD_SIZE;
+  rx->next_sn = 1;
+  rx->active = true;
+  return ISOTP_RX_IN_PROGRESS;
+}
 
-    *out_payload_len = payload_len;
-    return true;
+isotp_rx_status_t isotp_reassembler_consecutive(isotp_reassembler_t* rx, const can_rx_frame_t* frame) {
+  if (!rx->active || frame->data_len == 0 || (frame->data[0] & 0xF0) != ISOTP_CONSECUTIVE_FRAME) {
+    rx->active = false;
+    return ISOTP_RX_ERR_MALFORMED;
+  }
+  if ((frame->data[0] & 0x0F) != rx->next_sn) {
+    rx->active = false;
+    return ISOTP_RX_ERR_SEQUENCE;
+  }
+  const size_t remaining = rx->expected - rx->len;
+  const size_t chunk =
+      (remaining > ISOTP_CONSECUTIVE_FRAME_PAYLOAD_SIZE) ? ISOTP_CONSECUTIVE_FRAME_PAYLOAD_SIZE : remaining;
+  if (frame->data_len < chunk + 1U) {
+    rx->active = false;
+    return ISOTP_RX_ERR_MALFORMED;
+  }
+  memcpy(rx->buffer + rx->len, &frame->data[1], chunk);
+  rx->len += chunk;
+  rx->next_sn = (rx->next_sn + 1U) & 0x0F;
+  if (rx->len < rx->expected) {
+    return ISOTP_RX_IN_PROGRESS;
+  }
+  rx->active = false;
+  return ISOTP_RX_COMPLETE;
+}
+
+bool isotp_unwrap_frames(const can_rx_frame_t frames[], size_t frame_count, uint8_t* out_payload,
+                         size_t out_payload_size, size_t* out_payload_len) {
+  if (!frames || !out_payload || !out_payload_len || frame_count == 0) {
+    return false;
   }
 
-  return false;
+  isotp_reassembler_t rx;
+  isotp_reassembler_init(&rx, out_payload, out_payload_size);
+  isotp_rx_status_t status = isotp_reassembler_start(&rx, &frames[0]);
+  // Frames past the end of the message are ignored.
+  for (size_t i = 1; i < frame_count && status == ISOTP_RX_IN_PROGRESS; i++) {
+    status = isotp_reassembler_consecutive(&rx, &frames[i]);
+  }
+  if (status != ISOTP_RX_COMPLETE) {
+    return false;
+  }
+  *out_payload_len = rx.len;
+  return true;
 }
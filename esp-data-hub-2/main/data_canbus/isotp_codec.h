@@ -11,7 +11,37 @@
 #define ISOTP_CONSECUTIVE_FRAME 0x20
 #define ISOTP_FLOW_CONTROL_FRAME 0x30
 
+// Largest payload a classic first frame can announce (12-bit length).
+#define ISOTP_MAX_PAYLOAD 4095U
+
 bool isotp_wrap_payload(const uint8_t* payload, uint16_t payload_len, uint8_t frames[][8], size_t max_frames,
                         size_t* out_frame_count);
 bool isotp_unwrap_frames(const can_rx_frame_t frames[], size_t frame_count, uint8_t* out_payload,
                          size_t out_payload_size, size_t* out_payload_len);
+
+// Incremental reassembly: each frame's payload is copied straight into the
+// caller's buffer as it arrives, so a response needs no frame array and can
+// be up to ISOTP_MAX_PAYLOAD bytes.
+typedef enum {
+  ISOTP_RX_IN_PROGRESS = 0,  // first frame or consecutive frame taken, more to come
+  ISOTP_RX_COMPLETE,
+  ISOTP_RX_ERR_SEQUENCE,   // consecutive frame out of order
+  ISOTP_RX_ERR_OVERFLOW,   // announced length larger than the buffer
+  ISOTP_RX_ERR_MALFORMED,  // bad length, short frame, or unexpected frame type
+} isotp_rx_status_t;
+
+typedef struct {
+  uint8_t* buffer;
+  size_t capacity;
+  size_t expected;  // announced payload length
+  size_t len;       // bytes copied so far
+  uint8_t next_sn;  // expected consecutive frame sequence number
+  bool active;      // a first frame was taken and the payload is incomplete
+} isotp_reassembler_t;
+
+void isotp_reassembler_init(isotp_reassembler_t* rx, uint8_t* buffer, size_t capacity);
+// Starts a message from a single or first frame, dropping any message in
+// progress.
+isotp_rx_status_t isotp_reassembler_start(isotp_reassembler_t* rx, const can_rx_frame_t* frame);
+// Appends a consecutive frame to the message in progress.
+isotp_rx_status_t isotp_reassembler_consecutive(isotp_reassembler_t* rx, const can_rx_frame_t* frame);
@@ -0,0 +1,70 @@
+#include "isotp_gap_calibration.h"
+
+#include <string.h>
+
+void isotp_gap_calibration_start(isotp_gap_calibration_t* cal, uint32_t start_us, uint32_t max_us,
+                                 uint32_t resolution_us, uint16_t passes_required) {
+  memset(cal, 0, sizeof(*cal));
+  cal->max_us = max_us;
+  cal->hi_us = start_us < max_us ? start_us : max_us;
+  cal->resolution_us = resolution_us > 0 ? resolution_us : 1;
+  cal->passes_required = passes_required > 0 ? passes_required : 1;
+}
+
+uint32_t isotp_gap_calibration_gap_us(const isotp_gap_calibration_t* cal) {
+  if (cal->done || !cal->verified) {
+    return cal->hi_us;
+  }
+  return cal->lo_us + (cal->hi_us - cal->lo_us) / 2U;
+}
+
+static void finish_if_narrow(isotp_gap_calibration_t* cal) {
+  if (cal->hi_us - cal->lo_us < cal->resolution_us) {
+    cal->done = true;
+    cal->found = true;
+  }
+}
+
+bool isotp_gap_calibration_record(isotp_gap_calibration_t* cal, isotp_gap_trial_t trial) {
+  if (cal->done || trial == ISOTP_GAP_TRIAL_INCONCLUSIVE) {
+    return cal->done;
+  }
+  const uint32_t gap_us = isotp_gap_calibration_gap_us(cal);
+
+  if (trial == ISOTP_GAP_TRIAL_PASS) {
+    if (++cal->passes < cal->passes_required) {
+      return false;
+    }
+    cal->passes = 0;
+    cal->hi_us = gap_us;
+    cal->verified = true;
+    finish_if_narrow(cal);
+    return cal->done;
+  }
+
+  cal->passes = 0;
+  cal->lo_us = gap_us + 1U;
+  if (cal->verified) {
+    finish_if_narrow(cal);
+    return cal->done;
+  }
+  // The starting gap failed: widen until one passes.
+  if (gap_us >= cal->max_us) {
+    cal->done = true;
+    return true;
+  }
+  const uint32_t wider_us = gap_us > 0 ? gap_us * 2U : cal->resolution_us;
+  cal->hi_us = wider_us < cal->max_us ? wider_us : cal->max_us;
+  return false;
+}
+
+isotp_gap_trial_t isotp_gap_trial_from_result(isotp_result_t result) {
+  switch (result) {
+    case ISOTP_OK:
+      return ISOTP_GAP_TRIAL_PASS;
+    case ISOTP_ERR_RESPONSE_TIMEOUT:
+      return ISOTP_GAP_TRIAL_FAIL;
+    default:
+      return ISOTP_GAP_TRIAL_INCONCLUSIVE;
+  }
+}
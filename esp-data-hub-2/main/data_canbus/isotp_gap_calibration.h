@@ -0,0 +1,48 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "isotp_channel.h"
+
+// Search for the smallest extra consecutive-frame gap (added to the node's
+// STmin) at which a node takes segmented requests reliably.
+//
+// The starting gap is checked first and widened (doubled up to max_us) until
+// it passes. The search then halves the interval between the largest gap
+// that failed and the smallest that passed, until the two are within
+// resolution_us. A gap passes after passes_required consecutive good
+// exchanges and fails at the first exchange the node drops.
+
+typedef enum {
+  ISOTP_GAP_TRIAL_PASS,
+  ISOTP_GAP_TRIAL_FAIL,
+  ISOTP_GAP_TRIAL_INCONCLUSIVE,  // says nothing about the gap; not counted
+} isotp_gap_trial_t;
+
+typedef struct {
+  uint32_t lo_us;  // smallest gap not yet ruled out
+  uint32_t hi_us;  // smallest gap that passed, once verified
+  uint32_t max_us;
+  uint32_t resolution_us;
+  uint16_t passes_required;
+  uint16_t passes;  // consecutive passes at the trial gap
+  bool verified;    // hi_us has passed
+  bool done;
+  bool found;  // done with a gap that passed; false when even max_us failed
+} isotp_gap_calibration_t;
+
+void isotp_gap_calibration_start(isotp_gap_calibration_t* cal, uint32_t start_us, uint32_t max_us,
+                                 uint32_t resolution_us, uint16_t passes_required);
+
+// Gap to run the next exchange with; once done, the result.
+uint32_t isotp_gap_calibration_gap_us(const isotp_gap_calibration_t* cal);
+
+// Records an exchange run at isotp_gap_calibration_gap_us(). Returns true
+// once the search has finished.
+bool isotp_gap_calibration_record(isotp_gap_calibration_t* cal, isotp_gap_trial_t trial);
+
+// How an exchange bears on the gap. Only a request that got its flow control
+// and all its consecutive frames out, then no answer, counts against the gap;
+// a node that is off or busy never sends the flow control.
+isotp_gap_trial_t isotp_gap_trial_from_result(isotp_result_t result);
@@ -1,102 +1,171 @@
 #include "request_ecu.h"
 
+#include <stddef.h>
 #include <string.h>
 
-static inline float ssm_ecu_parse_coolant_temp(uint8_t value) { return 32.0f + 9.0f * ((float)value - 40.0f) / 5.0f; }
+#include "isotp_codec.h"
 
-static inline float ssm_ecu_parse_af_correction(uint8_t value) { return ((float)value - 128.0f) * 100.0f / 128.0f; }
-
-static inline float ssm_ecu_parse_af_learning(uint8_t value) { return ((float)value - 128.0f) * 100.0f / 128.0f; }
-
-static inline float ssm_ecu_parse_rpm(uint16_t value) { return (float)value / 4.0f; }
-
-static inline float ssm_ecu_parse_intake_air_temp(uint8_t value) {
-  return 32.0f + 9.0f * ((float)value - 40.0f) / 5.0f;
-}
-
-static inline float ssm_ecu_parse_afr(uint8_t value) { return (float)value * 14.7f / 128.0f; }
-
-static inline float ssm_ecu_parse_dam(uint8_t value) { return (float)value * 0.0625f; }
-
-static inline float ssm_ecu_parse_injector_pw_ms(uint8_t value) { return (float)value * 256.0f / 1000.0f; }
-
-static inline float ssm_ecu_parse_injector_duty(float injector_pw_ms, float engine_rpm) {
+// Injector #1 pulse width in µs to duty cycle in percent.
+static inline float ssm_ecu_injector_duty(float injector_pw_us, float engine_rpm) {
   if (engine_rpm <= 0.0f) {
     return 0.0f;
   }
 
-  return injector_pw_ms * engine_rpm / 1200.0f;
+  return injector_pw_us * engine_rpm / 1200000.0f;
 }
 
-static inline float ssm_ecu_parse_ethanol_concentration(uint16_t value) { return (float)value * 100.0f / 65536.0f; }
-
-static inline float ssm_ecu_parse_throttle_pos(uint8_t value) { return ((float)value) * 100.0f / 255.0f; }
-
-static inline float ssm_ecu_parse_feedback_knock(uint32_t value) {
-  float out;
-  memcpy(&out, &value, sizeof(out));
-  return out;
+// Telemetry channels polled over SSM, in request order, and the parameter
+// and response member behind each.
+typedef struct {
+  telemetry_channel_t channel;
+  ssm_param_id_t param;
+  size_t member;  // offsetof(request_ecu_response_t, ...)
+} ssm_ecu_field_t;
+
+#define SSM_ECU_FIELD(name, param) {TELEMETRY_CHANNEL_##name, param, offsetof(request_ecu_response_t, name)}
+
+static const ssm_ecu_field_t k_ssm_ecu_fields[] = {
+    SSM_ECU_FIELD(water_temp, SSM_PARAM_COOLANT_TEMPERATURE),
+    SSM_ECU_FIELD(af_correct, SSM_PARAM_A_F_CORRECTION_1),
+    SSM_ECU_FIELD(af_learned, SSM_PARAM_A_F_LEARNING_1),
+    SSM_ECU_FIELD(engine_rpm, SSM_PARAM_ENGINE_SPEED),
+    SSM_ECU_FIELD(int_temp, SSM_PARAM_INTAKE_AIR_TEMPERATURE),
+    SSM_ECU_FIELD(inj_duty, SSM_PARAM_FUEL_INJECTOR_1_PULSE_WIDTH),  // converted to duty with RPM
+    SSM_ECU_FIELD(af_ratio, SSM_PARAM_A_F_SENSOR_1),
+    SSM_ECU_FIELD(dam, SSM_PARAM_DAM),
+    SSM_ECU_FIELD(fb_knock, SSM_PARAM_KNOCK_CORRECTION_ADVANCE),
+    SSM_ECU_FIELD(eth_conc, SSM_PARAM_ETHANOL_CONCENTRATION),
+    SSM_ECU_FIELD(throttle_pos, SSM_PARAM_ACCELERATOR_PEDAL),
+};
+
+#define SSM_ECU_FIELD_COUNT (sizeof(k_ssm_ecu_fields) / sizeof(k_ssm_ecu_fields[0]))
+
+// Lists the parameters behind the channels in a normalized mask, in request
+// order, with the field each came from.
+static size_t select_fields(uint32_t field_mask, ssm_param_id_t* params, const ssm_ecu_field_t** fields) {
+  size_t count = 0;
+  for (size_t i = 0; i < SSM_ECU_FIELD_COUNT; ++i) {
+    if (field_mask & (1UL << k_ssm_ecu_fields[i].channel)) {
+      params[count] = k_ssm_ecu_fields[i].param;
+      fields[count] = &k_ssm_ecu_fields[i];
+      count++;
+    }
+  }
+  return count;
 }
 
-size_t request_ecu_build_poll_payload(uint8_t* out_payload, size_t out_capacity) {
-  if (out_payload == NULL) {
+size_t request_ecu_build_read_payload(const ssm_param_id_t* params, size_t count, uint8_t* out_payload,
+                                      size_t out_capacity) {
+  if (params == NULL || count == 0 || out_payload == NULL || out_capacity < 2) {
     return 0;
   }
 
-  // clang-format off
-  static const uint8_t payload[] = {
-      0xA8, 0x00,        // read memory by addr list, padding mode 0
-      0x00, 0x00, 0x08,  // coolant
-      0x00, 0x00, 0x09,  // af correction #1
-      0x00, 0x00, 0x0A,  // af learning #1
-      0x00, 0x00, 0x0E,  // engine rpm
-      0x00, 0x00, 0x0F,  // engine rpm
-      0x00, 0x00, 0x12,  // intake air temperature
-      0x00, 0x00, 0x20,  // fuel injector #1 pulse width
-      0x00, 0x00, 0x46,  // afr
-      0xFF, 0x6B, 0x49,  // DAM
-      0xFF, 0x84, 0x80,  // feedback knock correction
-      0xFF, 0x84, 0x81,  // feedback knock correction
-      0xFF, 0x84, 0x82,  // feedback knock correction
-      0xFF, 0x84, 0x83,  // feedback knock correction
-      0xFF, 0x1E, 0xE4,  // ethanol concentration
-      0xFF, 0x1E, 0xE5,  // ethanol concentration
-      0x00, 0x00, 0x29,  // accelerator pedal
-  };
-  // clang-format on
-
-  if (out_capacity < sizeof(payload)) {
-    return 0;
+  size_t length = 0;
+  out_payload[length++] = 0xA8;  // read memory by addr list
+  out_payload[length++] = 0x00;  // padding mode 0
+  for (size_t i = 0; i < count; ++i) {
+    if ((unsigned)params[i] >= SSM_PARAM_COUNT) {
+      return 0;
+    }
+    const ssm_param_t* param = &k_ssm_params[params[i]];
+    if (out_capacity - length < param->length * 3U) {
+      return 0;
+    }
+    // One address per byte.
+    for (uint8_t b = 0; b < param->length; ++b) {
+      const uint32_t address = param->address + b;
+      out_payload[length++] = (uint8_t)(address >> 16);
+      out_payload[length++] = (uint8_t)(address >> 8);
+      out_payload[length++] = (uint8_t)address;
+    }
   }
-
-  memcpy(out_payload, payload, sizeof(payload));
-  return sizeof(payload);
+  return length;
 }
 
-bool request_ecu_parse_ssm_response(const uint8_t* ssm_payload, size_t length, request_ecu_response_t* response) {
-  if (ssm_payload == NULL || response == NULL) {
+bool request_ecu_parse_read_response(const ssm_param_id_t* params, size_t count, const uint8_t* ssm_payload,
+                                     size_t length, float* out_values) {
+  if (params == NULL || count == 0 || ssm_payload == NULL || out_values == NULL) {
     return false;
   }
 
+  size_t expected = 1;
+  for (size_t i = 0; i < count; ++i) {
+    if ((unsigned)params[i] >= SSM_PARAM_COUNT) {
+      return false;
+    }
+    expected += k_ssm_params[params[i]].length;
+  }
+
   // SSM response payload starts with service id (0xE8).
-  if (length < 17 || ssm_payload[0] != 0xE8) {
+  if (length < expected || ssm_payload[0] != 0xE8) {
     return false;
   }
 
   const uint8_t* data = &ssm_payload[1];
+  for (size_t i = 0; i < count; ++i) {
+    const ssm_param_t* param = &k_ssm_params[params[i]];
+    out_values[i] = ssm_param_decode(param, data);
+    data += param->length;
+  }
+  return true;
+}
 
-  response->water_temp = ssm_ecu_parse_coolant_temp(data[0]);
-  response->af_correct = ssm_ecu_parse_af_correction(data[1]);
-  response->af_learned = ssm_ecu_parse_af_learning(data[2]);
-  response->engine_rpm = ssm_ecu_parse_rpm((uint16_t)((data[3] << 8) | data[4]));
-  response->int_temp = ssm_ecu_parse_intake_air_temp(data[5]);
-  response->inj_duty = ssm_ecu_parse_injector_duty(ssm_ecu_parse_injector_pw_ms(data[6]), response->engine_rpm);
-  response->af_ratio = ssm_ecu_parse_afr(data[7]);
-  response->dam = ssm_ecu_parse_dam(data[8]);
-  response->fb_knock = ssm_ecu_parse_feedback_knock((uint32_t)data[9] << 24 | (uint32_t)data[10] << 16 |
-                                                    (uint32_t)data[11] << 8 | (uint32_t)data[12]);
-  response->eth_conc = ssm_ecu_parse_ethanol_concentration((uint16_t)((data[13] << 8) | data[14]));
-  response->throttle_pos = ssm_ecu_parse_throttle_pos(data[15]);
+uint32_t request_ecu_normalize_fields(uint32_t field_mask) {
+  field_mask &= REQUEST_ECU_ALL_FIELDS;
+  if (field_mask & REQUEST_ECU_FIELD_BIT(inj_duty)) {
+    field_mask |= REQUEST_ECU_FIELD_BIT(engine_rpm);
+  }
+  return field_mask;
+}
+
+size_t request_ecu_build_poll_payload(uint32_t field_mask, uint8_t* out_payload, size_t out_capacity) {
+  ssm_param_id_t params[SSM_ECU_FIELD_COUNT];
+  const ssm_ecu_field_t* fields[SSM_ECU_FIELD_COUNT];
+  const size_t count = select_fields(request_ecu_normalize_fields(field_mask), params, fields);
+  return request_ecu_build_read_payload(params, count, out_payload, out_capacity);
+}
+
+bool request_ecu_template_update(request_ecu_template_t* request, uint32_t field_mask) {
+  if (request == NULL) {
+    return false;
+  }
+  field_mask = request_ecu_normalize_fields(field_mask);
+  if (field_mask != 0 && field_mask == request->field_mask) {
+    return true;
+  }
+
+  request->field_mask = 0;
+  request->frame_count = 0;
+  memset(request->frames, 0, sizeof(request->frames));  // zero padding, not a previous request
+  uint8_t payload[64];
+  const size_t length = request_ecu_build_poll_payload(field_mask, payload, sizeof(payload));
+  if (length == 0 ||
+      !isotp_wrap_payload(payload, (uint16_t)length, request->frames, REQUEST_ECU_MAX_FRAMES, &request->frame_count)) {
+    request->frame_count = 0;
+    return false;
+  }
+  request->field_mask = field_mask;
+  request->builds++;
+  return true;
+}
 
+bool request_ecu_parse_ssm_response(uint32_t field_mask, const uint8_t* ssm_payload, size_t length,
+                                    request_ecu_response_t* response) {
+  ssm_param_id_t params[SSM_ECU_FIELD_COUNT];
+  const ssm_ecu_field_t* fields[SSM_ECU_FIELD_COUNT];
+  float values[SSM_ECU_FIELD_COUNT];
+  field_mask = request_ecu_normalize_fields(field_mask);
+  const size_t count = select_fields(field_mask, params, fields);
+  if (response == NULL || !request_ecu_parse_read_response(params, count, ssm_payload, length, values)) {
+    return false;
+  }
+
+  for (size_t i = 0; i < count; ++i) {
+    memcpy((uint8_t*)response + fields[i]->member, &values[i], sizeof(float));
+  }
+  if (field_mask & REQUEST_ECU_FIELD_BIT(inj_duty)) {
+    // RPM is always polled with injector duty.
+    response->inj_duty = ssm_ecu_injector_duty(response->inj_duty, response->engine_rpm);
+  }
   return true;
 }
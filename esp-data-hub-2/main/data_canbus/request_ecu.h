@@ -4,6 +4,18 @@
 #include <stddef.h>
 #include <stdint.h>
 
+#include "ssm_param_table.h"
+#include "telemetry_types.h"
+
+#define REQUEST_ECU_FIELD_BIT(name) (1UL << TELEMETRY_CHANNEL_##name)
+
+// Channels that can be polled over SSM, as TELEMETRY_CHANNEL_* bits.
+#define REQUEST_ECU_ALL_FIELDS                                                                                \
+  (REQUEST_ECU_FIELD_BIT(water_temp) | REQUEST_ECU_FIELD_BIT(af_correct) | REQUEST_ECU_FIELD_BIT(af_learned) | \
+   REQUEST_ECU_FIELD_BIT(engine_rpm) | REQUEST_ECU_FIELD_BIT(int_temp) | REQUEST_ECU_FIELD_BIT(inj_duty) |     \
+   REQUEST_ECU_FIELD_BIT(af_ratio) | REQUEST_ECU_FIELD_BIT(dam) | REQUEST_ECU_FIELD_BIT(fb_knock) |            \
+   REQUEST_ECU_FIELD_BIT(eth_conc) | REQUEST_ECU_FIELD_BIT(throttle_pos))
+
 typedef struct {
   // primary
   float water_temp;
@@ -25,5 +37,43 @@ typedef struct {
   float engine_rpm;
 } request_ecu_response_t;
 
-size_t request_ecu_build_poll_payload(uint8_t* out_payload, size_t out_capacity);
-bool request_ecu_parse_ssm_response(const uint8_t* ssm_payload, size_t length, request_ecu_response_t* response);
+// Builds an SSM read request (service 0xA8) for `count` parameters of the
+// generated table, in order, one address per parameter byte. Returns 0 if the
+// list is empty or holds an unknown id, or the output is too small.
+size_t request_ecu_build_read_payload(const ssm_param_id_t* params, size_t count, uint8_t* out_payload,
+                                      size_t out_capacity);
+
+// Decodes a response to the request built from the same list into
+// `out_values`, one engineering value per parameter.
+bool request_ecu_parse_read_response(const ssm_param_id_t* params, size_t count, const uint8_t* ssm_payload,
+                                     size_t length, float* out_values);
+
+// Limits `field_mask` to REQUEST_ECU_ALL_FIELDS. Injector duty is derived from
+// RPM, so selecting inj_duty also polls engine_rpm.
+uint32_t request_ecu_normalize_fields(uint32_t field_mask);
+
+// Builds the SSM read request for the channels in `field_mask`. Returns 0 if
+// no channel is selected or the output is too small.
+size_t request_ecu_build_poll_payload(uint32_t field_mask, uint8_t* out_payload, size_t out_capacity);
+
+// Longest poll request in ISO-TP frames, with every field selected.
+#define REQUEST_ECU_MAX_FRAMES 16U
+
+// The poll request for one field mask, kept wrapped in ISO-TP frames between
+// polls so it is only rebuilt when the selected fields change.
+typedef struct {
+  uint32_t field_mask;  // normalized mask the frames request; 0 = not built
+  size_t frame_count;
+  uint8_t frames[REQUEST_ECU_MAX_FRAMES][8];
+  uint32_t builds;  // times the frames were rebuilt
+} request_ecu_template_t;
+
+// Brings `request` up to date for `field_mask`, rebuilding it only when the
+// normalized mask differs from the one it was built for. Returns false and
+// clears the template if no field is selected or the request does not fit.
+bool request_ecu_template_update(request_ecu_template_t* request, uint32_t field_mask);
+
+// Parses a response to the request built with the same `field_mask`. Only the
+// selected members of `response` are written.
+bool request_ecu_parse_ssm_response(uint32_t field_mask, const uint8_t* ssm_payload, size_t length,
+                                    request_ecu_response_t* response);
@@ -1,25 +1,14 @@
 #include "request_vdc.h"
 
-#include <string.h>
+#include "isotp_codec.h"
 
-#include "can_transport.h"
-#include "isotp.h"
-
-bool request_vdc_send(twai_node_handle_t node_hdl) {
-  uint8_t uds_req_payload[8] = {0};
-  const size_t uds_len = 5;
-  uds_req_payload[0] = 0x22;  // read data by identifier
-  uds_req_payload[1] = 0x10;  // brake pressure DID 0x102B
-  uds_req_payload[2] = 0x2B;
-  uds_req_payload[3] = 0x10;  // steering angle DID 0x1029
-  uds_req_payload[4] = 0x29;
-
-  uint8_t can_frame[8] = {0};
-  can_frame[0] = ISOTP_SINGLE_FRAME | (uint8_t)(uds_len & 0x0F);
-  memcpy(&can_frame[1], &uds_req_payload[0], uds_len);
-
-  return can_transport_transmit_frame(node_hdl, VDC_REQ_ID, can_frame, sizeof(can_frame));
-}
+const uint8_t request_vdc_request[1][8] = {{
+    ISOTP_SINGLE_FRAME | 5,
+    0x22,        // read data by identifier
+    0x10, 0x2B,  // brake pressure DID 0x102B
+    0x10, 0x29,  // steering angle DID 0x1029
+    0x00, 0x00,
+}};
 
 bool request_vdc_parse_response(const uint8_t* uds_payload, size_t length, float* out_brake_pressure_bar,
                                 float* out_steering_angle_deg) {
@@ -4,8 +4,9 @@
 #include <stddef.h>
 #include <stdint.h>
 
-#include "esp_twai.h"
+// ReadDataByIdentifier for brake pressure and steering angle, as the single
+// frame an isotp_session_t sends.
+extern const uint8_t request_vdc_request[1][8];
 
-bool request_vdc_send(twai_node_handle_t node_hdl);
 bool request_vdc_parse_response(const uint8_t* uds_payload, size_t length, float* out_brake_pressure_bar,
                                 float* out_steering_angle_deg);
@@ -0,0 +1,34 @@
+#include "ssm_param.h"
+
+#include <string.h>
+
+float ssm_param_decode(const ssm_param_t* param, const uint8_t* data) {
+  uint32_t raw = 0;
+  for (uint8_t i = 0; i < param->length; ++i) {
+    if (param->little_endian) {
+      raw |= (uint32_t)data[i] << (8U * i);
+    } else {
+      raw = raw << 8 | data[i];
+    }
+  }
+  if (param->lut != NULL) {
+    return param->lut[raw & 0xFFU];
+  }
+
+  float x;
+  switch (param->type) {
+    case SSM_PARAM_TYPE_INT: {
+      const uint32_t sign = 1UL << (8U * param->length - 1U);
+      x = (float)((int64_t)(raw ^ sign) - (int64_t)sign);
+      break;
+    }
+    case SSM_PARAM_TYPE_FLOAT:
+      memcpy(&x, &raw, sizeof(x));
+      break;
+    case SSM_PARAM_TYPE_UINT:
+    default:
+      x = (float)raw;
+      break;
+  }
+  return x * param->scale + param->offset;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// One ECU memory parameter readable over SSM (service 0xA8): where it lives,
+// how its bytes form a raw value and how that value converts to engineering
+// units. The table itself, ssm_param_table.{c,h}, is generated from
+// scripts/subaru-decode/known-addresses.yaml by gen_ssm_params.py.
+
+#define SSM_PARAM_MAX_LENGTH 4U
+
+typedef enum {
+  SSM_PARAM_TYPE_UINT = 0,
+  SSM_PARAM_TYPE_INT,    // two's complement
+  SSM_PARAM_TYPE_FLOAT,  // IEEE 754 single, length 4
+} ssm_param_type_t;
+
+typedef struct {
+  const char* name;
+  const char* unit;
+  uint32_t address;  // first byte; the others follow at address + 1..
+  uint8_t length;    // bytes, 1..SSM_PARAM_MAX_LENGTH
+  bool little_endian;
+  ssm_param_type_t type;
+  // value = raw * scale + offset, unless `lut` is set: one-byte parameters
+  // whose conversion is not affine are looked up by raw byte instead.
+  float scale;
+  float offset;
+  const float* lut;
+} ssm_param_t;
+
+// Converts the `param->length` response bytes at `data` to engineering units.
+float ssm_param_decode(const ssm_param_t* param, const uint8_t* data);
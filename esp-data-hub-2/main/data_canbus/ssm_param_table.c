@@ -0,0 +1,45 @@
+// Generated by scripts/subaru-decode/gen_ssm_params.py from known-addresses.yaml; do not edit.
+#include "ssm_param_table.h"
+
+// clang-format off
+const ssm_param_t k_ssm_params[SSM_PARAM_COUNT] = {
+    [SSM_PARAM_COOLANT_TEMPERATURE] = {.name = "Coolant Temperature", .unit = "F", .address = 0x000008, .length = 1,
+        .type = SSM_PARAM_TYPE_UINT, .scale = 1.8f, .offset = -40.0f},
+    [SSM_PARAM_A_F_CORRECTION_1] = {.name = "A/F Correction #1", .unit = "%", .address = 0x000009, .length = 1,
+        .type = SSM_PARAM_TYPE_UINT, .scale = 0.78125f, .offset = -100.0f},
+    [SSM_PARAM_A_F_LEARNING_1] = {.name = "A/F Learning #1", .unit = "%", .address = 0x00000A, .length = 1,
+        .type = SSM_PARAM_TYPE_UINT, .scale = 0.78125f, .offset = -100.0f},
+    [SSM_PARAM_ENGINE_SPEED] = {.name = "Engine Speed", .unit = "RPM", .address = 0x00000E, .length = 2,
+        .type = SSM_PARAM_TYPE_UINT, .scale = 0.25f, .offset = 0.0f},
+    [SSM_PARAM_IGNITION_TOTAL_TIMING] = {.name = "Ignition Total Timing", .unit = "deg", .address = 0x000011, .length = 1,
+        .type = SSM_PARAM_TYPE_UINT, .scale = 0.5f, .offset = -64.0f},
+    [SSM_PARAM_INTAKE_AIR_TEMPERATURE] = {.name = "Intake Air Temperature", .unit = "F", .address = 0x000012, .length = 1,
+        .type = SSM_PARAM_TYPE_UINT, .scale = 1.8f, .offset = -40.0f},
+    [SSM_PARAM_MASS_AIRFLOW] = {.name = "Mass Airflow", .unit = "g/s", .address = 0x000013, .length = 2,
+        .type = SSM_PARAM_TYPE_UINT, .scale = 0.01f, .offset = 0.0f},
+    [SSM_PARAM_THROTTLE_OPENING_ANGLE] = {.name = "Throttle Opening Angle", .unit = "%", .address = 0x000015, .length = 1,
+        .type = SSM_PARAM_TYPE_UINT, .scale = 0.39215686f, .offset = 0.0f},
+    [SSM_PARAM_REAR_O2_SENSOR] = {.name = "Rear O2 Sensor", .unit = "V", .address = 0x000018, .length = 2,
+        .type = SSM_PARAM_TYPE_UINT, .scale = 0.005f, .offset = 0.0f},
+    [SSM_PARAM_MASS_AIRFLOW_SENSOR_VOLTAGE] = {.name = "Mass Airflow Sensor Voltage", .unit = "V", .address = 0x00001D, .length = 1,
+        .type = SSM_PARAM_TYPE_UINT, .scale = 0.02f, .offset = 0.0f},
+    [SSM_PARAM_FUEL_INJECTOR_1_PULSE_WIDTH] = {.name = "Fuel Injector #1 Pulse Width", .unit = "µs", .address = 0x000020, .length = 1,
+        .type = SSM_PARAM_TYPE_UINT, .scale = 256.0f, .offset = 0.0f},
+    [SSM_PARAM_ACCELERATOR_PEDAL] = {.name = "Accelerator Pedal", .unit = "%", .address = 0x000029, .length = 1,
+        .type = SSM_PARAM_TYPE_UINT, .scale = 0.39215686f, .offset = 0.0f},
+    [SSM_PARAM_A_F_SENSOR_1_CURRENT] = {.name = "A/F Sensor #1 Current", .unit = "mA", .address = 0x000042, .length = 1,
+        .type = SSM_PARAM_TYPE_UINT, .scale = 0.125f, .offset = -16.0f},
+    [SSM_PARAM_A_F_SENSOR_1] = {.name = "A/F Sensor #1", .unit = "AFR", .address = 0x000046, .length = 1,
+        .type = SSM_PARAM_TYPE_UINT, .scale = 0.11484375f, .offset = 0.0f},
+    [SSM_PARAM_ETHANOL_CONCENTRATION] = {.name = "Ethanol Concentration", .unit = "%", .address = 0xFF1EE4, .length = 2,
+        .type = SSM_PARAM_TYPE_UINT, .scale = 0.0015258789f, .offset = 0.0f},
+    [SSM_PARAM_BOOST] = {.name = "Boost", .unit = "psi", .address = 0xFF63D4, .length = 4,
+        .type = SSM_PARAM_TYPE_FLOAT, .scale = 0.01933677f, .offset = 0.0f},
+    [SSM_PARAM_DAM] = {.name = "DAM", .unit = "multiplier", .address = 0xFF6B49, .length = 1,
+        .type = SSM_PARAM_TYPE_UINT, .scale = 0.0625f, .offset = 0.0f},
+    [SSM_PARAM_KNOCK_CORRECTION_ADVANCE] = {.name = "Knock Correction Advance", .unit = "multiplier", .address = 0xFF8480, .length = 4,
+        .type = SSM_PARAM_TYPE_FLOAT, .scale = 1.0f, .offset = 0.0f},
+    [SSM_PARAM_FINE_KNOCK_LEARN] = {.name = "Fine Knock Learn", .unit = "multiplier", .address = 0xFF851C, .length = 4,
+        .type = SSM_PARAM_TYPE_FLOAT, .scale = 1.0f, .offset = 0.0f},
+};
+// clang-format on
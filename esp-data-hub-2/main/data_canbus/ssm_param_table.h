@@ -0,0 +1,29 @@
+// Generated by scripts/subaru-decode/gen_ssm_params.py from known-addresses.yaml; do not edit.
+#pragma once
+
+#include "ssm_param.h"
+
+typedef enum {
+  SSM_PARAM_COOLANT_TEMPERATURE,          // 0x000008
+  SSM_PARAM_A_F_CORRECTION_1,             // 0x000009
+  SSM_PARAM_A_F_LEARNING_1,               // 0x00000A
+  SSM_PARAM_ENGINE_SPEED,                 // 0x00000E
+  SSM_PARAM_IGNITION_TOTAL_TIMING,        // 0x000011
+  SSM_PARAM_INTAKE_AIR_TEMPERATURE,       // 0x000012
+  SSM_PARAM_MASS_AIRFLOW,                 // 0x000013
+  SSM_PARAM_THROTTLE_OPENING_ANGLE,       // 0x000015
+  SSM_PARAM_REAR_O2_SENSOR,               // 0x000018
+  SSM_PARAM_MASS_AIRFLOW_SENSOR_VOLTAGE,  // 0x00001D
+  SSM_PARAM_FUEL_INJECTOR_1_PULSE_WIDTH,  // 0x000020
+  SSM_PARAM_ACCELERATOR_PEDAL,            // 0x000029
+  SSM_PARAM_A_F_SENSOR_1_CURRENT,         // 0x000042
+  SSM_PARAM_A_F_SENSOR_1,                 // 0x000046
+  SSM_PARAM_ETHANOL_CONCENTRATION,        // 0xFF1EE4
+  SSM_PARAM_BOOST,                        // 0xFF63D4
+  SSM_PARAM_DAM,                          // 0xFF6B49
+  SSM_PARAM_KNOCK_CORRECTION_ADVANCE,     // 0xFF8480
+  SSM_PARAM_FINE_KNOCK_LEARN,             // 0xFF851C
+  SSM_PARAM_COUNT,
+} ssm_param_id_t;
+
+extern const ssm_param_t k_ssm_params[SSM_PARAM_COUNT];
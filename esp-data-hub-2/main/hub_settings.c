@@ -0,0 +1,44 @@
+#include "hub_settings.h"
+
+#include <stddef.h>
+
+#include "request_ecu.h"
+
+static uint32_t clamp_u32(uint32_t value, uint32_t min_value, uint32_t max_value) {
+  if (value < min_value) {
+    return min_value;
+  }
+  return value > max_value ? max_value : value;
+}
+
+bool hub_settings_apply(hub_settings_t* settings, const telemetry_control_t* control, telemetry_control_t* reply) {
+  if (settings == NULL || control == NULL || reply == NULL) {
+    return false;
+  }
+
+  uint32_t applied;
+  switch (control->type) {
+    case TELEMETRY_CONTROL_SET_EMIT_PERIOD:
+      applied = clamp_u32(control->value, HUB_SETTINGS_EMIT_PERIOD_MIN_MS, HUB_SETTINGS_EMIT_PERIOD_MAX_MS);
+      settings->emit_period_ms = applied;
+      break;
+    case TELEMETRY_CONTROL_SET_ECU_POLL_PERIOD:
+      applied = clamp_u32(control->value, HUB_SETTINGS_POLL_PERIOD_MIN_MS, HUB_SETTINGS_POLL_PERIOD_MAX_MS);
+      settings->ecu_poll_period_ms = applied;
+      break;
+    case TELEMETRY_CONTROL_SET_VDC_POLL_PERIOD:
+      applied = clamp_u32(control->value, HUB_SETTINGS_POLL_PERIOD_MIN_MS, HUB_SETTINGS_POLL_PERIOD_MAX_MS);
+      settings->vdc_poll_period_ms = applied;
+      break;
+    case TELEMETRY_CONTROL_SET_ECU_FIELDS:
+      applied = request_ecu_normalize_fields(control->value);
+      settings->ecu_field_mask = applied;
+      break;
+    default:
+      return false;
+  }
+
+  reply->type = control->type;
+  reply->value = applied;
+  return true;
+}
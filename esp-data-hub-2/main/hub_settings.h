@@ -0,0 +1,27 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "telemetry_protocol.h"
+
+// Settings the display can change at runtime with SET_* control frames. They
+// start from Kconfig and last until the hub restarts.
+typedef struct {
+  uint32_t emit_period_ms;      // UART telemetry period (fast channels with multi-rate)
+  uint32_t ecu_poll_period_ms;  // SSM request period
+  uint32_t vdc_poll_period_ms;  // VDC request period
+  uint32_t ecu_field_mask;      // TELEMETRY_CHANNEL_* bits polled over SSM, within REQUEST_ECU_ALL_FIELDS
+} hub_settings_t;
+
+// Poll periods use the Kconfig ranges. The emit period stops at 500 ms so the
+// display's one second link silence check keeps seeing frames.
+#define HUB_SETTINGS_EMIT_PERIOD_MIN_MS 1U
+#define HUB_SETTINGS_EMIT_PERIOD_MAX_MS 500U
+#define HUB_SETTINGS_POLL_PERIOD_MIN_MS 1U
+#define HUB_SETTINGS_POLL_PERIOD_MAX_MS 60000U
+
+// Applies a SET_* control frame. Returns false for any other type. Otherwise
+// the value is clamped to its range and stored, and `reply` is filled with the
+// same type and the value applied, for the hub to send back.
+bool hub_settings_apply(hub_settings_t* settings, const telemetry_control_t* control, telemetry_control_t* reply);
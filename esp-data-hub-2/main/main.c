@@ -7,6 +7,8 @@
 #include <stdio.h>
 
 #include "app_context.h"
+#include "can_broadcast.h"
+#include "can_routes.h"
 #include "can_transport.h"
 #include "driver/uart.h"
 #include "esp_err.h"
@@ -17,8 +19,11 @@
 #include "freertos/task.h"
 #include "sdkconfig.h"
 #include "tasks/task_analog_sensors.h"
-#include "tasks/task_can_rx_dispatcher.h"
+#include "tasks/task_can_broadcast.h"
+#include "tasks/task_can_replay.h"
+#include "tasks/task_can_trace.h"
 #include "tasks/task_ecu_ssm.h"
+#include "tasks/task_isotp.h"
 #include "tasks/task_racechrono_ble.h"
 #include "tasks/task_twai_monitor.h"
 #include "tasks/task_uart_emitter.h"
@@ -28,6 +33,22 @@
 static const char* TAG = "app_main";
 #define DH_UART_PORT ((uart_port_t)CONFIG_DH_UART_PORT)
 
+#ifdef CONFIG_DH_CAN_BROADCAST
+// One route per broadcast ID in the decoder table.
+static bool register_broadcast_routes(can_rx_sink_t* sink) {
+  for (size_t i = 0; i < can_broadcast_signal_count; ++i) {
+    bool seen = false;
+    for (size_t j = 0; j < i; ++j) {
+      seen = seen || can_broadcast_signals[j].can_id == can_broadcast_signals[i].can_id;
+    }
+    if (!seen && !can_transport_register(can_broadcast_signals[i].can_id, CAN_ROUTES_STD_MASK, sink)) {
+      return false;
+    }
+  }
+  return true;
+}
+#endif
+
 void app_main(void) {
   printf("Hello world!\n");
 
@@ -38,7 +59,7 @@ void app_main(void) {
   twai_onchip_node_config_t node_config = {
       .io_cfg.tx = CONFIG_DH_TWAI_TX_GPIO,
       .io_cfg.rx = CONFIG_DH_TWAI_RX_GPIO,
-      .bit_timing.bitrate = 500000,
+      .bit_timing.bitrate = CAN_BUS_BITRATE,
       .tx_queue_depth = 8,
   };
   twai_node_handle_t node_hdl = NULL;
@@ -53,13 +74,27 @@ void app_main(void) {
     ESP_LOGE(TAG, "Failed to create app context");
     return;
   }
+  if (!can_transport_register(ECU_RES_ID, CAN_ROUTES_STD_MASK, &app.ecu_rx) ||
+      !can_transport_register(VDC_RES_ID, CAN_ROUTES_STD_MASK, &app.vdc_rx)) {
+    return;
+  }
+#ifdef CONFIG_DH_CAN_BROADCAST
+  if (!register_broadcast_routes(&app.chassis_rx)) {
+    return;
+  }
+#endif
 
   twai_event_callbacks_t twai_cbs = {
       .on_tx_done = can_transport_tx_done_callback,
       .on_rx_done = can_transport_rx_callback,
+      .on_state_change = can_transport_state_callback,
+      .on_error = can_transport_error_callback,
   };
   ESP_ERROR_CHECK(twai_node_register_event_callbacks(node_hdl, &twai_cbs, &app));
-  ESP_ERROR_CHECK(twai_node_enable(node_hdl));
+  if (!can_transport_start(node_hdl)) {
+    ESP_LOGE(TAG, "Failed to start CAN transport");
+    return;
+  }
 
 #ifdef CONFIG_DH_UART_ENABLED
   uart_config_t uart_config = {
@@ -87,6 +122,12 @@ void app_main(void) {
   }
 #endif
 
+  // Above the poll tasks, so consecutive frames and flow control go out on
+  // time while they parse.
+  if (xTaskCreate(task_isotp, "task_isotp", 4096, NULL, tskIDLE_PRIORITY + 2, NULL) != pdPASS) {
+    ESP_LOGE(TAG, "Failed to create ISO-TP task");
+    return;
+  }
   if (xTaskCreate(task_ecu_ssm, "task_ecu_ssm", 8192 * 2, (void*)&app, tskIDLE_PRIORITY + 1, NULL) != pdPASS) {
     ESP_LOGE(TAG, "Failed to create ECU SSM task");
     return;
@@ -95,7 +136,28 @@ void app_main(void) {
     ESP_LOGE(TAG, "Failed to create VDC UDS task");
     return;
   }
-  xTaskCreate(task_can_rx_dispatcher, "task_can_rx_dispatcher", 8192, (void*)&app, tskIDLE_PRIORITY + 2, NULL);
+#ifdef CONFIG_DH_CAN_BROADCAST
+  if (xTaskCreate(task_can_broadcast, "task_can_broadcast", 4096, (void*)&app, tskIDLE_PRIORITY + 1, NULL) != pdPASS) {
+    ESP_LOGE(TAG, "Failed to create CAN broadcast task");
+    return;
+  }
+#endif
+#ifdef CONFIG_DH_CAN_REPLAY
+#ifdef CONFIG_DH_CAN_REPLAY_REALTIME
+  const UBaseType_t replay_priority = tskIDLE_PRIORITY + 1;
+#else
+  // Flat out, yielding only to equal priority: share the CPU with idle
+  // rather than starving it.
+  const UBaseType_t replay_priority = tskIDLE_PRIORITY;
+#endif
+  if (xTaskCreate(task_can_replay, "task_can_replay", 4096, NULL, replay_priority, NULL) != pdPASS) {
+    ESP_LOGE(TAG, "Failed to create CAN replay task");
+    return;
+  }
+#endif
+#ifdef CONFIG_DH_CAN_TRACE
+  xTaskCreate(task_can_trace, "task_can_trace", 4096, NULL, tskIDLE_PRIORITY + 1, NULL);
+#endif
   xTaskCreate(task_analog_sensors, "task_analog_sensors", 8192, (void*)&app, tskIDLE_PRIORITY + 1, NULL);
   xTaskCreate(task_twai_monitor, "task_twai_monitor", 4096, (void*)&app, tskIDLE_PRIORITY + 1, NULL);
 #ifdef CONFIG_DH_UART_ENABLED
@@ -4,6 +4,7 @@
 #include "app_context.h"
 #include "esp_err.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "sdkconfig.h"
 
 static const char* TAG = "task_analog_sensors";
@@ -45,6 +46,9 @@ void task_analog_sensors(void* arg) {
       app->vehicle_state.oil_temp = reading.oil_temp_f;
       app->vehicle_state.oil_pressure = reading.oil_pressure_filtered_psi;
       app->vehicle_state.oil_pressure_raw = reading.oil_pressure_raw_psi;
+#ifdef CONFIG_DH_UART_SAMPLE_BATCHES
+      telemetry_sample_batch_push(&app->oil_samples, (uint32_t)(esp_timer_get_time() / 1000), &app->vehicle_state);
+#endif
       xSemaphoreGive(app->vehicle_state_mutex);
     } else {
       ESP_LOGW(TAG, "failed to take vehicle_state_mutex");
@@ -0,0 +1,64 @@
+#include "task_can_broadcast.h"
+
+#include <inttypes.h>
+#include <stdint.h>
+
+#include "app_context.h"
+#include "can_broadcast.h"
+#include "can_transport.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "sdkconfig.h"
+
+#ifdef CONFIG_DH_CAN_BROADCAST
+
+static const char* TAG = "task_can_broadcast";
+
+// Checks for timed-out channels at least this often when the bus is quiet.
+#define BROADCAST_IDLE_WAIT_MS 100
+
+void task_can_broadcast(void* arg) {
+  app_context_t* app = (app_context_t*)arg;
+  if (app == NULL) {
+    vTaskDelete(NULL);
+    return;
+  }
+
+  can_transport_sink_attach(&app->chassis_rx);
+  can_broadcast_tracker_t tracker = {0};
+  vehicle_state_t decoded = {0};
+  uint32_t covered = 0;
+
+  while (1) {
+    // Decode everything queued, then publish it under one mutex take.
+    uint32_t decoded_mask = 0;
+    can_rx_frame_t frame;
+    TickType_t wait = pdMS_TO_TICKS(BROADCAST_IDLE_WAIT_MS);
+    while (can_transport_sink_receive(&app->chassis_rx, &frame, wait)) {
+      decoded_mask |= can_broadcast_decode(can_broadcast_signals, can_broadcast_signal_count, frame.id, frame.ide,
+                                           frame.data, frame.data_len, &decoded);
+      wait = 0;
+    }
+
+    const uint32_t now_ms = (uint32_t)(esp_timer_get_time() / 1000);
+    can_broadcast_tracker_note(&tracker, decoded_mask, now_ms);
+    const uint32_t fresh = can_broadcast_tracker_fresh(&tracker, now_ms, CONFIG_DH_CAN_BROADCAST_TIMEOUT_MS);
+    if (fresh != covered) {
+      ESP_LOGI(TAG, "broadcast channels 0x%08" PRIX32 " -> 0x%08" PRIX32 ", the rest are polled", covered, fresh);
+    }
+
+    if (decoded_mask == 0 && fresh == covered) {
+      continue;
+    }
+    if (xSemaphoreTake(app->vehicle_state_mutex, pdMS_TO_TICKS(5)) == pdTRUE) {
+      can_broadcast_copy_channels(decoded_mask, &decoded, &app->vehicle_state);
+      app->broadcast_fields = fresh;
+      xSemaphoreGive(app->vehicle_state_mutex);
+      covered = fresh;
+    } else {
+      ESP_LOGW(TAG, "failed to take vehicle_state_mutex");
+    }
+  }
+}
+
+#endif  // CONFIG_DH_CAN_BROADCAST
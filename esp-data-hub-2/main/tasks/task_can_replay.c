@@ -0,0 +1,85 @@
+#include "task_can_replay.h"
+
+#include <inttypes.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "can_trace.h"
+#include "can_transport.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "sdkconfig.h"
+
+#ifdef CONFIG_DH_CAN_REPLAY
+
+static const char* TAG = "task_can_replay";
+
+// CONFIG_DH_CAN_REPLAY_FILE, embedded with a trailing NUL by
+// main/CMakeLists.txt.
+extern const char can_replay_trc_start[] asm("_binary_can_replay_trc_start");
+extern const char can_replay_trc_end[] asm("_binary_can_replay_trc_end");
+
+#define REPLAY_TICK_US (portTICK_PERIOD_MS * 1000U)
+
+#ifdef CONFIG_DH_CAN_REPLAY_LOOP
+#define REPLAY_LOOP true
+#else
+#define REPLAY_LOOP false
+#endif
+
+// Waits until `due_us` past `start_us`, rounded up to a tick, or just lets the
+// session tasks run when replaying as fast as possible.
+static void wait_until_due(int64_t start_us, uint64_t due_us) {
+#ifdef CONFIG_DH_CAN_REPLAY_REALTIME
+  const int64_t ahead = start_us + (int64_t)due_us - esp_timer_get_time();
+  if (ahead > 0) {
+    vTaskDelay((TickType_t)((ahead + REPLAY_TICK_US - 1) / REPLAY_TICK_US));
+  }
+#else
+  (void)start_us;
+  (void)due_us;
+  taskYIELD();
+#endif
+}
+
+void task_can_replay(void* arg) {
+  (void)arg;
+  const size_t len = (size_t)(can_replay_trc_end - can_replay_trc_start);
+
+  do {
+    can_trace_replay_t replay;
+    can_trace_replay_init(&replay, can_replay_trc_start, len);
+    const int64_t start_us = esp_timer_get_time();
+    uint32_t full_waits = 0;
+    can_trace_record_t record;
+    uint64_t due_us = 0;
+
+    while (can_trace_replay_next(&replay, &record, &due_us)) {
+      wait_until_due(start_us, due_us);
+      can_rx_frame_t frame = {
+          .id = record.id,
+          .ide = (record.flags & CAN_TRACE_FLAG_IDE) != 0,
+          .data_len = record.dlc,
+      };
+      memcpy(frame.data, record.data, record.dlc);
+      // A full session holds the replay back rather than losing the frame,
+      // so every run of the same trace delivers the same frames.
+      while (!can_transport_inject_frame(&frame)) {
+        full_waits++;
+        vTaskDelay(1);
+      }
+    }
+
+    ESP_LOGI(TAG, "replayed %" PRIu32 " frames in %" PRIu32 " ms, %" PRIu32 " malformed lines, %" PRIu32
+                  " waits on a full session",
+             replay.frames, (uint32_t)((esp_timer_get_time() - start_us) / 1000), replay.malformed, full_waits);
+    if (replay.frames == 0) {
+      ESP_LOGE(TAG, "%s holds no frames", CONFIG_DH_CAN_REPLAY_FILE);
+      break;
+    }
+  } while (REPLAY_LOOP);
+
+  vTaskDelete(NULL);
+}
+
+#endif  // CONFIG_DH_CAN_REPLAY
@@ -1,3 +0,0 @@
-#pragma once
-
-void task_can_rx_dispatcher(void* arg);
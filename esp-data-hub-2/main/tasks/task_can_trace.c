@@ -0,0 +1,90 @@
+#include "task_can_trace.h"
+
+#include <inttypes.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdint.h>
+
+#include "can_transport.h"
+#include "driver/uart.h"
+#include "esp_log.h"
+#include "sdkconfig.h"
+
+#ifdef CONFIG_DH_CAN_TRACE
+
+static const char* TAG = "task_can_trace";
+
+#define TRACE_CONSOLE_PORT ((uart_port_t)CONFIG_ESP_CONSOLE_UART_NUM)
+#define TRACE_CONSOLE_RX_BUFFER 256
+
+// Log writes other tasks made while a dump held the console.
+static atomic_uint_least32_t s_dropped_log_writes;
+
+static int drop_log_write(const char* format, va_list args) {
+  (void)format;
+  (void)args;
+  atomic_fetch_add_explicit(&s_dropped_log_writes, 1, memory_order_relaxed);
+  return 0;
+}
+
+static void write_console(const char* text, size_t len, void* ctx) {
+  (void)ctx;
+  uart_write_bytes(TRACE_CONSOLE_PORT, text, len);
+}
+
+static void log_trace_stats(const char* what) {
+  can_transport_trace_stats_t stats;
+  can_transport_get_trace_stats(&stats);
+  ESP_LOGI(TAG, "%s: %" PRIu32 "/%" PRIu32 " frames, %" PRIu32 " overwritten, capture %s", what, stats.frames,
+           stats.capacity, stats.overwritten, stats.enabled ? "on" : "off");
+}
+
+void task_can_trace(void* arg) {
+  (void)arg;
+  // Only the RX side goes through the driver; the console still writes
+  // directly.
+  esp_err_t err = uart_driver_install(TRACE_CONSOLE_PORT, TRACE_CONSOLE_RX_BUFFER, 0, 0, NULL, 0);
+  if (err != ESP_OK) {
+    ESP_LOGE(TAG, "console UART driver install failed: %s", esp_err_to_name(err));
+    vTaskDelete(NULL);
+    return;
+  }
+  log_trace_stats("CAN capture (d = dump .trc, c = clear, s = stop/start)");
+
+  while (1) {
+    uint8_t key = 0;
+    if (uart_read_bytes(TRACE_CONSOLE_PORT, &key, 1, portMAX_DELAY) != 1) {
+      continue;
+    }
+    switch (key) {
+      case 'd': {
+        // Log lines from other tasks would land in the middle of the trace.
+        // Divert the log output instead of lowering levels, so levels set
+        // per tag or at run time are untouched.
+        atomic_store_explicit(&s_dropped_log_writes, 0, memory_order_relaxed);
+        const vprintf_like_t previous = esp_log_set_vprintf(drop_log_write);
+        can_transport_trace_dump(write_console, NULL);
+        uart_wait_tx_done(TRACE_CONSOLE_PORT, portMAX_DELAY);
+        esp_log_set_vprintf(previous);
+        log_trace_stats("dumped");
+        const uint32_t dropped = atomic_load_explicit(&s_dropped_log_writes, memory_order_relaxed);
+        if (dropped > 0) {
+          ESP_LOGW(TAG, "%" PRIu32 " log writes dropped during the dump", dropped);
+        }
+        break;
+      }
+      case 'c':
+        can_transport_trace_clear();
+        log_trace_stats("cleared");
+        break;
+      case 's':
+        can_transport_trace_set_enabled(!can_transport_trace_set_enabled(false));
+        log_trace_stats("toggled");
+        break;
+      default:
+        break;
+    }
+  }
+}
+
+#endif  // CONFIG_DH_CAN_TRACE
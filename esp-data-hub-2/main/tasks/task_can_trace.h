@@ -0,0 +1,3 @@
+#pragma once
+
+void task_can_trace(void* arg);
@@ -1,32 +1,120 @@
 #include "task_ecu_ssm.h"
 
+#include <inttypes.h>
 #include <stddef.h>
 #include <stdint.h>
 
 #include "app_context.h"
-#include "can_transport.h"
 #include "can_types.h"
 #include "esp_log.h"
-#include "esp_rom_sys.h"
 #include "isotp.h"
-#include "isotp_response.h"
+#include "isotp_gap_calibration.h"
+#include "nvs_flash.h"
 #include "request_ecu.h"
 #include "sdkconfig.h"
 
 static const char* TAG = "task_ecu_ssm";
 
-static void apply_ecu_response(const request_ecu_response_t* response, vehicle_state_t* state) {
-  state->water_temp = response->water_temp;
-  state->af_correct = response->af_correct;
-  state->af_learned = response->af_learned;
-  state->engine_rpm = response->engine_rpm;
-  state->int_temp = response->int_temp;
-  state->af_ratio = response->af_ratio;
-  state->dam = response->dam;
-  state->fb_knock = response->fb_knock;
-  state->throttle_pos = response->throttle_pos;
-  state->inj_duty = response->inj_duty;
-  state->eth_conc = response->eth_conc;
+#ifdef CONFIG_DH_TWAI_ISOTP_CF_GAP_CALIBRATE
+#define CF_GAP_NVS_NAMESPACE "isotp"
+#define CF_GAP_NVS_KEY "ecu_cf_gap_us"
+#define CF_GAP_MAX_US 2000U
+#define CF_GAP_RESOLUTION_US 25U
+// Requests the ECU drops in a row at the settled gap before it is searched
+// for again.
+#define CF_GAP_RESEARCH_FAILURES 3
+
+typedef struct {
+  isotp_gap_calibration_t search;
+  bool searching;
+  uint8_t failures;  // consecutive drops at the settled gap
+} cf_gap_tuner_t;
+
+static bool load_cf_gap(uint32_t* out_us) {
+  esp_err_t err = nvs_flash_init();
+  if (err != ESP_OK && err != ESP_ERR_NVS_INVALID_STATE) {
+    ESP_LOGW(TAG, "NVS unavailable, CF gap will not persist: %s", esp_err_to_name(err));
+    return false;
+  }
+  nvs_handle_t nvs;
+  if (nvs_open(CF_GAP_NVS_NAMESPACE, NVS_READONLY, &nvs) != ESP_OK) {
+    return false;
+  }
+  err = nvs_get_u32(nvs, CF_GAP_NVS_KEY, out_us);
+  nvs_close(nvs);
+  return err == ESP_OK && *out_us <= CF_GAP_MAX_US;
+}
+
+static void store_cf_gap(uint32_t gap_us) {
+  nvs_handle_t nvs;
+  esp_err_t err = nvs_open(CF_GAP_NVS_NAMESPACE, NVS_READWRITE, &nvs);
+  if (err == ESP_OK) {
+    err = nvs_set_u32(nvs, CF_GAP_NVS_KEY, gap_us);
+    if (err == ESP_OK) {
+      err = nvs_commit(nvs);
+    }
+    nvs_close(nvs);
+  }
+  if (err != ESP_OK) {
+    ESP_LOGW(TAG, "Failed to store CF gap: %s", esp_err_to_name(err));
+  }
+}
+
+static void cf_gap_tuner_start(cf_gap_tuner_t* tuner, isotp_session_t* session, uint32_t from_us) {
+  isotp_gap_calibration_start(&tuner->search, from_us, CF_GAP_MAX_US, CF_GAP_RESOLUTION_US,
+                              CONFIG_DH_TWAI_ISOTP_CF_GAP_CALIBRATE_PASSES);
+  tuner->searching = true;
+  tuner->failures = 0;
+  isotp_session_set_cf_gap(session, isotp_gap_calibration_gap_us(&tuner->search));
+  ESP_LOGI(TAG, "Calibrating ECU consecutive frame gap from %" PRIu32 " us", from_us);
+}
+
+// Called after each segmented request: steps the search, or watches the
+// settled gap for drops.
+static void cf_gap_tuner_record(cf_gap_tuner_t* tuner, isotp_session_t* session, isotp_result_t result) {
+  const isotp_gap_trial_t trial = isotp_gap_trial_from_result(result);
+  if (!tuner->searching) {
+    if (trial == ISOTP_GAP_TRIAL_PASS) {
+      tuner->failures = 0;
+    } else if (trial == ISOTP_GAP_TRIAL_FAIL && ++tuner->failures >= CF_GAP_RESEARCH_FAILURES) {
+      cf_gap_tuner_start(tuner, session, isotp_session_cf_gap(session));
+    }
+    return;
+  }
+
+  const bool done = isotp_gap_calibration_record(&tuner->search, trial);
+  const uint32_t gap_us = isotp_gap_calibration_gap_us(&tuner->search);
+  isotp_session_set_cf_gap(session, gap_us);
+  if (!done) {
+    return;
+  }
+  tuner->searching = false;
+  if (tuner->search.found) {
+    ESP_LOGI(TAG, "ECU consecutive frame gap calibrated to %" PRIu32 " us", gap_us);
+    store_cf_gap(gap_us);
+  } else {
+    ESP_LOGW(TAG, "ECU drops requests even with a %" PRIu32 " us gap; keeping it unstored", gap_us);
+  }
+}
+#endif
+
+static void apply_ecu_response(uint32_t field_mask, const request_ecu_response_t* response, vehicle_state_t* state) {
+#define APPLY_ECU_FIELD(name)                     \
+  if (field_mask & REQUEST_ECU_FIELD_BIT(name)) { \
+    state->name = response->name;                 \
+  }
+  APPLY_ECU_FIELD(water_temp)
+  APPLY_ECU_FIELD(af_correct)
+  APPLY_ECU_FIELD(af_learned)
+  APPLY_ECU_FIELD(engine_rpm)
+  APPLY_ECU_FIELD(int_temp)
+  APPLY_ECU_FIELD(af_ratio)
+  APPLY_ECU_FIELD(dam)
+  APPLY_ECU_FIELD(fb_knock)
+  APPLY_ECU_FIELD(throttle_pos)
+  APPLY_ECU_FIELD(inj_duty)
+  APPLY_ECU_FIELD(eth_conc)
+#undef APPLY_ECU_FIELD
 }
 
 void task_ecu_ssm(void* arg) {
@@ -36,84 +124,70 @@ void task_ecu_ssm(void* arg) {
     return;
   }
 
-  const TickType_t poll_period_ticks =
-      pdMS_TO_TICKS(CONFIG_DH_ECU_POLL_PERIOD_MS > 0 ? CONFIG_DH_ECU_POLL_PERIOD_MS : 1);
+  hub_settings_t settings = app->settings;
+  request_ecu_template_t request = {0};
   TickType_t last_wake = xTaskGetTickCount();
 
-  while (1) {
-    vTaskDelayUntil(&last_wake, poll_period_ticks);
+#ifdef CONFIG_DH_TWAI_ISOTP_CF_GAP_CALIBRATE
+  cf_gap_tuner_t tuner = {0};
+  uint32_t stored_gap_us = 0;
+  if (load_cf_gap(&stored_gap_us)) {
+    isotp_session_set_cf_gap(&app->ecu_isotp, stored_gap_us);
+    ESP_LOGI(TAG, "ECU consecutive frame gap %" PRIu32 " us (calibrated)", stored_gap_us);
+  } else {
+    cf_gap_tuner_start(&tuner, &app->ecu_isotp, CONFIG_DH_TWAI_ISOTP_CF_GAP_US);
+  }
+#endif
 
-    can_rx_frame_t stale;
-    while (xQueueReceive(app->ecu_can_frames, &stale, 0) == pdTRUE) {
-      ESP_LOGW(TAG, "Drained stale ECU frame ID 0x%0X", stale.id);
-    }
+  while (1) {
+    vTaskDelayUntil(&last_wake, pdMS_TO_TICKS(settings.ecu_poll_period_ms > 0 ? settings.ecu_poll_period_ms : 1));
 
-    uint8_t ssm_req_payload[64] = {0};
-    const size_t payload_len = request_ecu_build_poll_payload(ssm_req_payload, sizeof(ssm_req_payload));
-    if (payload_len == 0) {
-      ESP_LOGE(TAG, "Failed to build ECU request payload");
+    // The display may change the period and fields between polls; if the mutex
+    // is busy the previous copy is used once more.
+    app_context_get_settings(app, &settings);
+    // Channels the car broadcasts are not polled, except RPM when injector
+    // duty still needs it.
+    const uint32_t broadcast_fields = app_context_get_broadcast_fields(app);
+    const uint32_t field_mask = request_ecu_normalize_fields(settings.ecu_field_mask & ~broadcast_fields);
+    if (field_mask == 0) {
       continue;
     }
 
-    uint8_t can_frames[16][8] = {0};
-    size_t frame_count = 0;
-    if (!isotp_wrap_payload(ssm_req_payload, (uint16_t)payload_len, can_frames, 16, &frame_count)) {
-      ESP_LOGE(TAG, "Failed to build ISO-TP frames for ECU data request");
+    // The wrapped request is reused until the display changes the fields.
+    const uint32_t builds = request.builds;
+    if (!request_ecu_template_update(&request, field_mask)) {
+      ESP_LOGE(TAG, "Failed to build ECU request for fields 0x%08" PRIX32, field_mask);
       continue;
     }
-    if (!can_transport_transmit_frame(app->node_hdl, ECU_REQ_ID, can_frames[0], 8)) {
-      continue;
+    if (request.builds != builds) {
+      ESP_LOGI(TAG, "ECU request for fields 0x%08" PRIX32 " is %u frames", field_mask, (unsigned)request.frame_count);
     }
-
-    uint8_t fc_block_size = 0;
-    uint8_t fc_stmin_raw = 0;
-    if (frame_count > 1 &&
-        !isotp_wait_for_fc(app->ecu_can_frames, pdMS_TO_TICKS(1000), &fc_block_size, &fc_stmin_raw, TAG)) {
+    // The engine reads the frames until the exchange ends, and this task
+    // waits for that before touching the request again.
+    if (!isotp_session_submit(&app->ecu_isotp, request.frames, request.frame_count)) {
       continue;
     }
-
-    bool sent_all = true;
-    uint8_t frames_sent_in_block = 0;
-    for (size_t i = 1; i < frame_count; i++) {
-      if (!can_transport_transmit_frame(app->node_hdl, ECU_REQ_ID, can_frames[i], 8)) {
-        sent_all = false;
-        break;
-      }
-      if (CONFIG_DH_TWAI_ISOTP_CF_GAP_US > 0) {
-        esp_rom_delay_us(CONFIG_DH_TWAI_ISOTP_CF_GAP_US);
-      }
-      frames_sent_in_block++;
-      if (i + 1 < frame_count) {
-        isotp_wait_stmin(fc_stmin_raw);
-      }
-      if (fc_block_size > 0 && frames_sent_in_block >= fc_block_size && i + 1 < frame_count) {
-        if (!isotp_wait_for_fc(app->ecu_can_frames, pdMS_TO_TICKS(1000), &fc_block_size, &fc_stmin_raw, TAG)) {
-          sent_all = false;
-          break;
-        }
-        frames_sent_in_block = 0;
-      }
-    }
-    if (!sent_all) {
-      continue;
+    const isotp_result_t result = isotp_session_wait(&app->ecu_isotp, portMAX_DELAY);
+#ifdef CONFIG_DH_TWAI_ISOTP_CF_GAP_CALIBRATE
+    if (request.frame_count > 1) {
+      cf_gap_tuner_record(&tuner, &app->ecu_isotp, result);
     }
-
-    uint8_t assembled_payload[128] = {0};
-    size_t assembled_len = 0;
-    if (!isotp_collect_response(app->ecu_can_frames, app->node_hdl, ECU_REQ_ID, "ECU", TAG, assembled_payload,
-                                sizeof(assembled_payload), &assembled_len)) {
+#endif
+    if (result != ISOTP_OK) {
       continue;
     }
+    const uint8_t* payload = app->ecu_isotp.response;
+    const size_t payload_len = app->ecu_isotp.response_len;
 
     request_ecu_response_t response = {0};
-    if (!request_ecu_parse_ssm_response(assembled_payload, assembled_len, &response)) {
-      ESP_LOGW(TAG, "failed to parse SSM response len=%u sid=0x%02X", (unsigned)assembled_len,
-               assembled_len > 0 ? assembled_payload[0] : 0x00);
+    if (!request_ecu_parse_ssm_response(field_mask, payload, payload_len, &response)) {
+      ESP_LOGW(TAG, "failed to parse SSM response len=%u sid=0x%02X", (unsigned)payload_len,
+               payload_len > 0 ? payload[0] : 0x00);
       continue;
     }
 
     if (xSemaphoreTake(app->vehicle_state_mutex, pdMS_TO_TICKS(5)) == pdTRUE) {
-      apply_ecu_response(&response, &app->vehicle_state);
+      apply_ecu_response(field_mask & ~broadcast_fields, &response, &app->vehicle_state);
       xSemaphoreGive(app->vehicle_state_mutex);
     } else {
       ESP_LOGW(TAG, "failed to take vehicle_state_mutex");
@@ -0,0 +1,59 @@
+#include "task_isotp.h"
+
+#include <stdint.h>
+
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "isotp.h"
+
+static const char* TAG = "task_isotp";
+
+#define ISOTP_TICK_US (portTICK_PERIOD_MS * 1000U)
+
+// Runs on the esp_timer task, which outranks every application task, so the
+// engine is scheduled as soon as the deadline passes.
+static void on_deadline(void* arg) {
+  xTaskNotifyGive((TaskHandle_t)arg);
+}
+
+void task_isotp(void* arg) {
+  (void)arg;
+  isotp_engine_attach();
+
+  // Deadlines are microseconds apart while consecutive frames go out; a
+  // FreeRTOS tick would round each gap up to 10 ms.
+  esp_timer_handle_t timer = NULL;
+  const esp_timer_create_args_t timer_args = {
+      .callback = on_deadline,
+      .arg = xTaskGetCurrentTaskHandle(),
+      .dispatch_method = ESP_TIMER_TASK,
+      .name = "isotp",
+  };
+  esp_err_t err = esp_timer_create(&timer_args, &timer);
+  if (err != ESP_OK) {
+    ESP_LOGE(TAG, "esp_timer_create failed: %s; ISO-TP deadlines fall back to ticks", esp_err_to_name(err));
+    timer = NULL;
+  }
+
+  while (1) {
+    const uint32_t wait_us = isotp_engine_service((uint32_t)esp_timer_get_time());
+    if (wait_us == 0) {
+      continue;
+    }
+    if (timer != NULL) {
+      // A callback already queued only costs one more pass.
+      esp_timer_stop(timer);
+      if (wait_us != UINT32_MAX) {
+        esp_timer_start_once(timer, wait_us);
+      }
+      ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+      continue;
+    }
+    const TickType_t ticks =
+        wait_us == UINT32_MAX ? portMAX_DELAY : (TickType_t)((wait_us + ISOTP_TICK_US - 1U) / ISOTP_TICK_US);
+    ulTaskNotifyTake(pdTRUE, ticks);
+  }
+}
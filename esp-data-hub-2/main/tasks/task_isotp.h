@@ -0,0 +1,3 @@
+#pragma once
+
+void task_isotp(void* arg);
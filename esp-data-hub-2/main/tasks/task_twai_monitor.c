@@ -3,11 +3,113 @@
 #include <inttypes.h>
 
 #include "app_context.h"
+#include "can_transport.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "esp_twai.h"
+#include "sdkconfig.h"
 
 static const char* TAG = "task_twai_monitor";
 
+#define TWAI_MONITOR_PERIOD_MS 500
+#define TWAI_MONITOR_LATENCY_EVERY 20  // log RX latency every 10 s
+#define TWAI_MONITOR_BUS_EVERY 2       // bus report window, 1 s
+
+// Too big for the task stack; only this task touches them.
+static can_bus_sample_t s_bus_samples[2];
+static can_bus_report_t s_bus_report;
+
+static const char* const k_state_names[] = {"active", "warning", "passive", "bus-off"};
+
+static const char* state_name(uint8_t state) {
+  return state < sizeof(k_state_names) / sizeof(k_state_names[0]) ? k_state_names[state] : "?";
+}
+
+// Software rejections are counted as they happen; hardware rejections are
+// not counted by the controller, so their rate comes from the startup survey.
+static void log_filter_rates(const can_transport_rx_stats_t* rx, const can_transport_rx_stats_t* last) {
+  const uint32_t period_ms = TWAI_MONITOR_PERIOD_MS * TWAI_MONITOR_LATENCY_EVERY;
+  const uint32_t sw_per_s = (rx->unrouted - last->unrouted) * 1000U / period_ms;
+  const uint32_t routed_per_s = (rx->routed - last->routed) * 1000U / period_ms;
+  if (rx->survey_ms > 0) {
+    const uint32_t survey_permille =
+        (uint32_t)((uint64_t)rx->survey_bits * 1000U / rx->survey_ms * 1000U / CAN_BUS_BITRATE);
+    ESP_LOGI(TAG,
+             "RX filter: %" PRIu32 " hw filters reject ~%" PRIu32 "/s of %" PRIu32 "/s (survey, open bus load %" PRIu32
+             ".%" PRIu32 "%%), sw rejects %" PRIu32 "/s, routed %" PRIu32 "/s",
+             rx->hw_filters, rx->survey_hw_rejected * 1000U / rx->survey_ms, rx->survey_frames * 1000U / rx->survey_ms,
+             survey_permille / 10U, survey_permille % 10U, sw_per_s, routed_per_s);
+  } else {
+    ESP_LOGI(TAG, "RX filter: %" PRIu32 " hw filters, sw rejects %" PRIu32 "/s, routed %" PRIu32 "/s",
+             rx->hw_filters, sw_per_s, routed_per_s);
+  }
+}
+
+static void log_isotp(const isotp_session_t* session) {
+  ESP_LOGI(TAG, "%s ISO-TP exchanges ok=%" PRIu32 " failed=%" PRIu32 " ignored frames=%" PRIu32, session->name,
+           session->completed, session->failed, session->channel.ignored_frames);
+}
+
+static void log_sink(const can_rx_sink_t* sink, can_rx_ring_stats_t* last, bool log_latency) {
+  can_rx_ring_stats_t ring;
+  can_rx_ring_get_stats(&sink->ring, &ring);
+  if (ring.overruns != last->overruns) {
+    ESP_LOGW(TAG, "%s RX ring overruns=%" PRIu32 " (capacity %" PRIu32 ")", sink->name, ring.overruns,
+             ring.capacity);
+  }
+  *last = ring;
+  if (log_latency && sink->received > 0) {
+    ESP_LOGI(TAG, "%s RX frames=%" PRIu32 " high_water=%" PRIu32 " ISR->task latency min=%" PRIu32 "us avg=%" PRIu32
+                  "us max=%" PRIu32 "us",
+             sink->name, sink->received, ring.high_water, sink->latency_min_us, sink->latency_avg_us,
+             sink->latency_max_us);
+  }
+}
+
+static void log_bus_report(const can_bus_report_t* report) {
+  ESP_LOGI(TAG,
+           "CAN bus load %u.%u%% (%" PRIu32 " frames/s, %" PRIu32 " B/s seen), TX %" PRIu32 " sent %" PRIu32
+           " failed, submit->done avg=%" PRIu32 "us max=%" PRIu32 "us",
+           report->load_permille / 10U, report->load_permille % 10U, report->frames_per_s, report->bytes_per_s,
+           report->tx_frames, report->tx_failed, report->tx_latency_avg_us, report->tx_latency_max_us);
+  for (size_t i = 0; i < report->id_count; ++i) {
+    const can_bus_id_rate_t* id = &report->ids[i];
+    if (id->frames_per_s > 0) {
+      ESP_LOGI(TAG, "  %s 0x%03" PRIX32 "%s: %" PRIu32 " frames/s, %" PRIu32 " B/s", id->tx ? "TX" : "RX", id->id,
+               id->ide ? " (ext)" : "", id->frames_per_s, id->bytes_per_s);
+    }
+  }
+  if (report->other_frames_per_s > 0) {
+    ESP_LOGI(TAG, "  other IDs: %" PRIu32 " frames/s", report->other_frames_per_s);
+  }
+}
+
+// Samples the bus counters and publishes the report for the other tasks.
+static void update_bus_report(app_context_t* app, uint32_t* sample_ms, bool* has_sample) {
+  can_bus_sample_t* prev = &s_bus_samples[0];
+  can_bus_sample_t* now = &s_bus_samples[1];
+  can_transport_sample_bus_stats(now);
+  const uint32_t now_ms = (uint32_t)(esp_timer_get_time() / 1000);
+  if (*has_sample && now_ms != *sample_ms) {
+    can_bus_report_update(&s_bus_report, prev, now, now_ms, now_ms - *sample_ms, CAN_BUS_BITRATE);
+    for (size_t i = 0; i < now->state_count; ++i) {
+      ESP_LOGW(TAG, "CAN error state %s -> %s at %" PRIu32 " ms", state_name(now->states[i].old_state),
+               state_name(now->states[i].new_state), now->states[i].t_ms);
+    }
+    if (s_bus_report.error_frames > 0) {
+      ESP_LOGW(TAG, "CAN error frames=%" PRIu32 " flags=0x%02" PRIX32 " in %" PRIu32 " ms", s_bus_report.error_frames,
+               now->error_flags, s_bus_report.window_ms);
+    }
+    if (xSemaphoreTake(app->vehicle_state_mutex, pdMS_TO_TICKS(5)) == pdTRUE) {
+      app->bus_report = s_bus_report;
+      xSemaphoreGive(app->vehicle_state_mutex);
+    }
+  }
+  *prev = *now;
+  *sample_ms = now_ms;
+  *has_sample = true;
+}
+
 void task_twai_monitor(void* arg) {
   app_context_t* app = (app_context_t*)arg;
   if (app == NULL || app->node_hdl == NULL) {
@@ -18,6 +120,16 @@ void task_twai_monitor(void* arg) {
   twai_node_status_t last_status = {0};
   twai_node_record_t last_record = {0};
   bool has_last = false;
+  can_transport_rx_stats_t last_rx = {0};
+  can_transport_rx_stats_t last_rates = {0};
+  can_rx_ring_stats_t last_ecu = {0};
+  can_rx_ring_stats_t last_vdc = {0};
+#ifdef CONFIG_DH_CAN_BROADCAST
+  can_rx_ring_stats_t last_chassis = {0};
+#endif
+  uint32_t polls = 0;
+  uint32_t bus_sample_ms = 0;
+  bool has_bus_sample = false;
 
   while (1) {
     twai_node_status_t status = {0};
@@ -43,6 +155,33 @@ void task_twai_monitor(void* arg) {
       ESP_LOGW(TAG, "TWAI status read failed");
     }
 
-    vTaskDelay(pdMS_TO_TICKS(500));
+    can_transport_rx_stats_t rx;
+    can_transport_get_rx_stats(&rx);
+    if (rx.receive_errors != last_rx.receive_errors) {
+      ESP_LOGW(TAG, "CAN RX receive errors=%" PRIu32, rx.receive_errors);
+    }
+    last_rx = rx;
+    const bool log_latency = ++polls % TWAI_MONITOR_LATENCY_EVERY == 0;
+    if (log_latency) {
+      log_filter_rates(&rx, &last_rates);
+      last_rates = rx;
+    }
+    log_sink(&app->ecu_rx, &last_ecu, log_latency);
+    log_sink(&app->vdc_rx, &last_vdc, log_latency);
+    if (log_latency) {
+      log_isotp(&app->ecu_isotp);
+      log_isotp(&app->vdc_isotp);
+    }
+#ifdef CONFIG_DH_CAN_BROADCAST
+    log_sink(&app->chassis_rx, &last_chassis, log_latency);
+#endif
+    if (polls % TWAI_MONITOR_BUS_EVERY == 0) {
+      update_bus_report(app, &bus_sample_ms, &has_bus_sample);
+    }
+    if (log_latency && s_bus_report.window_ms > 0) {
+      log_bus_report(&s_bus_report);
+    }
+
+    vTaskDelay(pdMS_TO_TICKS(TWAI_MONITOR_PERIOD_MS));
   }
 }
@@ -5,11 +5,146 @@
 #include "esp_log.h"
 #include "esp_timer.h"
 #include "sdkconfig.h"
+#include "telemetry_link.h"
 #include "telemetry_protocol.h"
 
 static const char* TAG = "task_uart_emitter";
 #define DH_UART_PORT ((uart_port_t)CONFIG_DH_UART_PORT)
 
+static telemetry_stream_decoder_t s_rx_stream;
+#ifdef CONFIG_DH_UART_NEGOTIATE_BAUD
+static telemetry_link_t s_link;
+#endif
+
+static void send_control(const telemetry_control_t* control) {
+  uint8_t wire_frame[TELEMETRY_WIRE_FRAME_MAX_SIZE];
+  size_t frame_length = 0;
+  if (telemetry_control_encode_wire(control, wire_frame, sizeof(wire_frame), &frame_length) == TELEMETRY_RESULT_OK) {
+    uart_write_bytes(DH_UART_PORT, wire_frame, frame_length);
+  }
+}
+
+#ifdef CONFIG_DH_UART_NEGOTIATE_BAUD
+static void run_link_actions(uint32_t now_ms) {
+  telemetry_link_action_t action;
+  while (telemetry_link_poll(&s_link, now_ms, &action)) {
+    if (action.send) {
+      send_control(&action.control);
+    }
+    if (action.baud != 0) {
+      // Everything queued so far was meant for the old rate.
+      uart_wait_tx_done(DH_UART_PORT, pdMS_TO_TICKS(50));
+      uart_set_baudrate(DH_UART_PORT, action.baud);
+      ESP_LOGI(TAG, "UART link now at %u baud", (unsigned)action.baud);
+    }
+  }
+}
+#endif
+
+// Applies a runtime setting from the display and echoes the value used. If the
+// mutex is busy nothing is echoed and the display sends it again.
+static void apply_setting(app_context_t* app, const telemetry_control_t* control) {
+  telemetry_control_t reply;
+  bool applied = false;
+  if (xSemaphoreTake(app->vehicle_state_mutex, pdMS_TO_TICKS(10)) == pdTRUE) {
+    applied = hub_settings_apply(&app->settings, control, &reply);
+    xSemaphoreGive(app->vehicle_state_mutex);
+  }
+  if (applied) {
+    ESP_LOGI(TAG, "display setting %u = %u", (unsigned)reply.type, (unsigned)reply.value);
+    send_control(&reply);
+  }
+}
+
+// Answers a clock sync ping right away. `rx_us` is when the ping was read off
+// the UART; the display measures the round trip around the time spent here.
+static void answer_time_ping(const telemetry_control_t* ping, uint32_t rx_us) {
+  const telemetry_control_t pong = {
+      .type = TELEMETRY_CONTROL_TIME_PONG,
+      .value = ping->value,
+      .hub_rx_us = rx_us,
+      .hub_tx_us = (uint32_t)esp_timer_get_time(),
+  };
+  send_control(&pong);
+}
+
+// Handles everything the display sent since the last period: clock sync
+// pings, runtime settings and, when enabled, link negotiation.
+static void service_rx(app_context_t* app) {
+#ifdef CONFIG_DH_UART_NEGOTIATE_BAUD
+  const uint32_t now_ms = (uint32_t)(esp_timer_get_time() / 1000);
+#endif
+  uint8_t rx_buf[128];
+  vehicle_state_t unused;
+  int bytes_read;
+  while ((bytes_read = uart_read_bytes(DH_UART_PORT, rx_buf, sizeof(rx_buf), 0)) > 0) {
+    const uint32_t rx_us = (uint32_t)esp_timer_get_time();
+    size_t pos = 0;
+    while (pos < (size_t)bytes_read) {
+      size_t consumed = 0;
+      const telemetry_result_t result =
+          telemetry_stream_decoder_feed(&s_rx_stream, rx_buf + pos, (size_t)bytes_read - pos, &consumed, &unused);
+      pos += consumed;
+      if (result == TELEMETRY_RESULT_CONTROL) {
+        const telemetry_control_t* control = telemetry_decoder_last_control(&s_rx_stream.decoder);
+        if (control->type == TELEMETRY_CONTROL_TIME_PING) {
+          answer_time_ping(control, rx_us);
+        } else {
+          apply_setting(app, control);
+        }
+#ifdef CONFIG_DH_UART_NEGOTIATE_BAUD
+        telemetry_link_on_control(&s_link, control, now_ms);
+#endif
+      }
+#ifdef CONFIG_DH_UART_NEGOTIATE_BAUD
+      telemetry_link_on_frame(&s_link, result, now_ms);
+      run_link_actions(now_ms);
+#endif
+    }
+  }
+#ifdef CONFIG_DH_UART_NEGOTIATE_BAUD
+  run_link_actions(now_ms);
+#endif
+}
+
+#if CONFIG_DH_UART_SCHEMA_PERIOD_MS > 0
+static uint32_t s_layout_id;
+static uint32_t s_descriptor_next;  // entry to send next, TELEMETRY_FLOAT_FIELD_COUNT when idle
+static uint32_t s_announce_ms;      // when the next announcement starts
+
+// Appends the next schema descriptor while an announcement is in progress.
+// One goes out per emit period, so announcing never adds more than one short
+// frame to a period. Returns the bytes appended.
+static size_t append_descriptor(uint32_t now_ms, uint8_t* output, size_t output_capacity) {
+  if (s_descriptor_next >= TELEMETRY_FLOAT_FIELD_COUNT) {
+    if ((int32_t)(now_ms - s_announce_ms) < 0) {
+      return 0;
+    }
+    s_descriptor_next = 0;
+    s_announce_ms = now_ms + CONFIG_DH_UART_SCHEMA_PERIOD_MS;
+  }
+
+  size_t length = 0;
+  const telemetry_result_t result =
+      telemetry_descriptor_encode_wire(s_layout_id, TELEMETRY_FLOAT_FIELD_COUNT, s_descriptor_next,
+                                       &telemetry_local_descriptors()[s_descriptor_next], output, output_capacity,
+                                       &length);
+  if (result != TELEMETRY_RESULT_OK) {
+    ESP_LOGW(TAG, "schema descriptor encode failed: %s", telemetry_result_name(result));
+    s_descriptor_next = TELEMETRY_FLOAT_FIELD_COUNT;
+    return 0;
+  }
+  s_descriptor_next++;
+  return length;
+}
+#endif
+
+#ifdef CONFIG_DH_UART_MULTI_RATE
+static uint32_t slow_every_periods(uint32_t emit_period_ms) {
+  return CONFIG_DH_UART_SLOW_PERIOD_MS > emit_period_ms ? CONFIG_DH_UART_SLOW_PERIOD_MS / emit_period_ms : 1;
+}
+#endif
+
 void task_uart_emitter(void* arg) {
   app_context_t* app = (app_context_t*)arg;
   if (app == NULL) {
@@ -17,16 +152,66 @@ void task_uart_emitter(void* arg) {
     return;
   }
 
-  const TickType_t period_ticks = pdMS_TO_TICKS(CONFIG_DH_UART_EMIT_PERIOD_MS);
+  hub_settings_t settings = app->settings;
   TickType_t last_wake = xTaskGetTickCount();
 
+#ifdef CONFIG_DH_UART_DELTA_FRAMES
+  static telemetry_delta_encoder_t encoder;
+  telemetry_delta_encoder_init(&encoder, CONFIG_DH_UART_KEYFRAME_INTERVAL);
+#ifdef CONFIG_DH_UART_QUANTIZED_FRAMES
+  telemetry_delta_encoder_set_quantized(&encoder, true);
+#endif
+#ifdef CONFIG_DH_UART_FEC
+  telemetry_delta_encoder_set_fec(&encoder, true);
+#endif
+#endif
+#ifdef CONFIG_DH_UART_MULTI_RATE
+  // The fast group goes out every period; the slow group follows it in its own
+  // frame every slow_every periods.
+  uint32_t periods_until_slow = 0;
+#endif
+  telemetry_stream_decoder_init(&s_rx_stream);
+#ifdef CONFIG_DH_UART_NEGOTIATE_BAUD
+  const telemetry_link_config_t link_config = telemetry_link_default_config(CONFIG_DH_UART_MAX_BAUD);
+  telemetry_link_init(&s_link, TELEMETRY_LINK_ROLE_HUB, &link_config, (uint32_t)(esp_timer_get_time() / 1000));
+#endif
+#if CONFIG_DH_UART_SCHEMA_PERIOD_MS > 0
+  s_layout_id = telemetry_local_layout_id();
+  s_descriptor_next = TELEMETRY_FLOAT_FIELD_COUNT;
+  s_announce_ms = (uint32_t)(esp_timer_get_time() / 1000);
+  ESP_LOGI(TAG, "telemetry layout 0x%08lx, %u channels", (unsigned long)s_layout_id,
+           (unsigned)TELEMETRY_FLOAT_FIELD_COUNT);
+#endif
+
   while (1) {
-    vTaskDelayUntil(&last_wake, period_ticks);
+    vTaskDelayUntil(&last_wake, pdMS_TO_TICKS(settings.emit_period_ms));
+
+    service_rx(app);
+
+#ifdef CONFIG_DH_UART_MULTI_RATE
+    const uint32_t slow_every = slow_every_periods(settings.emit_period_ms);
+    if (periods_until_slow >= slow_every) {
+      periods_until_slow = slow_every - 1;  // the emit period just got longer
+    }
+    const bool slow_due = periods_until_slow == 0;
+#else
+    const bool slow_due = false;
+#endif
 
     vehicle_state_t state_copy;
+#ifdef CONFIG_DH_UART_SAMPLE_BATCHES
+    telemetry_sample_batch_t batch;
+#endif
     if (xSemaphoreTake(app->vehicle_state_mutex, pdMS_TO_TICKS(10)) == pdTRUE) {
       state_copy = app->vehicle_state;
-      app->vehicle_state.sequence++;
+      settings = app->settings;
+      uint32_t frame_count = slow_due ? 2 : 1;
+#ifdef CONFIG_DH_UART_SAMPLE_BATCHES
+      batch = app->oil_samples;
+      app->oil_samples.sample_count = 0;
+      frame_count += batch.sample_count > 0 ? 1 : 0;
+#endif
+      app->vehicle_state.sequence += frame_count;
       xSemaphoreGive(app->vehicle_state_mutex);
     } else {
       ESP_LOGW(TAG, "failed to take vehicle_state_mutex");
@@ -35,16 +220,53 @@ void task_uart_emitter(void* arg) {
 
     state_copy.timestamp_ms = (uint32_t)(esp_timer_get_time() / 1000);
 
-    uint8_t wire_frame[TELEMETRY_WIRE_FRAME_MAX_SIZE];
+    uint8_t wire_frame[4 * TELEMETRY_WIRE_FRAME_MAX_SIZE];
     size_t frame_length = 0;
-    telemetry_result_t result = telemetry_frame_encode(&state_copy, wire_frame, sizeof(wire_frame) - 1,
-                                                       &frame_length);
+    telemetry_result_t result = TELEMETRY_RESULT_OK;
+#ifdef CONFIG_DH_UART_MULTI_RATE
+    uint32_t field_mask = TELEMETRY_FAST_FIELD_MASK;
+#else
+    uint32_t field_mask = TELEMETRY_DELTA_FULL_MASK;
+#endif
+#ifdef CONFIG_DH_UART_SAMPLE_BATCHES
+    // The batch goes first since its samples are older, and carries the
+    // newest sample, so the delta that follows leaves those channels out.
+    if (batch.sample_count > 0) {
+      result = telemetry_delta_encoder_encode_batch_wire(&encoder, &batch, state_copy.sequence++, wire_frame,
+                                                         TELEMETRY_WIRE_FRAME_MAX_SIZE, &frame_length);
+      field_mask &= ~batch.field_mask;
+    }
+#endif
+#if defined(CONFIG_DH_UART_DELTA_FRAMES)
+    if (result == TELEMETRY_RESULT_OK) {
+      size_t delta_length = 0;
+      result = telemetry_delta_encoder_encode_fields_wire(&encoder, &state_copy, field_mask, wire_frame + frame_length,
+                                                          TELEMETRY_WIRE_FRAME_MAX_SIZE, &delta_length);
+      frame_length += delta_length;
+    }
+#ifdef CONFIG_DH_UART_MULTI_RATE
+    if (result == TELEMETRY_RESULT_OK && slow_due) {
+      size_t slow_length = 0;
+      state_copy.sequence++;
+      result = telemetry_delta_encoder_encode_fields_wire(&encoder, &state_copy, TELEMETRY_SLOW_FIELD_MASK,
+                                                          wire_frame + frame_length, TELEMETRY_WIRE_FRAME_MAX_SIZE,
+                                                          &slow_length);
+      frame_length += slow_length;
+    }
+    periods_until_slow = slow_due ? slow_every - 1 : periods_until_slow - 1;
+#endif
+#else
+    result = telemetry_frame_encode_wire(&state_copy, wire_frame, sizeof(wire_frame), &frame_length);
+#endif
     if (result != TELEMETRY_RESULT_OK) {
       ESP_LOGW(TAG, "telemetry encode failed: %s", telemetry_result_name(result));
       continue;
     }
+#if CONFIG_DH_UART_SCHEMA_PERIOD_MS > 0
+    frame_length += append_descriptor(state_copy.timestamp_ms, wire_frame + frame_length,
+                                      sizeof(wire_frame) - frame_length);
+#endif
 
-    wire_frame[frame_length++] = 0x00;
     const int bytes_written = uart_write_bytes(DH_UART_PORT, wire_frame, frame_length);
     if (bytes_written != (int)frame_length) {
       ESP_LOGW(TAG, "UART short write: expected=%u actual=%d", (unsigned)frame_length, bytes_written);
@@ -6,12 +6,15 @@
 #include "app_context.h"
 #include "can_types.h"
 #include "esp_log.h"
-#include "isotp_response.h"
+#include "isotp.h"
 #include "request_vdc.h"
+#include "telemetry_types.h"
 #include "sdkconfig.h"
 
 static const char* TAG = "task_vdc_uds";
 
+#define VDC_FIELDS ((1UL << TELEMETRY_CHANNEL_brake_pressure_bar) | (1UL << TELEMETRY_CHANNEL_steering_angle_deg))
+
 void task_vdc_uds(void* arg) {
   app_context_t* app = (app_context_t*)arg;
   if (app == NULL || app->node_hdl == NULL) {
@@ -19,28 +22,25 @@ void task_vdc_uds(void* arg) {
     return;
   }
 
-  const TickType_t poll_period_ticks =
-      pdMS_TO_TICKS(CONFIG_DH_VDC_POLL_PERIOD_MS > 0 ? CONFIG_DH_VDC_POLL_PERIOD_MS : 1);
+  hub_settings_t settings = app->settings;
   TickType_t last_wake = xTaskGetTickCount();
 
   while (1) {
-    vTaskDelayUntil(&last_wake, poll_period_ticks);
-
-    can_rx_frame_t stale;
-    while (xQueueReceive(app->vdc_can_frames, &stale, 0) == pdTRUE) {
-      ESP_LOGW(TAG, "Drained stale VDC frame ID 0x%0X", stale.id);
-    }
-
-    if (!request_vdc_send(app->node_hdl)) {
+    vTaskDelayUntil(&last_wake, pdMS_TO_TICKS(settings.vdc_poll_period_ms > 0 ? settings.vdc_poll_period_ms : 1));
+    app_context_get_settings(app, &settings);
+    // One request reads both channels, so it is skipped only when broadcasts
+    // cover both.
+    const uint32_t broadcast_fields = app_context_get_broadcast_fields(app);
+    if ((broadcast_fields & VDC_FIELDS) == VDC_FIELDS) {
       continue;
     }
 
-    uint8_t payload[128] = {0};
-    size_t payload_len = 0;
-    if (!isotp_collect_response(app->vdc_can_frames, app->node_hdl, VDC_REQ_ID, "VDC", TAG, payload,
-                                sizeof(payload), &payload_len)) {
+    if (!isotp_session_submit(&app->vdc_isotp, request_vdc_request, 1) ||
+        isotp_session_wait(&app->vdc_isotp, portMAX_DELAY) != ISOTP_OK) {
       continue;
     }
+    const uint8_t* payload = app->vdc_isotp.response;
+    const size_t payload_len = app->vdc_isotp.response_len;
 
     float brake_pressure_bar = 0.0f;
     float steering_angle_deg = 0.0f;
@@ -51,8 +51,12 @@ void task_vdc_uds(void* arg) {
     }
 
     if (xSemaphoreTake(app->vehicle_state_mutex, pdMS_TO_TICKS(5)) == pdTRUE) {
-      app->vehicle_state.brake_pressure_bar = brake_pressure_bar;
-      app->vehicle_state.steering_angle_deg = steering_angle_deg;
+      if (!(broadcast_fields & (1UL << TELEMETRY_CHANNEL_brake_pressure_bar))) {
+        app->vehicle_state.brake_pressure_bar = brake_pressure_bar;
+      }
+      if (!(broadcast_fields & (1UL << TELEMETRY_CHANNEL_steering_angle_deg))) {
+        app->vehicle_state.steering_angle_deg = steering_angle_deg;
+      }
       xSemaphoreGive(app->vehicle_state_mutex);
     } else {
       ESP_LOGW(TAG, "failed to take vehicle_state_mutex");
@@ -0,0 +1,430 @@
+// Host benchmark of ISR-to-session latency on the two CAN RX paths.
+//
+// A producer thread stands in for the TWAI RX ISR: it replays a .trc trace
+// with can_trace_replay_next(), waits until each frame is due, stamps rx_us
+// and hands the frame on. Two consumer threads stand in for the ECU and VDC
+// session tasks and record how long each frame took to reach them.
+//
+// dispatcher: the path before can_transport_register(). The ISR pushes every
+//   frame into one ring and notifies task_can_rx_dispatcher, which copies it
+//   into ecu_can_frames or vdc_can_frames (16-deep queues taking a lock, like
+//   a FreeRTOS queue), where the session blocks.
+// routed: the current path. The ISR looks the ID up in a can_routes_t, pushes
+//   into the owning session's ring and notifies that session directly.
+//
+// Task notifications are a counter under a mutex and condition variable, so
+// both paths pay the same per wake-up; the difference is the dispatcher hop.
+// Host threads are not FreeRTOS tasks on a 240 MHz core, so compare the two
+// rows rather than reading them as hub numbers.
+//
+// With no argument a synthetic trace of ECU and VDC responses is replayed;
+// pass a file saved from the hub's `trace dump` to replay that instead. Frames
+// with other IDs are dropped at the ISR, as on the hub.
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "can_routes.h"
+#include "can_rx_ring.h"
+#include "can_trace.h"
+#include "can_types.h"
+
+#define BENCH_CYCLES 500U
+#define BENCH_CYCLE_MS 5U
+#define BENCH_RING_SIZE 64U
+#define BENCH_QUEUE_DEPTH 16U
+#define BENCH_MAX_FRAMES 200000U
+#define BENCH_SPIN_US 200U
+
+static uint64_t now_us(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000ULL + (uint64_t)ts.tv_nsec / 1000U;
+}
+
+// ulTaskNotifyTake(pdTRUE, ...) / vTaskNotifyGiveFromISR() stand-in.
+typedef struct {
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+  uint32_t count;
+} notify_t;
+
+static void notify_init(notify_t* notify) {
+  pthread_mutex_init(&notify->lock, NULL);
+  pthread_cond_init(&notify->cond, NULL);
+  notify->count = 0;
+}
+
+static void notify_give(notify_t* notify) {
+  pthread_mutex_lock(&notify->lock);
+  notify->count++;
+  pthread_cond_signal(&notify->cond);
+  pthread_mutex_unlock(&notify->lock);
+}
+
+static void notify_take(notify_t* notify) {
+  pthread_mutex_lock(&notify->lock);
+  while (notify->count == 0) {
+    pthread_cond_wait(&notify->cond, &notify->lock);
+  }
+  notify->count = 0;
+  pthread_mutex_unlock(&notify->lock);
+}
+
+// xQueueSend() / xQueueReceive() stand-in.
+typedef struct {
+  pthread_mutex_t lock;
+  pthread_cond_t not_empty;
+  pthread_cond_t not_full;
+  can_rx_frame_t frames[BENCH_QUEUE_DEPTH];
+  uint32_t head;
+  uint32_t count;
+  bool closed;
+} frame_queue_t;
+
+static void queue_init(frame_queue_t* queue) {
+  memset(queue, 0, sizeof(*queue));
+  pthread_mutex_init(&queue->lock, NULL);
+  pthread_cond_init(&queue->not_empty, NULL);
+  pthread_cond_init(&queue->not_full, NULL);
+}
+
+static void queue_send(frame_queue_t* queue, const can_rx_frame_t* frame) {
+  pthread_mutex_lock(&queue->lock);
+  while (queue->count == BENCH_QUEUE_DEPTH) {
+    pthread_cond_wait(&queue->not_full, &queue->lock);
+  }
+  queue->frames[(queue->head + queue->count++) % BENCH_QUEUE_DEPTH] = *frame;
+  pthread_cond_signal(&queue->not_empty);
+  pthread_mutex_unlock(&queue->lock);
+}
+
+static bool queue_receive(frame_queue_t* queue, can_rx_frame_t* frame) {
+  pthread_mutex_lock(&queue->lock);
+  while (queue->count == 0 && !queue->closed) {
+    pthread_cond_wait(&queue->not_empty, &queue->lock);
+  }
+  const bool got = queue->count > 0;
+  if (got) {
+    *frame = queue->frames[queue->head];
+    queue->head = (queue->head + 1) % BENCH_QUEUE_DEPTH;
+    queue->count--;
+    pthread_cond_signal(&queue->not_full);
+  }
+  pthread_mutex_unlock(&queue->lock);
+  return got;
+}
+
+static void queue_close(frame_queue_t* queue) {
+  pthread_mutex_lock(&queue->lock);
+  queue->closed = true;
+  pthread_cond_broadcast(&queue->not_empty);
+  pthread_mutex_unlock(&queue->lock);
+}
+
+// A session's receive side on the routed path, like can_rx_sink_t.
+typedef struct {
+  can_rx_ring_t ring;
+  can_rx_frame_t storage[BENCH_RING_SIZE];
+  notify_t notify;
+} sink_t;
+
+typedef struct {
+  uint32_t* latency_us;
+  uint32_t count;
+} samples_t;
+
+typedef enum {
+  PATH_DISPATCHER = 0,
+  PATH_ROUTED,
+} path_t;
+
+typedef struct {
+  const char* trace;
+  size_t trace_len;
+  path_t path;
+  atomic_bool done;
+
+  // dispatcher path
+  can_rx_ring_t rx_ring;
+  can_rx_frame_t rx_storage[BENCH_RING_SIZE];
+  notify_t dispatcher_notify;
+  frame_queue_t queues[2];
+
+  // routed path
+  can_routes_t routes;
+  sink_t sinks[2];
+
+  samples_t samples;
+  pthread_mutex_t samples_lock;
+  uint32_t offered;
+  uint32_t overruns;
+} bench_t;
+
+typedef struct {
+  bench_t* bench;
+  int session;
+} session_arg_t;
+
+static void record_latency(bench_t* bench, const can_rx_frame_t* frame) {
+  const uint32_t latency = (uint32_t)now_us() - frame->rx_us;
+  pthread_mutex_lock(&bench->samples_lock);
+  if (bench->samples.count < BENCH_MAX_FRAMES) {
+    bench->samples.latency_us[bench->samples.count++] = latency;
+  }
+  pthread_mutex_unlock(&bench->samples_lock);
+}
+
+static void wait_until(uint64_t due_us) {
+  for (;;) {
+    const uint64_t now = now_us();
+    if (now >= due_us) {
+      return;
+    }
+    if (due_us - now > BENCH_SPIN_US) {
+      const uint64_t sleep_us = due_us - now - BENCH_SPIN_US;
+      const struct timespec ts = {.tv_sec = (time_t)(sleep_us / 1000000U),
+                                  .tv_nsec = (long)(sleep_us % 1000000U) * 1000L};
+      nanosleep(&ts, NULL);
+    }
+  }
+}
+
+static void* isr_thread(void* arg) {
+  bench_t* bench = arg;
+  can_trace_replay_t replay;
+  can_trace_replay_init(&replay, bench->trace, bench->trace_len);
+  can_trace_record_t record;
+  uint64_t due_us = 0;
+  const uint64_t start_us = now_us();
+  while (can_trace_replay_next(&replay, &record, &due_us)) {
+    wait_until(start_us + due_us);
+    const bool ide = (record.flags & CAN_TRACE_FLAG_IDE) != 0;
+    can_rx_frame_t frame = {.id = record.id, .ide = ide, .data_len = record.dlc, .rx_us = (uint32_t)now_us()};
+    memcpy(frame.data, record.data, record.dlc);
+
+    if (bench->path == PATH_DISPATCHER) {
+      // The old ISR's hard-coded ID check.
+      if (ide || (record.id != ECU_RES_ID && record.id != VDC_RES_ID)) {
+        continue;
+      }
+      bench->offered++;
+      if (!can_rx_ring_push(&bench->rx_ring, &frame)) {
+        bench->overruns++;
+        continue;
+      }
+      notify_give(&bench->dispatcher_notify);
+    } else {
+      sink_t* sink = can_routes_find(&bench->routes, record.id, ide);
+      if (sink == NULL) {
+        continue;
+      }
+      bench->offered++;
+      if (!can_rx_ring_push(&sink->ring, &frame)) {
+        bench->overruns++;
+        continue;
+      }
+      notify_give(&sink->notify);
+    }
+  }
+
+  atomic_store(&bench->done, true);
+  if (bench->path == PATH_DISPATCHER) {
+    notify_give(&bench->dispatcher_notify);
+  } else {
+    notify_give(&bench->sinks[0].notify);
+    notify_give(&bench->sinks[1].notify);
+  }
+  return NULL;
+}
+
+static void* dispatcher_thread(void* arg) {
+  bench_t* bench = arg;
+  for (;;) {
+    const bool done = atomic_load(&bench->done);
+    can_rx_frame_t frame;
+    while (can_rx_ring_pop(&bench->rx_ring, &frame)) {
+      queue_send(&bench->queues[frame.id == ECU_RES_ID ? 0 : 1], &frame);
+    }
+    if (done) {
+      break;
+    }
+    notify_take(&bench->dispatcher_notify);
+  }
+  queue_close(&bench->queues[0]);
+  queue_close(&bench->queues[1]);
+  return NULL;
+}
+
+static void* session_thread(void* arg) {
+  const session_arg_t* session = arg;
+  bench_t* bench = session->bench;
+  can_rx_frame_t frame;
+  if (bench->path == PATH_DISPATCHER) {
+    while (queue_receive(&bench->queues[session->session], &frame)) {
+      record_latency(bench, &frame);
+    }
+    return NULL;
+  }
+
+  sink_t* sink = &bench->sinks[session->session];
+  for (;;) {
+    const bool done = atomic_load(&bench->done);
+    while (can_rx_ring_pop(&sink->ring, &frame)) {
+      record_latency(bench, &frame);
+    }
+    if (done) {
+      return NULL;
+    }
+    notify_take(&sink->notify);
+  }
+}
+
+static int compare_u32(const void* a, const void* b) {
+  const uint32_t x = *(const uint32_t*)a;
+  const uint32_t y = *(const uint32_t*)b;
+  return (x > y) - (x < y);
+}
+
+static bool run_path(const char* name, path_t path, const char* trace, size_t trace_len) {
+  static bench_t bench;
+  memset(&bench, 0, sizeof(bench));
+  bench.trace = trace;
+  bench.trace_len = trace_len;
+  bench.path = path;
+  atomic_init(&bench.done, false);
+  pthread_mutex_init(&bench.samples_lock, NULL);
+  bench.samples.latency_us = malloc(BENCH_MAX_FRAMES * sizeof(uint32_t));
+  if (bench.samples.latency_us == NULL) {
+    return false;
+  }
+
+  can_rx_ring_init(&bench.rx_ring, bench.rx_storage, BENCH_RING_SIZE);
+  notify_init(&bench.dispatcher_notify);
+  queue_init(&bench.queues[0]);
+  queue_init(&bench.queues[1]);
+  can_routes_init(&bench.routes);
+  for (int i = 0; i < 2; ++i) {
+    can_rx_ring_init(&bench.sinks[i].ring, bench.sinks[i].storage, BENCH_RING_SIZE);
+    notify_init(&bench.sinks[i].notify);
+  }
+  can_routes_add(&bench.routes, ECU_RES_ID, CAN_ROUTES_STD_MASK, &bench.sinks[0]);
+  can_routes_add(&bench.routes, VDC_RES_ID, CAN_ROUTES_STD_MASK, &bench.sinks[1]);
+
+  session_arg_t sessions[2] = {{&bench, 0}, {&bench, 1}};
+  pthread_t session_threads[2];
+  pthread_t dispatcher;
+  pthread_t isr;
+  for (int i = 0; i < 2; ++i) {
+    pthread_create(&session_threads[i], NULL, session_thread, &sessions[i]);
+  }
+  if (path == PATH_DISPATCHER) {
+    pthread_create(&dispatcher, NULL, dispatcher_thread, &bench);
+  }
+  pthread_create(&isr, NULL, isr_thread, &bench);
+  pthread_join(isr, NULL);
+  if (path == PATH_DISPATCHER) {
+    pthread_join(dispatcher, NULL);
+  }
+  for (int i = 0; i < 2; ++i) {
+    pthread_join(session_threads[i], NULL);
+  }
+
+  samples_t* samples = &bench.samples;
+  const bool complete = samples->count == bench.offered - bench.overruns && samples->count > 0;
+  if (samples->count > 0) {
+    qsort(samples->latency_us, samples->count, sizeof(uint32_t), compare_u32);
+    uint64_t sum = 0;
+    for (uint32_t i = 0; i < samples->count; ++i) {
+      sum += samples->latency_us[i];
+    }
+    printf("%-12s %7u frames  min %5u us  avg %7.1f us  p50 %5u us  p99 %5u us  max %6u us  overruns %u\n", name,
+           (unsigned)samples->count, (unsigned)samples->latency_us[0], (double)sum / samples->count,
+           (unsigned)samples->latency_us[samples->count / 2],
+           (unsigned)samples->latency_us[(uint32_t)((uint64_t)samples->count * 99U / 100U)],
+           (unsigned)samples->latency_us[samples->count - 1], (unsigned)bench.overruns);
+  }
+  if (!complete) {
+    fprintf(stderr, "%s: %u frames offered, %u overrun, %u taken\n", name, (unsigned)bench.offered,
+            (unsigned)bench.overruns, (unsigned)samples->count);
+  }
+  free(samples->latency_us);
+  return complete;
+}
+
+// Every cycle the ECU answers with a first frame and two consecutive frames a
+// millisecond apart, the VDC with a single frame, and an unrouted broadcast
+// goes by.
+static char* synthetic_trace(size_t* len) {
+  const size_t capacity = BENCH_CYCLES * 5U * CAN_TRACE_LINE_MAX + 1U;
+  char* text = malloc(capacity);
+  if (text == NULL) {
+    return NULL;
+  }
+  size_t pos = 0;
+  for (uint32_t c = 0; c < BENCH_CYCLES; ++c) {
+    const uint64_t t_us = (uint64_t)c * BENCH_CYCLE_MS * 1000U;
+    const can_trace_record_t records[] = {
+        {.t_us = t_us, .id = ECU_RES_ID, .dlc = 8, .data = {0x10, 0x11, 0xE8, 0x5A, 0x40, 0xC0, 0x2E, 0xE0}},
+        {.t_us = t_us + 1000U, .id = ECU_RES_ID, .dlc = 8, .data = {0x21, 0x3C, 0x14, 0x80, 0x10, 0xBF, 0xC0}},
+        {.t_us = t_us + 1000U, .id = 0x040, .dlc = 8, .data = {0x5A, 0x03, 0xC4, 0x49, 0x80}},
+        {.t_us = t_us + 2000U, .id = ECU_RES_ID, .dlc = 8, .data = {0x22, 0x00, 0x80, 0x00, 0xFF}},
+        {.t_us = t_us + 3000U, .id = VDC_RES_ID, .dlc = 8, .data = {0x05, 0x62, 0x10, 0x01, 0x03, 0xE8}},
+    };
+    for (size_t i = 0; i < sizeof(records) / sizeof(records[0]); ++i) {
+      pos += can_trace_format_line(&records[i], 0, text + pos, capacity - pos);
+    }
+  }
+  text[pos] = '\0';
+  *len = pos;
+  return text;
+}
+
+static char* read_trace(const char* path, size_t* len) {
+  FILE* file = fopen(path, "rb");
+  if (file == NULL) {
+    return NULL;
+  }
+  size_t capacity = 1 << 16;
+  size_t used = 0;
+  char* text = malloc(capacity);
+  while (text != NULL) {
+    used += fread(text + used, 1, capacity - used, file);
+    if (used < capacity) {
+      break;
+    }
+    char* grown = realloc(text, capacity * 2);
+    if (grown == NULL) {
+      free(text);
+      text = NULL;
+      break;
+    }
+    text = grown;
+    capacity *= 2;
+  }
+  fclose(file);
+  *len = used;
+  return text;
+}
+
+int main(int argc, char** argv) {
+  size_t trace_len = 0;
+  char* trace = argc > 1 ? read_trace(argv[1], &trace_len) : synthetic_trace(&trace_len);
+  if (trace == NULL) {
+    fprintf(stderr, "cannot load trace %s\n", argc > 1 ? argv[1] : "(synthetic)");
+    return 1;
+  }
+  printf("ISR-to-session latency, %s\n", argc > 1 ? argv[1] : "synthetic ECU/VDC trace");
+  const bool dispatcher_ok = run_path("dispatcher", PATH_DISPATCHER, trace, trace_len);
+  const bool routed_ok = run_path("routed", PATH_ROUTED, trace, trace_len);
+  free(trace);
+  return dispatcher_ok && routed_ok ? 0 : 1;
+}
@@ -0,0 +1,134 @@
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "can_broadcast.h"
+
+// Frames in CANHacker .trc layout (time, ID, DLC, data bytes), as read by
+// scripts/subaru-decode/main.py.
+static const char* const k_trace[] = {
+    "12.004 040 8 5A 03 C4 49 80 00 00 00",  // 2500 rpm, pedal 0x80, flag bit 30 set
+    "12.010 002 8 11 07 2E FB 00 00 00 00",  // steering raw -1234
+    "12.013 138 8 00 00 00 00 00 00 37 00",  // brake 55
+    "12.020 7E8 8 03 E8 00 00 00 00 00 00",  // not a broadcast
+    "12.024 040 4 5B 03 70 17",              // short frame: 6000 rpm, no pedal byte
+};
+
+typedef struct {
+  uint32_t id;
+  uint8_t dlc;
+  uint8_t data[8];
+} trace_frame_t;
+
+static void parse_trace_line(const char* line, trace_frame_t* frame) {
+  double t = 0;
+  unsigned id = 0;
+  unsigned dlc = 0;
+  int used = 0;
+  assert(sscanf(line, "%lf %x %u%n", &t, &id, &dlc, &used) == 3 && dlc <= 8);
+  memset(frame, 0, sizeof(*frame));
+  frame->id = id;
+  frame->dlc = (uint8_t)dlc;
+  const char* p = line + used;
+  for (unsigned i = 0; i < dlc; ++i) {
+    unsigned byte = 0;
+    int n = 0;
+    assert(sscanf(p, "%x%n", &byte, &n) == 1);
+    frame->data[i] = (uint8_t)byte;
+    p += n;
+  }
+}
+
+static uint32_t decode_line(const char* line, vehicle_state_t* state) {
+  trace_frame_t frame;
+  parse_trace_line(line, &frame);
+  return can_broadcast_decode(can_broadcast_signals, can_broadcast_signal_count, frame.id, false, frame.data,
+                              frame.dlc, state);
+}
+
+#define BIT(name) (1UL << TELEMETRY_CHANNEL_##name)
+
+static void test_extract(void) {
+  const uint8_t data[8] = {0xF0, 0x0F, 0xC4, 0x49, 0x80, 0xFF, 0xFF, 0x7F};
+  const can_broadcast_signal_t byte = {.start_bit = 32, .bit_length = 8};
+  assert(can_broadcast_extract(&byte, data, 8) == 0x80);
+  const can_broadcast_signal_t rpm = {.start_bit = 16, .bit_length = 14};
+  assert(can_broadcast_extract(&rpm, data, 8) == 0x09C4);
+  const can_broadcast_signal_t nibble = {.start_bit = 4, .bit_length = 8};
+  assert(can_broadcast_extract(&nibble, data, 8) == 0xFF);
+  const can_broadcast_signal_t negative = {.start_bit = 4, .bit_length = 8, .is_signed = true};
+  assert(can_broadcast_extract(&negative, data, 8) == -1);
+  const can_broadcast_signal_t wide = {.start_bit = 32, .bit_length = 32, .is_signed = true};
+  assert(can_broadcast_extract(&wide, data, 8) == 0x7FFFFF80);
+  const can_broadcast_signal_t odd = {.start_bit = 36, .bit_length = 32};
+  assert(can_broadcast_extract(&wide, data, 7) == 0);
+  assert(can_broadcast_extract(&odd, data, 8) == 0);
+}
+
+static void test_decode_trace(void) {
+  vehicle_state_t state = {0};
+  state.water_temp = 190.0f;
+
+  assert(decode_line(k_trace[0], &state) == (BIT(engine_rpm) | BIT(throttle_pos)));
+  assert(state.engine_rpm == 2500.0f);
+  assert(fabsf(state.throttle_pos - 128.0f * 100.0f / 255.0f) < 1e-4f);
+
+  assert(decode_line(k_trace[1], &state) == BIT(steering_angle_deg));
+  assert(fabsf(state.steering_angle_deg - 123.4f) < 1e-3f);
+
+  assert(decode_line(k_trace[2], &state) == BIT(brake_pressure_bar));
+  assert(state.brake_pressure_bar == 55.0f);
+
+  assert(decode_line(k_trace[3], &state) == 0);
+
+  // The pedal byte is missing, so only RPM changes.
+  const float pedal = state.throttle_pos;
+  assert(decode_line(k_trace[4], &state) == BIT(engine_rpm));
+  assert(state.engine_rpm == 6000.0f && state.throttle_pos == pedal);
+  assert(state.water_temp == 190.0f);
+
+  // Extended frames never match.
+  trace_frame_t frame;
+  parse_trace_line(k_trace[0], &frame);
+  assert(can_broadcast_decode(can_broadcast_signals, can_broadcast_signal_count, frame.id, true, frame.data, 8,
+                              &state) == 0);
+}
+
+static void test_channel_mask_and_copy(void) {
+  const uint32_t mask = can_broadcast_channel_mask(can_broadcast_signals, can_broadcast_signal_count);
+  assert(mask == (BIT(engine_rpm) | BIT(throttle_pos) | BIT(brake_pressure_bar) | BIT(steering_angle_deg)));
+
+  vehicle_state_t from = {0};
+  vehicle_state_t to = {0};
+  from.engine_rpm = 3000.0f;
+  from.throttle_pos = 40.0f;
+  from.oil_temp = 220.0f;
+  to.throttle_pos = 10.0f;
+  can_broadcast_copy_channels(BIT(engine_rpm) | BIT(oil_temp), &from, &to);
+  assert(to.engine_rpm == 3000.0f && to.oil_temp == 220.0f && to.throttle_pos == 10.0f);
+}
+
+static void test_tracker_times_out(void) {
+  can_broadcast_tracker_t tracker = {0};
+  assert(can_broadcast_tracker_fresh(&tracker, 0, 500) == 0);
+
+  can_broadcast_tracker_note(&tracker, BIT(engine_rpm) | BIT(throttle_pos), 1000);
+  can_broadcast_tracker_note(&tracker, BIT(engine_rpm), 1400);
+  assert(can_broadcast_tracker_fresh(&tracker, 1500, 500) == (BIT(engine_rpm) | BIT(throttle_pos)));
+  assert(can_broadcast_tracker_fresh(&tracker, 1501, 500) == BIT(engine_rpm));
+  assert(can_broadcast_tracker_fresh(&tracker, 1901, 500) == 0);
+
+  // Timestamps wrap like esp_timer milliseconds.
+  can_broadcast_tracker_note(&tracker, BIT(steering_angle_deg), UINT32_MAX - 100);
+  assert(can_broadcast_tracker_fresh(&tracker, 200, 500) == BIT(steering_angle_deg));
+}
+
+int main(void) {
+  test_extract();
+  test_decode_trace();
+  test_channel_mask_and_copy();
+  test_tracker_times_out();
+  puts("CAN broadcast decoder tests passed");
+  return 0;
+}
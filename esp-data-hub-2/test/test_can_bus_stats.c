@@ -0,0 +1,144 @@
+#include <assert.h>
+#include <stdio.h>
+
+#include "can_bus_stats.h"
+
+static can_bus_stats_t s_stats;
+static can_bus_sample_t s_prev;
+static can_bus_sample_t s_now;
+
+static const can_bus_id_rate_t* find_rate(const can_bus_report_t* report, uint32_t id, bool tx) {
+  for (size_t i = 0; i < report->id_count; ++i) {
+    if (report->ids[i].id == id && report->ids[i].tx == tx) {
+      return &report->ids[i];
+    }
+  }
+  return NULL;
+}
+
+static void test_frame_bits(void) {
+  // 8-byte standard frame: 111 bits, 24 stuff bits at worst.
+  assert(can_bus_frame_bits(8, false) == 135);
+  assert(can_bus_frame_bits(0, false) == 55);
+  assert(can_bus_frame_bits(8, true) == 160);
+  assert(can_bus_frame_bits(15, false) == can_bus_frame_bits(8, false));
+}
+
+static void test_rates_per_id(void) {
+  can_bus_stats_init(&s_stats);
+  can_bus_report_t report = {0};
+  can_bus_stats_sample(&s_stats, &s_prev);
+
+  // 500 ms of ECU polling: 20 requests out, 40 responses in, plus a broadcast.
+  for (int i = 0; i < 20; ++i) {
+    can_bus_stats_record_frame(&s_stats, 0x7E0, false, true, 8);
+    can_bus_stats_record_tx_done(&s_stats, true, 100U + (uint32_t)i);
+    can_bus_stats_record_frame(&s_stats, 0x7E8, false, false, 8);
+    can_bus_stats_record_frame(&s_stats, 0x7E8, false, false, 8);
+  }
+  can_bus_stats_record_frame(&s_stats, 0x140, false, false, 4);
+  can_bus_stats_record_tx_done(&s_stats, false, 0);
+  can_bus_stats_sample(&s_stats, &s_now);
+  can_bus_report_update(&report, &s_prev, &s_now, 1500, 500, 500000);
+
+  assert(report.window_ms == 500 && report.t_ms == 1500);
+  assert(report.frames_per_s == 122);
+  assert(report.bytes_per_s == 968);
+  assert(report.bits_per_s == (60U * 135U + can_bus_frame_bits(4, false)) * 2U);
+  assert(report.load_permille == report.bits_per_s * 1000U / 500000U);
+  assert(report.id_count == 3);
+  assert(find_rate(&report, 0x7E0, true)->frames_per_s == 40);
+  assert(find_rate(&report, 0x7E8, false)->frames_per_s == 80);
+  assert(find_rate(&report, 0x7E8, false)->bytes_per_s == 640);
+  assert(find_rate(&report, 0x140, false)->bytes_per_s == 8);
+  assert(find_rate(&report, 0x7E0, false) == NULL);
+
+  assert(report.tx_frames == 20 && report.tx_failed == 1);
+  assert(report.tx_latency_avg_us == 109);
+  assert(report.tx_latency_max_us == 119);
+
+  // The next window sees only new traffic and a fresh maximum.
+  s_prev = s_now;
+  can_bus_stats_record_frame(&s_stats, 0x7E8, false, false, 8);
+  can_bus_stats_record_tx_done(&s_stats, true, 50);
+  can_bus_stats_sample(&s_stats, &s_now);
+  can_bus_report_update(&report, &s_prev, &s_now, 2500, 1000, 500000);
+  assert(report.frames_per_s == 1);
+  assert(find_rate(&report, 0x7E0, true)->frames_per_s == 0);
+  assert(report.tx_latency_max_us == 50);
+  assert(report.event_count == 0);
+}
+
+static void test_full_table_counts_other(void) {
+  can_bus_stats_init(&s_stats);
+  can_bus_report_t report = {0};
+  can_bus_stats_sample(&s_stats, &s_prev);
+  for (uint32_t id = 0; id < CAN_BUS_STATS_MAX_IDS + 8; ++id) {
+    can_bus_stats_record_frame(&s_stats, 0x100 + id, false, false, 2);
+  }
+  // Known IDs still find their entry once the table is full.
+  can_bus_stats_record_frame(&s_stats, 0x100, false, false, 2);
+  can_bus_stats_record_frame(&s_stats, 0x18DAF110, true, false, 8);
+  can_bus_stats_sample(&s_stats, &s_now);
+  can_bus_report_update(&report, &s_prev, &s_now, 1000, 1000, 500000);
+  assert(report.id_count == CAN_BUS_STATS_MAX_IDS);
+  assert(report.other_frames_per_s == 9);
+  assert(find_rate(&report, 0x100, false)->frames_per_s == 2);
+  assert(report.frames_per_s == CAN_BUS_STATS_MAX_IDS + 10);
+}
+
+static void test_error_and_state_timeline(void) {
+  can_bus_stats_init(&s_stats);
+  can_bus_report_t report = {0};
+  can_bus_stats_sample(&s_stats, &s_prev);
+
+  can_bus_stats_record_error(&s_stats, 1U << 4);
+  can_bus_stats_record_error(&s_stats, 1U << 1);
+  can_bus_stats_record_state(&s_stats, 900, CAN_BUS_STATE_ACTIVE, CAN_BUS_STATE_PASSIVE);
+  can_bus_stats_record_state(&s_stats, 950, CAN_BUS_STATE_PASSIVE, CAN_BUS_STATE_BUS_OFF);
+  can_bus_stats_sample(&s_stats, &s_now);
+  can_bus_report_update(&report, &s_prev, &s_now, 1000, 1000, 500000);
+
+  assert(report.error_frames == 2);
+  assert(report.bus_off_count == 1);
+  assert(report.event_count == 3);
+  assert(report.events[0].kind == CAN_BUS_EVENT_STATE && report.events[0].t_ms == 900);
+  assert(report.events[1].new_state == CAN_BUS_STATE_BUS_OFF && report.events[1].t_ms == 950);
+  assert(report.events[2].kind == CAN_BUS_EVENT_ERRORS && report.events[2].t_ms == 1000);
+  assert(report.events[2].error_frames == 2 && report.events[2].error_flags == 0x12);
+
+  // A quiet window adds nothing; flags start over.
+  s_prev = s_now;
+  can_bus_stats_sample(&s_stats, &s_now);
+  can_bus_report_update(&report, &s_prev, &s_now, 2000, 1000, 500000);
+  assert(report.event_count == 3 && report.error_frames == 0 && s_now.error_flags == 0);
+
+  // More changes than the queue holds are counted, and the timeline keeps
+  // the newest entries.
+  for (uint32_t i = 0; i < CAN_BUS_STATS_STATE_QUEUE + 3; ++i) {
+    can_bus_stats_record_state(&s_stats, 3000 + i, CAN_BUS_STATE_ACTIVE, CAN_BUS_STATE_WARNING);
+  }
+  s_prev = s_now;
+  can_bus_stats_sample(&s_stats, &s_now);
+  can_bus_report_update(&report, &s_prev, &s_now, 4000, 2000, 500000);
+  assert(report.state_dropped == 3);
+  assert(report.event_count == 3 + CAN_BUS_STATS_STATE_QUEUE);
+  for (uint32_t i = 0; i < 2 * CAN_BUS_STATS_STATE_QUEUE; ++i) {
+    can_bus_stats_record_error(&s_stats, 1);
+    s_prev = s_now;
+    can_bus_stats_sample(&s_stats, &s_now);
+    can_bus_report_update(&report, &s_prev, &s_now, 5000 + i, 1, 500000);
+  }
+  assert(report.event_count == CAN_BUS_REPORT_EVENTS);
+  assert(report.events[CAN_BUS_REPORT_EVENTS - 1].t_ms == 5000 + 2 * CAN_BUS_STATS_STATE_QUEUE - 1);
+  assert(report.events[0].kind == CAN_BUS_EVENT_ERRORS);
+}
+
+int main(void) {
+  test_frame_bits();
+  test_rates_per_id();
+  test_full_table_counts_other();
+  test_error_and_state_timeline();
+  puts("CAN bus stats tests passed");
+  return 0;
+}
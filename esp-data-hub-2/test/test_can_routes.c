@@ -0,0 +1,121 @@
+#include <assert.h>
+#include <stdio.h>
+
+#include "can_routes.h"
+
+static int s_ecu;
+static int s_vdc;
+static int s_broadcast;
+
+static void test_exact_routes(void) {
+  can_routes_t table;
+  can_routes_init(&table);
+  assert(can_routes_find(&table, 0x7E8, false) == NULL);
+
+  assert(can_routes_add(&table, 0x7E8, CAN_ROUTES_STD_MASK, &s_ecu));
+  assert(can_routes_add(&table, 0x7B8, CAN_ROUTES_STD_MASK, &s_vdc));
+  assert(can_routes_find(&table, 0x7E8, false) == &s_ecu);
+  assert(can_routes_find(&table, 0x7B8, false) == &s_vdc);
+  assert(can_routes_find(&table, 0x7E0, false) == NULL);
+  assert(can_routes_find(&table, 0x7E9, false) == NULL);
+
+  // Extended frames never match, even with the same low bits.
+  assert(can_routes_find(&table, 0x7E8, true) == NULL);
+  assert(can_routes_find(&table, 0x100007E8, false) == NULL);
+}
+
+static void test_masked_routes_first_match_wins(void) {
+  can_routes_t table;
+  can_routes_init(&table);
+
+  // 0x140-0x14F to one sink, but 0x144 claimed first by another.
+  assert(can_routes_add(&table, 0x144, CAN_ROUTES_STD_MASK, &s_ecu));
+  assert(can_routes_add(&table, 0x140, 0x7F0, &s_broadcast));
+  assert(can_routes_find(&table, 0x144, false) == &s_ecu);
+  assert(can_routes_find(&table, 0x140, false) == &s_broadcast);
+  assert(can_routes_find(&table, 0x14F, false) == &s_broadcast);
+  assert(can_routes_find(&table, 0x150, false) == NULL);
+}
+
+static void test_rejects_bad_routes(void) {
+  can_routes_t table;
+  can_routes_init(&table);
+  assert(!can_routes_add(&table, 0x7E8, CAN_ROUTES_STD_MASK, NULL));
+  assert(!can_routes_add(&table, 0x800, 0xFFF, &s_ecu));
+  assert(!can_routes_add(&table, 0x7E8, 0x7F0, &s_ecu));
+  assert(!can_routes_add(NULL, 0x7E8, CAN_ROUTES_STD_MASK, &s_ecu));
+  assert(table.count == 0);
+
+  for (uint32_t i = 0; i < CAN_ROUTES_MAX; ++i) {
+    assert(can_routes_add(&table, 0x100 + i, CAN_ROUTES_STD_MASK, &s_vdc));
+  }
+  assert(!can_routes_add(&table, 0x7E8, CAN_ROUTES_STD_MASK, &s_ecu));
+  assert(can_routes_find(&table, 0x100 + CAN_ROUTES_MAX - 1, false) == &s_vdc);
+}
+
+// Brute-force check that the filters accept every routed ID and report how
+// many standard IDs they let through.
+static uint32_t check_filters_cover_routes(const can_routes_t* table, const can_filter_t* filters, size_t count) {
+  uint32_t accepted = 0;
+  for (uint32_t id = 0; id <= CAN_ROUTES_STD_MASK; ++id) {
+    const bool pass = can_filter_accepts(filters, count, id, false);
+    if (can_routes_find(table, id, false) != NULL) {
+      assert(pass);
+    }
+    accepted += pass ? 1U : 0U;
+  }
+  return accepted;
+}
+
+static void test_single_filter_for_ecu_and_vdc(void) {
+  can_routes_t table;
+  can_routes_init(&table);
+  assert(can_routes_add(&table, 0x7E8, CAN_ROUTES_STD_MASK, &s_ecu));
+  assert(can_routes_add(&table, 0x7B8, CAN_ROUTES_STD_MASK, &s_vdc));
+
+  // 0x7E8 and 0x7B8 differ in bits 4 and 6, so one filter passes four IDs.
+  can_filter_t filter;
+  assert(can_routes_build_filters(&table, &filter, 1) == 1);
+  assert(filter.mask == 0x7AF && filter.id == 0x7A8);
+  assert(can_filter_id_count(&filter) == 4);
+  assert(check_filters_cover_routes(&table, &filter, 1) == 4);
+  assert(!can_filter_accepts(&filter, 1, 0x7E8, true));
+
+  // With a filter per route nothing extra gets through.
+  can_filter_t filters[2];
+  assert(can_routes_build_filters(&table, filters, 2) == 2);
+  assert(check_filters_cover_routes(&table, filters, 2) == 2);
+}
+
+static void test_merges_cheapest_pair(void) {
+  can_routes_t table;
+  can_routes_init(&table);
+  assert(can_routes_add(&table, 0x7E8, CAN_ROUTES_STD_MASK, &s_ecu));
+  assert(can_routes_add(&table, 0x140, 0x7F0, &s_broadcast));
+  assert(can_routes_add(&table, 0x7B8, CAN_ROUTES_STD_MASK, &s_vdc));
+  assert(can_routes_add(&table, 0x152, CAN_ROUTES_STD_MASK, &s_broadcast));
+
+  // 0x152 joins 0x140/0x7F0 (32 IDs) and 0x7E8 joins 0x7B8 (4 IDs).
+  can_filter_t filters[2];
+  assert(can_routes_build_filters(&table, filters, 2) == 2);
+  assert(check_filters_cover_routes(&table, filters, 2) == 36);
+
+  // Squeezed into one filter everything still passes.
+  can_filter_t one;
+  assert(can_routes_build_filters(&table, &one, 1) == 1);
+  assert(check_filters_cover_routes(&table, &one, 1) == can_filter_id_count(&one));
+
+  can_routes_init(&table);
+  assert(can_routes_build_filters(&table, filters, 2) == 0);
+  assert(!can_filter_accepts(filters, 0, 0x7E8, false));
+}
+
+int main(void) {
+  test_exact_routes();
+  test_masked_routes_first_match_wins();
+  test_rejects_bad_routes();
+  test_single_filter_for_ecu_and_vdc();
+  test_merges_cheapest_pair();
+  puts("CAN routing tests passed");
+  return 0;
+}
@@ -0,0 +1,183 @@
+#include <assert.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "can_rx_ring.h"
+
+#define STRESS_FRAMES 2000000U
+
+// Each frame carries its sequence number in the id and the first four data
+// bytes, and a checksum of those in the rest, so a torn copy is caught.
+static can_rx_frame_t make_frame(uint32_t seq) {
+  can_rx_frame_t frame = {.id = seq & 0x7FFU, .ide = (seq & 0x800U) != 0, .data_len = 8};
+  memcpy(frame.data, &seq, sizeof(seq));
+  const uint32_t check = ~seq * 2654435761U;
+  memcpy(frame.data + 4, &check, sizeof(check));
+  return frame;
+}
+
+static uint32_t frame_seq(const can_rx_frame_t* frame) {
+  uint32_t seq;
+  uint32_t check;
+  memcpy(&seq, frame->data, sizeof(seq));
+  memcpy(&check, frame->data + 4, sizeof(check));
+  assert(check == ~seq * 2654435761U);
+  assert(frame->id == (seq & 0x7FFU) && frame->ide == ((seq & 0x800U) != 0) && frame->data_len == 8);
+  return seq;
+}
+
+static void test_init_rejects_bad_capacity(void) {
+  can_rx_ring_t ring;
+  can_rx_frame_t storage[8];
+  assert(!can_rx_ring_init(&ring, storage, 0));
+  assert(!can_rx_ring_init(&ring, storage, 1));
+  assert(!can_rx_ring_init(&ring, storage, 6));
+  assert(!can_rx_ring_init(&ring, NULL, 8));
+  assert(can_rx_ring_init(&ring, storage, 8));
+  assert(can_rx_ring_init(&ring, storage, 2));
+}
+
+static void test_full_ring_drops_newest(void) {
+  can_rx_ring_t ring;
+  can_rx_frame_t storage[4];
+  assert(can_rx_ring_init(&ring, storage, 4));
+
+  can_rx_frame_t out;
+  assert(!can_rx_ring_pop(&ring, &out));
+  for (uint32_t i = 0; i < 4; ++i) {
+    assert(!can_rx_ring_full(&ring));
+    const can_rx_frame_t frame = make_frame(i);
+    assert(can_rx_ring_push(&ring, &frame));
+  }
+  assert(can_rx_ring_full(&ring));
+  const can_rx_frame_t extra = make_frame(4);
+  assert(!can_rx_ring_push(&ring, &extra));
+  assert(!can_rx_ring_push(&ring, &extra));
+  assert(can_rx_ring_count(&ring) == 4);
+
+  for (uint32_t i = 0; i < 4; ++i) {
+    assert(can_rx_ring_pop(&ring, &out) && frame_seq(&out) == i);
+  }
+  assert(!can_rx_ring_pop(&ring, &out) && !can_rx_ring_full(&ring));
+
+  can_rx_ring_stats_t stats;
+  can_rx_ring_get_stats(&ring, &stats);
+  assert(stats.pushed == 4 && stats.overruns == 2);
+  assert(stats.high_water == 4 && stats.capacity == 4);
+}
+
+static void test_counters_wrap(void) {
+  can_rx_ring_t ring;
+  can_rx_frame_t storage[4];
+  assert(can_rx_ring_init(&ring, storage, 4));
+  atomic_store(&ring.head, UINT32_MAX - 1);
+  atomic_store(&ring.tail, UINT32_MAX - 1);
+
+  can_rx_frame_t out;
+  for (uint32_t i = 0; i < 16; ++i) {
+    const can_rx_frame_t a = make_frame(2 * i);
+    const can_rx_frame_t b = make_frame(2 * i + 1);
+    assert(can_rx_ring_push(&ring, &a) && can_rx_ring_push(&ring, &b));
+    assert(can_rx_ring_count(&ring) == 2);
+    assert(can_rx_ring_pop(&ring, &out) && frame_seq(&out) == 2 * i);
+    assert(can_rx_ring_pop(&ring, &out) && frame_seq(&out) == 2 * i + 1);
+  }
+  for (uint32_t i = 0; i < 4; ++i) {
+    const can_rx_frame_t frame = make_frame(i);
+    assert(can_rx_ring_push(&ring, &frame));
+  }
+  assert(!can_rx_ring_push(&ring, &out));
+  assert(can_rx_ring_count(&ring) == 4);
+}
+
+typedef struct {
+  can_rx_ring_t* ring;
+  bool lossless;  // wait for room instead of dropping
+  atomic_bool done;
+} stress_t;
+
+static void* producer(void* arg) {
+  stress_t* stress = (stress_t*)arg;
+  for (uint32_t seq = 0; seq < STRESS_FRAMES; ++seq) {
+    const can_rx_frame_t frame = make_frame(seq);
+    if (stress->lossless) {
+      // Wait for room instead of pushing into a full ring, which would count
+      // an overrun.
+      while (can_rx_ring_count(stress->ring) > stress->ring->mask) {
+        sched_yield();
+      }
+    }
+    can_rx_ring_push(stress->ring, &frame);
+  }
+  atomic_store(&stress->done, true);
+  return NULL;
+}
+
+// Runs the producer on its own thread and consumes here. Every frame must
+// arrive intact and in order, and every missing sequence number must be an
+// overrun.
+static void run_stress(bool lossless, size_t capacity) {
+  static can_rx_frame_t storage[1024];
+  can_rx_ring_t ring;
+  assert(capacity <= sizeof(storage) / sizeof(storage[0]));
+  assert(can_rx_ring_init(&ring, storage, capacity));
+  stress_t stress = {.ring = &ring, .lossless = lossless};
+  atomic_init(&stress.done, false);
+
+  pthread_t thread;
+  assert(pthread_create(&thread, NULL, producer, &stress) == 0);
+
+  uint32_t received = 0;
+  uint32_t gaps = 0;
+  int64_t last = -1;
+  for (uint32_t spin = 0;; ++spin) {
+    can_rx_frame_t frame;
+    if (can_rx_ring_pop(&ring, &frame)) {
+      const uint32_t seq = frame_seq(&frame);
+      assert((int64_t)seq > last);
+      gaps += seq - (uint32_t)(last + 1);
+      last = seq;
+      received++;
+      // Stall now and then so the ring fills up.
+      if (!lossless && (received & 0x3FFU) == 0) {
+        for (volatile uint32_t i = 0; i < 20000U; ++i) {
+        }
+      }
+    } else if (atomic_load(&stress.done) && can_rx_ring_count(&ring) == 0) {
+      break;
+    } else if ((spin & 0xFFU) == 0) {
+      sched_yield();
+    }
+  }
+  assert(pthread_join(thread, NULL) == 0);
+  gaps += STRESS_FRAMES - 1 - (uint32_t)last;
+
+  can_rx_ring_stats_t stats;
+  can_rx_ring_get_stats(&ring, &stats);
+  assert(stats.pushed == received);
+  assert(stats.overruns == gaps);
+  assert(received + stats.overruns == STRESS_FRAMES);
+  assert(stats.high_water <= capacity);
+  if (lossless) {
+    assert(received == STRESS_FRAMES && stats.overruns == 0);
+  } else {
+    assert(stats.overruns > 0 && stats.high_water == capacity);
+  }
+  printf("  %s, %zu slots: received %u, overruns %u, high water %u\n", lossless ? "lossless" : "lossy", capacity,
+         (unsigned)received, (unsigned)stats.overruns, (unsigned)stats.high_water);
+}
+
+int main(void) {
+  test_init_rejects_bad_capacity();
+  test_full_ring_drops_newest();
+  test_counters_wrap();
+  run_stress(true, 4);
+  run_stress(true, 64);
+  run_stress(false, 64);
+  run_stress(false, 1024);
+  puts("CAN RX ring tests passed");
+  return 0;
+}
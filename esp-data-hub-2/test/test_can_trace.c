@@ -0,0 +1,251 @@
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "can_routes.h"
+#include "can_rx_ring.h"
+#include "can_trace.h"
+#include "isotp_codec.h"
+#include "request_ecu.h"
+
+// One ECU poll as the hub sees it on the bus: the request (only its first
+// frame here), the ECU's first frame, the hub's flow control, the two
+// consecutive frames, and a broadcast nobody routes.
+static const char k_ecu_trace[] =
+    "Time   ID     DLC Data\n"
+    "10.000 7E0 8 10 35 A8 00 00 00 08 00\n"
+    "10.004 7E8 8 10 11 E8 5A 40 C0 2E E0\n"
+    "10.004 7E0 3 30 00 00\n"
+    "10.005 040 8 5A 03 C4 49 80 00 00 00\n"
+    "10.006 7E8 8 21 3C 14 80 10 BF C0 00\n"
+    "10.007 7E8 8 22 00 80 00 FF 00 00 00\n";
+
+static void assert_float_near(float actual, float expected) {
+  assert(fabsf(actual - expected) < 0.0001f);
+}
+
+static void test_format_and_parse(void) {
+  const can_trace_record_t std = {.t_us = 12004999, .id = 0x7E8, .dlc = 3, .data = {0x03, 0xE8, 0x0A}};
+  char line[CAN_TRACE_LINE_MAX];
+  assert(can_trace_format_line(&std, 0, line, sizeof(line)) == strlen("12.004 7E8 3 03 E8 0A\n"));
+  assert(strcmp(line, "12.004 7E8 3 03 E8 0A\n") == 0);
+
+  const can_trace_record_t ext = {
+      .t_us = 5000, .id = 0x18DAF110, .flags = CAN_TRACE_FLAG_IDE | CAN_TRACE_FLAG_TX, .dlc = 8,
+      .data = {1, 2, 3, 4, 5, 6, 7, 8}};
+  assert(can_trace_format_line(&ext, 2000, line, sizeof(line)) > 0);
+  assert(strcmp(line, "0.003 18DAF110 8 01 02 03 04 05 06 07 08\n") == 0);
+  assert(can_trace_format_line(&ext, 0, line, CAN_TRACE_LINE_MAX - 1) == 0);
+
+  // The longest line, 50 characters, fits.
+  const can_trace_record_t longest = {
+      .t_us = 9999999999999999ULL, .id = 0x1FFFFFFF, .flags = CAN_TRACE_FLAG_IDE, .dlc = 8};
+  assert(can_trace_format_line(&longest, 0, line, sizeof(line)) == 50);
+
+  can_trace_record_t parsed;
+  assert(can_trace_parse_line("12.004 7E8 3 03 E8 0A", 21, &parsed) == CAN_TRACE_LINE_FRAME);
+  assert(parsed.t_us == 12004000 && parsed.id == 0x7E8 && parsed.flags == 0 && parsed.dlc == 3);
+  assert(parsed.data[0] == 0x03 && parsed.data[1] == 0xE8 && parsed.data[2] == 0x0A);
+
+  static const char ext_line[] = "0.003 18DAF110 8 01 02 03 04 05 06 07 08\r";
+  assert(can_trace_parse_line(ext_line, strlen(ext_line), &parsed) == CAN_TRACE_LINE_FRAME);
+  assert(parsed.t_us == 3000 && parsed.id == 0x18DAF110 && parsed.flags == CAN_TRACE_FLAG_IDE && parsed.dlc == 8);
+  assert(parsed.data[7] == 8);
+
+  // Microsecond stamps, tabs, lower case and a bare second are accepted too.
+  static const char loose[] = "  7.000123\t7e8\t0";
+  assert(can_trace_parse_line(loose, strlen(loose), &parsed) == CAN_TRACE_LINE_FRAME);
+  assert(parsed.t_us == 7000123 && parsed.id == 0x7E8 && parsed.dlc == 0);
+  assert(can_trace_parse_line("3 123 1 FF", 10, &parsed) == CAN_TRACE_LINE_FRAME && parsed.t_us == 3000000);
+  // Past 32 bits of microseconds, up to CANHacker's ten digits of seconds.
+  assert(can_trace_parse_line("4294.967296 7E8 0", 17, &parsed) == CAN_TRACE_LINE_FRAME &&
+         parsed.t_us == 4294967296ULL);
+  assert(can_trace_parse_line("9999999999.999 7E8 0", 20, &parsed) == CAN_TRACE_LINE_FRAME &&
+         parsed.t_us == 9999999999999000ULL);
+
+  static const char* const skipped[] = {"", "   \r", "Time   ID     DLC Data", "# comment"};
+  for (size_t i = 0; i < sizeof(skipped) / sizeof(skipped[0]); ++i) {
+    assert(can_trace_parse_line(skipped[i], strlen(skipped[i]), &parsed) == CAN_TRACE_LINE_SKIPPED);
+  }
+  static const char* const malformed[] = {
+      "1.000 7E8 9 00 00 00 00 00 00 00 00 00",  // DLC above 8
+      "1.000 7E8 2 00",                          // fewer bytes than the DLC
+      "1.000 7E8 1 00 11",                       // more bytes than the DLC
+      "1.000 7E8 1 100",                         // byte out of range
+      "1.000 20000000 0",                        // ID out of range
+      "1.000 7G8 0",                             // not hex
+      "1.0.0 7E8 0",                             // two decimal points
+      "1.000",                                   // no ID
+      "12345678901.000 7E8 0",                   // eleven digits of seconds
+  };
+  for (size_t i = 0; i < sizeof(malformed) / sizeof(malformed[0]); ++i) {
+    assert(can_trace_parse_line(malformed[i], strlen(malformed[i]), &parsed) == CAN_TRACE_LINE_MALFORMED);
+  }
+
+  // Every formatted frame parses back to itself, at millisecond resolution.
+  for (uint32_t id = 0; id < 0x800; id += 0x55) {
+    const can_trace_record_t frame = {.t_us = id * 1000U, .id = id, .dlc = (uint8_t)(id % 9), .data = {0xA5, 0x5A}};
+    assert(can_trace_format_line(&frame, 0, line, sizeof(line)) > 0);
+    assert(can_trace_parse_line(line, strlen(line) - 1, &parsed) == CAN_TRACE_LINE_FRAME);
+    assert(parsed.t_us == frame.t_us && parsed.id == frame.id && parsed.dlc == frame.dlc);
+    assert(memcmp(parsed.data, frame.data, frame.dlc) == 0);
+  }
+}
+
+static void test_capture_overwrites_oldest(void) {
+  can_trace_record_t storage[8];
+  can_trace_t trace;
+  assert(!can_trace_init(&trace, storage, 6));
+  assert(can_trace_init(&trace, storage, 8));
+  assert(can_trace_count(&trace) == 0 && can_trace_get(&trace, 0) == NULL);
+
+  const uint8_t data[8] = {0};
+  for (uint32_t i = 0; i < 5; ++i) {
+    can_trace_record(&trace, 1000U * i, 0x100 + i, 0, data, 8);
+  }
+  assert(can_trace_count(&trace) == 5 && can_trace_overwritten(&trace) == 0);
+  assert(can_trace_get(&trace, 0)->id == 0x100 && can_trace_get(&trace, 4)->id == 0x104);
+
+  for (uint32_t i = 5; i < 19; ++i) {
+    can_trace_record(&trace, 1000U * i, 0x100 + i, CAN_TRACE_FLAG_TX, data, 15);
+  }
+  assert(can_trace_count(&trace) == 8 && can_trace_overwritten(&trace) == 11);
+  assert(can_trace_get(&trace, 0)->id == 0x10B && can_trace_get(&trace, 7)->id == 0x112);
+  assert(can_trace_get(&trace, 7)->dlc == 8 && can_trace_get(&trace, 8) == NULL);
+
+  // Stopped capture keeps what it has.
+  trace.enabled = false;
+  can_trace_record(&trace, 0, 0x7FF, 0, data, 0);
+  assert(can_trace_get(&trace, 7)->id == 0x112);
+  trace.enabled = true;
+
+  can_trace_clear(&trace);
+  assert(can_trace_count(&trace) == 0 && can_trace_overwritten(&trace) == 0);
+}
+
+static void test_replay_paces_frames(void) {
+  static const char text[] =
+      "Time   ID     DLC Data\r\n"
+      "59.990 7E8 1 01\r\n"
+      "\r\n"
+      "59.998 7E8 1 02\r\n"
+      "garbage\n"
+      "1.1 7E8 1\n"
+      "0.004 7E8 1 03\n"  // CANHacker's one-minute wrap
+      "0.010 7E8 1 04";   // no final newline
+  can_trace_replay_t replay;
+  can_trace_replay_init(&replay, text, strlen(text));
+
+  can_trace_record_t frame;
+  uint64_t due = 1;
+  static const uint64_t expected_due[] = {0, 8000, 8000, 14000};
+  for (size_t i = 0; i < 4; ++i) {
+    assert(can_trace_replay_next(&replay, &frame, &due));
+    assert(frame.data[0] == i + 1 && due == expected_due[i]);
+  }
+  assert(!can_trace_replay_next(&replay, &frame, &due));
+  assert(replay.frames == 4 && replay.malformed == 1);
+
+  // Text embedded by the build ends at its NUL, which the length includes.
+  can_trace_replay_init(&replay, text, sizeof(text));
+  size_t frames = 0;
+  while (can_trace_replay_next(&replay, NULL, NULL)) {
+    frames++;
+  }
+  assert(frames == 4);
+
+  // A drive longer than 32 bits of microseconds keeps its timing.
+  static const char long_text[] =
+      "1000.000 7E8 1 01\n"
+      "4294.967 7E8 1 02\n"
+      "4295.000 7E8 1 03\n"
+      "1234567890.5 7E8 1 04\n";
+  can_trace_replay_init(&replay, long_text, strlen(long_text));
+  static const uint64_t expected_long_due[] = {0, 3294967000ULL, 3295000000ULL, 1234566890500000ULL};
+  for (size_t i = 0; i < 4; ++i) {
+    assert(can_trace_replay_next(&replay, &frame, &due));
+    assert(frame.data[0] == i + 1 && due == expected_long_due[i]);
+  }
+  assert(replay.malformed == 0);
+}
+
+// Replays k_ecu_trace through the same route table and ring the TWAI ISR
+// uses, then decodes the response like task_ecu_ssm.
+static size_t replay_ecu_response(can_rx_ring_t* ring, const can_routes_t* routes, request_ecu_response_t* out) {
+  can_trace_replay_t replay;
+  can_trace_replay_init(&replay, k_ecu_trace, sizeof(k_ecu_trace) - 1);
+  can_trace_record_t record;
+  uint64_t due_us = 0;
+  size_t unrouted = 0;
+  while (can_trace_replay_next(&replay, &record, &due_us)) {
+    can_rx_ring_t* sink = can_routes_find(routes, record.id, (record.flags & CAN_TRACE_FLAG_IDE) != 0);
+    if (sink == NULL) {
+      unrouted++;
+      continue;
+    }
+    can_rx_frame_t frame = {.id = record.id, .ide = false, .data_len = record.dlc, .rx_us = (uint32_t)due_us};
+    memcpy(frame.data, record.data, record.dlc);
+    assert(can_rx_ring_push(sink, &frame));
+  }
+
+  can_rx_frame_t frames[REQUEST_ECU_MAX_FRAMES];
+  size_t count = 0;
+  while (count < REQUEST_ECU_MAX_FRAMES && can_rx_ring_pop(ring, &frames[count])) {
+    count++;
+  }
+  uint8_t payload[REQUEST_ECU_MAX_FRAMES * 7];
+  size_t payload_len = 0;
+  assert(count == 3 && frames[2].rx_us == 7000);
+  assert(isotp_unwrap_frames(frames, count, payload, sizeof(payload), &payload_len));
+  assert(payload_len == 17);
+  assert(request_ecu_parse_ssm_response(REQUEST_ECU_ALL_FIELDS, payload, payload_len, out));
+  return unrouted;
+}
+
+static void test_replay_ecu_exchange(void) {
+  static can_rx_frame_t storage[16];
+  static can_rx_ring_t ring;
+  can_routes_t routes;
+  assert(can_rx_ring_init(&ring, storage, 16));
+  can_routes_init(&routes);
+  assert(can_routes_add(&routes, 0x7E8, CAN_ROUTES_STD_MASK, &ring));
+
+  request_ecu_response_t response = {0};
+  assert(replay_ecu_response(&ring, &routes, &response) == 3);
+  assert_float_near(response.water_temp, 122.0f);
+  assert_float_near(response.af_correct, -50.0f);
+  assert_float_near(response.af_learned, 50.0f);
+  assert_float_near(response.engine_rpm, 3000.0f);
+  assert_float_near(response.int_temp, 68.0f);
+  assert_float_near(response.inj_duty, 12.8f);
+  assert_float_near(response.af_ratio, 14.7f);
+  assert_float_near(response.dam, 1.0f);
+  assert_float_near(response.fb_knock, -1.5f);
+  assert_float_near(response.eth_conc, 50.0f);
+  assert_float_near(response.throttle_pos, 100.0f);
+
+  // Same trace, same result, as fast as the host goes.
+  enum { ROUNDS = 20000 };
+  struct timespec start;
+  struct timespec end;
+  timespec_get(&start, TIME_UTC);
+  for (int i = 0; i < ROUNDS; ++i) {
+    request_ecu_response_t again = {0};
+    replay_ecu_response(&ring, &routes, &again);
+    assert(memcmp(&again, &response, sizeof(response)) == 0);
+  }
+  timespec_get(&end, TIME_UTC);
+  const double seconds = (double)(end.tv_sec - start.tv_sec) + (double)(end.tv_nsec - start.tv_nsec) * 1e-9;
+  printf("  replayed %d ECU exchanges (%d frames) in %.1f ms\n", ROUNDS, ROUNDS * 6, seconds * 1e3);
+}
+
+int main(void) {
+  test_format_and_parse();
+  test_capture_overwrites_oldest();
+  test_replay_paces_frames();
+  test_replay_ecu_exchange();
+  puts("CAN trace tests passed");
+  return 0;
+}
@@ -0,0 +1,76 @@
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "hub_settings.h"
+#include "request_ecu.h"
+
+static hub_settings_t default_settings(void) {
+  const hub_settings_t settings = {
+      .emit_period_ms = 20,
+      .ecu_poll_period_ms = 63,
+      .vdc_poll_period_ms = 63,
+      .ecu_field_mask = REQUEST_ECU_ALL_FIELDS,
+  };
+  return settings;
+}
+
+static void test_applies_and_echoes_settings(void) {
+  hub_settings_t settings = default_settings();
+  telemetry_control_t reply = {0};
+
+  const telemetry_control_t emit = {.type = TELEMETRY_CONTROL_SET_EMIT_PERIOD, .value = 50};
+  assert(hub_settings_apply(&settings, &emit, &reply));
+  assert(settings.emit_period_ms == 50);
+  assert(reply.type == TELEMETRY_CONTROL_SET_EMIT_PERIOD && reply.value == 50);
+
+  const telemetry_control_t ecu = {.type = TELEMETRY_CONTROL_SET_ECU_POLL_PERIOD, .value = 250};
+  assert(hub_settings_apply(&settings, &ecu, &reply));
+  assert(settings.ecu_poll_period_ms == 250 && reply.value == 250);
+
+  const telemetry_control_t vdc = {.type = TELEMETRY_CONTROL_SET_VDC_POLL_PERIOD, .value = 1000};
+  assert(hub_settings_apply(&settings, &vdc, &reply));
+  assert(settings.vdc_poll_period_ms == 1000 && reply.value == 1000);
+  assert(settings.emit_period_ms == 50 && settings.ecu_poll_period_ms == 250);
+}
+
+static void test_clamps_out_of_range_values(void) {
+  hub_settings_t settings = default_settings();
+  telemetry_control_t reply = {0};
+
+  const telemetry_control_t zero_emit = {.type = TELEMETRY_CONTROL_SET_EMIT_PERIOD, .value = 0};
+  assert(hub_settings_apply(&settings, &zero_emit, &reply));
+  assert(settings.emit_period_ms == HUB_SETTINGS_EMIT_PERIOD_MIN_MS && reply.value == HUB_SETTINGS_EMIT_PERIOD_MIN_MS);
+
+  const telemetry_control_t slow_poll = {.type = TELEMETRY_CONTROL_SET_ECU_POLL_PERIOD, .value = UINT32_MAX};
+  assert(hub_settings_apply(&settings, &slow_poll, &reply));
+  assert(settings.ecu_poll_period_ms == HUB_SETTINGS_POLL_PERIOD_MAX_MS);
+
+  // Non-SSM channels are dropped and injector duty brings RPM along.
+  const telemetry_control_t fields = {
+      .type = TELEMETRY_CONTROL_SET_ECU_FIELDS,
+      .value = (1UL << TELEMETRY_CHANNEL_inj_duty) | (1UL << TELEMETRY_CHANNEL_oil_temp)};
+  assert(hub_settings_apply(&settings, &fields, &reply));
+  assert(settings.ecu_field_mask == ((1UL << TELEMETRY_CHANNEL_inj_duty) | (1UL << TELEMETRY_CHANNEL_engine_rpm)));
+  assert(reply.value == settings.ecu_field_mask);
+}
+
+static void test_ignores_other_control_frames(void) {
+  hub_settings_t settings = default_settings();
+  telemetry_control_t reply = {0};
+
+  const telemetry_control_t keepalive = {.type = TELEMETRY_CONTROL_LINK_KEEPALIVE, .value = 5};
+  assert(!hub_settings_apply(&settings, &keepalive, &reply));
+  assert(reply.type == 0);
+  assert(settings.emit_period_ms == 20);
+  assert(!hub_settings_apply(NULL, &keepalive, &reply));
+  assert(!hub_settings_apply(&settings, NULL, &reply));
+}
+
+int main(void) {
+  test_applies_and_echoes_settings();
+  test_clamps_out_of_range_values();
+  test_ignores_other_control_frames();
+  puts("hub settings tests passed");
+  return 0;
+}
@@ -0,0 +1,400 @@
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "isotp_channel.h"
+#include "isotp_codec.h"
+
+#define TX_ID 0x7E0U
+
+typedef struct {
+  uint8_t data[32][8];
+  uint8_t len[32];
+  uint32_t id[32];
+  size_t count;
+  size_t fail_next;  // refuse this many sends before accepting again
+} sent_t;
+
+static bool record_send(void* ctx, uint32_t id, const uint8_t* data, uint8_t len) {
+  sent_t* sent = (sent_t*)ctx;
+  if (sent->fail_next > 0) {
+    sent->fail_next--;
+    return false;
+  }
+  assert(sent->count < 32);
+  memset(sent->data[sent->count], 0, 8);
+  memcpy(sent->data[sent->count], data, len);
+  sent->len[sent->count] = len;
+  sent->id[sent->count] = id;
+  sent->count++;
+  return true;
+}
+
+static void setup(isotp_channel_t* channel, sent_t* sent, uint8_t* rx_buffer, size_t rx_capacity, uint32_t id) {
+  memset(sent, 0, sizeof(*sent));
+  const isotp_channel_config_t config = {
+      .tx_id = id,
+      .send = record_send,
+      .send_ctx = sent,
+      .rx_buffer = rx_buffer,
+      .rx_capacity = rx_capacity,
+      .fc_timeout_us = 1000000,
+      .response_timeout_us = 200000,
+      .cf_timeout_us = 150000,
+      .cf_gap_us = 0,
+      .tx_retry_us = 10000,
+      .tx_retries = 2,
+      .fc_wait_max = 2,
+  };
+  isotp_channel_init(channel, &config);
+}
+
+static can_rx_frame_t frame_of(const uint8_t* data, uint8_t len) {
+  can_rx_frame_t frame = {.id = TX_ID + 8, .data_len = len};
+  memcpy(frame.data, data, len);
+  return frame;
+}
+
+static size_t wrap(size_t payload_len, uint8_t frames[][8], size_t capacity) {
+  uint8_t payload[128];
+  for (size_t i = 0; i < payload_len; ++i) {
+    payload[i] = (uint8_t)(0x40 + i);
+  }
+  size_t count = 0;
+  assert(isotp_wrap_payload(payload, (uint16_t)payload_len, frames, capacity, &count));
+  return count;
+}
+
+static void test_single_frame_exchange(void) {
+  isotp_channel_t channel;
+  sent_t sent;
+  uint8_t rx[64];
+  setup(&channel, &sent, rx, sizeof(rx), TX_ID);
+
+  uint8_t request[1][8];
+  assert(wrap(3, request, 1) == 1);
+  assert(isotp_channel_submit(&channel, request, 1, 1000));
+  assert(sent.count == 1 && sent.len[0] == 8 && sent.id[0] == TX_ID);
+  assert(memcmp(sent.data[0], request[0], 8) == 0);
+  assert(channel.state == ISOTP_CHANNEL_WAIT_RESPONSE);
+  // Busy until reset.
+  assert(!isotp_channel_submit(&channel, request, 1, 1000));
+
+  uint32_t deadline = 0;
+  assert(isotp_channel_next_deadline(&channel, &deadline) && deadline == 201000);
+
+  // A stray flow control is not a response.
+  const uint8_t fc[3] = {0x30, 0, 0};
+  can_rx_frame_t frame = frame_of(fc, 3);
+  isotp_channel_on_frame(&channel, &frame, 2000);
+  assert(channel.ignored_frames == 1 && channel.state == ISOTP_CHANNEL_WAIT_RESPONSE);
+
+  const uint8_t response[8] = {0x03, 0xE8, 0x11, 0x22};
+  frame = frame_of(response, 8);
+  isotp_channel_on_frame(&channel, &frame, 3000);
+  assert(channel.state == ISOTP_CHANNEL_DONE && channel.result == ISOTP_OK);
+  assert(channel.rx.len == 3 && rx[0] == 0xE8 && rx[2] == 0x22);
+  assert(!isotp_channel_next_deadline(&channel, NULL));
+
+  isotp_channel_reset(&channel);
+  assert(channel.state == ISOTP_CHANNEL_IDLE);
+  // Frames while idle are stale.
+  isotp_channel_on_frame(&channel, &frame, 4000);
+  assert(channel.ignored_frames == 2 && channel.state == ISOTP_CHANNEL_IDLE);
+}
+
+static void test_segmented_request_honours_flow_control(void) {
+  isotp_channel_t channel;
+  sent_t sent;
+  uint8_t rx[64];
+  setup(&channel, &sent, rx, sizeof(rx), TX_ID);
+  channel.config.cf_gap_us = 50;
+
+  uint8_t request[6][8];
+  const size_t count = wrap(34, request, 6);  // FF + 4 CFs
+  assert(count == 5);
+  assert(isotp_channel_submit(&channel, request, count, 0));
+  assert(sent.count == 1 && channel.state == ISOTP_CHANNEL_WAIT_FC);
+
+  // Nothing goes out before the flow control.
+  isotp_channel_on_time(&channel, 500000);
+  assert(sent.count == 1);
+
+  // WAIT restarts the timer.
+  const uint8_t fc_wait[3] = {0x31, 0, 0};
+  can_rx_frame_t frame = frame_of(fc_wait, 3);
+  isotp_channel_on_frame(&channel, &frame, 600000);
+  assert(channel.state == ISOTP_CHANNEL_WAIT_FC && channel.deadline_us == 1600000);
+
+  // CTS, block of 2, STmin 5 ms: the first CF goes at once.
+  const uint8_t fc_cts[3] = {0x30, 2, 5};
+  frame = frame_of(fc_cts, 3);
+  isotp_channel_on_frame(&channel, &frame, 700000);
+  assert(sent.count == 2 && memcmp(sent.data[1], request[1], 8) == 0);
+  assert(channel.state == ISOTP_CHANNEL_SEND_CF && channel.deadline_us == 705050);
+
+  // Not yet due, then due.
+  isotp_channel_on_time(&channel, 705049);
+  assert(sent.count == 2);
+  isotp_channel_on_time(&channel, 705050);
+  assert(sent.count == 3 && memcmp(sent.data[2], request[2], 8) == 0);
+  // Block full: back to waiting for flow control.
+  assert(channel.state == ISOTP_CHANNEL_WAIT_FC);
+
+  // Sub-millisecond STmin, no block limit: the rest follows.
+  const uint8_t fc_fast[3] = {0x30, 0, 0xF3};
+  frame = frame_of(fc_fast, 3);
+  isotp_channel_on_frame(&channel, &frame, 710000);
+  assert(sent.count == 4 && channel.deadline_us == 710350);
+  isotp_channel_on_time(&channel, 710350);
+  assert(sent.count == 5 && memcmp(sent.data[4], request[4], 8) == 0);
+  assert(channel.state == ISOTP_CHANNEL_WAIT_RESPONSE && channel.deadline_us == 910350);
+  for (size_t i = 0; i < sent.count; ++i) {
+    assert(sent.id[i] == TX_ID && sent.len[i] == 8);
+  }
+}
+
+static void test_flow_control_refusals(void) {
+  isotp_channel_t channel;
+  sent_t sent;
+  uint8_t rx[64];
+  uint8_t request[3][8];
+  const size_t count = wrap(20, request, 3);
+
+  // Overflow aborts.
+  setup(&channel, &sent, rx, sizeof(rx), TX_ID);
+  assert(isotp_channel_submit(&channel, request, count, 0));
+  const uint8_t overflow[3] = {0x32, 0, 0};
+  can_rx_frame_t frame = frame_of(overflow, 3);
+  isotp_channel_on_frame(&channel, &frame, 10);
+  assert(channel.result == ISOTP_ERR_FLOW_CONTROL && sent.count == 1);
+
+  // Too many WAITs abort.
+  setup(&channel, &sent, rx, sizeof(rx), TX_ID);
+  assert(isotp_channel_submit(&channel, request, count, 0));
+  const uint8_t wait[3] = {0x31, 0, 0};
+  frame = frame_of(wait, 3);
+  isotp_channel_on_frame(&channel, &frame, 10);
+  isotp_channel_on_frame(&channel, &frame, 20);
+  assert(channel.state == ISOTP_CHANNEL_WAIT_FC);
+  isotp_channel_on_frame(&channel, &frame, 30);
+  assert(channel.result == ISOTP_ERR_FLOW_CONTROL);
+
+  // A short flow control is malformed.
+  setup(&channel, &sent, rx, sizeof(rx), TX_ID);
+  assert(isotp_channel_submit(&channel, request, count, 0));
+  frame = frame_of(wait, 2);
+  isotp_channel_on_frame(&channel, &frame, 10);
+  assert(channel.result == ISOTP_ERR_MALFORMED);
+
+  // No flow control at all.
+  setup(&channel, &sent, rx, sizeof(rx), TX_ID);
+  assert(isotp_channel_submit(&channel, request, count, 0));
+  isotp_channel_on_time(&channel, 999999);
+  assert(channel.state == ISOTP_CHANNEL_WAIT_FC);
+  isotp_channel_on_time(&channel, 1000000);
+  assert(channel.result == ISOTP_ERR_FC_TIMEOUT);
+}
+
+static void test_segmented_response_sends_flow_control_once(void) {
+  isotp_channel_t channel;
+  sent_t sent;
+  uint8_t rx[64];
+  uint8_t request[1][8];
+  wrap(2, request, 1);
+
+  uint8_t response[4][8];
+  const size_t count = wrap(20, response, 4);  // FF + 2 CFs
+  assert(count == 3);
+
+  for (int fc_sent = 0; fc_sent <= 1; ++fc_sent) {
+    setup(&channel, &sent, rx, sizeof(rx), TX_ID);
+    assert(isotp_channel_submit(&channel, request, 1, 0));
+    can_rx_frame_t frame = frame_of(response[0], 8);
+    frame.flags = fc_sent ? CAN_RX_FLAG_FC_SENT : 0;
+    isotp_channel_on_frame(&channel, &frame, 100);
+    assert(channel.state == ISOTP_CHANNEL_RECEIVE_CF);
+    if (fc_sent) {
+      assert(sent.count == 1);
+    } else {
+      // Clear to send, no limits, 3 bytes.
+      assert(sent.count == 2 && sent.len[1] == 3 && sent.id[1] == TX_ID);
+      assert(sent.data[1][0] == 0x30 && sent.data[1][1] == 0 && sent.data[1][2] == 0);
+    }
+    for (size_t i = 1; i < count; ++i) {
+      frame = frame_of(response[i], 8);
+      isotp_channel_on_frame(&channel, &frame, 100 + (uint32_t)i);
+    }
+    assert(channel.result == ISOTP_OK && channel.rx.len == 20);
+    for (size_t i = 0; i < 20; ++i) {
+      assert(rx[i] == (uint8_t)(0x40 + i));
+    }
+  }
+}
+
+static void test_response_errors(void) {
+  isotp_channel_t channel;
+  sent_t sent;
+  uint8_t rx[16];
+  uint8_t big_rx[32];
+  uint8_t request[1][8];
+  wrap(2, request, 1);
+  uint8_t response[4][8];
+  const size_t count = wrap(20, response, 4);
+
+  // Out of order consecutive frame.
+  setup(&channel, &sent, big_rx, sizeof(big_rx), TX_ID);
+  assert(isotp_channel_submit(&channel, request, 1, 0));
+  can_rx_frame_t frame = frame_of(response[0], 8);
+  isotp_channel_on_frame(&channel, &frame, 10);
+  frame = frame_of(response[2], 8);
+  isotp_channel_on_frame(&channel, &frame, 20);
+  assert(channel.result == ISOTP_ERR_SEQUENCE);
+
+  // Larger than the buffer.
+  setup(&channel, &sent, rx, sizeof(rx), TX_ID);
+  assert(isotp_channel_submit(&channel, request, 1, 0));
+  frame = frame_of(response[0], 8);
+  isotp_channel_on_frame(&channel, &frame, 10);
+  assert(channel.result == ISOTP_ERR_OVERFLOW && sent.count == 1);
+
+  // Stalls after the first frame.
+  setup(&channel, &sent, big_rx, sizeof(big_rx), TX_ID);
+  assert(isotp_channel_submit(&channel, request, 1, 0));
+  frame = frame_of(response[0], 8);
+  isotp_channel_on_frame(&channel, &frame, 10);
+  frame = frame_of(response[1], 8);
+  isotp_channel_on_frame(&channel, &frame, 1000);
+  isotp_channel_on_time(&channel, 150999);
+  assert(channel.state == ISOTP_CHANNEL_RECEIVE_CF);
+  isotp_channel_on_time(&channel, 151000);
+  assert(channel.result == ISOTP_ERR_CF_TIMEOUT);
+
+  // A new first frame restarts reception.
+  setup(&channel, &sent, big_rx, sizeof(big_rx), TX_ID);
+  assert(isotp_channel_submit(&channel, request, 1, 0));
+  frame = frame_of(response[0], 8);
+  isotp_channel_on_frame(&channel, &frame, 10);
+  frame = frame_of(response[1], 8);
+  isotp_channel_on_frame(&channel, &frame, 20);
+  for (size_t i = 0; i < count; ++i) {
+    frame = frame_of(response[i], 8);
+    isotp_channel_on_frame(&channel, &frame, 30 + (uint32_t)i);
+  }
+  assert(channel.result == ISOTP_OK && channel.rx.len == 20);
+
+  // Nothing at all.
+  setup(&channel, &sent, big_rx, sizeof(big_rx), TX_ID);
+  assert(isotp_channel_submit(&channel, request, 1, 0));
+  isotp_channel_on_time(&channel, 200000);
+  assert(channel.result == ISOTP_ERR_RESPONSE_TIMEOUT);
+
+  // Malformed single frames.
+  setup(&channel, &sent, big_rx, sizeof(big_rx), TX_ID);
+  assert(isotp_channel_submit(&channel, request, 1, 0));
+  const uint8_t empty_sf[8] = {0x00};
+  frame = frame_of(empty_sf, 8);
+  isotp_channel_on_frame(&channel, &frame, 10);
+  assert(channel.result == ISOTP_ERR_MALFORMED);
+}
+
+static void test_retries_consecutive_frames_without_tx_slot(void) {
+  isotp_channel_t channel;
+  sent_t sent;
+  uint8_t rx[16];
+  uint8_t request[3][8];
+  const size_t count = wrap(20, request, 3);
+  const uint8_t fc_cts[3] = {0x30, 0, 0};
+
+  setup(&channel, &sent, rx, sizeof(rx), TX_ID);
+  assert(isotp_channel_submit(&channel, request, count, 0));
+  sent.fail_next = 2;
+  can_rx_frame_t frame = frame_of(fc_cts, 3);
+  isotp_channel_on_frame(&channel, &frame, 100);
+  assert(sent.count == 1 && channel.state == ISOTP_CHANNEL_SEND_CF && channel.deadline_us == 10100);
+  isotp_channel_on_time(&channel, 10100);
+  assert(sent.count == 1 && channel.deadline_us == 20100);
+  isotp_channel_on_time(&channel, 20100);
+  assert(sent.count == 3 && channel.state == ISOTP_CHANNEL_WAIT_RESPONSE);
+
+  // Out of retries.
+  setup(&channel, &sent, rx, sizeof(rx), TX_ID);
+  assert(isotp_channel_submit(&channel, request, count, 0));
+  sent.fail_next = 3;
+  isotp_channel_on_frame(&channel, &frame, 100);
+  isotp_channel_on_time(&channel, 10100);
+  isotp_channel_on_time(&channel, 20100);
+  assert(channel.result == ISOTP_ERR_TX);
+
+  // The first frame cannot be queued.
+  setup(&channel, &sent, rx, sizeof(rx), TX_ID);
+  sent.fail_next = 1;
+  assert(isotp_channel_submit(&channel, request, count, 0));
+  assert(channel.result == ISOTP_ERR_TX);
+}
+
+static void test_channels_interleave(void) {
+  isotp_channel_t ecu;
+  isotp_channel_t vdc;
+  sent_t ecu_sent;
+  sent_t vdc_sent;
+  uint8_t ecu_rx[64];
+  uint8_t vdc_rx[64];
+  setup(&ecu, &ecu_sent, ecu_rx, sizeof(ecu_rx), 0x7E0);
+  setup(&vdc, &vdc_sent, vdc_rx, sizeof(vdc_rx), 0x7B0);
+
+  uint8_t ecu_request[5][8];
+  const size_t ecu_count = wrap(30, ecu_request, 5);
+  uint8_t vdc_request[1][8];
+  wrap(5, vdc_request, 1);
+  uint8_t vdc_response[3][8];
+  const size_t vdc_count = wrap(17, vdc_response, 3);
+
+  assert(isotp_channel_submit(&ecu, ecu_request, ecu_count, 0));
+  assert(isotp_channel_submit(&vdc, vdc_request, 1, 0));
+  const uint8_t fc_slow[3] = {0x30, 0, 10};
+  can_rx_frame_t frame = frame_of(fc_slow, 3);
+  isotp_channel_on_frame(&ecu, &frame, 1000);
+
+  // The VDC response completes while the ECU is between consecutive frames.
+  frame = frame_of(vdc_response[0], 8);
+  frame.flags = CAN_RX_FLAG_FC_SENT;
+  isotp_channel_on_frame(&vdc, &frame, 2000);
+  for (size_t i = 1; i < vdc_count; ++i) {
+    frame = frame_of(vdc_response[i], 8);
+    isotp_channel_on_frame(&vdc, &frame, 3000);
+  }
+  assert(vdc.result == ISOTP_OK && vdc.rx.len == 17 && vdc_sent.count == 1);
+  assert(ecu.state == ISOTP_CHANNEL_SEND_CF && ecu_sent.count == 2);
+
+  uint32_t deadline = 0;
+  while (isotp_channel_next_deadline(&ecu, &deadline) && ecu.state == ISOTP_CHANNEL_SEND_CF) {
+    isotp_channel_on_time(&ecu, deadline);
+  }
+  assert(ecu_sent.count == ecu_count && ecu.state == ISOTP_CHANNEL_WAIT_RESPONSE);
+  assert(ecu.deadline_us == 1000 + 10000 * (ecu_count - 2) + 200000);
+}
+
+static void test_stmin_encoding(void) {
+  assert(isotp_stmin_us(0x00) == 0);
+  assert(isotp_stmin_us(0x7F) == 127000);
+  assert(isotp_stmin_us(0xF1) == 100);
+  assert(isotp_stmin_us(0xF9) == 900);
+  assert(isotp_stmin_us(0x80) == 127000);
+  assert(isotp_stmin_us(0xFA) == 127000);
+}
+
+int main(void) {
+  test_single_frame_exchange();
+  test_segmented_request_honours_flow_control();
+  test_flow_control_refusals();
+  test_segmented_response_sends_flow_control_once();
+  test_response_errors();
+  test_retries_consecutive_frames_without_tx_slot();
+  test_channels_interleave();
+  test_stmin_encoding();
+  puts("ISO-TP channel tests passed");
+  return 0;
+}
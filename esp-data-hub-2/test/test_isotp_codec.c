@@ -2,9 +2,13 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
+#include <time.h>
 
 #include "isotp_codec.h"
 
+// 1 first frame + ceil((4095 - 6) / 7) consecutive frames.
+#define MAX_FRAMES 586U
+
 static void fill_payload(uint8_t* payload, size_t length) {
   for (size_t i = 0; i < length; ++i) {
     payload[i] = (uint8_t)i;
@@ -171,6 +175,106 @@ static void test_unwraps_single_frame_and_checks_data_length(void) {
   assert(!isotp_unwrap_frames(&frame, 1, output, sizeof(output), &output_length));
 }
 
+static void test_reassembles_max_payload_frame_by_frame(void) {
+  static uint8_t payload[ISOTP_MAX_PAYLOAD];
+  static uint8_t tx[MAX_FRAMES][8];
+  static uint8_t output[ISOTP_MAX_PAYLOAD];
+  size_t frame_count = 0;
+  fill_payload(payload, sizeof(payload));
+
+  assert(isotp_wrap_payload(payload, ISOTP_MAX_PAYLOAD, tx, MAX_FRAMES, &frame_count));
+  assert(frame_count == MAX_FRAMES);
+  assert(tx[0][0] == 0x1F && tx[0][1] == 0xFF);
+
+  isotp_reassembler_t rx;
+  isotp_reassembler_init(&rx, output, sizeof(output));
+  for (size_t i = 0; i < frame_count; ++i) {
+    can_rx_frame_t frame = {.data_len = 8};
+    memcpy(frame.data, tx[i], 8);
+    const isotp_rx_status_t status =
+        i == 0 ? isotp_reassembler_start(&rx, &frame) : isotp_reassembler_consecutive(&rx, &frame);
+    assert(status == (i + 1 < frame_count ? ISOTP_RX_IN_PROGRESS : ISOTP_RX_COMPLETE));
+  }
+  assert(rx.len == ISOTP_MAX_PAYLOAD && !rx.active);
+  assert(memcmp(output, payload, sizeof(payload)) == 0);
+
+  // One byte short of room.
+  can_rx_frame_t first = {.data_len = 8};
+  memcpy(first.data, tx[0], 8);
+  isotp_reassembler_init(&rx, output, sizeof(output) - 1);
+  assert(isotp_reassembler_start(&rx, &first) == ISOTP_RX_ERR_OVERFLOW);
+}
+
+static void test_reassembler_rejects_out_of_order_frames(void) {
+  uint8_t payload[30];
+  uint8_t tx[5][8] = {{0}};
+  can_rx_frame_t rx_frames[5] = {{0}};
+  uint8_t output[sizeof(payload)];
+  size_t frame_count = 0;
+  fill_payload(payload, sizeof(payload));
+  assert(isotp_wrap_payload(payload, sizeof(payload), tx, 5, &frame_count));
+  copy_tx_to_rx(tx, rx_frames, frame_count);
+
+  isotp_reassembler_t rx;
+  isotp_reassembler_init(&rx, output, sizeof(output));
+  // Nothing to continue yet.
+  assert(isotp_reassembler_consecutive(&rx, &rx_frames[1]) == ISOTP_RX_ERR_MALFORMED);
+
+  assert(isotp_reassembler_start(&rx, &rx_frames[0]) == ISOTP_RX_IN_PROGRESS);
+  assert(isotp_reassembler_consecutive(&rx, &rx_frames[2]) == ISOTP_RX_ERR_SEQUENCE);
+  assert(!rx.active);
+
+  // A new first frame starts over; a repeated frame is out of sequence.
+  assert(isotp_reassembler_start(&rx, &rx_frames[0]) == ISOTP_RX_IN_PROGRESS);
+  assert(isotp_reassembler_consecutive(&rx, &rx_frames[1]) == ISOTP_RX_IN_PROGRESS);
+  assert(isotp_reassembler_consecutive(&rx, &rx_frames[1]) == ISOTP_RX_ERR_SEQUENCE);
+
+  // Only single and first frames start a message.
+  assert(isotp_reassembler_start(&rx, &rx_frames[1]) == ISOTP_RX_ERR_MALFORMED);
+}
+
+static double elapsed_s(const struct timespec* start) {
+  struct timespec end;
+  timespec_get(&end, TIME_UTC);
+  return (double)(end.tv_sec - start->tv_sec) + (double)(end.tv_nsec - start->tv_nsec) * 1e-9;
+}
+
+static void benchmark_wrap_and_unwrap(void) {
+  static uint8_t payload[ISOTP_MAX_PAYLOAD];
+  static uint8_t tx[MAX_FRAMES][8];
+  static can_rx_frame_t rx[MAX_FRAMES];
+  static uint8_t output[ISOTP_MAX_PAYLOAD];
+  const size_t sizes[] = {128, 1024, ISOTP_MAX_PAYLOAD};
+  fill_payload(payload, sizeof(payload));
+
+  for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s) {
+    const size_t length = sizes[s];
+    const int rounds = (int)(8000000 / length);
+    size_t frame_count = 0;
+
+    struct timespec start;
+    timespec_get(&start, TIME_UTC);
+    for (int i = 0; i < rounds; ++i) {
+      payload[0] = (uint8_t)i;
+      assert(isotp_wrap_payload(payload, (uint16_t)length, tx, MAX_FRAMES, &frame_count));
+    }
+    const double wrap_s = elapsed_s(&start);
+
+    copy_tx_to_rx(tx, rx, frame_count);
+    size_t output_length = 0;
+    timespec_get(&start, TIME_UTC);
+    for (int i = 0; i < rounds; ++i) {
+      assert(isotp_unwrap_frames(rx, frame_count, output, sizeof(output), &output_length));
+    }
+    const double unwrap_s = elapsed_s(&start);
+    assert(output_length == length && memcmp(output, payload, length) == 0);
+
+    const double megabytes = (double)length * rounds / 1e6;
+    printf("  %4zu B x %d: wrap %.0f MB/s, unwrap %.0f MB/s\n", length, rounds, megabytes / wrap_s,
+           megabytes / unwrap_s);
+  }
+}
+
 int main(void) {
   test_wraps_single_frame_boundaries();
   test_wraps_and_unwraps_multiple_frames();
@@ -179,6 +283,9 @@ int main(void) {
   test_rejects_invalid_wrap_arguments_and_capacity();
   test_rejects_malformed_frames();
   test_unwraps_single_frame_and_checks_data_length();
+  test_reassembles_max_payload_frame_by_frame();
+  test_reassembler_rejects_out_of_order_frames();
+  benchmark_wrap_and_unwrap();
   puts("ISO-TP codec tests passed");
   return 0;
 }
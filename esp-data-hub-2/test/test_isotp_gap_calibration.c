@@ -0,0 +1,102 @@
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "isotp_gap_calibration.h"
+
+// Runs a search against a node that drops requests sent with a gap below
+// `needed_us`, and returns how many exchanges it took.
+static uint32_t calibrate(isotp_gap_calibration_t* cal, uint32_t start_us, uint32_t needed_us) {
+  isotp_gap_calibration_start(cal, start_us, 2000, 25, 4);
+  uint32_t exchanges = 0;
+  while (!cal->done) {
+    const uint32_t gap_us = isotp_gap_calibration_gap_us(cal);
+    assert(gap_us <= 2000);
+    const isotp_gap_trial_t trial = gap_us >= needed_us ? ISOTP_GAP_TRIAL_PASS : ISOTP_GAP_TRIAL_FAIL;
+    isotp_gap_calibration_record(cal, trial);
+    assert(++exchanges < 1000);
+  }
+  return exchanges;
+}
+
+static void test_finds_smallest_reliable_gap(void) {
+  const uint32_t needs[] = {0, 1, 24, 25, 90, 249, 250, 251, 700, 1999, 2000};
+  for (size_t i = 0; i < sizeof(needs) / sizeof(needs[0]); ++i) {
+    isotp_gap_calibration_t cal;
+    calibrate(&cal, 250, needs[i]);
+    assert(cal.found);
+    const uint32_t gap_us = isotp_gap_calibration_gap_us(&cal);
+    assert(gap_us >= needs[i]);
+    assert(gap_us < needs[i] + 25);
+  }
+}
+
+static void test_gives_up_at_max(void) {
+  isotp_gap_calibration_t cal;
+  calibrate(&cal, 250, 2500);
+  assert(!cal.found);
+  assert(isotp_gap_calibration_gap_us(&cal) == 2000);
+}
+
+static void test_starts_from_zero(void) {
+  isotp_gap_calibration_t cal;
+  calibrate(&cal, 0, 0);
+  assert(cal.found && isotp_gap_calibration_gap_us(&cal) == 0);
+  calibrate(&cal, 0, 300);
+  assert(cal.found);
+  assert(isotp_gap_calibration_gap_us(&cal) >= 300 && isotp_gap_calibration_gap_us(&cal) < 325);
+}
+
+static void test_needs_consecutive_passes(void) {
+  isotp_gap_calibration_t cal;
+  isotp_gap_calibration_start(&cal, 400, 2000, 25, 3);
+  assert(isotp_gap_calibration_gap_us(&cal) == 400);
+
+  // Inconclusive exchanges neither count nor reset the run.
+  assert(!isotp_gap_calibration_record(&cal, ISOTP_GAP_TRIAL_PASS));
+  assert(!isotp_gap_calibration_record(&cal, ISOTP_GAP_TRIAL_INCONCLUSIVE));
+  assert(!isotp_gap_calibration_record(&cal, ISOTP_GAP_TRIAL_PASS));
+  assert(isotp_gap_calibration_gap_us(&cal) == 400);
+  assert(!isotp_gap_calibration_record(&cal, ISOTP_GAP_TRIAL_PASS));
+  assert(cal.verified);
+  // Bisecting below the verified gap.
+  assert(isotp_gap_calibration_gap_us(&cal) == 200);
+
+  // One drop rejects the gap, however many passed before it.
+  assert(!isotp_gap_calibration_record(&cal, ISOTP_GAP_TRIAL_PASS));
+  assert(!isotp_gap_calibration_record(&cal, ISOTP_GAP_TRIAL_PASS));
+  assert(!isotp_gap_calibration_record(&cal, ISOTP_GAP_TRIAL_FAIL));
+  assert(cal.lo_us == 201 && cal.hi_us == 400);
+  assert(isotp_gap_calibration_gap_us(&cal) == 300);
+}
+
+static void test_widens_failing_start(void) {
+  isotp_gap_calibration_t cal;
+  isotp_gap_calibration_start(&cal, 250, 2000, 25, 1);
+  isotp_gap_calibration_record(&cal, ISOTP_GAP_TRIAL_FAIL);
+  assert(!cal.verified && isotp_gap_calibration_gap_us(&cal) == 500);
+  isotp_gap_calibration_record(&cal, ISOTP_GAP_TRIAL_FAIL);
+  assert(isotp_gap_calibration_gap_us(&cal) == 1000);
+  isotp_gap_calibration_record(&cal, ISOTP_GAP_TRIAL_PASS);
+  assert(cal.verified && cal.lo_us == 501 && cal.hi_us == 1000);
+}
+
+static void test_maps_results(void) {
+  assert(isotp_gap_trial_from_result(ISOTP_OK) == ISOTP_GAP_TRIAL_PASS);
+  assert(isotp_gap_trial_from_result(ISOTP_ERR_RESPONSE_TIMEOUT) == ISOTP_GAP_TRIAL_FAIL);
+  assert(isotp_gap_trial_from_result(ISOTP_ERR_FC_TIMEOUT) == ISOTP_GAP_TRIAL_INCONCLUSIVE);
+  assert(isotp_gap_trial_from_result(ISOTP_ERR_TX) == ISOTP_GAP_TRIAL_INCONCLUSIVE);
+  assert(isotp_gap_trial_from_result(ISOTP_ERR_SEQUENCE) == ISOTP_GAP_TRIAL_INCONCLUSIVE);
+}
+
+int main(void) {
+  test_finds_smallest_reliable_gap();
+  test_gives_up_at_max();
+  test_starts_from_zero();
+  test_needs_consecutive_passes();
+  test_widens_failing_start();
+  test_maps_results();
+  puts("ISO-TP gap calibration tests passed");
+  return 0;
+}
@@ -4,7 +4,9 @@
 #include <stdio.h>
 #include <string.h>
 
+#include "isotp_codec.h"
 #include "request_ecu.h"
+#include "ssm_param.h"
 
 static void assert_float_near(float actual, float expected) { assert(fabsf(actual - expected) < 0.0001f); }
 
@@ -17,15 +19,15 @@ static void test_builds_golden_poll_payload(void) {
   };
   uint8_t payload[sizeof(expected)] = {0};
 
-  const size_t length = request_ecu_build_poll_payload(payload, sizeof(payload));
+  const size_t length = request_ecu_build_poll_payload(REQUEST_ECU_ALL_FIELDS, payload, sizeof(payload));
   assert(length == sizeof(expected));
   assert(memcmp(payload, expected, sizeof(expected)) == 0);
 }
 
 static void test_rejects_invalid_poll_payload_output(void) {
   uint8_t payload[50] = {0};
-  assert(request_ecu_build_poll_payload(NULL, sizeof(payload)) == 0);
-  assert(request_ecu_build_poll_payload(payload, sizeof(payload) - 1) == 0);
+  assert(request_ecu_build_poll_payload(REQUEST_ECU_ALL_FIELDS, NULL, sizeof(payload)) == 0);
+  assert(request_ecu_build_poll_payload(REQUEST_ECU_ALL_FIELDS, payload, sizeof(payload) - 1) == 0);
 }
 
 static void test_parses_known_ssm_response(void) {
@@ -45,7 +47,7 @@ static void test_parses_known_ssm_response(void) {
   };
   request_ecu_response_t response = {0};
 
-  assert(request_ecu_parse_ssm_response(payload, sizeof(payload), &response));
+  assert(request_ecu_parse_ssm_response(REQUEST_ECU_ALL_FIELDS, payload, sizeof(payload), &response));
   assert_float_near(response.water_temp, 122.0f);
   assert_float_near(response.af_correct, -50.0f);
   assert_float_near(response.af_learned, 50.0f);
@@ -64,7 +66,7 @@ static void test_zero_rpm_produces_zero_injector_duty(void) {
   payload[7] = 255;
   request_ecu_response_t response = {0};
 
-  assert(request_ecu_parse_ssm_response(payload, sizeof(payload), &response));
+  assert(request_ecu_parse_ssm_response(REQUEST_ECU_ALL_FIELDS, payload, sizeof(payload), &response));
   assert_float_near(response.engine_rpm, 0.0f);
   assert_float_near(response.inj_duty, 0.0f);
 }
@@ -73,11 +75,131 @@ static void test_rejects_invalid_ssm_responses(void) {
   uint8_t payload[17] = {0xE8};
   request_ecu_response_t response = {0};
 
-  assert(!request_ecu_parse_ssm_response(NULL, sizeof(payload), &response));
-  assert(!request_ecu_parse_ssm_response(payload, sizeof(payload), NULL));
-  assert(!request_ecu_parse_ssm_response(payload, sizeof(payload) - 1, &response));
+  assert(!request_ecu_parse_ssm_response(REQUEST_ECU_ALL_FIELDS, NULL, sizeof(payload), &response));
+  assert(!request_ecu_parse_ssm_response(REQUEST_ECU_ALL_FIELDS, payload, sizeof(payload), NULL));
+  assert(!request_ecu_parse_ssm_response(REQUEST_ECU_ALL_FIELDS, payload, sizeof(payload) - 1, &response));
   payload[0] = 0x7F;
-  assert(!request_ecu_parse_ssm_response(payload, sizeof(payload), &response));
+  assert(!request_ecu_parse_ssm_response(REQUEST_ECU_ALL_FIELDS, payload, sizeof(payload), &response));
+}
+
+static void test_polls_only_selected_fields(void) {
+  // Injector duty pulls in RPM; oil pressure is not an SSM channel.
+  const uint32_t fields = REQUEST_ECU_FIELD_BIT(dam) | REQUEST_ECU_FIELD_BIT(inj_duty) |
+                          (1UL << TELEMETRY_CHANNEL_oil_pressure);
+  assert(request_ecu_normalize_fields(fields) ==
+         (REQUEST_ECU_FIELD_BIT(dam) | REQUEST_ECU_FIELD_BIT(inj_duty) | REQUEST_ECU_FIELD_BIT(engine_rpm)));
+
+  static const uint8_t expected[] = {
+      0xA8, 0x00, 0x00, 0x00, 0x0E, 0x00, 0x00, 0x0F, 0x00, 0x00, 0x20, 0xFF, 0x6B, 0x49,
+  };
+  uint8_t payload[64] = {0};
+  assert(request_ecu_build_poll_payload(fields, payload, sizeof(payload)) == sizeof(expected));
+  assert(memcmp(payload, expected, sizeof(expected)) == 0);
+
+  static const uint8_t response_payload[] = {0xE8, 0x2E, 0xE0, 20, 16};
+  request_ecu_response_t response = {.water_temp = 99.0f};
+  assert(request_ecu_parse_ssm_response(fields, response_payload, sizeof(response_payload), &response));
+  assert_float_near(response.engine_rpm, 3000.0f);
+  assert_float_near(response.inj_duty, 12.8f);
+  assert_float_near(response.dam, 1.0f);
+  assert_float_near(response.water_temp, 99.0f);
+  assert(!request_ecu_parse_ssm_response(fields, response_payload, sizeof(response_payload) - 1, &response));
+
+  // Nothing selected: nothing to poll.
+  assert(request_ecu_build_poll_payload(1UL << TELEMETRY_CHANNEL_oil_pressure, payload, sizeof(payload)) == 0);
+  assert(!request_ecu_parse_ssm_response(0, response_payload, sizeof(response_payload), &response));
+}
+
+static void test_request_template_rebuilds_only_on_change(void) {
+  request_ecu_template_t request = {0};
+  assert(request_ecu_template_update(&request, REQUEST_ECU_ALL_FIELDS));
+  assert(request.builds == 1 && request.field_mask == REQUEST_ECU_ALL_FIELDS);
+
+  // The frames are the wrapped golden payload.
+  uint8_t payload[64];
+  const size_t length = request_ecu_build_poll_payload(REQUEST_ECU_ALL_FIELDS, payload, sizeof(payload));
+  uint8_t frames[REQUEST_ECU_MAX_FRAMES][8] = {{0}};
+  size_t frame_count = 0;
+  assert(isotp_wrap_payload(payload, (uint16_t)length, frames, REQUEST_ECU_MAX_FRAMES, &frame_count));
+  assert(request.frame_count == frame_count && frame_count == 8);
+  assert(memcmp(request.frames, frames, frame_count * 8) == 0);
+
+  assert(request_ecu_template_update(&request, REQUEST_ECU_ALL_FIELDS));
+  assert(request.builds == 1);
+
+  // inj_duty implies engine_rpm, so both masks are the same request.
+  const uint32_t duty = REQUEST_ECU_FIELD_BIT(inj_duty);
+  assert(request_ecu_template_update(&request, duty));
+  assert(request.builds == 2 && request.frame_count == 2);
+  assert(request_ecu_template_update(&request, duty | REQUEST_ECU_FIELD_BIT(engine_rpm)));
+  assert(request.builds == 2);
+
+  // Nothing selected clears the template, and the next valid mask rebuilds.
+  assert(!request_ecu_template_update(&request, 1UL << TELEMETRY_CHANNEL_oil_pressure));
+  assert(request.field_mask == 0 && request.frame_count == 0);
+  assert(request_ecu_template_update(&request, duty));
+  assert(request.builds == 3);
+  assert(!request_ecu_template_update(NULL, duty));
+}
+
+static void test_reads_any_table_parameter(void) {
+  static const ssm_param_id_t params[] = {SSM_PARAM_IGNITION_TOTAL_TIMING, SSM_PARAM_MASS_AIRFLOW, SSM_PARAM_BOOST};
+  static const uint8_t expected[] = {
+      0xA8, 0x00, 0x00, 0x00, 0x11, 0x00, 0x00, 0x13, 0x00, 0x00, 0x14,
+      0xFF, 0x63, 0xD4, 0xFF, 0x63, 0xD5, 0xFF, 0x63, 0xD6, 0xFF, 0x63, 0xD7,
+  };
+  uint8_t payload[32] = {0};
+  assert(request_ecu_build_read_payload(params, 3, payload, sizeof(payload)) == sizeof(expected));
+  assert(memcmp(payload, expected, sizeof(expected)) == 0);
+  assert(request_ecu_build_read_payload(params, 3, payload, sizeof(expected) - 1) == 0);
+
+  static const uint8_t response_payload[] = {
+      0xE8,
+      148,                     // timing: 10 deg
+      0x03, 0xE8,              // MAF: 10 g/s
+      0x44, 0x7A, 0x00, 0x00,  // boost: 1000 mmHg
+  };
+  float values[3] = {0};
+  assert(request_ecu_parse_read_response(params, 3, response_payload, sizeof(response_payload), values));
+  assert_float_near(values[0], 10.0f);
+  assert_float_near(values[1], 10.0f);
+  assert(fabsf(values[2] - 19.33677f) < 0.001f);
+  assert(!request_ecu_parse_read_response(params, 3, response_payload, sizeof(response_payload) - 1, values));
+
+  const ssm_param_id_t unknown[] = {SSM_PARAM_COUNT};
+  assert(request_ecu_build_read_payload(unknown, 1, payload, sizeof(payload)) == 0);
+  assert(!request_ecu_parse_read_response(unknown, 1, response_payload, sizeof(response_payload), values));
+  assert(request_ecu_build_read_payload(params, 0, payload, sizeof(payload)) == 0);
+}
+
+static void test_generated_table_is_consistent(void) {
+  for (size_t i = 0; i < SSM_PARAM_COUNT; ++i) {
+    const ssm_param_t* param = &k_ssm_params[i];
+    assert(param->name != NULL && param->unit != NULL);
+    assert(param->length >= 1 && param->length <= SSM_PARAM_MAX_LENGTH);
+    assert(param->address + param->length - 1U <= 0xFFFFFFU);
+    assert(param->type != SSM_PARAM_TYPE_FLOAT || param->length == 4);
+    assert(param->lut == NULL || param->length == 1);
+  }
+}
+
+static void test_decodes_byte_orders_signs_and_lookup_tables(void) {
+  const uint8_t data[] = {0xFE, 0xFF};
+  ssm_param_t param = {.length = 2, .type = SSM_PARAM_TYPE_UINT, .scale = 1.0f};
+  assert_float_near(ssm_param_decode(&param, data), 65279.0f);
+  param.little_endian = true;
+  assert_float_near(ssm_param_decode(&param, data), 65534.0f);
+  param.type = SSM_PARAM_TYPE_INT;
+  assert_float_near(ssm_param_decode(&param, data), -2.0f);
+  param.little_endian = false;
+  param.scale = 0.5f;
+  param.offset = 10.0f;
+  assert_float_near(ssm_param_decode(&param, data), -257.0f * 0.5f + 10.0f);
+
+  static float lut[256];
+  lut[0xFE] = 42.0f;
+  const ssm_param_t looked_up = {.length = 1, .lut = lut};
+  assert_float_near(ssm_param_decode(&looked_up, data), 42.0f);
 }
 
 int main(void) {
@@ -86,6 +208,11 @@ int main(void) {
   test_parses_known_ssm_response();
   test_zero_rpm_produces_zero_injector_duty();
   test_rejects_invalid_ssm_responses();
+  test_polls_only_selected_fields();
+  test_request_template_rebuilds_only_on_change();
+  test_reads_any_table_parameter();
+  test_generated_table_is_consistent();
+  test_decodes_byte_orders_signs_and_lookup_tables();
   puts("Subaru SSM payload tests passed");
   return 0;
 }
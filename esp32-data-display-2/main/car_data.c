@@ -1,7 +1,6 @@
 #include "car_data.h"
 
 #include <stdbool.h>
-#include <string.h>
 
 #include "esp_timer.h"
 #include "math.h"
@@ -72,95 +71,429 @@ bool get_data(vehicle_state_t* packet) {
 }
 
 void dd_car_data_uart_resync(void) {}
+
+void dd_car_data_set_uart_events(QueueHandle_t events) { (void)events; }
+
+bool dd_car_data_link_stats(link_stats_t* stats) {
+  (void)stats;
+  return false;
+}
+
+bool dd_car_data_clock_sync(clock_sync_t* sync) {
+  (void)sync;
+  return false;
+}
+
+bool dd_car_data_latency_stats(latency_stats_t* stats) {
+  (void)stats;
+  return false;
+}
+
+void dd_car_data_record_render(uint32_t hub_timestamp_ms) { (void)hub_timestamp_ms; }
+
+const telemetry_sample_batch_t* dd_car_data_last_batch(void) { return NULL; }
+
+bool dd_car_data_set_hub_setting(telemetry_control_type_t type, uint32_t value) {
+  (void)type;
+  (void)value;
+  return false;
+}
+
+bool dd_car_data_hub_setting(telemetry_control_type_t type, uint32_t* value) {
+  (void)type;
+  (void)value;
+  return false;
+}
 #else
 #include "driver/uart.h"
 #include "esp_log.h"
 #include "freertos/FreeRTOS.h"
+#include "telemetry_link.h"
 #include "telemetry_protocol.h"
 
 static const char* TAG = "car_data";
 static const TickType_t UART_PARTIAL_FRAME_TIMEOUT_TICKS = pdMS_TO_TICKS(100);
 
+// Bytes read from the UART but not yet fed to the decoder. get_data() returns as
+// soon as one frame decodes, so the rest of a read is kept for the next call.
 static uint8_t s_uart_rx_buf[CONFIG_DD_UART_BUFFER_SIZE];
 static size_t s_uart_rx_len = 0;
+static size_t s_uart_rx_pos = 0;
 static TickType_t s_uart_last_rx_tick = 0;
+static telemetry_stream_decoder_t s_stream;
+static bool s_stream_initialized = false;
+static uint32_t s_plans_logged = 0;
+static QueueHandle_t s_uart_events = NULL;
 
-static void drop_consumed_bytes(size_t consumed) {
-  if (consumed >= s_uart_rx_len) {
-    s_uart_rx_len = 0;
+// Updated by the UART task and copied out by dd_car_data_link_stats().
+static link_stats_t s_link_stats;
+static portMUX_TYPE s_link_stats_lock = portMUX_INITIALIZER_UNLOCKED;
+#if CONFIG_DD_UART_LINK_STATS_LOG_PERIOD_MS > 0
+static uint32_t s_link_stats_next_log_ms = CONFIG_DD_UART_LINK_STATS_LOG_PERIOD_MS;
+#endif
+
+// Hub clock estimate and sample ages. The UART task feeds both; the render task
+// reads the clock and records the rendered stage, so both sit under one lock.
+static clock_sync_t s_clock_sync;
+static latency_stats_t s_latency;
+static portMUX_TYPE s_latency_lock = portMUX_INITIALIZER_UNLOCKED;
+#if CONFIG_DD_UART_TIME_SYNC_PERIOD_MS > 0
+static uint32_t s_time_sync_next_ms = 0;
+#endif
+#if CONFIG_DD_LATENCY_LOG_PERIOD_MS > 0
+static uint32_t s_latency_next_log_ms = CONFIG_DD_LATENCY_LOG_PERIOD_MS;
+#endif
+
+// Runtime hub settings, indexed from TELEMETRY_CONTROL_SET_EMIT_PERIOD. Written
+// by the UI task and read by the UART task, so guarded by s_hub_settings_lock.
+#define HUB_SETTING_COUNT (TELEMETRY_CONTROL_SET_ECU_FIELDS - TELEMETRY_CONTROL_SET_EMIT_PERIOD + 1)
+#define HUB_SETTING_RETRY_MS 200U
+
+typedef struct {
+  bool pending;  // requested but not yet echoed by the hub
+  uint32_t requested;
+  bool confirmed;
+  uint32_t confirmed_value;
+} hub_setting_t;
+
+static hub_setting_t s_hub_settings[HUB_SETTING_COUNT];
+static portMUX_TYPE s_hub_settings_lock = portMUX_INITIALIZER_UNLOCKED;
+static uint32_t s_hub_settings_next_send_ms = 0;
+
+static void send_control(const telemetry_control_t* control) {
+  uint8_t wire_frame[TELEMETRY_WIRE_FRAME_MAX_SIZE];
+  size_t frame_length = 0;
+  if (telemetry_control_encode_wire(control, wire_frame, sizeof(wire_frame), &frame_length) == TELEMETRY_RESULT_OK) {
+    uart_write_bytes(UART_NUM_1, wire_frame, frame_length);
+  }
+}
+
+static bool hub_setting_index(uint32_t type, size_t* index) {
+  if (type < TELEMETRY_CONTROL_SET_EMIT_PERIOD || type > TELEMETRY_CONTROL_SET_ECU_FIELDS) {
+    return false;
+  }
+  *index = type - TELEMETRY_CONTROL_SET_EMIT_PERIOD;
+  return true;
+}
+
+bool dd_car_data_set_hub_setting(telemetry_control_type_t type, uint32_t value) {
+  size_t index;
+  if (!hub_setting_index(type, &index)) {
+    return false;
+  }
+  taskENTER_CRITICAL(&s_hub_settings_lock);
+  s_hub_settings[index].pending = true;
+  s_hub_settings[index].requested = value;
+  s_hub_settings_next_send_ms = (uint32_t)(esp_timer_get_time() / 1000);
+  taskEXIT_CRITICAL(&s_hub_settings_lock);
+  return true;
+}
+
+bool dd_car_data_hub_setting(telemetry_control_type_t type, uint32_t* value) {
+  size_t index;
+  if (value == NULL || !hub_setting_index(type, &index)) {
+    return false;
+  }
+  taskENTER_CRITICAL(&s_hub_settings_lock);
+  const bool confirmed = s_hub_settings[index].confirmed;
+  *value = s_hub_settings[index].confirmed_value;
+  taskEXIT_CRITICAL(&s_hub_settings_lock);
+  return confirmed;
+}
+
+static void on_hub_setting_echo(const telemetry_control_t* control) {
+  size_t index;
+  if (!hub_setting_index(control->type, &index)) {
     return;
   }
+  taskENTER_CRITICAL(&s_hub_settings_lock);
+  s_hub_settings[index].pending = false;
+  s_hub_settings[index].confirmed = true;
+  s_hub_settings[index].confirmed_value = control->value;
+  taskEXIT_CRITICAL(&s_hub_settings_lock);
+  ESP_LOGI(TAG, "hub setting %u = %u", (unsigned)control->type, (unsigned)control->value);
+}
+
+// Sends every unconfirmed setting, at most every HUB_SETTING_RETRY_MS.
+static void send_pending_hub_settings(uint32_t now_ms) {
+  telemetry_control_t requests[HUB_SETTING_COUNT];
+  size_t request_count = 0;
+  taskENTER_CRITICAL(&s_hub_settings_lock);
+  if ((int32_t)(now_ms - s_hub_settings_next_send_ms) >= 0) {
+    for (size_t i = 0; i < HUB_SETTING_COUNT; ++i) {
+      if (s_hub_settings[i].pending) {
+        requests[request_count].type = TELEMETRY_CONTROL_SET_EMIT_PERIOD + i;
+        requests[request_count].value = s_hub_settings[i].requested;
+        request_count++;
+      }
+    }
+    s_hub_settings_next_send_ms = now_ms + HUB_SETTING_RETRY_MS;
+  }
+  taskEXIT_CRITICAL(&s_hub_settings_lock);
 
-  memmove(s_uart_rx_buf, s_uart_rx_buf + consumed, s_uart_rx_len - consumed);
-  s_uart_rx_len -= consumed;
+  for (size_t i = 0; i < request_count; ++i) {
+    send_control(&requests[i]);
+  }
 }
 
-static int find_frame_delimiter(void) {
-  for (size_t i = 0; i < s_uart_rx_len; i++) {
-    if (s_uart_rx_buf[i] == 0x00) {
-      return (int)i;
+#ifdef CONFIG_DD_UART_NEGOTIATE_BAUD
+static telemetry_link_t s_link;
+
+static void run_link_actions(uint32_t now_ms) {
+  telemetry_link_action_t action;
+  while (telemetry_link_poll(&s_link, now_ms, &action)) {
+    if (action.send) {
+      send_control(&action.control);
+    }
+    if (action.baud != 0) {
+      // The acknowledgement has to leave at the old rate.
+      uart_wait_tx_done(UART_NUM_1, pdMS_TO_TICKS(50));
+      uart_set_baudrate(UART_NUM_1, action.baud);
+      ESP_LOGI(TAG, "UART link now at %u baud", (unsigned)action.baud);
     }
   }
-  return -1;
 }
+#endif
+
+#if CONFIG_DD_UART_TIME_SYNC_PERIOD_MS > 0
+static void send_time_sync_ping(uint32_t now_ms) {
+  if ((int32_t)(now_ms - s_time_sync_next_ms) < 0) {
+    return;
+  }
+  s_time_sync_next_ms = now_ms + CONFIG_DD_UART_TIME_SYNC_PERIOD_MS;
+  taskENTER_CRITICAL(&s_latency_lock);
+  const telemetry_control_t ping = clock_sync_make_ping(&s_clock_sync, (uint32_t)esp_timer_get_time());
+  taskEXIT_CRITICAL(&s_latency_lock);
+  send_control(&ping);
+}
+#endif
+
+// Records the age of a decoded frame, or of every sample in a batch.
+static void record_decode_latency(const vehicle_state_t* packet, const telemetry_sample_batch_t* batch,
+                                  uint32_t now_us) {
+  taskENTER_CRITICAL(&s_latency_lock);
+  int32_t age_us;
+  if (batch != NULL) {
+    for (uint8_t i = 0; i < batch->sample_count; ++i) {
+      if (clock_sync_age_us(&s_clock_sync, batch->timestamp_ms[i], now_us, &age_us)) {
+        latency_stats_record(&s_latency, LATENCY_STAGE_BATCH_SAMPLE, age_us);
+      }
+    }
+  } else if (clock_sync_age_us(&s_clock_sync, packet->timestamp_ms, now_us, &age_us)) {
+    latency_stats_record(&s_latency, LATENCY_STAGE_DECODED, age_us);
+  }
+  taskEXIT_CRITICAL(&s_latency_lock);
+}
+
+static void record_resync(void) {
+  taskENTER_CRITICAL(&s_link_stats_lock);
+  link_stats_on_resync(&s_link_stats);
+  taskEXIT_CRITICAL(&s_link_stats_lock);
+}
+
+// Counts overflows reported since the last call. The stream decoder resyncs on
+// its own at the next delimiter, so nothing is flushed here.
+static void drain_uart_events(void) {
+  if (s_uart_events == NULL) {
+    return;
+  }
+  uart_event_t event;
+  while (xQueueReceive(s_uart_events, &event, 0) == pdTRUE) {
+    if (event.type == UART_FIFO_OVF || event.type == UART_BUFFER_FULL) {
+      taskENTER_CRITICAL(&s_link_stats_lock);
+      link_stats_on_overflow(&s_link_stats);
+      taskEXIT_CRITICAL(&s_link_stats_lock);
+    }
+  }
+}
+
+#if CONFIG_DD_UART_LINK_STATS_LOG_PERIOD_MS > 0
+static void log_link_stats(uint32_t now_ms) {
+  if ((int32_t)(now_ms - s_link_stats_next_log_ms) < 0) {
+    return;
+  }
+  s_link_stats_next_log_ms = now_ms + CONFIG_DD_UART_LINK_STATS_LOG_PERIOD_MS;
+  link_stats_t stats;
+  dd_car_data_link_stats(&stats);
+  char line[320];
+  link_stats_format(&stats, line, sizeof(line));
+  ESP_LOGI(TAG, "link: %s", line);
+}
+#endif
+
+#if CONFIG_DD_LATENCY_LOG_PERIOD_MS > 0
+static void log_latency_stats(uint32_t now_ms) {
+  if ((int32_t)(now_ms - s_latency_next_log_ms) < 0) {
+    return;
+  }
+  s_latency_next_log_ms = now_ms + CONFIG_DD_LATENCY_LOG_PERIOD_MS;
+  clock_sync_t sync;
+  latency_stats_t latency;
+  dd_car_data_clock_sync(&sync);
+  dd_car_data_latency_stats(&latency);
+  ESP_LOGI(TAG, "clock: synced=%d offset=%uus rtt=%uus min_rtt=%uus drift=%.1fppm pongs=%u/%u", sync.synced,
+           (unsigned)sync.offset_us, (unsigned)sync.rtt_us, (unsigned)(sync.pongs > 0 ? sync.min_rtt_us : 0),
+           sync.drift_ppm, (unsigned)sync.pongs, (unsigned)sync.pings);
+  char report[384];
+  latency_stats_format(&latency, report, sizeof(report));
+  ESP_LOGI(TAG, "latency:\n%s", report);
+}
+#endif
 
 void dd_car_data_uart_resync(void) {
   uart_flush_input(UART_NUM_1);
   s_uart_rx_len = 0;
+  s_uart_rx_pos = 0;
+  telemetry_stream_decoder_reset(&s_stream);
   s_uart_last_rx_tick = xTaskGetTickCount();
+  record_resync();
+}
+
+void dd_car_data_set_uart_events(QueueHandle_t events) { s_uart_events = events; }
+
+bool dd_car_data_link_stats(link_stats_t* stats) {
+  if (stats == NULL) {
+    return false;
+  }
+  taskENTER_CRITICAL(&s_link_stats_lock);
+  *stats = s_link_stats;
+  taskEXIT_CRITICAL(&s_link_stats_lock);
+  return true;
+}
+
+bool dd_car_data_clock_sync(clock_sync_t* sync) {
+  if (sync == NULL) {
+    return false;
+  }
+  taskENTER_CRITICAL(&s_latency_lock);
+  *sync = s_clock_sync;
+  taskEXIT_CRITICAL(&s_latency_lock);
+  return true;
+}
+
+bool dd_car_data_latency_stats(latency_stats_t* stats) {
+  if (stats == NULL) {
+    return false;
+  }
+  taskENTER_CRITICAL(&s_latency_lock);
+  *stats = s_latency;
+  taskEXIT_CRITICAL(&s_latency_lock);
+  return true;
+}
+
+void dd_car_data_record_render(uint32_t hub_timestamp_ms) {
+  const uint32_t now_us = (uint32_t)esp_timer_get_time();
+  int32_t age_us;
+  taskENTER_CRITICAL(&s_latency_lock);
+  if (clock_sync_age_us(&s_clock_sync, hub_timestamp_ms, now_us, &age_us)) {
+    latency_stats_record(&s_latency, LATENCY_STAGE_RENDERED, age_us);
+  }
+  taskEXIT_CRITICAL(&s_latency_lock);
+}
+
+const telemetry_sample_batch_t* dd_car_data_last_batch(void) {
+  return telemetry_decoder_last_batch(&s_stream.decoder);
 }
 
 bool get_data(vehicle_state_t* packet) {
   if (!packet) {
     return false;
   }
+  if (!s_stream_initialized) {
+    telemetry_stream_decoder_init(&s_stream);
+    link_stats_init(&s_link_stats);
+    clock_sync_init(&s_clock_sync);
+    latency_stats_init(&s_latency);
+#ifdef CONFIG_DD_UART_NEGOTIATE_BAUD
+    const telemetry_link_config_t link_config = telemetry_link_default_config(CONFIG_DD_UART_MAX_BAUD);
+    telemetry_link_init(&s_link, TELEMETRY_LINK_ROLE_DISPLAY, &link_config, (uint32_t)(esp_timer_get_time() / 1000));
+#endif
+    s_stream_initialized = true;
+  }
 
-  int bytes_read = 0;
-  if (s_uart_rx_len < sizeof(s_uart_rx_buf)) {
-    bytes_read = uart_read_bytes(UART_NUM_1, s_uart_rx_buf + s_uart_rx_len, sizeof(s_uart_rx_buf) - s_uart_rx_len,
-                                 pdMS_TO_TICKS(10));
+  drain_uart_events();
+  if (s_uart_rx_pos >= s_uart_rx_len) {
+    s_uart_rx_len = 0;
+    s_uart_rx_pos = 0;
+    int bytes_read = uart_read_bytes(UART_NUM_1, s_uart_rx_buf, sizeof(s_uart_rx_buf), pdMS_TO_TICKS(10));
     if (bytes_read > 0) {
-      s_uart_rx_len += (size_t)bytes_read;
+      s_uart_rx_len = (size_t)bytes_read;
       s_uart_last_rx_tick = xTaskGetTickCount();
     }
   }
 
-  while (1) {
-    int delimiter_idx = find_frame_delimiter();
-    if (delimiter_idx < 0) {
-      break;
-    }
+  while (s_uart_rx_pos < s_uart_rx_len) {
+    size_t consumed = 0;
+    const telemetry_result_t result = telemetry_stream_decoder_feed(
+        &s_stream, s_uart_rx_buf + s_uart_rx_pos, s_uart_rx_len - s_uart_rx_pos, &consumed, packet);
+    s_uart_rx_pos += consumed;
 
-    const size_t frame_len = (size_t)delimiter_idx;
-    if (frame_len == 0) {
-      drop_consumed_bytes(1);
-      continue;
+    const uint32_t now_us = (uint32_t)esp_timer_get_time();
+    if (result != TELEMETRY_RESULT_INCOMPLETE) {
+      const bool batch = telemetry_decoder_last_batch(&s_stream.decoder) != NULL;
+      taskENTER_CRITICAL(&s_link_stats_lock);
+      link_stats_on_frame(&s_link_stats, result, packet, batch, now_us);
+      s_link_stats.fec_repaired = s_stream.decoder.fec_corrected_frames;
+      taskEXIT_CRITICAL(&s_link_stats_lock);
     }
-
-    const telemetry_result_t result = telemetry_frame_decode(s_uart_rx_buf, frame_len, packet);
-    const bool decoded = result == TELEMETRY_RESULT_OK;
-    if (!decoded) {
-      ESP_LOGW(TAG, "telemetry frame rejected: %s (len=%u)", telemetry_result_name(result),
-               (unsigned)frame_len);
+    if (result == TELEMETRY_RESULT_OK) {
+      record_decode_latency(packet, telemetry_decoder_last_batch(&s_stream.decoder), now_us);
     }
-
-    drop_consumed_bytes(frame_len + 1);
-    if (decoded) {
+    if (result == TELEMETRY_RESULT_CONTROL) {
+      const telemetry_control_t* control = telemetry_decoder_last_control(&s_stream.decoder);
+      if (control->type == TELEMETRY_CONTROL_TIME_PONG) {
+        taskENTER_CRITICAL(&s_latency_lock);
+        clock_sync_on_pong(&s_clock_sync, control, now_us);
+        taskEXIT_CRITICAL(&s_latency_lock);
+      } else {
+        on_hub_setting_echo(control);
+      }
+    }
+#ifdef CONFIG_DD_UART_NEGOTIATE_BAUD
+    const uint32_t now_ms = (uint32_t)(esp_timer_get_time() / 1000);
+    if (result == TELEMETRY_RESULT_CONTROL) {
+      telemetry_link_on_control(&s_link, telemetry_decoder_last_control(&s_stream.decoder), now_ms);
+    } else {
+      telemetry_link_on_frame(&s_link, result, now_ms);
+    }
+    run_link_actions(now_ms);
+#endif
+    if (result == TELEMETRY_RESULT_DESCRIPTOR && s_stream.decoder.schema.plans_built != s_plans_logged) {
+      const telemetry_schema_cache_t* schema = &s_stream.decoder.schema;
+      s_plans_logged = schema->plans_built;
+      ESP_LOGI(TAG, "hub telemetry layout 0x%08lx: %u channels, %u unknown here",
+               (unsigned long)schema->plan.layout_id, (unsigned)schema->plan.field_count,
+               (unsigned)schema->unknown_channels);
+    }
+    if (result == TELEMETRY_RESULT_OK) {
       return true;
     }
+    if (result != TELEMETRY_RESULT_INCOMPLETE && result != TELEMETRY_RESULT_CONTROL &&
+        result != TELEMETRY_RESULT_DESCRIPTOR) {
+      ESP_LOGW(TAG, "telemetry frame rejected: %s", telemetry_result_name(result));
+    }
   }
 
-  if (s_uart_rx_len >= sizeof(s_uart_rx_buf)) {
-    ESP_LOGW(TAG, "UART RX buffer filled without frame delimiter, forcing resync");
-    dd_car_data_uart_resync();
-    return false;
-  }
-
-  if (s_uart_rx_len > 0 && s_uart_last_rx_tick != 0 &&
+  if (telemetry_stream_decoder_in_frame(&s_stream) && s_uart_last_rx_tick != 0 &&
       (xTaskGetTickCount() - s_uart_last_rx_tick) >= UART_PARTIAL_FRAME_TIMEOUT_TICKS) {
-    ESP_LOGW(TAG, "discarding stalled partial UART frame (%u bytes)", (unsigned)s_uart_rx_len);
-    s_uart_rx_len = 0;
+    ESP_LOGW(TAG, "discarding stalled partial UART frame");
+    telemetry_stream_decoder_reset(&s_stream);
+    record_resync();
   }
+  const uint32_t now_ms = (uint32_t)(esp_timer_get_time() / 1000);
+  send_pending_hub_settings(now_ms);
+#if CONFIG_DD_UART_TIME_SYNC_PERIOD_MS > 0
+  send_time_sync_ping(now_ms);
+#endif
+#if CONFIG_DD_UART_LINK_STATS_LOG_PERIOD_MS > 0
+  log_link_stats(now_ms);
+#endif
+#if CONFIG_DD_LATENCY_LOG_PERIOD_MS > 0
+  log_latency_stats(now_ms);
+#endif
+#ifdef CONFIG_DD_UART_NEGOTIATE_BAUD
+  run_link_actions(now_ms);
+#endif
 
   return false;
 }
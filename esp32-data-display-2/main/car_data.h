@@ -1,6 +1,45 @@
 #include <stdbool.h>
 
+#include "freertos/FreeRTOS.h"
+#include "clock_sync.h"
+#include "freertos/queue.h"
+#include "latency_stats.h"
+#include "link_stats.h"
+#include "telemetry_protocol.h"
 #include "telemetry_types.h"
 
 bool get_data(vehicle_state_t* packet);
+
+// Samples carried by the frame get_data() last returned, or NULL if it was not
+// a batch frame.
+const telemetry_sample_batch_t* dd_car_data_last_batch(void);
 void dd_car_data_uart_resync(void);
+
+// Event queue from uart_driver_install(). get_data() drains it to count
+// receive overflows in the link stats.
+void dd_car_data_set_uart_events(QueueHandle_t events);
+
+// Copies the UART link statistics. Returns false when fake data is enabled.
+bool dd_car_data_link_stats(link_stats_t* stats);
+
+// Copies the hub clock estimate kept from TIME_PING/TIME_PONG exchanges.
+// Returns false when fake data is enabled.
+bool dd_car_data_clock_sync(clock_sync_t* sync);
+
+// Copies the per-stage sample ages. Nothing is recorded until the first clock
+// sync exchange. Returns false when fake data is enabled.
+bool dd_car_data_latency_stats(latency_stats_t* stats);
+
+// Records the age of the state with hub time `hub_timestamp_ms` as it is
+// rendered. Call once per new state.
+void dd_car_data_record_render(uint32_t hub_timestamp_ms);
+
+// Asks the hub to change a runtime setting, `type` being one of the
+// TELEMETRY_CONTROL_SET_* values. The request is repeated until the hub echoes
+// it, and lasts until the hub restarts. Returns false for other types or when
+// fake data is enabled.
+bool dd_car_data_set_hub_setting(telemetry_control_type_t type, uint32_t value);
+
+// Value the hub last confirmed for a TELEMETRY_CONTROL_SET_* type, after its
+// clamping. Returns false until the hub has confirmed one.
+bool dd_car_data_hub_setting(telemetry_control_type_t type, uint32_t* value);
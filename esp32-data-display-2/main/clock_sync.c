@@ -0,0 +1,118 @@
+#include "clock_sync.h"
+
+#include <string.h>
+
+void clock_sync_init(clock_sync_t* sync) {
+  if (sync != NULL) {
+    memset(sync, 0, sizeof(*sync));
+    sync->min_rtt_us = UINT32_MAX;
+  }
+}
+
+telemetry_control_t clock_sync_make_ping(clock_sync_t* sync, uint32_t now_us) {
+  const telemetry_control_t ping = {.type = TELEMETRY_CONTROL_TIME_PING, .value = now_us};
+  if (sync != NULL) {
+    sync->pings++;
+    sync->ping_outstanding = true;
+    sync->ping_local_us = now_us;
+  }
+  return ping;
+}
+
+static const clock_sync_sample_t* trusted_sample(const clock_sync_t* sync) {
+  const clock_sync_sample_t* best = &sync->window[0];
+  for (size_t i = 1; i < sync->window_count; ++i) {
+    if (sync->window[i].rtt_us < best->rtt_us) {
+      best = &sync->window[i];
+    }
+  }
+  return best;
+}
+
+// Measures the drift from the anchor to `trusted` once they are far enough
+// apart. Slopes beyond any real crystal come from a bad pair and are skipped.
+static void update_drift(clock_sync_t* sync, const clock_sync_sample_t* trusted) {
+  if (!sync->has_anchor) {
+    sync->anchor = *trusted;
+    sync->has_anchor = true;
+    return;
+  }
+  const int32_t span_us = (int32_t)(trusted->local_us - sync->anchor.local_us);
+  if (span_us < (int32_t)CLOCK_SYNC_DRIFT_MIN_SPAN_US) {
+    return;
+  }
+  const int32_t offset_change_us = (int32_t)(trusted->offset_us - sync->anchor.offset_us);
+  const float slope_ppm = (float)offset_change_us * 1e6f / (float)span_us;
+  sync->anchor = *trusted;
+  if (slope_ppm > CLOCK_SYNC_MAX_DRIFT_PPM || slope_ppm < -CLOCK_SYNC_MAX_DRIFT_PPM) {
+    return;
+  }
+  sync->drift_ppm = sync->has_drift ? sync->drift_ppm + (slope_ppm - sync->drift_ppm) / 4.0f : slope_ppm;
+  sync->has_drift = true;
+}
+
+bool clock_sync_on_pong(clock_sync_t* sync, const telemetry_control_t* pong, uint32_t now_us) {
+  if (sync == NULL || pong == NULL || pong->type != TELEMETRY_CONTROL_TIME_PONG) {
+    return false;
+  }
+  if (!sync->ping_outstanding || pong->value != sync->ping_local_us) {
+    sync->stale++;
+    return false;
+  }
+  sync->ping_outstanding = false;
+
+  const uint32_t t1 = pong->value;
+  const uint32_t t2 = pong->hub_rx_us;
+  const uint32_t t3 = pong->hub_tx_us;
+  const uint32_t t4 = now_us;
+  const int64_t rtt_us = (int64_t)(int32_t)(t4 - t1) - (int32_t)(t3 - t2);
+  if (rtt_us < 0 || rtt_us > CLOCK_SYNC_MAX_RTT_US || (int32_t)(t3 - t2) < 0) {
+    sync->rejected++;
+    return false;
+  }
+  sync->pongs++;
+
+  // offset = ((t2 - t1) + (t3 - t4)) / 2 = (t2 - t1) - rtt / 2, modulo 2^32.
+  const clock_sync_sample_t sample = {
+      .local_us = t1 + (uint32_t)(t4 - t1) / 2U,
+      .offset_us = (t2 - t1) - (uint32_t)(rtt_us / 2),
+      .rtt_us = (uint32_t)rtt_us,
+  };
+  sync->window[sync->window_next] = sample;
+  sync->window_next = (sync->window_next + 1) % CLOCK_SYNC_WINDOW;
+  if (sync->window_count < CLOCK_SYNC_WINDOW) {
+    sync->window_count++;
+  }
+  if (sample.rtt_us < sync->min_rtt_us) {
+    sync->min_rtt_us = sample.rtt_us;
+  }
+
+  const clock_sync_sample_t* trusted = trusted_sample(sync);
+  update_drift(sync, trusted);
+  sync->offset_us = trusted->offset_us;
+  sync->ref_local_us = trusted->local_us;
+  sync->rtt_us = trusted->rtt_us;
+  sync->synced = true;
+  return true;
+}
+
+bool clock_sync_to_hub_us(const clock_sync_t* sync, uint32_t local_us, uint32_t* hub_us) {
+  if (sync == NULL || hub_us == NULL || !sync->synced) {
+    return false;
+  }
+  const int32_t since_ref_us = (int32_t)(local_us - sync->ref_local_us);
+  const int32_t drift_us = (int32_t)((float)since_ref_us * sync->drift_ppm * 1e-6f);
+  *hub_us = local_us + sync->offset_us + (uint32_t)drift_us;
+  return true;
+}
+
+bool clock_sync_age_us(const clock_sync_t* sync, uint32_t hub_timestamp_ms, uint32_t now_us, int32_t* age_us) {
+  uint32_t hub_now_us;
+  if (age_us == NULL || !clock_sync_to_hub_us(sync, now_us, &hub_now_us)) {
+    return false;
+  }
+  // The hub's timestamp_ms is esp_timer / 1000, so timestamp_ms * 1000 is its
+  // esp_timer rounded down to the millisecond, modulo 2^32 like hub_now_us.
+  *age_us = (int32_t)(hub_now_us - hub_timestamp_ms * 1000U);
+  return true;
+}
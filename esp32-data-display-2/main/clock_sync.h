@@ -0,0 +1,82 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "telemetry_protocol.h"
+
+// Maps the hub's esp_timer onto the display's, NTP style.
+//
+// The display sends TIME_PING carrying its send time t1. The hub answers with
+// TIME_PONG carrying t1 back, the time t2 it read the ping and the time t3 it
+// sent the pong; the display notes the time t4 the pong completed. Then
+//
+//   round trip = (t4 - t1) - (t3 - t2)
+//   offset     = ((t2 - t1) + (t3 - t4)) / 2   (hub clock minus display clock)
+//
+// The offset is exact when both legs take equally long. They rarely do here:
+// the hub only reads the UART once per emit period and the display reads in
+// chunks, so a ping can wait up to a period on one leg. The extra wait always
+// lengthens the round trip, so of the last CLOCK_SYNC_WINDOW exchanges the one
+// with the shortest round trip is trusted. Drift between the two crystals is
+// the slope of the trusted offset over time, smoothed across updates at least
+// CLOCK_SYNC_DRIFT_MIN_SPAN_US apart.
+//
+// All times are the low 32 bits of esp_timer_get_time() and may wrap; spans
+// must stay under 35 minutes.
+
+#define CLOCK_SYNC_WINDOW 8U
+#define CLOCK_SYNC_DRIFT_MIN_SPAN_US 10000000U
+#define CLOCK_SYNC_MAX_DRIFT_PPM 500.0f
+// Exchanges whose round trip is longer than this are dropped outright.
+#define CLOCK_SYNC_MAX_RTT_US 200000U
+
+typedef struct {
+  uint32_t local_us;   // display time halfway through the exchange
+  uint32_t offset_us;  // hub minus display, modulo 2^32
+  uint32_t rtt_us;
+} clock_sync_sample_t;
+
+typedef struct {
+  uint32_t pings;        // pings sent
+  uint32_t pongs;        // pongs matched to the outstanding ping
+  uint32_t stale;        // pongs that matched no outstanding ping
+  uint32_t rejected;     // pongs with an implausible round trip
+  bool synced;           // an offset is known
+  uint32_t offset_us;    // hub minus display at ref_local_us, modulo 2^32
+  uint32_t ref_local_us;
+  float drift_ppm;       // hub clock rate minus display clock rate, parts per million
+  uint32_t rtt_us;       // round trip of the trusted exchange
+  uint32_t min_rtt_us;   // shortest round trip seen
+
+  // Private to clock_sync.c.
+  bool ping_outstanding;
+  uint32_t ping_local_us;
+  clock_sync_sample_t window[CLOCK_SYNC_WINDOW];
+  size_t window_count;
+  size_t window_next;
+  bool has_anchor;
+  clock_sync_sample_t anchor;  // trusted sample the drift is measured from
+  bool has_drift;
+} clock_sync_t;
+
+void clock_sync_init(clock_sync_t* sync);
+
+// Records a ping sent at `now_us` and returns the TIME_PING to send. A ping
+// still unanswered is abandoned.
+telemetry_control_t clock_sync_make_ping(clock_sync_t* sync, uint32_t now_us);
+
+// Feeds a TIME_PONG that completed at `now_us`. Returns true when it matched
+// the outstanding ping and was accepted as a sample.
+bool clock_sync_on_pong(clock_sync_t* sync, const telemetry_control_t* pong, uint32_t now_us);
+
+// Converts a display time to the hub's clock. Returns false before the first
+// exchange.
+bool clock_sync_to_hub_us(const clock_sync_t* sync, uint32_t local_us, uint32_t* hub_us);
+
+// Microseconds between a hub timestamp in milliseconds (as in
+// vehicle_state_t.timestamp_ms) and the display time `now_us`, both taken on
+// the hub's clock. Hub timestamps are truncated to the millisecond, so ages
+// read up to 1 ms high. Returns false before the first exchange.
+bool clock_sync_age_us(const clock_sync_t* sync, uint32_t hub_timestamp_ms, uint32_t now_us, int32_t* age_us);
@@ -2,6 +2,7 @@
 
 #include "bsp/display.h"
 #include "bsp/esp-bsp.h"
+#include "car_data.h"
 #include "esp_check.h"
 #include "esp_log.h"
 #include "freertos/FreeRTOS.h"
@@ -14,6 +15,7 @@ static dd_state_iface_t s_state_iface = {0};
 static TaskHandle_t s_render_task = NULL;
 
 static void display_render_task(void* arg) {
+  uint32_t rendered_timestamp_ms = 0;
   for (;;) {
     monitored_state_t snapshot = {0};
     bool have_snapshot = false;
@@ -29,6 +31,11 @@ static void display_render_task(void* arg) {
     if (have_snapshot && bsp_display_lock(pdMS_TO_TICKS(100))) {
       dd_ui_controller_render(&snapshot);
       bsp_display_unlock();
+      // Only the first render of a state says how old its data was.
+      if (snapshot.timestamp_ms != rendered_timestamp_ms) {
+        dd_car_data_record_render(snapshot.timestamp_ms);
+        rendered_timestamp_ms = snapshot.timestamp_ms;
+      }
     }
 
     vTaskDelay(pdMS_TO_TICKS(33));
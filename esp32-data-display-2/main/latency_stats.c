@@ -0,0 +1,78 @@
+#include "latency_stats.h"
+
+#include <stdio.h>
+#include <string.h>
+
+static const uint32_t k_bounds_us[LATENCY_STATS_BUCKETS] = LATENCY_STATS_BOUNDS_US;
+static const char* const k_stage_names[LATENCY_STAGE_COUNT] = {"decoded", "batch_sample", "rendered"};
+
+void latency_stats_init(latency_stats_t* stats) {
+  if (stats == NULL) {
+    return;
+  }
+  memset(stats, 0, sizeof(*stats));
+  for (size_t i = 0; i < LATENCY_STAGE_COUNT; ++i) {
+    stats->stages[i].min_us = UINT32_MAX;
+  }
+}
+
+void latency_stats_record(latency_stats_t* stats, latency_stage_t stage, int32_t age_us) {
+  if (stats == NULL || stage >= LATENCY_STAGE_COUNT) {
+    return;
+  }
+  latency_stage_stats_t* s = &stats->stages[stage];
+  if (age_us < 0) {
+    s->negative++;
+    age_us = 0;
+  }
+  const uint32_t age = (uint32_t)age_us;
+
+  size_t bucket = 0;
+  while (age > k_bounds_us[bucket]) {
+    bucket++;
+  }
+  s->hist[bucket]++;
+  if (age < s->min_us) {
+    s->min_us = age;
+  }
+  if (age > s->max_us) {
+    s->max_us = age;
+  }
+  // Start the average at the first age instead of ramping up from 0.
+  if (s->count == 0) {
+    s->avg_q4 = age > (UINT32_MAX >> 4) ? UINT32_MAX : age << 4;
+  } else {
+    const int64_t avg_q4 = (int64_t)s->avg_q4 + age - (s->avg_q4 >> 4);
+    s->avg_q4 = avg_q4 > UINT32_MAX ? UINT32_MAX : (uint32_t)avg_q4;
+  }
+  s->avg_us = s->avg_q4 >> 4;
+  s->last_us = age;
+  s->count++;
+}
+
+const char* latency_stage_name(latency_stage_t stage) {
+  return stage < LATENCY_STAGE_COUNT ? k_stage_names[stage] : "unknown";
+}
+
+size_t latency_stats_format(const latency_stats_t* stats, char* buffer, size_t capacity) {
+  if (stats == NULL || buffer == NULL || capacity == 0) {
+    return 0;
+  }
+  size_t length = 0;
+  buffer[0] = '\0';
+  for (size_t i = 0; i < LATENCY_STAGE_COUNT && length < capacity - 1; ++i) {
+    const latency_stage_stats_t* s = &stats->stages[i];
+    const int written = snprintf(
+        buffer + length, capacity - length,
+        "%s%s: n=%u min=%uus avg=%uus max=%uus last=%uus neg=%u hist=%u/%u/%u/%u/%u/%u/%u/%u", i > 0 ? "\n" : "",
+        latency_stage_name((latency_stage_t)i), (unsigned)s->count, (unsigned)(s->count > 0 ? s->min_us : 0),
+        (unsigned)s->avg_us, (unsigned)s->max_us, (unsigned)s->last_us, (unsigned)s->negative, (unsigned)s->hist[0],
+        (unsigned)s->hist[1], (unsigned)s->hist[2], (unsigned)s->hist[3], (unsigned)s->hist[4], (unsigned)s->hist[5],
+        (unsigned)s->hist[6], (unsigned)s->hist[7]);
+    if (written < 0) {
+      break;
+    }
+    length += (size_t)written;
+  }
+  return length < capacity ? length : capacity - 1;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// End-to-end sample age at each stage of the display pipeline, measured on the
+// hub's clock through clock_sync.h. The age is display time at the stage minus
+// the hub time the value was stamped:
+//
+//   DECODED         full and delta frames, hub emit -> frame decoded
+//   BATCH_SAMPLE    every sample of a batch frame, analog read -> frame decoded
+//   RENDERED        newest state, hub emit -> UI updated by the render task
+//
+// DECODED covers the UART, both drivers' buffering and the decode; RENDERED
+// adds the wait for the monitor mutex and the next render period.
+
+typedef enum {
+  LATENCY_STAGE_DECODED,
+  LATENCY_STAGE_BATCH_SAMPLE,
+  LATENCY_STAGE_RENDERED,
+  LATENCY_STAGE_COUNT
+} latency_stage_t;
+
+// Upper bounds of the age histogram buckets in microseconds; the last bucket
+// takes everything above the previous bound.
+#define LATENCY_STATS_BUCKETS 8U
+#define LATENCY_STATS_BOUNDS_US {1000U, 2000U, 5000U, 10000U, 20000U, 50000U, 100000U, UINT32_MAX}
+
+typedef struct {
+  uint32_t count;
+  uint32_t negative;  // ages below zero, i.e. clock sync error; counted as 0
+  uint32_t min_us;
+  uint32_t max_us;
+  uint32_t avg_us;    // smoothed, avg += (age - avg) / 16
+  uint32_t last_us;
+  uint32_t hist[LATENCY_STATS_BUCKETS];
+
+  // Private to latency_stats.c.
+  uint32_t avg_q4;  // avg_us * 16
+} latency_stage_stats_t;
+
+typedef struct {
+  latency_stage_stats_t stages[LATENCY_STAGE_COUNT];
+} latency_stats_t;
+
+void latency_stats_init(latency_stats_t* stats);
+
+// Records one age for `stage`. Negative ages mean the clock estimate is off by
+// more than the true latency and are counted separately.
+void latency_stats_record(latency_stats_t* stats, latency_stage_t stage, int32_t age_us);
+
+const char* latency_stage_name(latency_stage_t stage);
+
+// One line per stage for the log, separated by '\n'. Returns the length
+// written, excluding the terminator, truncated to fit `capacity`.
+size_t latency_stats_format(const latency_stats_t* stats, char* buffer, size_t capacity);
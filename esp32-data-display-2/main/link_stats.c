@@ -0,0 +1,139 @@
+#include "link_stats.h"
+
+#include <stdio.h>
+#include <string.h>
+
+static const uint32_t k_jitter_bounds_us[LINK_STATS_JITTER_BUCKETS] = LINK_STATS_JITTER_BOUNDS_US;
+
+void link_stats_init(link_stats_t* stats) {
+  if (stats != NULL) {
+    memset(stats, 0, sizeof(*stats));
+  }
+}
+
+static void track_sequence(link_stats_t* stats, uint32_t sequence) {
+  if (stats->has_sequence) {
+    const uint32_t step = sequence - stats->last_sequence;
+    if (step == 0 || step > INT32_MAX) {
+      stats->sequence_resets++;
+    } else if (step > 1) {
+      stats->sequence_gaps++;
+      stats->frames_lost += step - 1;
+    }
+  }
+  stats->has_sequence = true;
+  stats->last_sequence = sequence;
+}
+
+static void track_jitter(link_stats_t* stats, uint32_t hub_ms, uint32_t now_us) {
+  if (stats->has_timing) {
+    const int64_t rx_delta_us = (int32_t)(now_us - stats->last_rx_us);
+    const int64_t hub_delta_us = (int64_t)(int32_t)(hub_ms - stats->last_hub_ms) * 1000;
+    int64_t transit_change_us = rx_delta_us - hub_delta_us;
+    if (transit_change_us < 0) {
+      transit_change_us = -transit_change_us;
+    }
+    const uint32_t jitter_us = transit_change_us > INT32_MAX ? INT32_MAX : (uint32_t)transit_change_us;
+
+    size_t bucket = 0;
+    while (jitter_us > k_jitter_bounds_us[bucket]) {
+      bucket++;
+    }
+    stats->jitter[bucket]++;
+    if (jitter_us > stats->jitter_max_us) {
+      stats->jitter_max_us = jitter_us;
+    }
+    // J += (|D| - J) / 16, kept in 1/16 us.
+    const int64_t avg_q4 = (int64_t)stats->jitter_avg_q4 + jitter_us - (stats->jitter_avg_q4 >> 4);
+    stats->jitter_avg_q4 = avg_q4 > UINT32_MAX ? UINT32_MAX : (uint32_t)avg_q4;
+    stats->jitter_avg_us = stats->jitter_avg_q4 >> 4;
+  }
+  stats->has_timing = true;
+  stats->last_rx_us = now_us;
+  stats->last_hub_ms = hub_ms;
+}
+
+void link_stats_on_frame(link_stats_t* stats, telemetry_result_t result, const vehicle_state_t* packet, bool batch,
+                         uint32_t now_us) {
+  if (stats == NULL || result == TELEMETRY_RESULT_INCOMPLETE) {
+    return;
+  }
+  stats->frames++;
+
+  switch (result) {
+    case TELEMETRY_RESULT_OK:
+      stats->telemetry_ok++;
+      if (packet != NULL) {
+        track_sequence(stats, packet->sequence);
+        if (!batch) {
+          track_jitter(stats, packet->timestamp_ms, now_us);
+        }
+      }
+      break;
+    case TELEMETRY_RESULT_CONTROL:
+    case TELEMETRY_RESULT_DESCRIPTOR:
+      stats->control++;
+      break;
+    case TELEMETRY_RESULT_NEED_KEYFRAME:
+      stats->need_keyframe++;
+      break;
+    case TELEMETRY_RESULT_COBS_ERROR:
+      stats->cobs_errors++;
+      break;
+    case TELEMETRY_RESULT_CRC_ERROR:
+      stats->crc_errors++;
+      break;
+    case TELEMETRY_RESULT_FRAME_TOO_LARGE:
+      stats->oversize++;
+      break;
+    default:
+      stats->schema_errors++;
+      break;
+  }
+}
+
+void link_stats_on_resync(link_stats_t* stats) {
+  if (stats != NULL) {
+    stats->resyncs++;
+    // The gap after a resync says nothing about transit time.
+    stats->has_timing = false;
+  }
+}
+
+void link_stats_on_overflow(link_stats_t* stats) {
+  if (stats != NULL) {
+    stats->overflows++;
+  }
+}
+
+float link_stats_delivery_ratio(const link_stats_t* stats) {
+  if (stats == NULL) {
+    return 1.0f;
+  }
+  const uint64_t sent = (uint64_t)stats->telemetry_ok + stats->frames_lost;
+  return sent == 0 ? 1.0f : (float)((double)stats->telemetry_ok / (double)sent);
+}
+
+size_t link_stats_format(const link_stats_t* stats, char* buffer, size_t capacity) {
+  if (stats == NULL || buffer == NULL || capacity == 0) {
+    return 0;
+  }
+  const int written = snprintf(
+      buffer, capacity,
+      "frames=%u ok=%u ctl=%u delivered=%.1f%% lost=%u gaps=%u resets=%u keyframe_wait=%u cobs=%u crc=%u "
+      "schema=%u oversize=%u fec=%u resync=%u overflow=%u jitter_avg=%uus jitter_max=%uus "
+      "hist=%u/%u/%u/%u/%u/%u/%u/%u",
+      (unsigned)stats->frames, (unsigned)stats->telemetry_ok, (unsigned)stats->control,
+      100.0 * link_stats_delivery_ratio(stats), (unsigned)stats->frames_lost, (unsigned)stats->sequence_gaps,
+      (unsigned)stats->sequence_resets, (unsigned)stats->need_keyframe, (unsigned)stats->cobs_errors,
+      (unsigned)stats->crc_errors, (unsigned)stats->schema_errors, (unsigned)stats->oversize,
+      (unsigned)stats->fec_repaired, (unsigned)stats->resyncs, (unsigned)stats->overflows,
+      (unsigned)stats->jitter_avg_us, (unsigned)stats->jitter_max_us, (unsigned)stats->jitter[0],
+      (unsigned)stats->jitter[1], (unsigned)stats->jitter[2], (unsigned)stats->jitter[3], (unsigned)stats->jitter[4],
+      (unsigned)stats->jitter[5], (unsigned)stats->jitter[6], (unsigned)stats->jitter[7]);
+  if (written < 0) {
+    buffer[0] = '\0';
+    return 0;
+  }
+  return (size_t)written < capacity ? (size_t)written : capacity - 1;
+}
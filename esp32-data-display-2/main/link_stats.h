@@ -0,0 +1,69 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "telemetry_protocol.h"
+#include "telemetry_types.h"
+
+// UART link quality counters, fed with every frame the display completes.
+//
+// Sequence numbers are consecutive across every telemetry frame the hub sends
+// (full, delta and batch), so a jump shows how many frames never arrived
+// intact, whether they were rejected here or lost on the wire. Jitter is the
+// change in transit time between consecutive frames, (rx_j - rx_i) minus
+// (hub timestamp_j - hub timestamp_i), so it does not depend on the emit rate.
+
+// Upper bounds of the jitter histogram buckets in microseconds; the last
+// bucket takes everything above the previous bound.
+#define LINK_STATS_JITTER_BUCKETS 8U
+#define LINK_STATS_JITTER_BOUNDS_US {500U, 1000U, 2000U, 5000U, 10000U, 20000U, 50000U, UINT32_MAX}
+
+typedef struct {
+  uint32_t frames;           // every completed frame, accepted or not
+  uint32_t telemetry_ok;     // full, delta and batch frames accepted
+  uint32_t control;          // control and schema descriptor frames accepted
+  uint32_t need_keyframe;    // deltas dropped while waiting for a keyframe
+  uint32_t sequence_gaps;    // times the sequence skipped ahead
+  uint32_t frames_lost;      // sequence numbers skipped in total
+  uint32_t sequence_resets;  // sequence went backwards, e.g. the hub restarted
+  uint32_t cobs_errors;
+  uint32_t crc_errors;
+  uint32_t schema_errors;    // MessagePack or schema errors
+  uint32_t oversize;         // frames longer than the maximum
+  uint32_t fec_repaired;     // accepted after FEC repair
+  uint32_t resyncs;          // partial frames or buffered bytes dropped to regain sync
+  uint32_t overflows;        // UART receive FIFO or buffer overflows
+  uint32_t jitter[LINK_STATS_JITTER_BUCKETS];
+  uint32_t jitter_avg_us;    // RFC 3550 style smoothed |jitter|
+  uint32_t jitter_max_us;
+
+  // Private to link_stats.c.
+  bool has_sequence;
+  uint32_t last_sequence;
+  bool has_timing;
+  uint32_t last_rx_us;
+  uint32_t last_hub_ms;
+  uint32_t jitter_avg_q4;  // jitter_avg_us * 16
+} link_stats_t;
+
+void link_stats_init(link_stats_t* stats);
+
+// Records a completed frame. `packet` is the decoded state for
+// TELEMETRY_RESULT_OK and is ignored otherwise. Batch frames are counted and
+// sequenced but left out of the jitter, since their timestamp is the newest
+// sample's rather than the send time. `now_us` may wrap.
+void link_stats_on_frame(link_stats_t* stats, telemetry_result_t result, const vehicle_state_t* packet, bool batch,
+                         uint32_t now_us);
+
+void link_stats_on_resync(link_stats_t* stats);
+void link_stats_on_overflow(link_stats_t* stats);
+
+// Share of sent telemetry frames that arrived intact, 0..1, judged from the
+// sequence numbers. 1 before anything was received.
+float link_stats_delivery_ratio(const link_stats_t* stats);
+
+// One-line summary for the log. Returns the length written, excluding the
+// terminator, truncated to fit `capacity`.
+size_t link_stats_format(const link_stats_t* stats, char* buffer, size_t capacity);
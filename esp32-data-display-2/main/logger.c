@@ -19,6 +19,12 @@ static const char* TAG = "logger";
 #define LOG_TASK_STACK_SIZE (4096)
 #define LOG_TASK_PRIORITY (tskIDLE_PRIORITY + 1)
 #define LOG_FILE_NAME_LEN (32)
+#define LOG_ROW_MAX_LEN (512)
+
+// CSV columns follow TELEMETRY_CHANNELS order
+#define LOG_HEADER_COLUMN(name, ...) "," #name
+static const char k_log_header[] = "timestamp_s" TELEMETRY_CHANNELS(LOG_HEADER_COLUMN) "\n";
+#undef LOG_HEADER_COLUMN
 
 static bool s_sd_ready = false;
 static volatile bool s_logging_active = false;
@@ -85,10 +91,7 @@ static esp_err_t open_log_file_with_header(void) {
 
   setvbuf(s_log_fp, NULL, _IOLBF, 0);
 
-  if (fprintf(s_log_fp,
-              "timestamp_s,water_temp,oil_temp,oil_pressure,oil_pressure_raw,dam,af_learned,af_ratio,int_temp,"
-              "fb_knock,af_correct,"
-              "inj_duty,eth_conc,throttle_pos,brake_pressure_bar,steering_angle_deg\n") < 0) {
+  if (fputs(k_log_header, s_log_fp) < 0) {
     fclose(s_log_fp);
     s_log_fp = NULL;
     ESP_LOGE(TAG, "Failed writing CSV header");
@@ -99,19 +102,27 @@ static esp_err_t open_log_file_with_header(void) {
   return ESP_OK;
 }
 
+static void append_column(char* row, size_t* length, float value) {
+  if (*length < LOG_ROW_MAX_LEN) {
+    *length += (size_t)snprintf(row + *length, LOG_ROW_MAX_LEN - *length, ",%.3f", value);
+  }
+}
+
 static bool write_snapshot_row(FILE* fp, const monitored_state_t* snapshot) {
   double timestamp_s = (double)(esp_timer_get_time() - s_session_start_us) / 1000000.0;
-  int rc = fprintf(fp,
-                   "%.2f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f\n",
-                   timestamp_s,
-                   snapshot->water_temp.current_value, snapshot->oil_temp.current_value,
-                   snapshot->oil_pressure.current_value, snapshot->oil_pressure_raw, snapshot->dam.current_value,
-                   snapshot->af_learned.current_value, snapshot->af_ratio.current_value,
-                   snapshot->int_temp.current_value, snapshot->fb_knock.current_value,
-                   snapshot->af_correct.current_value, snapshot->inj_duty.current_value,
-                   snapshot->eth_conc.current_value, snapshot->throttle_pos, snapshot->brake_pressure_bar,
-                   snapshot->steering_angle_deg);
-  return (rc >= 0);
+  char row[LOG_ROW_MAX_LEN];
+  size_t length = (size_t)snprintf(row, sizeof(row), "%.2f", timestamp_s);
+
+#define LOG_ROW_COLUMN(name, ...) append_column(row, &length, snapshot->name.current_value);
+  TELEMETRY_CHANNELS(LOG_ROW_COLUMN)
+#undef LOG_ROW_COLUMN
+
+  if (length + 1 >= sizeof(row)) {
+    return false;
+  }
+  row[length++] = '\n';
+  row[length] = '\0';
+  return (fputs(row, fp) >= 0);
 }
 
 static void logger_task(void* arg) {
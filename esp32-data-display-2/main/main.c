@@ -99,8 +99,11 @@ void app_main(void) {
 
 #ifndef CONFIG_DD_ENABLE_FAKE_DATA
   // Flush stale UART bytes that accumulated during splash/init so the
-  // pipeline starts on a clean packet boundary.
+  // pipeline starts on a clean packet boundary. Overflows from that time are
+  // dropped with them so they do not show up in the link stats.
   uart_flush_input(UART_NUM_1);
+  xQueueReset(uart_queue);
+  dd_car_data_set_uart_events(uart_queue);
 #endif
 
   ESP_ERROR_CHECK(dd_uart_pipeline_start(&shared_state));
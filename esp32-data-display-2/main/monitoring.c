@@ -1,16 +1,69 @@
 #include "monitoring.h"
 
+#include <stddef.h>
+
 #include "math.h"
 
 #define MIN(a, b) ((a) < (b) ? (a) : (b))
 #define MAX(a, b) ((a) > (b) ? (a) : (b))
 
+typedef struct {
+  size_t monitor_offset;
+  size_t packet_offset;
+} channel_binding_t;
+
+static const channel_binding_t k_channels[] = {
+#define CHANNEL_BINDING(name, ...) {offsetof(monitored_state_t, name), offsetof(vehicle_state_t, name)},
+    TELEMETRY_CHANNELS(CHANNEL_BINDING)
+#undef CHANNEL_BINDING
+};
+
+#define CHANNEL_COUNT (sizeof(k_channels) / sizeof(k_channels[0]))
+
+static inline numeric_monitor_t* channel_monitor(monitored_state_t* m_state, size_t index) {
+  return (numeric_monitor_t*)((char*)m_state + k_channels[index].monitor_offset);
+}
+
+static inline const numeric_monitor_t* channel_monitor_const(const monitored_state_t* m_state, size_t index) {
+  return (const numeric_monitor_t*)((const char*)m_state + k_channels[index].monitor_offset);
+}
+
 void update_numeric_monitor(numeric_monitor_t* monitor, float new_value) {
+  // NaN marks a channel the hub does not have; MIN/MAX would keep it and wipe
+  // the session extrema, and evaluate_statuses() would read it as critical.
+  if (isnan(new_value)) {
+    return;
+  }
   monitor->current_value = new_value;
   monitor->min_value = MIN(monitor->min_value, new_value);
   monitor->max_value = MAX(monitor->max_value, new_value);
 }
 
+void update_monitored_state(monitored_state_t* m_state, const vehicle_state_t* packet) {
+  m_state->missing_mask = 0;
+  for (size_t i = 0; i < CHANNEL_COUNT; ++i) {
+    const float value = *(const float*)((const char*)packet + k_channels[i].packet_offset);
+    if (isnan(value)) {
+      m_state->missing_mask |= 1UL << i;
+    }
+    update_numeric_monitor(channel_monitor(m_state, i), value);
+  }
+  m_state->timestamp_ms = packet->timestamp_ms;
+}
+
+void update_monitored_batch(monitored_state_t* m_state, const telemetry_sample_batch_t* batch) {
+  size_t column = 0;
+  for (size_t i = 0; i < CHANNEL_COUNT && column < TELEMETRY_BATCH_MAX_CHANNELS; ++i) {
+    if (!(batch->field_mask & (1UL << i))) {
+      continue;
+    }
+    for (size_t s = 0; s < batch->sample_count; ++s) {
+      update_numeric_monitor(channel_monitor(m_state, i), batch->values[s][column]);
+    }
+    column++;
+  }
+}
+
 bool is_alert_status(monitor_status status) { return status == STATUS_WARN || status == STATUS_CRITICAL; }
 
 bool is_new_alert(monitor_status previous, monitor_status current) {
@@ -25,21 +78,15 @@ bool is_new_alert(monitor_status previous, monitor_status current) {
 }
 
 bool has_alert_transition(const monitored_state_t* prev, const monitored_state_t* curr) {
-  // TODO i hate this
-  return is_new_alert(prev->water_temp.status, curr->water_temp.status) ||
-         is_new_alert(prev->oil_temp.status, curr->oil_temp.status) ||
-         is_new_alert(prev->oil_pressure.status, curr->oil_pressure.status) ||
-         is_new_alert(prev->dam.status, curr->dam.status) ||
-         is_new_alert(prev->af_learned.status, curr->af_learned.status) ||
-         is_new_alert(prev->af_ratio.status, curr->af_ratio.status) ||
-         is_new_alert(prev->int_temp.status, curr->int_temp.status) ||
-         is_new_alert(prev->fb_knock.status, curr->fb_knock.status) ||
-         is_new_alert(prev->af_correct.status, curr->af_correct.status) ||
-         is_new_alert(prev->inj_duty.status, curr->inj_duty.status) ||
-         is_new_alert(prev->eth_conc.status, curr->eth_conc.status);
+  for (size_t i = 0; i < CHANNEL_COUNT; ++i) {
+    if (is_new_alert(channel_monitor_const(prev, i)->status, channel_monitor_const(curr, i)->status)) {
+      return true;
+    }
+  }
+  return false;
 }
 
-void evaluate_statuses(monitored_state_t* m_state, unsigned int engine_rpm) {
+void evaluate_statuses(monitored_state_t* m_state, float engine_rpm) {
   // --- do monitoring logic
 
   if (m_state->water_temp.current_value < 160) {
@@ -64,10 +111,10 @@ void evaluate_statuses(monitored_state_t* m_state, unsigned int engine_rpm) {
 
   // should have at least 10 psi per 1000 RPM, capped at 60 psi
   // TODO: model a curve one day but this is close enough for now.
-  if (engine_rpm < 300) {
+  if (isnan(engine_rpm) || engine_rpm < 300) {
     m_state->oil_pressure.status = STATUS_NOT_READY;
   } else {
-    float min_psi = (float)engine_rpm / 100.0f;
+    float min_psi = engine_rpm / 100.0f;
     if (min_psi > 60.0f) min_psi = 60.0f;
     m_state->oil_pressure.status =
         (m_state->oil_pressure.current_value < min_psi) ? STATUS_CRITICAL : STATUS_OK;
@@ -104,6 +151,13 @@ void evaluate_statuses(monitored_state_t* m_state, unsigned int engine_rpm) {
   } else {
     m_state->inj_duty.status = STATUS_OK;
   }
+
+  // a channel the hub does not send keeps a stale value; don't judge it
+  for (size_t i = 0; i < CHANNEL_COUNT; ++i) {
+    if (m_state->missing_mask & (1UL << i)) {
+      channel_monitor(m_state, i)->status = STATUS_NOT_READY;
+    }
+  }
 }
 
 void reset_numeric_monitor(numeric_monitor_t* monitor) {
@@ -112,17 +166,7 @@ void reset_numeric_monitor(numeric_monitor_t* monitor) {
 }
 
 void reset_monitored_state(monitored_state_t* m_state) {
-  reset_numeric_monitor(&m_state->oil_temp);
-  reset_numeric_monitor(&m_state->water_temp);
-  reset_numeric_monitor(&m_state->oil_pressure);
-
-  reset_numeric_monitor(&m_state->dam);
-  reset_numeric_monitor(&m_state->af_learned);
-  reset_numeric_monitor(&m_state->af_ratio);
-  reset_numeric_monitor(&m_state->int_temp);
-
-  reset_numeric_monitor(&m_state->fb_knock);
-  reset_numeric_monitor(&m_state->af_correct);
-  reset_numeric_monitor(&m_state->inj_duty);
-  reset_numeric_monitor(&m_state->eth_conc);
-}
\ No newline at end of file
+  for (size_t i = 0; i < CHANNEL_COUNT; ++i) {
+    reset_numeric_monitor(channel_monitor(m_state, i));
+  }
+}
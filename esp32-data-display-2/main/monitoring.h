@@ -2,6 +2,9 @@
 
 #include <stdbool.h>
 
+#include "telemetry_protocol.h"
+#include "telemetry_types.h"
+
 // info = something you might want to look at, like low knock value at lower load
 // warn = something you should start paying attention to, like when oil hits 240F
 // critical = something you should take action on immediately, like when coolant hits 220F
@@ -14,32 +17,29 @@ typedef struct {
   monitor_status status;
 } numeric_monitor_t;
 
+// one monitor per telemetry channel, generated from TELEMETRY_CHANNELS
 typedef struct {
-  numeric_monitor_t water_temp;
-  numeric_monitor_t oil_temp;
-  numeric_monitor_t oil_pressure;
-  float oil_pressure_raw;
-  float throttle_pos;
-  float brake_pressure_bar;
-  float steering_angle_deg;
-
-  numeric_monitor_t dam;
-  numeric_monitor_t af_learned;
-  numeric_monitor_t af_ratio;
-  numeric_monitor_t int_temp;
-
-  numeric_monitor_t fb_knock;
-  numeric_monitor_t af_correct;
-  numeric_monitor_t inj_duty;
-  numeric_monitor_t eth_conc;
+#define MONITORED_STATE_MEMBER(name, ...) numeric_monitor_t name;
+  TELEMETRY_CHANNELS(MONITORED_STATE_MEMBER)
+#undef MONITORED_STATE_MEMBER
+  uint32_t timestamp_ms;  // hub time of the newest packet
+  uint32_t missing_mask;  // bit TELEMETRY_CHANNEL_*: NaN in the newest packet, e.g. not in the hub's layout
 } monitored_state_t;
 
 void update_numeric_monitor(numeric_monitor_t* monitor, float new_value);
 
+// feeds every channel of a received packet into its monitor
+void update_monitored_state(monitored_state_t* m_state, const vehicle_state_t* packet);
+
+// feeds every sample of a batch frame into its channel's monitor, so min/max
+// include readings taken between packets
+void update_monitored_batch(monitored_state_t* m_state, const telemetry_sample_batch_t* batch);
+
 // compares states to check for any newly set warn/critical status transitions
 bool has_alert_transition(const monitored_state_t* prev, const monitored_state_t* curr);
 
-// check m_state and set status fields appropriately
-void evaluate_statuses(monitored_state_t* m_state, unsigned int engine_rpm);
+// check m_state and set status fields appropriately; missing channels, and
+// oil pressure while RPM is NaN, are STATUS_NOT_READY
+void evaluate_statuses(monitored_state_t* m_state, float engine_rpm);
 
 void reset_monitored_state(monitored_state_t* m_state);
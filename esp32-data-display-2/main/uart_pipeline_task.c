@@ -49,24 +49,11 @@ static void uart_pipeline_task(void* arg) {
 
     bool alert_transition = false;
     if (xSemaphoreTake(s_state_iface.mutex, pdMS_TO_TICKS(100))) {
-      update_numeric_monitor(&s_state_iface.state->water_temp, packet.water_temp);
-      update_numeric_monitor(&s_state_iface.state->oil_temp, packet.oil_temp);
-      update_numeric_monitor(&s_state_iface.state->oil_pressure, packet.oil_pressure);
-      s_state_iface.state->oil_pressure_raw = packet.oil_pressure_raw;
-      s_state_iface.state->throttle_pos = packet.throttle_pos;
-      s_state_iface.state->brake_pressure_bar = packet.brake_pressure_bar;
-      s_state_iface.state->steering_angle_deg = packet.steering_angle_deg;
-
-      update_numeric_monitor(&s_state_iface.state->dam, packet.dam);
-      update_numeric_monitor(&s_state_iface.state->af_learned, packet.af_learned);
-      update_numeric_monitor(&s_state_iface.state->af_ratio, packet.af_ratio);
-      update_numeric_monitor(&s_state_iface.state->int_temp, packet.int_temp);
-
-      update_numeric_monitor(&s_state_iface.state->fb_knock, packet.fb_knock);
-      update_numeric_monitor(&s_state_iface.state->af_correct, packet.af_correct);
-      update_numeric_monitor(&s_state_iface.state->inj_duty, packet.inj_duty);
-      update_numeric_monitor(&s_state_iface.state->eth_conc, packet.eth_conc);
-
+      const telemetry_sample_batch_t* batch = dd_car_data_last_batch();
+      if (batch != NULL) {
+        update_monitored_batch(s_state_iface.state, batch);
+      }
+      update_monitored_state(s_state_iface.state, &packet);
       evaluate_statuses(s_state_iface.state, packet.engine_rpm);
 
       if (prev_state_valid) {
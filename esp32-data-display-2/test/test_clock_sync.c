@@ -0,0 +1,168 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "clock_sync.h"
+#include "latency_stats.h"
+
+// Simulated hub clock: hub = display * (1 + drift) + offset, kept in 64-bit
+// and truncated to 32 bits like esp_timer_get_time().
+typedef struct {
+  int64_t offset_us;
+  double drift_ppm;
+} hub_clock_t;
+
+static uint32_t hub_time(const hub_clock_t* hub, int64_t display_us) {
+  return (uint32_t)(int64_t)((double)display_us * (1.0 + hub->drift_ppm * 1e-6) + (double)hub->offset_us);
+}
+
+// One exchange: the ping takes `out_us` to be read, the hub answers after
+// `hold_us` and the pong takes `back_us` to complete.
+static bool exchange(clock_sync_t* sync, const hub_clock_t* hub, int64_t t1, uint32_t out_us, uint32_t hold_us,
+                     uint32_t back_us) {
+  const telemetry_control_t ping = clock_sync_make_ping(sync, (uint32_t)t1);
+  assert(ping.type == TELEMETRY_CONTROL_TIME_PING && ping.value == (uint32_t)t1);
+  const telemetry_control_t pong = {
+      .type = TELEMETRY_CONTROL_TIME_PONG,
+      .value = ping.value,
+      .hub_rx_us = hub_time(hub, t1 + out_us),
+      .hub_tx_us = hub_time(hub, t1 + out_us + hold_us),
+  };
+  return clock_sync_on_pong(sync, &pong, (uint32_t)(t1 + out_us + hold_us + back_us));
+}
+
+static int32_t hub_error_us(const clock_sync_t* sync, const hub_clock_t* hub, int64_t display_us) {
+  uint32_t estimate;
+  assert(clock_sync_to_hub_us(sync, (uint32_t)display_us, &estimate));
+  return (int32_t)(estimate - hub_time(hub, display_us));
+}
+
+static void test_symmetric_exchange_is_exact(void) {
+  clock_sync_t sync;
+  clock_sync_init(&sync);
+  uint32_t hub_us;
+  assert(!clock_sync_to_hub_us(&sync, 0, &hub_us));
+
+  // The hub booted long after the display, so its clock is behind and the
+  // offset wraps.
+  const hub_clock_t hub = {.offset_us = -3000000000LL, .drift_ppm = 0.0};
+  assert(exchange(&sync, &hub, 4000000000LL, 400, 50, 400));
+  assert(sync.synced && sync.rtt_us == 800 && sync.pongs == 1);
+  assert(hub_error_us(&sync, &hub, 4000000000LL) == 0);
+  assert(hub_error_us(&sync, &hub, 4100000000LL) == 0);
+
+  // A sample stamped by the hub 1500 us ago is 1500 us old.
+  const int64_t now = 4000500000LL;
+  const uint32_t stamped_ms = hub_time(&hub, now - 1500) / 1000U;
+  int32_t age_us;
+  assert(clock_sync_age_us(&sync, stamped_ms, (uint32_t)now, &age_us));
+  const int32_t exact_age = (int32_t)(hub_time(&hub, now) - stamped_ms * 1000U);
+  assert(age_us == exact_age && age_us >= 1500 && age_us < 2500);
+}
+
+static void test_shortest_round_trip_wins(void) {
+  clock_sync_t sync;
+  clock_sync_init(&sync);
+  const hub_clock_t hub = {.offset_us = 123456789, .drift_ppm = 0.0};
+
+  // Pings that waited for the hub's next emit period arrive late one way.
+  int64_t t = 1000000;
+  assert(exchange(&sync, &hub, t, 300 + 18000, 20, 300));
+  assert(abs(hub_error_us(&sync, &hub, t)) > 8000);
+  t += 1000000;
+  assert(exchange(&sync, &hub, t, 300 + 500, 20, 300));
+  assert(exchange(&sync, &hub, t + 1000000, 300 + 9000, 20, 300));
+  assert(sync.rtt_us == 1100 && abs(hub_error_us(&sync, &hub, t + 2000000)) <= 250);
+  assert(sync.min_rtt_us == 1100);
+
+  // The good exchange ages out of the window after CLOCK_SYNC_WINDOW more.
+  for (uint32_t i = 0; i < CLOCK_SYNC_WINDOW; ++i) {
+    t += 1000000;
+    assert(exchange(&sync, &hub, t, 300 + 4000, 20, 300));
+  }
+  assert(sync.rtt_us == 4600);
+}
+
+static void test_stale_and_implausible_pongs(void) {
+  clock_sync_t sync;
+  clock_sync_init(&sync);
+  const hub_clock_t hub = {.offset_us = 5000, .drift_ppm = 0.0};
+
+  // A pong for an abandoned ping does not match the newer one.
+  const telemetry_control_t old_ping = clock_sync_make_ping(&sync, 1000);
+  clock_sync_make_ping(&sync, 2000000);
+  telemetry_control_t pong = {.type = TELEMETRY_CONTROL_TIME_PONG, .value = old_ping.value,
+                              .hub_rx_us = hub_time(&hub, 2000100), .hub_tx_us = hub_time(&hub, 2000100)};
+  assert(!clock_sync_on_pong(&sync, &pong, 2000200));
+  assert(sync.stale == 1 && !sync.synced);
+
+  // Nor does a second pong for the same ping.
+  pong.value = 2000000;
+  assert(clock_sync_on_pong(&sync, &pong, 2000200));
+  assert(!clock_sync_on_pong(&sync, &pong, 2000300));
+  assert(sync.stale == 2 && sync.pongs == 1);
+
+  // A hub hold time longer than the round trip, or a very slow exchange, is
+  // dropped.
+  clock_sync_make_ping(&sync, 3000000);
+  pong.value = 3000000;
+  pong.hub_rx_us = hub_time(&hub, 3000100);
+  pong.hub_tx_us = pong.hub_rx_us + 5000;
+  assert(!clock_sync_on_pong(&sync, &pong, 3004200));
+  assert(!exchange(&sync, &hub, 4000000, CLOCK_SYNC_MAX_RTT_US, 0, 10));
+  assert(sync.rejected == 2 && sync.pongs == 1);
+}
+
+static void test_drift_is_tracked(void) {
+  clock_sync_t sync;
+  clock_sync_init(&sync);
+  const hub_clock_t hub = {.offset_us = -777777, .drift_ppm = 40.0};
+
+  int64_t t = 0;
+  for (int i = 0; i < 120; ++i) {
+    t += 1000000;
+    // Round trips vary between 1 and 3 ms.
+    exchange(&sync, &hub, t, 500 + (uint32_t)(i % 5) * 400, 20, 500);
+  }
+  assert(sync.drift_ppm > 30.0f && sync.drift_ppm < 50.0f);
+  // Predicting 5 s past the last exchange stays within a millisecond, where
+  // ignoring the drift would be 200 us further off.
+  assert(abs(hub_error_us(&sync, &hub, t + 5000000)) < 1000);
+}
+
+static void test_latency_stages(void) {
+  latency_stats_t stats;
+  latency_stats_init(&stats);
+  latency_stats_record(&stats, LATENCY_STAGE_DECODED, 1500);
+  latency_stats_record(&stats, LATENCY_STAGE_DECODED, 3000);
+  latency_stats_record(&stats, LATENCY_STAGE_DECODED, -200);
+  latency_stats_record(&stats, LATENCY_STAGE_RENDERED, 250000);
+  latency_stats_record(&stats, LATENCY_STAGE_COUNT, 1);
+
+  const latency_stage_stats_t* decoded = &stats.stages[LATENCY_STAGE_DECODED];
+  assert(decoded->count == 3 && decoded->negative == 1);
+  assert(decoded->min_us == 0 && decoded->max_us == 3000 && decoded->last_us == 0);
+  assert(decoded->hist[0] == 1 && decoded->hist[1] == 1 && decoded->hist[2] == 1);
+  assert(decoded->avg_us > 1000 && decoded->avg_us < 1700);
+  assert(stats.stages[LATENCY_STAGE_RENDERED].hist[LATENCY_STATS_BUCKETS - 1] == 1);
+  assert(stats.stages[LATENCY_STAGE_RENDERED].avg_us == 250000);
+  assert(stats.stages[LATENCY_STAGE_BATCH_SAMPLE].count == 0);
+
+  char report[384];
+  const size_t length = latency_stats_format(&stats, report, sizeof(report));
+  assert(length == strlen(report) && length < sizeof(report));
+  assert(strstr(report, "decoded: n=3") != NULL && strstr(report, "\nrendered: n=1") != NULL);
+  char small[20];
+  assert(latency_stats_format(&stats, small, sizeof(small)) == sizeof(small) - 1);
+}
+
+int main(void) {
+  test_symmetric_exchange_is_exact();
+  test_shortest_round_trip_wins();
+  test_stale_and_implausible_pongs();
+  test_drift_is_tracked();
+  test_latency_stages();
+  puts("display clock sync tests passed");
+  return 0;
+}
@@ -0,0 +1,121 @@
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "link_stats.h"
+
+static void receive(link_stats_t* stats, uint32_t sequence, uint32_t hub_ms, uint32_t rx_us) {
+  const vehicle_state_t packet = {.sequence = sequence, .timestamp_ms = hub_ms};
+  link_stats_on_frame(stats, TELEMETRY_RESULT_OK, &packet, false, rx_us);
+}
+
+static void test_counts_sequence_gaps_and_resets(void) {
+  link_stats_t stats;
+  link_stats_init(&stats);
+  assert(link_stats_delivery_ratio(&stats) == 1.0f);
+
+  receive(&stats, 10, 0, 0);
+  receive(&stats, 11, 20, 20000);
+  receive(&stats, 14, 80, 80000);  // 12 and 13 lost
+  receive(&stats, 15, 100, 100000);
+  assert(stats.telemetry_ok == 4 && stats.sequence_gaps == 1 && stats.frames_lost == 2);
+  assert(link_stats_delivery_ratio(&stats) > 0.66f && link_stats_delivery_ratio(&stats) < 0.67f);
+
+  // The hub restarted, then the sequence wraps without a gap.
+  receive(&stats, 3, 0, 120000);
+  receive(&stats, UINT32_MAX, 20, 140000);
+  receive(&stats, 0, 40, 160000);
+  assert(stats.sequence_resets == 2 && stats.sequence_gaps == 1 && stats.frames_lost == 2);
+
+  // Batch frames are sequenced too.
+  const vehicle_state_t batch = {.sequence = 1, .timestamp_ms = 55};
+  link_stats_on_frame(&stats, TELEMETRY_RESULT_OK, &batch, true, 170000);
+  receive(&stats, 3, 60, 180000);
+  assert(stats.sequence_gaps == 2 && stats.frames_lost == 3);
+}
+
+static void test_counts_rejections_by_kind(void) {
+  link_stats_t stats;
+  link_stats_init(&stats);
+  link_stats_on_frame(&stats, TELEMETRY_RESULT_INCOMPLETE, NULL, false, 0);
+  link_stats_on_frame(&stats, TELEMETRY_RESULT_COBS_ERROR, NULL, false, 0);
+  link_stats_on_frame(&stats, TELEMETRY_RESULT_CRC_ERROR, NULL, false, 0);
+  link_stats_on_frame(&stats, TELEMETRY_RESULT_CRC_ERROR, NULL, false, 0);
+  link_stats_on_frame(&stats, TELEMETRY_RESULT_MSGPACK_ERROR, NULL, false, 0);
+  link_stats_on_frame(&stats, TELEMETRY_RESULT_SCHEMA_ERROR, NULL, false, 0);
+  link_stats_on_frame(&stats, TELEMETRY_RESULT_FRAME_TOO_LARGE, NULL, false, 0);
+  link_stats_on_frame(&stats, TELEMETRY_RESULT_NEED_KEYFRAME, NULL, false, 0);
+  link_stats_on_frame(&stats, TELEMETRY_RESULT_CONTROL, NULL, false, 0);
+  link_stats_on_resync(&stats);
+  link_stats_on_overflow(&stats);
+  assert(stats.frames == 8);
+  assert(stats.cobs_errors == 1 && stats.crc_errors == 2 && stats.schema_errors == 2 && stats.oversize == 1);
+  assert(stats.need_keyframe == 1 && stats.control == 1 && stats.telemetry_ok == 0);
+  assert(stats.resyncs == 1 && stats.overflows == 1);
+}
+
+static void test_jitter_ignores_emit_rate_and_batches(void) {
+  link_stats_t stats;
+  link_stats_init(&stats);
+
+  // Perfectly paced frames at any rate have no jitter, including frames
+  // that share a UART write and a timestamp.
+  receive(&stats, 0, 1000, 5000000);
+  receive(&stats, 1, 1020, 5020000);
+  receive(&stats, 2, 1020, 5020000);
+  receive(&stats, 3, 1520, 5520000);
+  assert(stats.jitter[0] == 3 && stats.jitter_max_us == 0 && stats.jitter_avg_us == 0);
+
+  // A frame held up by 3 ms, then one on time again.
+  receive(&stats, 4, 1540, 5543000);
+  receive(&stats, 5, 1560, 5560000);
+  assert(stats.jitter[3] == 2 && stats.jitter_max_us == 3000);
+  assert(stats.jitter_avg_us > 0 && stats.jitter_avg_us < 3000);
+
+  // A batch's timestamp is its newest sample, so it is not timed.
+  const vehicle_state_t batch = {.sequence = 6, .timestamp_ms = 1561};
+  link_stats_on_frame(&stats, TELEMETRY_RESULT_OK, &batch, true, 5600000);
+  receive(&stats, 7, 1580, 5580000);
+  assert(stats.jitter[0] == 4);
+
+  // Nor is the gap across a resync.
+  link_stats_on_resync(&stats);
+  receive(&stats, 8, 1600, 9000000);
+  uint32_t timed = 0;
+  for (size_t i = 0; i < LINK_STATS_JITTER_BUCKETS; ++i) {
+    timed += stats.jitter[i];
+  }
+  assert(timed == 6);
+
+  // Large delays land in the last bucket, and the receive clock may wrap.
+  receive(&stats, 9, 1620, 9020000 + 200000);
+  assert(stats.jitter[LINK_STATS_JITTER_BUCKETS - 1] == 1);
+  link_stats_init(&stats);
+  receive(&stats, 0, 0, UINT32_MAX - 9999);
+  receive(&stats, 1, 20, 10000);
+  assert(stats.jitter[0] == 1);
+}
+
+static void test_format_fits_buffer(void) {
+  link_stats_t stats;
+  link_stats_init(&stats);
+  receive(&stats, 1, 0, 0);
+  receive(&stats, 3, 40, 40000);
+  char line[320];
+  const size_t length = link_stats_format(&stats, line, sizeof(line));
+  assert(length == strlen(line) && length < sizeof(line));
+  assert(strstr(line, "ok=2") != NULL && strstr(line, "lost=1") != NULL);
+
+  char small[16];
+  assert(link_stats_format(&stats, small, sizeof(small)) == sizeof(small) - 1);
+  assert(strlen(small) == sizeof(small) - 1);
+}
+
+int main(void) {
+  test_counts_sequence_gaps_and_resets();
+  test_counts_rejections_by_kind();
+  test_jitter_ignores_emit_rate_and_batches();
+  test_format_fits_buffer();
+  puts("display link stats tests passed");
+  return 0;
+}
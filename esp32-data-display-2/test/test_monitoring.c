@@ -1,4 +1,5 @@
 #include <assert.h>
+#include <math.h>
 #include <stdbool.h>
 #include <stdio.h>
 
@@ -17,7 +18,7 @@ static monitored_state_t new_normal_state(void) {
   return state;
 }
 
-static monitor_status oil_pressure_status(float oil_pressure_psi, unsigned int engine_rpm) {
+static monitor_status oil_pressure_status(float oil_pressure_psi, float engine_rpm) {
   monitored_state_t state = new_normal_state();
   state.oil_pressure.current_value = oil_pressure_psi;
   evaluate_statuses(&state, engine_rpm);
@@ -176,6 +177,48 @@ static void test_numeric_monitor_tracks_extrema(void) {
   assert(monitor.max_value == 12.0f);
 }
 
+static void test_numeric_monitor_ignores_nan(void) {
+  monitored_state_t state = {0};
+  state.water_temp = (numeric_monitor_t){.current_value = 190.0f, .min_value = 170.0f, .max_value = 200.0f};
+
+  update_numeric_monitor(&state.water_temp, NAN);
+  assert(state.water_temp.current_value == 190.0f);
+  assert(state.water_temp.min_value == 170.0f);
+  assert(state.water_temp.max_value == 200.0f);
+
+  evaluate_statuses(&state, 0);
+  assert(state.water_temp.status == STATUS_OK);
+
+  update_numeric_monitor(&state.water_temp, 205.0f);
+  assert(state.water_temp.max_value == 205.0f);
+}
+
+static void test_missing_channels_are_not_ready(void) {
+  // A hub without DAM or RPM in its layout: both decode as NaN.
+  monitored_state_t state = new_normal_state();
+  state.dam.current_value = 0.0f;  // never received
+  vehicle_state_t packet = {0};
+  packet.water_temp = 190.0f;
+  packet.oil_temp = 200.0f;
+  packet.oil_pressure = 1.0f;
+  packet.dam = NAN;
+  packet.engine_rpm = NAN;
+  update_monitored_state(&state, &packet);
+  assert(state.missing_mask == ((1UL << TELEMETRY_CHANNEL_dam) | (1UL << TELEMETRY_CHANNEL_engine_rpm)));
+  evaluate_statuses(&state, packet.engine_rpm);
+  assert(state.dam.status == STATUS_NOT_READY);
+  assert(state.engine_rpm.status == STATUS_NOT_READY);
+  assert(state.oil_pressure.status == STATUS_NOT_READY);
+  assert(state.water_temp.status == STATUS_OK);
+  assert(oil_pressure_status(0.0f, NAN) == STATUS_NOT_READY);
+
+  // Once the channel arrives it is judged again.
+  packet.dam = 0.5f;
+  update_monitored_state(&state, &packet);
+  evaluate_statuses(&state, packet.engine_rpm);
+  assert(state.dam.status == STATUS_CRITICAL);
+}
+
 static void test_reset_monitored_state_resets_every_numeric_field(void) {
   monitored_state_t state = {0};
   numeric_monitor_t* monitors[] = {
@@ -198,6 +241,46 @@ static void test_reset_monitored_state_resets_every_numeric_field(void) {
   }
 }
 
+static void test_update_monitored_state_feeds_every_channel(void) {
+  vehicle_state_t packet = {0};
+  float* values[] = {
+#define PACKET_FIELD(name, ...) &packet.name,
+      TELEMETRY_CHANNELS(PACKET_FIELD)
+#undef PACKET_FIELD
+  };
+  for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); ++i) {
+    *values[i] = (float)i + 1.0f;
+  }
+
+  monitored_state_t state = {0};
+  update_monitored_state(&state, &packet);
+
+  assert(state.water_temp.current_value == packet.water_temp);
+  assert(state.engine_rpm.current_value == packet.engine_rpm);
+  assert(state.oil_pressure_raw.current_value == packet.oil_pressure_raw);
+  assert(state.steering_angle_deg.max_value == packet.steering_angle_deg);
+  assert(state.throttle_pos.min_value == 0.0f);
+  assert(state.brake_pressure_bar.current_value == packet.brake_pressure_bar);
+}
+
+static void test_update_monitored_batch_feeds_every_sample(void) {
+  telemetry_sample_batch_t batch = {
+      .field_mask = (1UL << TELEMETRY_CHANNEL_oil_pressure) | (1UL << TELEMETRY_CHANNEL_oil_pressure_raw),
+      .sample_count = 3,
+      .values = {{40.0f, 41.0f}, {12.0f, 9.0f}, {45.0f, 46.0f}},
+  };
+  monitored_state_t state = {0};
+  state.oil_pressure.min_value = 40.0f;
+  state.oil_pressure.max_value = 40.0f;
+  update_monitored_batch(&state, &batch);
+
+  assert(state.oil_pressure.current_value == 45.0f);
+  assert(state.oil_pressure.min_value == 12.0f);
+  assert(state.oil_pressure.max_value == 45.0f);
+  assert(state.oil_pressure_raw.min_value == 0.0f && state.oil_pressure_raw.max_value == 46.0f);
+  assert(state.oil_temp.max_value == 0.0f);
+}
+
 int main(void) {
   test_oil_pressure_tracks_rpm_threshold();
   test_oil_pressure_threshold_caps_at_sixty_psi();
@@ -208,7 +291,11 @@ int main(void) {
   test_injector_duty_boundaries();
   test_alert_transitions_only_fire_for_new_or_escalated_alerts();
   test_numeric_monitor_tracks_extrema();
+  test_numeric_monitor_ignores_nan();
+  test_missing_channels_are_not_ready();
   test_reset_monitored_state_resets_every_numeric_field();
+  test_update_monitored_state_feeds_every_channel();
+  test_update_monitored_batch_feeds_every_sample();
   puts("display monitoring tests passed");
   return 0;
 }
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "telemetry_protocol.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// UART link speed negotiation between the hub and the display.
+//
+// Both sides start at TELEMETRY_LINK_BASE_BAUD. The hub advertises the rates it
+// supports, picks the fastest one the display also supports, and both switch
+// once the display acknowledges. The hub then probes at the new rate; if the
+// probe is not answered, or either side later sees too many bad frames or
+// hears nothing from the other, both return to the base rate and the hub stops
+// offering that rate for a while.
+//
+//   hub                                  display
+//   HELLO(rates)          -- base -->
+//                         <-- base --    HELLO_ACK(rates)
+//   SWITCH(rate)          -- base -->
+//                         <-- base --    SWITCH_ACK(rate), then switch
+//   switch, PROBE(nonce)  -- new  -->
+//                         <-- new  --    PROBE_ACK(nonce)
+//   linked                               linked, KEEPALIVE every interval
+//
+// The state machine does no I/O. Received control frames and frame results
+// are passed in, and telemetry_link_poll() returns what to send and when to
+// change the baud rate, so it runs the same on the devices and in host tests.
+
+// Rates by index; bit i of a rate mask refers to entry i. Index 0 is the base
+// rate every device supports.
+#define TELEMETRY_LINK_RATE_COUNT 3U
+#define TELEMETRY_LINK_BASE_BAUD 115200U
+
+typedef enum { TELEMETRY_LINK_ROLE_HUB, TELEMETRY_LINK_ROLE_DISPLAY } telemetry_link_role_t;
+
+typedef enum {
+  TELEMETRY_LINK_STATE_BASE,         // at the base rate, negotiating or idle
+  TELEMETRY_LINK_STATE_SWITCH_SENT,  // hub: waiting for SWITCH_ACK
+  TELEMETRY_LINK_STATE_PROBING,      // at the new rate, waiting for the probe exchange
+  TELEMETRY_LINK_STATE_LINKED,       // at the new rate, probe answered
+} telemetry_link_state_t;
+
+typedef struct {
+  uint32_t max_baud;               // highest rate to offer or accept
+  uint32_t hello_interval_ms;      // hub: HELLO repeat period at the base rate
+  uint32_t response_timeout_ms;    // hub: wait for SWITCH_ACK
+  uint32_t probe_interval_ms;      // hub: PROBE repeat period
+  uint32_t probe_timeout_ms;       // both: give up on the new rate after this
+  uint32_t keepalive_interval_ms;  // display: KEEPALIVE period while linked
+  uint32_t silence_timeout_ms;     // both: fall back after this long without a valid frame
+  uint32_t error_window_ms;        // both: bad frames are counted over this window
+  uint32_t error_threshold;        // both: fall back when a window reaches this many
+  uint32_t retry_backoff_ms;       // hub: how long a failed rate is not offered
+} telemetry_link_config_t;
+
+// What the caller should do next. Send `control` (if `send`) at the current
+// rate, wait for it to leave the UART, then switch to `baud` (if non-zero).
+typedef struct {
+  bool send;
+  telemetry_control_t control;
+  uint32_t baud;
+} telemetry_link_action_t;
+
+typedef struct {
+  uint32_t negotiations;  // times a faster rate was reached
+  uint32_t fallbacks;     // times a faster rate was abandoned
+  uint32_t bad_frames;    // frames rejected at any rate
+} telemetry_link_stats_t;
+
+// Fields are private to the state machine.
+typedef struct {
+  telemetry_link_config_t config;
+  telemetry_link_role_t role;
+  telemetry_link_state_t state;
+  uint32_t local_mask;
+  uint32_t peer_mask;      // hub: rates from the last HELLO_ACK
+  bool peer_seen;          // hub: a HELLO_ACK has arrived
+  uint8_t rate_index;      // current rate
+  uint32_t excluded_mask;  // hub: rates that failed recently
+  uint32_t excluded_until_ms;
+  uint32_t deadline_ms;   // timeout for the current state
+  uint32_t next_send_ms;  // next HELLO, PROBE or KEEPALIVE
+  uint32_t last_rx_ms;
+  uint32_t window_start_ms;
+  uint32_t window_errors;
+  uint32_t nonce;
+  telemetry_link_action_t pending;
+  telemetry_link_stats_t stats;
+} telemetry_link_t;
+
+uint32_t telemetry_link_rate_baud(uint8_t rate_index);
+
+// Timeouts suited to a 20 ms telemetry period, offering rates up to `max_baud`.
+telemetry_link_config_t telemetry_link_default_config(uint32_t max_baud);
+
+bool telemetry_link_init(telemetry_link_t* link, telemetry_link_role_t role, const telemetry_link_config_t* config,
+                         uint32_t now_ms);
+
+// Feeds a control frame received from the other side.
+void telemetry_link_on_control(telemetry_link_t* link, const telemetry_control_t* control, uint32_t now_ms);
+
+// Feeds the result of every other completed frame (OK or an error) so the link
+// can watch its health. TELEMETRY_RESULT_NEED_KEYFRAME counts as valid.
+void telemetry_link_on_frame(telemetry_link_t* link, telemetry_result_t result, uint32_t now_ms);
+
+// Runs timers. Returns true and fills `action` when something must be sent or
+// the rate must change; call again until it returns false.
+bool telemetry_link_poll(telemetry_link_t* link, uint32_t now_ms, telemetry_link_action_t* action);
+
+uint32_t telemetry_link_baud(const telemetry_link_t* link);
+telemetry_link_state_t telemetry_link_state(const telemetry_link_t* link);
+const telemetry_link_stats_t* telemetry_link_stats(const telemetry_link_t* link);
+
+#ifdef __cplusplus
+}
+#endif
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 
@@ -10,18 +11,129 @@ extern "C" {
 #endif
 
 #define TELEMETRY_SCHEMA_VERSION 3U
-#define TELEMETRY_MSGPACK_ITEM_COUNT 19U
+#define TELEMETRY_FLOAT_FIELD_COUNT 16U
+#define TELEMETRY_FULL_HEADER_ITEM_COUNT 3U
+#define TELEMETRY_MSGPACK_ITEM_COUNT (TELEMETRY_FULL_HEADER_ITEM_COUNT + TELEMETRY_FLOAT_FIELD_COUNT)
 
-// Maximum encoded sizes for the current 19-item schema:
-//   array16 + version + two uint32 values + sixteen float32 values = 94 bytes
-//   raw frame = MessagePack + two-byte CRC
+// Delta frames: [version, sequence, timestamp_ms, field_mask, changed floats...]
+// Bit i of field_mask selects the i-th float field in schema 3 order.
+#define TELEMETRY_SCHEMA_VERSION_DELTA 4U
+#define TELEMETRY_DELTA_HEADER_ITEM_COUNT 4U
+#define TELEMETRY_DELTA_FULL_MASK ((1UL << TELEMETRY_FLOAT_FIELD_COUNT) - 1UL)
+
+// Delta field masks for the fast and slow rate groups in TELEMETRY_CHANNELS.
+#define TELEMETRY_FAST_FIELD_BIT(name, units, deadband, rate, ...) \
+  | (TELEMETRY_RATE_##rate == TELEMETRY_RATE_FAST ? 1UL << TELEMETRY_CHANNEL_##name : 0UL)
+#define TELEMETRY_FAST_FIELD_MASK (0UL TELEMETRY_CHANNELS(TELEMETRY_FAST_FIELD_BIT))
+#define TELEMETRY_SLOW_FIELD_MASK (TELEMETRY_DELTA_FULL_MASK & ~TELEMETRY_FAST_FIELD_MASK)
+
+// Quantized frames (schemas 5 and 6) have the schema 3 and 4 layouts, but each
+// float is sent as an integer number of steps of its channel's `scale` (see
+// TELEMETRY_CHANNELS). Small values pack into 1-byte MessagePack fixints.
+#define TELEMETRY_SCHEMA_VERSION_QUANTIZED 5U
+#define TELEMETRY_SCHEMA_VERSION_QUANTIZED_DELTA 6U
+
+// Sample batches (schema 7) carry every sample of a few high-rate channels
+// taken since the last batch:
+//   [7, sequence, first_timestamp_ms, field_mask,
+//    dt_ms, value..., dt_ms, value..., ...]
+// Each sample is its time since the previous sample (0 for the first) followed
+// by one quantized value per set mask bit, lowest bit first.
+#define TELEMETRY_SCHEMA_VERSION_BATCH 7U
+#define TELEMETRY_BATCH_HEADER_ITEM_COUNT 4U
+#define TELEMETRY_BATCH_MAX_SAMPLES 8U
+#define TELEMETRY_BATCH_MAX_CHANNELS 2U
+
+// Control frames (schema 8) carry link management messages rather than
+// telemetry: [8, type, value]. TIME_PONG adds the hub's two timestamps:
+// [8, type, value, hub_rx_us, hub_tx_us]. Decoders report them with
+// TELEMETRY_RESULT_CONTROL and leave the telemetry state untouched.
+#define TELEMETRY_SCHEMA_VERSION_CONTROL 8U
+#define TELEMETRY_CONTROL_ITEM_COUNT 3U
+#define TELEMETRY_CONTROL_TIME_ITEM_COUNT 5U
+
+typedef enum {
+  TELEMETRY_CONTROL_LINK_HELLO = 1,   // hub: value = supported rate mask
+  TELEMETRY_CONTROL_LINK_HELLO_ACK,   // display: value = supported rate mask
+  TELEMETRY_CONTROL_LINK_SWITCH,      // hub: value = rate index to switch to
+  TELEMETRY_CONTROL_LINK_SWITCH_ACK,  // display: value = rate index, sent before switching
+  TELEMETRY_CONTROL_LINK_PROBE,       // hub, at the new rate: value = nonce
+  TELEMETRY_CONTROL_LINK_PROBE_ACK,   // display: value = nonce
+  TELEMETRY_CONTROL_LINK_KEEPALIVE,   // display, while linked above the base rate
+  TELEMETRY_CONTROL_LINK_FALLBACK,    // either side: returning to the base rate
+
+  // Display -> hub runtime settings. The hub answers each with the same type
+  // carrying the value it applied, after clamping to the supported range.
+  TELEMETRY_CONTROL_SET_EMIT_PERIOD = 16,      // value = UART emit period, ms
+  TELEMETRY_CONTROL_SET_ECU_POLL_PERIOD = 17,  // value = SSM poll period, ms
+  TELEMETRY_CONTROL_SET_VDC_POLL_PERIOD = 18,  // value = VDC poll period, ms
+  TELEMETRY_CONTROL_SET_ECU_FIELDS = 19,       // value = mask of TELEMETRY_CHANNEL_* bits to poll over SSM
+
+  // Clock synchronization. Timestamps are the low 32 bits of each side's
+  // esp_timer in microseconds.
+  TELEMETRY_CONTROL_TIME_PING = 32,  // display: value = display send time
+  TELEMETRY_CONTROL_TIME_PONG = 33,  // hub: value = the ping's value, plus hub_rx_us and hub_tx_us
+} telemetry_control_type_t;
+
+typedef struct {
+  uint32_t type;  // telemetry_control_type_t
+  uint32_t value;
+  uint32_t hub_rx_us;  // TIME_PONG only: hub time when the ping was read
+  uint32_t hub_tx_us;  // TIME_PONG only: hub time when the pong was sent
+} telemetry_control_t;
+
+// Schema descriptors (schema 9) announce the hub's channel layout, one channel
+// per frame:
+//   [9, layout_id, field_count, index, name, width, scale, offset]
+// `index` is the channel's position in full frames and its delta and batch
+// mask bit, `width` a telemetry_width_t, and scale/offset its quantization as
+// in TELEMETRY_CHANNELS. `layout_id` identifies the whole layout (see
+// telemetry_layout_id()). The display decodes data frames through a plan built
+// from a complete set, so a hub with added, removed or reordered channels
+// still decodes on a display built before the change.
+#define TELEMETRY_SCHEMA_VERSION_DESCRIPTOR 9U
+#define TELEMETRY_DESCRIPTOR_ITEM_COUNT 8U
+#define TELEMETRY_SCHEMA_MAX_FIELDS 32U  // delta and batch masks are 32 bits
+#define TELEMETRY_SCHEMA_NAME_MAX 24U    // channel name length, including the terminator
+
+// Tagged full frames (schemas 10 and 11) are schema 3 and 5 frames that name
+// their layout:
+//   [10 or 11, sequence, timestamp_ms, layout_id, values...]
+// Schema 3 and 5 frames are always in TELEMETRY_BASE_LAYOUT_ID, the layout
+// every display built before descriptors assumes, and a hub only sends them
+// in that layout. A hub whose channels differ sends tagged keyframes instead,
+// so no display reads its values in the wrong order.
+#define TELEMETRY_SCHEMA_VERSION_TAGGED 10U
+#define TELEMETRY_SCHEMA_VERSION_QUANTIZED_TAGGED 11U
+#define TELEMETRY_TAGGED_HEADER_ITEM_COUNT 4U
+#define TELEMETRY_BASE_LAYOUT_ID 0x9C4623A8UL
+
+typedef struct {
+  const char* name;  // at most TELEMETRY_SCHEMA_NAME_MAX - 1 characters
+  uint8_t width;     // telemetry_width_t
+  float scale;
+  float value_offset;
+} telemetry_descriptor_t;
+
+// Maximum encoded sizes for the current 19-item schema, plus the layout_id of
+// a tagged frame:
+//   array16 + version + three uint32 values + sixteen float32 values = 99 bytes
+//   A delta frame never carries all sixteen floats (that is sent as a full
+//   frame instead), so it peaks at 3 + 1 + 5 + 5 + 3 + 15 * 5 = 92 bytes.
+//   raw frame = MessagePack + two-byte CRC, plus four parity bytes with FEC
 //   COBS frame = raw + raw/254 + one code byte
-#define TELEMETRY_MSGPACK_MAX_SIZE 94U
-#define TELEMETRY_RAW_FRAME_MAX_SIZE (TELEMETRY_MSGPACK_MAX_SIZE + 2U)
+//   A quantized full frame is at most 3 + 1 + 5 + 5 + 5 + 16 * 3 = 67 bytes.
+//   A full batch is at most 3 + 1 + 5 + 5 + 5 + 8 * (3 + 2 * 3) = 91 bytes.
+#define TELEMETRY_MSGPACK_MAX_SIZE 99U
+#define TELEMETRY_QUANTIZED_MSGPACK_MAX_SIZE 67U
+#define TELEMETRY_FEC_PARITY_SIZE 4U
+#define TELEMETRY_RAW_FRAME_MAX_SIZE (TELEMETRY_MSGPACK_MAX_SIZE + 2U + TELEMETRY_FEC_PARITY_SIZE)
 #define TELEMETRY_COBS_FRAME_MAX_SIZE \
   (TELEMETRY_RAW_FRAME_MAX_SIZE + (TELEMETRY_RAW_FRAME_MAX_SIZE / 254U) + 1U)
 #define TELEMETRY_WIRE_FRAME_MAX_SIZE (TELEMETRY_COBS_FRAME_MAX_SIZE + 1U)
 
+#define TELEMETRY_CRC16_INIT 0xFFFFU
+
 typedef enum {
   TELEMETRY_RESULT_OK = 0,
   TELEMETRY_RESULT_INVALID_ARGUMENT,
@@ -31,20 +143,259 @@ typedef enum {
   TELEMETRY_RESULT_CRC_ERROR,
   TELEMETRY_RESULT_MSGPACK_ERROR,
   TELEMETRY_RESULT_SCHEMA_ERROR,
+  TELEMETRY_RESULT_NEED_KEYFRAME,
+  TELEMETRY_RESULT_INCOMPLETE,
+  TELEMETRY_RESULT_CONTROL,     // a valid control frame, see telemetry_decoder_last_control()
+  TELEMETRY_RESULT_DESCRIPTOR,  // a valid schema descriptor, see telemetry_decoder_t.schema
 } telemetry_result_t;
 
+// Single-pass frame writer. Each appended byte updates the CRC and is COBS
+// stuffed directly into `output`, so no intermediate raw frame is needed.
+// Fields are private to the codec.
+typedef struct {
+  uint8_t* output;
+  size_t capacity;
+  size_t write_index;
+  size_t code_index;
+  uint8_t code;
+  uint16_t crc;
+  bool overflow;
+  bool fec;
+  uint8_t parity[TELEMETRY_FEC_PARITY_SIZE];
+} telemetry_frame_writer_t;
+
+void telemetry_frame_writer_init(telemetry_frame_writer_t* writer, uint8_t* output, size_t output_capacity);
+
+// Protects the frame with TELEMETRY_FEC_PARITY_SIZE Reed-Solomon parity bytes
+// after the CRC, so the receiver can repair up to two corrupted bytes. Call
+// before the first append.
+void telemetry_frame_writer_set_fec(telemetry_frame_writer_t* writer, bool fec);
+
+// `data` may lie later in the writer's own output buffer, as long as it starts
+// past every byte the stuffed frame will have reached by then; the codec's
+// encoders use this to frame MessagePack in place.
+void telemetry_frame_writer_append(telemetry_frame_writer_t* writer, const uint8_t* data, size_t length);
+
+// Appends the big-endian CRC, and the parity bytes with FEC, then closes the
+// last COBS block. The result excludes the trailing 0x00 UART delimiter.
+telemetry_result_t telemetry_frame_writer_finish(telemetry_frame_writer_t* writer, size_t* output_length);
+
 // Encodes one complete frame, excluding the trailing 0x00 UART delimiter.
 telemetry_result_t telemetry_frame_encode(const vehicle_state_t* packet, uint8_t* output,
                                           size_t output_capacity, size_t* output_length);
 
+// Encodes one frame including the trailing 0x00 delimiter, ready to hand to the
+// UART driver. `output_capacity` must be at least TELEMETRY_WIRE_FRAME_MAX_SIZE.
+telemetry_result_t telemetry_frame_encode_wire(const vehicle_state_t* packet, uint8_t* output,
+                                               size_t output_capacity, size_t* output_length);
+
 // Decodes one COBS frame. `frame` must not include the trailing 0x00 delimiter.
-// `packet` is only modified after the entire frame has been validated.
+// `packet` is only modified after the entire frame has been validated. Delta
+// frames have no base here and return TELEMETRY_RESULT_NEED_KEYFRAME.
+// Data frames are read in the local layout, and full frames of another layout
+// return TELEMETRY_RESULT_SCHEMA_ERROR; descriptors are only validated.
 telemetry_result_t telemetry_frame_decode(const uint8_t* frame, size_t frame_length,
                                           vehicle_state_t* packet);
 
+// Encodes a control frame including the trailing 0x00 delimiter.
+telemetry_result_t telemetry_control_encode_wire(const telemetry_control_t* control, uint8_t* output,
+                                                 size_t output_capacity, size_t* output_length);
+
+// The layout compiled into this build, TELEMETRY_FLOAT_FIELD_COUNT entries in
+// wire order.
+const telemetry_descriptor_t* telemetry_local_descriptors(void);
+
+// FNV-1a over the FNV-1a hash of each entry in order, so the display can check
+// a set collected out of order.
+uint32_t telemetry_layout_id(const telemetry_descriptor_t* fields, size_t field_count);
+uint32_t telemetry_local_layout_id(void);
+
+// Encodes entry `index` of a `field_count` channel layout as a schema 9 frame
+// including the trailing 0x00 delimiter. Like control frames, descriptors are
+// repeated rather than protected with FEC parity.
+telemetry_result_t telemetry_descriptor_encode_wire(uint32_t layout_id, uint32_t field_count, uint32_t index,
+                                                    const telemetry_descriptor_t* field, uint8_t* output,
+                                                    size_t output_capacity, size_t* output_length);
+
+// Hub-side delta encoder. Fields whose change since the last transmitted value
+// is within their deadband are left out. Every `keyframe_interval` frames, or
+// whenever every field changed, a full schema 3 frame is sent so the display
+// can resync after lost frames. Fields are private to the codec.
+typedef struct {
+  vehicle_state_t reference;  // values the display holds after the last frame
+  uint32_t keyframe_interval;
+  uint32_t frames_until_keyframe;
+  bool quantized;  // send schema 5/6 frames instead of 3/4
+  bool fec;        // append Reed-Solomon parity to every frame
+} telemetry_delta_encoder_t;
+
+void telemetry_delta_encoder_init(telemetry_delta_encoder_t* encoder, uint32_t keyframe_interval);
+void telemetry_delta_encoder_force_keyframe(telemetry_delta_encoder_t* encoder);
+
+// Switches between float (schema 3/4) and quantized (schema 5/6) frames. The
+// next frame is a keyframe.
+void telemetry_delta_encoder_set_quantized(telemetry_delta_encoder_t* encoder, bool quantized);
+
+// Adds FEC parity to every following frame; see telemetry_frame_writer_set_fec().
+void telemetry_delta_encoder_set_fec(telemetry_delta_encoder_t* encoder, bool fec);
+
+// Encodes the next full or delta frame including the trailing 0x00 delimiter.
+telemetry_result_t telemetry_delta_encoder_encode_wire(telemetry_delta_encoder_t* encoder,
+                                                       const vehicle_state_t* packet, uint8_t* output,
+                                                       size_t output_capacity, size_t* output_length);
+
+// Like telemetry_delta_encoder_encode_wire(), but only fields in `field_mask`
+// are considered for the delta. Used to send the fast and slow rate groups as
+// separate messages. Keyframes still carry every field.
+telemetry_result_t telemetry_delta_encoder_encode_fields_wire(telemetry_delta_encoder_t* encoder,
+                                                              const vehicle_state_t* packet, uint32_t field_mask,
+                                                              uint8_t* output, size_t output_capacity,
+                                                              size_t* output_length);
+
+// Samples of up to TELEMETRY_BATCH_MAX_CHANNELS channels, oldest first. The
+// hub fills one with telemetry_sample_batch_push() as samples are taken; the
+// display gets the decoded batch from telemetry_decoder_last_batch().
+typedef struct {
+  uint32_t field_mask;  // channels carried; values[i][j] is the j-th set bit
+  uint8_t sample_count;
+  uint32_t timestamp_ms[TELEMETRY_BATCH_MAX_SAMPLES];
+  float values[TELEMETRY_BATCH_MAX_SAMPLES][TELEMETRY_BATCH_MAX_CHANNELS];
+} telemetry_sample_batch_t;
+
+// Starts an empty batch for the channels in `field_mask`, which may have at
+// most TELEMETRY_BATCH_MAX_CHANNELS bits set.
+bool telemetry_sample_batch_init(telemetry_sample_batch_t* batch, uint32_t field_mask);
+
+// Appends one sample taken from `state`. When the batch is full the oldest
+// sample is dropped; a sample more than 65535 ms after the previous one (the
+// largest time step on the wire) starts the batch over.
+void telemetry_sample_batch_push(telemetry_sample_batch_t* batch, uint32_t timestamp_ms,
+                                 const vehicle_state_t* state);
+
+// Encodes `batch` as a schema 7 frame including the trailing 0x00 delimiter.
+// The newest sample becomes the encoder's reference for those channels, so
+// the next delta does not repeat them.
+telemetry_result_t telemetry_delta_encoder_encode_batch_wire(telemetry_delta_encoder_t* encoder,
+                                                             const telemetry_sample_batch_t* batch,
+                                                             uint32_t sequence, uint8_t* output,
+                                                             size_t output_capacity, size_t* output_length);
+
+// One wire field of a decode plan: where its value goes and how to scale it.
+typedef struct {
+  uint16_t offset;  // of the destination float; channels unknown here go to a scratch slot
+  int8_t channel;   // local TELEMETRY_CHANNEL_*, or -1 when unknown here
+  int16_t raw_min;  // quantized range; raw_min is NaN
+  int16_t raw_max;
+  float scale;
+  float value_offset;
+} telemetry_plan_field_t;
+
+typedef struct {
+  uint32_t layout_id;
+  uint32_t field_count;
+  uint32_t missing_mask;  // local channels the hub does not send; full frames set them to NaN
+  telemetry_plan_field_t fields[TELEMETRY_SCHEMA_MAX_FIELDS];
+} telemetry_decode_plan_t;
+
+// Descriptor state of a decoder. `plan` starts as the local layout and is
+// replaced once every descriptor of a different layout has arrived. While one
+// is being collected, data frames are answered with
+// TELEMETRY_RESULT_NEED_KEYFRAME, and the first frame after the switch must be
+// a full frame. A set that makes no progress for
+// TELEMETRY_SCHEMA_PENDING_MAX_FRAMES data frames is dropped. Full frames in
+// a layout other than `plan` are answered the same way until descriptors for
+// it arrive. Fields other than `plan` and the counters are private.
+#define TELEMETRY_SCHEMA_PENDING_MAX_FRAMES 16U
+
+typedef struct {
+  telemetry_decode_plan_t plan;
+  uint32_t plans_built;            // layouts adopted from descriptors
+  uint32_t descriptors;            // valid descriptor frames received
+  uint32_t unknown_channels;       // wire fields in `plan` this build does not know
+  uint32_t announcements_dropped;  // incomplete descriptor sets given up on
+  uint32_t layout_mismatches;      // full frames held back for naming another layout
+
+  telemetry_decode_plan_t pending;
+  uint32_t pending_received;  // bit i: entry i of `pending` has arrived
+  uint32_t pending_frames;    // data frames held back since `pending` last grew
+  uint32_t entry_hashes[TELEMETRY_SCHEMA_MAX_FIELDS];
+  bool need_keyframe;
+} telemetry_schema_cache_t;
+
+// Display-side decoder that accepts full and delta frames. Delta frames are
+// applied over the last decoded state; they are rejected with
+// TELEMETRY_RESULT_NEED_KEYFRAME until the first full frame arrives.
+//
+// Frames with and without FEC parity are both accepted. A frame that fails
+// its CRC is retried as an FEC frame, and up to two corrupted bytes are
+// repaired before the inner CRC is checked.
+//
+// Data frames are decoded through `schema.plan`, which schema 9 descriptors
+// can replace; see telemetry_schema_cache_t.
+typedef struct {
+  vehicle_state_t state;
+  bool has_keyframe;
+  telemetry_schema_cache_t schema;
+  telemetry_sample_batch_t batch;  // samples from the last frame, if it was a batch
+  telemetry_control_t control;     // the last control frame
+  uint32_t fec_corrected_frames;   // accepted frames that needed FEC repair
+} telemetry_decoder_t;
+
+void telemetry_decoder_init(telemetry_decoder_t* decoder);
+
+// On success `packet` receives the complete merged state. Neither `packet` nor
+// the decoder state is modified when a frame is rejected. Control frames
+// return TELEMETRY_RESULT_CONTROL without touching `packet` or the state.
+telemetry_result_t telemetry_decoder_decode(telemetry_decoder_t* decoder, const uint8_t* frame,
+                                            size_t frame_length, vehicle_state_t* packet);
+
+// After a successful decode, returns the samples if that frame was a batch and
+// NULL otherwise. A batch's newest sample is already merged into the state.
+// Stream decoders use this on their `decoder` member.
+const telemetry_sample_batch_t* telemetry_decoder_last_batch(const telemetry_decoder_t* decoder);
+
+// The control frame behind the last TELEMETRY_RESULT_CONTROL.
+const telemetry_control_t* telemetry_decoder_last_control(const telemetry_decoder_t* decoder);
+
+// Streaming receiver for the UART byte stream. Bytes are COBS de-stuffed and
+// run through the CRC as they arrive, so a frame is validated as soon as its
+// 0x00 delimiter is seen, without buffering or rescanning the encoded bytes.
+// Full and delta frames are merged like telemetry_decoder_t. Fields are private
+// to the codec.
+typedef struct {
+  telemetry_decoder_t decoder;
+  uint8_t raw[TELEMETRY_RAW_FRAME_MAX_SIZE];
+  size_t raw_length;
+  size_t encoded_length;
+  uint16_t crc;
+  uint8_t block_remaining;   // data bytes left in the current COBS block
+  bool zero_pending;         // the current block ends with an implied 0x00
+  telemetry_result_t error;  // first error in the current frame, reported at its delimiter
+} telemetry_stream_decoder_t;
+
+void telemetry_stream_decoder_init(telemetry_stream_decoder_t* stream);
+
+// Drops any partially received frame. The keyframe state is kept.
+void telemetry_stream_decoder_reset(telemetry_stream_decoder_t* stream);
+
+// True when bytes of an unfinished frame are buffered.
+bool telemetry_stream_decoder_in_frame(const telemetry_stream_decoder_t* stream);
+
+// Consumes bytes up to and including the next frame delimiter. Returns the
+// result for that frame, with `*consumed` covering its delimiter, or
+// TELEMETRY_RESULT_INCOMPLETE once all `length` bytes are consumed without
+// completing one. Empty frames between delimiters are skipped. `packet` is
+// only written on TELEMETRY_RESULT_OK. Control frames return
+// TELEMETRY_RESULT_CONTROL.
+telemetry_result_t telemetry_stream_decoder_feed(telemetry_stream_decoder_t* stream, const uint8_t* data,
+                                                 size_t length, size_t* consumed, vehicle_state_t* packet);
+
 // CRC-16/CCITT-FALSE: poly=0x1021, init=0xFFFF, xorout=0x0000, refin=false.
 uint16_t telemetry_crc16_ccitt_false(const uint8_t* data, size_t length);
 
+// Continues a CRC-16/CCITT-FALSE computation. Start with TELEMETRY_CRC16_INIT.
+uint16_t telemetry_crc16_ccitt_false_update(uint16_t crc, const uint8_t* data, size_t length);
+
 const char* telemetry_result_name(telemetry_result_t result);
 
 #ifdef __cplusplus
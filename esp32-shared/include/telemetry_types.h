@@ -1,30 +1,61 @@
 #pragma once
 #include <stdint.h>
 
+// Telemetry channels in wire order. This list drives the vehicle_state_t layout,
+// the UART codec, and the display's monitor wiring and CSV columns, so adding a
+// channel is one line here (plus a schema version bump, see docs/protocols.md).
+//
+// X(name, units, deadband, rate, scale, offset, width)
+//   units     physical units, used for CSV headers and documentation
+//   deadband  changes at or below this are left out of delta frames; DAM and
+//             feedback knock send every change because they drive alerts
+//   rate      FAST channels go out every emit period, SLOW ones every
+//             CONFIG_DH_UART_SLOW_PERIOD_MS when multi-rate UART is enabled
+//   scale     quantization step for quantized frames: value = offset + raw * scale
+//   offset    value represented by raw 0
+//   width     I8 or I16, the signed integer range of the quantized value
+//
+// Macros that only need the leading columns can take the rest as `...`.
+//
+// clang-format off
+#define TELEMETRY_CHANNELS(X)                                          \
+  X(water_temp,         "degF",  0.5f,  SLOW, 0.1f,     0.0f, I16)     \
+  X(oil_temp,           "degF",  0.5f,  SLOW, 0.1f,     0.0f, I16)     \
+  X(oil_pressure,       "psi",   0.25f, FAST, 0.01f,    0.0f, I16)     \
+  X(dam,                "ratio", 0.0f,  SLOW, 0.0625f,  0.0f, I8)      \
+  X(af_learned,         "%",     0.1f,  SLOW, 0.01f,    0.0f, I16)     \
+  X(af_ratio,           "afr",   0.05f, FAST, 0.01f,    0.0f, I16)     \
+  X(int_temp,           "degF",  0.5f,  SLOW, 0.1f,     0.0f, I16)     \
+  X(fb_knock,           "deg",   0.0f,  FAST, 0.01f,    0.0f, I16)     \
+  X(af_correct,         "%",     0.1f,  FAST, 0.01f,    0.0f, I16)     \
+  X(inj_duty,           "%",     0.25f, FAST, 0.01f,    0.0f, I16)     \
+  X(eth_conc,           "%",     0.5f,  SLOW, 1.0f,     0.0f, I8)      \
+  X(engine_rpm,         "rpm",   10.0f, FAST, 1.0f,     0.0f, I16)     \
+  X(throttle_pos,       "%",     0.5f,  FAST, 0.01f,    0.0f, I16)     \
+  X(brake_pressure_bar, "bar",   0.5f,  FAST, 0.01f,    0.0f, I16)     \
+  X(steering_angle_deg, "deg",   0.5f,  FAST, 0.1f,     0.0f, I16)     \
+  X(oil_pressure_raw,   "psi",   0.25f, FAST, 0.01f,    0.0f, I16)
+// clang-format on
+
 typedef struct {
   // metadata
   uint32_t sequence;
   uint32_t timestamp_ms;
 
-  // primary
-  float water_temp;
-  float oil_temp;
-  float oil_pressure;      // filtered PSI used by the display and monitoring
-  float oil_pressure_raw;  // calibrated but unfiltered PSI for diagnostics
+  // Channels, all float. oil_pressure is the filtered PSI used by the display and
+  // monitoring; oil_pressure_raw is calibrated but unfiltered for diagnostics.
+#define TELEMETRY_STATE_MEMBER(name, ...) float name;
+  TELEMETRY_CHANNELS(TELEMETRY_STATE_MEMBER)
+#undef TELEMETRY_STATE_MEMBER
+} vehicle_state_t;
 
-  float dam;
-  float af_learned;
-  float af_ratio;
-  float int_temp;
+typedef enum {
+#define TELEMETRY_CHANNEL_ID(name, ...) TELEMETRY_CHANNEL_##name,
+  TELEMETRY_CHANNELS(TELEMETRY_CHANNEL_ID)
+#undef TELEMETRY_CHANNEL_ID
+  TELEMETRY_CHANNEL_COUNT
+} telemetry_channel_t;
 
-  float fb_knock;
-  float af_correct;
-  float inj_duty;
-  float eth_conc;
+typedef enum { TELEMETRY_RATE_FAST, TELEMETRY_RATE_SLOW } telemetry_rate_t;
 
-  // supplemental
-  float engine_rpm;
-  float throttle_pos;
-  float brake_pressure_bar;
-  float steering_angle_deg;
-} vehicle_state_t;
+typedef enum { TELEMETRY_WIDTH_I8, TELEMETRY_WIDTH_I16 } telemetry_width_t;
@@ -0,0 +1,288 @@
+#include "telemetry_link.h"
+
+#include <string.h>
+
+static const uint32_t k_link_rates[TELEMETRY_LINK_RATE_COUNT] = {TELEMETRY_LINK_BASE_BAUD, 921600U, 2000000U};
+
+// Wraparound-safe "now is at or past deadline".
+static inline bool time_reached(uint32_t now_ms, uint32_t deadline_ms) { return (int32_t)(now_ms - deadline_ms) >= 0; }
+
+uint32_t telemetry_link_rate_baud(uint8_t rate_index) {
+  return rate_index < TELEMETRY_LINK_RATE_COUNT ? k_link_rates[rate_index] : 0;
+}
+
+telemetry_link_config_t telemetry_link_default_config(uint32_t max_baud) {
+  const telemetry_link_config_t config = {
+      .max_baud = max_baud,
+      .hello_interval_ms = 1000,
+      .response_timeout_ms = 250,
+      .probe_interval_ms = 50,
+      .probe_timeout_ms = 500,
+      .keepalive_interval_ms = 250,
+      .silence_timeout_ms = 1000,
+      .error_window_ms = 1000,
+      .error_threshold = 5,
+      .retry_backoff_ms = 60000,
+  };
+  return config;
+}
+
+bool telemetry_link_init(telemetry_link_t* link, telemetry_link_role_t role, const telemetry_link_config_t* config,
+                         uint32_t now_ms) {
+  if (link == NULL || config == NULL || config->error_threshold == 0) {
+    return false;
+  }
+
+  memset(link, 0, sizeof(*link));
+  link->config = *config;
+  link->role = role;
+  link->state = TELEMETRY_LINK_STATE_BASE;
+  for (uint8_t i = 0; i < TELEMETRY_LINK_RATE_COUNT; ++i) {
+    if (i == 0 || k_link_rates[i] <= config->max_baud) {
+      link->local_mask |= 1UL << i;
+    }
+  }
+  link->next_send_ms = now_ms;
+  link->last_rx_ms = now_ms;
+  link->window_start_ms = now_ms;
+  return true;
+}
+
+static void queue(telemetry_link_t* link, bool send, uint32_t type, uint32_t value, uint32_t baud) {
+  link->pending.send = send;
+  link->pending.control.type = type;
+  link->pending.control.value = value;
+  link->pending.baud = baud;
+}
+
+// Highest rate both sides support that has not failed recently, or 0.
+static uint8_t hub_candidate(const telemetry_link_t* link) {
+  const uint32_t usable = link->local_mask & link->peer_mask & ~link->excluded_mask;
+  for (uint8_t i = TELEMETRY_LINK_RATE_COUNT - 1; i > 0; --i) {
+    if (usable & (1UL << i)) {
+      return i;
+    }
+  }
+  return 0;
+}
+
+static void enter_rate(telemetry_link_t* link, telemetry_link_state_t state, uint32_t now_ms) {
+  link->state = state;
+  link->last_rx_ms = now_ms;
+  link->window_start_ms = now_ms;
+  link->window_errors = 0;
+}
+
+// Returns to the base rate. `notify` sends FALLBACK first so the other side
+// follows without waiting for its own timeout.
+static void fall_back(telemetry_link_t* link, bool notify, uint32_t now_ms) {
+  if (link->role == TELEMETRY_LINK_ROLE_HUB) {
+    link->excluded_mask |= 1UL << link->rate_index;
+    link->excluded_until_ms = now_ms + link->config.retry_backoff_ms;
+    link->next_send_ms = now_ms + link->config.hello_interval_ms;
+  }
+  queue(link, notify, TELEMETRY_CONTROL_LINK_FALLBACK, link->rate_index, TELEMETRY_LINK_BASE_BAUD);
+  link->rate_index = 0;
+  link->stats.fallbacks++;
+  enter_rate(link, TELEMETRY_LINK_STATE_BASE, now_ms);
+}
+
+static void hub_on_control(telemetry_link_t* link, const telemetry_control_t* control, uint32_t now_ms) {
+  switch (control->type) {
+    case TELEMETRY_CONTROL_LINK_HELLO_ACK:
+      link->peer_seen = true;
+      link->peer_mask = control->value | 1UL;
+      if (link->state == TELEMETRY_LINK_STATE_BASE) {
+        const uint8_t target = hub_candidate(link);
+        if (target > 0) {
+          queue(link, true, TELEMETRY_CONTROL_LINK_SWITCH, target, 0);
+          link->rate_index = target;  // not applied until SWITCH_ACK
+          link->state = TELEMETRY_LINK_STATE_SWITCH_SENT;
+          link->deadline_ms = now_ms + link->config.response_timeout_ms;
+        }
+      }
+      break;
+    case TELEMETRY_CONTROL_LINK_SWITCH_ACK:
+      if (link->state == TELEMETRY_LINK_STATE_SWITCH_SENT && control->value == link->rate_index) {
+        queue(link, false, 0, 0, k_link_rates[link->rate_index]);
+        enter_rate(link, TELEMETRY_LINK_STATE_PROBING, now_ms);
+        link->deadline_ms = now_ms + link->config.probe_timeout_ms;
+        link->next_send_ms = now_ms;
+        link->nonce++;
+      }
+      break;
+    case TELEMETRY_CONTROL_LINK_PROBE_ACK:
+      if (link->state == TELEMETRY_LINK_STATE_PROBING && control->value == link->nonce) {
+        enter_rate(link, TELEMETRY_LINK_STATE_LINKED, now_ms);
+        link->stats.negotiations++;
+      }
+      break;
+    case TELEMETRY_CONTROL_LINK_FALLBACK:
+      if (link->state == TELEMETRY_LINK_STATE_PROBING || link->state == TELEMETRY_LINK_STATE_LINKED) {
+        fall_back(link, false, now_ms);
+      }
+      break;
+    default:
+      break;
+  }
+}
+
+static void display_on_control(telemetry_link_t* link, const telemetry_control_t* control, uint32_t now_ms) {
+  switch (control->type) {
+    case TELEMETRY_CONTROL_LINK_HELLO:
+      queue(link, true, TELEMETRY_CONTROL_LINK_HELLO_ACK, link->local_mask, 0);
+      break;
+    case TELEMETRY_CONTROL_LINK_SWITCH:
+      if (link->state == TELEMETRY_LINK_STATE_BASE && control->value > 0 &&
+          control->value < TELEMETRY_LINK_RATE_COUNT && (link->local_mask & (1UL << control->value))) {
+        link->rate_index = (uint8_t)control->value;
+        queue(link, true, TELEMETRY_CONTROL_LINK_SWITCH_ACK, control->value, k_link_rates[link->rate_index]);
+        enter_rate(link, TELEMETRY_LINK_STATE_PROBING, now_ms);
+        link->deadline_ms = now_ms + link->config.probe_timeout_ms;
+      }
+      break;
+    case TELEMETRY_CONTROL_LINK_PROBE:
+      if (link->state == TELEMETRY_LINK_STATE_PROBING || link->state == TELEMETRY_LINK_STATE_LINKED) {
+        queue(link, true, TELEMETRY_CONTROL_LINK_PROBE_ACK, control->value, 0);
+        if (link->state == TELEMETRY_LINK_STATE_PROBING) {
+          enter_rate(link, TELEMETRY_LINK_STATE_LINKED, now_ms);
+          link->next_send_ms = now_ms + link->config.keepalive_interval_ms;
+          link->stats.negotiations++;
+        }
+      }
+      break;
+    case TELEMETRY_CONTROL_LINK_FALLBACK:
+      if (link->state == TELEMETRY_LINK_STATE_PROBING || link->state == TELEMETRY_LINK_STATE_LINKED) {
+        fall_back(link, false, now_ms);
+      }
+      break;
+    default:
+      break;
+  }
+}
+
+void telemetry_link_on_control(telemetry_link_t* link, const telemetry_control_t* control, uint32_t now_ms) {
+  if (link == NULL || control == NULL) {
+    return;
+  }
+  link->last_rx_ms = now_ms;
+  if (link->role == TELEMETRY_LINK_ROLE_HUB) {
+    hub_on_control(link, control, now_ms);
+  } else {
+    display_on_control(link, control, now_ms);
+  }
+}
+
+void telemetry_link_on_frame(telemetry_link_t* link, telemetry_result_t result, uint32_t now_ms) {
+  if (link == NULL || result == TELEMETRY_RESULT_INCOMPLETE) {
+    return;
+  }
+  if (result == TELEMETRY_RESULT_OK || result == TELEMETRY_RESULT_NEED_KEYFRAME ||
+      result == TELEMETRY_RESULT_CONTROL || result == TELEMETRY_RESULT_DESCRIPTOR) {
+    link->last_rx_ms = now_ms;
+    return;
+  }
+
+  link->stats.bad_frames++;
+  if (link->state != TELEMETRY_LINK_STATE_PROBING && link->state != TELEMETRY_LINK_STATE_LINKED) {
+    return;
+  }
+  if (time_reached(now_ms, link->window_start_ms + link->config.error_window_ms)) {
+    link->window_start_ms = now_ms;
+    link->window_errors = 0;
+  }
+  if (++link->window_errors >= link->config.error_threshold) {
+    fall_back(link, true, now_ms);
+  }
+}
+
+static void hub_poll(telemetry_link_t* link, uint32_t now_ms) {
+  if (link->excluded_mask != 0 && time_reached(now_ms, link->excluded_until_ms)) {
+    link->excluded_mask = 0;
+  }
+
+  switch (link->state) {
+    case TELEMETRY_LINK_STATE_BASE:
+      // Keep offering while the display is unknown or a faster rate remains.
+      if ((!link->peer_seen || hub_candidate(link) > 0) && time_reached(now_ms, link->next_send_ms)) {
+        queue(link, true, TELEMETRY_CONTROL_LINK_HELLO, link->local_mask, 0);
+        link->next_send_ms = now_ms + link->config.hello_interval_ms;
+      }
+      break;
+    case TELEMETRY_LINK_STATE_SWITCH_SENT:
+      if (time_reached(now_ms, link->deadline_ms)) {
+        link->rate_index = 0;
+        link->state = TELEMETRY_LINK_STATE_BASE;
+      }
+      break;
+    case TELEMETRY_LINK_STATE_PROBING:
+      if (time_reached(now_ms, link->deadline_ms)) {
+        fall_back(link, true, now_ms);
+      } else if (time_reached(now_ms, link->next_send_ms)) {
+        queue(link, true, TELEMETRY_CONTROL_LINK_PROBE, link->nonce, 0);
+        link->next_send_ms = now_ms + link->config.probe_interval_ms;
+      }
+      break;
+    case TELEMETRY_LINK_STATE_LINKED:
+      if (time_reached(now_ms, link->last_rx_ms + link->config.silence_timeout_ms)) {
+        fall_back(link, true, now_ms);
+      }
+      break;
+  }
+}
+
+static void display_poll(telemetry_link_t* link, uint32_t now_ms) {
+  switch (link->state) {
+    case TELEMETRY_LINK_STATE_PROBING:
+      if (time_reached(now_ms, link->deadline_ms)) {
+        fall_back(link, true, now_ms);
+      }
+      break;
+    case TELEMETRY_LINK_STATE_LINKED:
+      if (time_reached(now_ms, link->last_rx_ms + link->config.silence_timeout_ms)) {
+        fall_back(link, true, now_ms);
+      } else if (time_reached(now_ms, link->next_send_ms)) {
+        queue(link, true, TELEMETRY_CONTROL_LINK_KEEPALIVE, 0, 0);
+        link->next_send_ms = now_ms + link->config.keepalive_interval_ms;
+      }
+      break;
+    default:
+      break;
+  }
+}
+
+bool telemetry_link_poll(telemetry_link_t* link, uint32_t now_ms, telemetry_link_action_t* action) {
+  if (link == NULL || action == NULL) {
+    return false;
+  }
+
+  if (!link->pending.send && link->pending.baud == 0) {
+    if (link->role == TELEMETRY_LINK_ROLE_HUB) {
+      hub_poll(link, now_ms);
+    } else {
+      display_poll(link, now_ms);
+    }
+  }
+  if (!link->pending.send && link->pending.baud == 0) {
+    return false;
+  }
+
+  *action = link->pending;
+  memset(&link->pending, 0, sizeof(link->pending));
+  return true;
+}
+
+uint32_t telemetry_link_baud(const telemetry_link_t* link) {
+  if (link == NULL || link->state == TELEMETRY_LINK_STATE_SWITCH_SENT) {
+    return TELEMETRY_LINK_BASE_BAUD;
+  }
+  return k_link_rates[link->rate_index];
+}
+
+telemetry_link_state_t telemetry_link_state(const telemetry_link_t* link) {
+  return link != NULL ? link->state : TELEMETRY_LINK_STATE_BASE;
+}
+
+const telemetry_link_stats_t* telemetry_link_stats(const telemetry_link_t* link) {
+  return link != NULL ? &link->stats : NULL;
+}
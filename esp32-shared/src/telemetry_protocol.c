@@ -1,35 +1,408 @@
 #include "telemetry_protocol.h"
 
+#include <math.h>
+#include <stddef.h>
 #include <string.h>
 
 #include "cobs.h"
 #include "mpack.h"
 
-static telemetry_result_t encode_msgpack(const vehicle_state_t* packet, uint8_t* output,
+// CRC-16/CCITT-FALSE lookup table for polynomial 0x1021, one entry per
+// possible high byte of (crc ^ input).
+static const uint16_t k_crc16_ccitt_false_table[256] = {
+    0x0000U, 0x1021U, 0x2042U, 0x3063U, 0x4084U, 0x50A5U, 0x60C6U, 0x70E7U,
+    0x8108U, 0x9129U, 0xA14AU, 0xB16BU, 0xC18CU, 0xD1ADU, 0xE1CEU, 0xF1EFU,
+    0x1231U, 0x0210U, 0x3273U, 0x2252U, 0x52B5U, 0x4294U, 0x72F7U, 0x62D6U,
+    0x9339U, 0x8318U, 0xB37BU, 0xA35AU, 0xD3BDU, 0xC39CU, 0xF3FFU, 0xE3DEU,
+    0x2462U, 0x3443U, 0x0420U, 0x1401U, 0x64E6U, 0x74C7U, 0x44A4U, 0x5485U,
+    0xA56AU, 0xB54BU, 0x8528U, 0x9509U, 0xE5EEU, 0xF5CFU, 0xC5ACU, 0xD58DU,
+    0x3653U, 0x2672U, 0x1611U, 0x0630U, 0x76D7U, 0x66F6U, 0x5695U, 0x46B4U,
+    0xB75BU, 0xA77AU, 0x9719U, 0x8738U, 0xF7DFU, 0xE7FEU, 0xD79DU, 0xC7BCU,
+    0x48C4U, 0x58E5U, 0x6886U, 0x78A7U, 0x0840U, 0x1861U, 0x2802U, 0x3823U,
+    0xC9CCU, 0xD9EDU, 0xE98EU, 0xF9AFU, 0x8948U, 0x9969U, 0xA90AU, 0xB92BU,
+    0x5AF5U, 0x4AD4U, 0x7AB7U, 0x6A96U, 0x1A71U, 0x0A50U, 0x3A33U, 0x2A12U,
+    0xDBFDU, 0xCBDCU, 0xFBBFU, 0xEB9EU, 0x9B79U, 0x8B58U, 0xBB3BU, 0xAB1AU,
+    0x6CA6U, 0x7C87U, 0x4CE4U, 0x5CC5U, 0x2C22U, 0x3C03U, 0x0C60U, 0x1C41U,
+    0xEDAEU, 0xFD8FU, 0xCDECU, 0xDDCDU, 0xAD2AU, 0xBD0BU, 0x8D68U, 0x9D49U,
+    0x7E97U, 0x6EB6U, 0x5ED5U, 0x4EF4U, 0x3E13U, 0x2E32U, 0x1E51U, 0x0E70U,
+    0xFF9FU, 0xEFBEU, 0xDFDDU, 0xCFFCU, 0xBF1BU, 0xAF3AU, 0x9F59U, 0x8F78U,
+    0x9188U, 0x81A9U, 0xB1CAU, 0xA1EBU, 0xD10CU, 0xC12DU, 0xF14EU, 0xE16FU,
+    0x1080U, 0x00A1U, 0x30C2U, 0x20E3U, 0x5004U, 0x4025U, 0x7046U, 0x6067U,
+    0x83B9U, 0x9398U, 0xA3FBU, 0xB3DAU, 0xC33DU, 0xD31CU, 0xE37FU, 0xF35EU,
+    0x02B1U, 0x1290U, 0x22F3U, 0x32D2U, 0x4235U, 0x5214U, 0x6277U, 0x7256U,
+    0xB5EAU, 0xA5CBU, 0x95A8U, 0x8589U, 0xF56EU, 0xE54FU, 0xD52CU, 0xC50DU,
+    0x34E2U, 0x24C3U, 0x14A0U, 0x0481U, 0x7466U, 0x6447U, 0x5424U, 0x4405U,
+    0xA7DBU, 0xB7FAU, 0x8799U, 0x97B8U, 0xE75FU, 0xF77EU, 0xC71DU, 0xD73CU,
+    0x26D3U, 0x36F2U, 0x0691U, 0x16B0U, 0x6657U, 0x7676U, 0x4615U, 0x5634U,
+    0xD94CU, 0xC96DU, 0xF90EU, 0xE92FU, 0x99C8U, 0x89E9U, 0xB98AU, 0xA9ABU,
+    0x5844U, 0x4865U, 0x7806U, 0x6827U, 0x18C0U, 0x08E1U, 0x3882U, 0x28A3U,
+    0xCB7DU, 0xDB5CU, 0xEB3FU, 0xFB1EU, 0x8BF9U, 0x9BD8U, 0xABBBU, 0xBB9AU,
+    0x4A75U, 0x5A54U, 0x6A37U, 0x7A16U, 0x0AF1U, 0x1AD0U, 0x2AB3U, 0x3A92U,
+    0xFD2EU, 0xED0FU, 0xDD6CU, 0xCD4DU, 0xBDAAU, 0xAD8BU, 0x9DE8U, 0x8DC9U,
+    0x7C26U, 0x6C07U, 0x5C64U, 0x4C45U, 0x3CA2U, 0x2C83U, 0x1CE0U, 0x0CC1U,
+    0xEF1FU, 0xFF3EU, 0xCF5DU, 0xDF7CU, 0xAF9BU, 0xBFBAU, 0x8FD9U, 0x9FF8U,
+    0x6E17U, 0x7E36U, 0x4E55U, 0x5E74U, 0x2E93U, 0x3EB2U, 0x0ED1U, 0x1EF0U,
+};
+
+static inline uint16_t crc16_ccitt_false_step(uint16_t crc, uint8_t byte) {
+  return (uint16_t)((crc << 8) ^ k_crc16_ccitt_false_table[(uint8_t)((crc >> 8) ^ byte)]);
+}
+
+// Reed-Solomon FEC over GF(2^8) with field polynomial 0x11D. The parity bytes
+// are the remainder of the frame divided by the generator
+// (x - 1)(x - a)(x - a^2)(x - a^3), so any two byte errors can be corrected.
+// k_gf_exp repeats after 255 entries so a sum of two logs needs no modulo.
+static const uint8_t k_gf_exp[512] = {
+    0x01U, 0x02U, 0x04U, 0x08U, 0x10U, 0x20U, 0x40U, 0x80U, 0x1DU, 0x3AU, 0x74U, 0xE8U, 0xCDU, 0x87U, 0x13U, 0x26U,
+    0x4CU, 0x98U, 0x2DU, 0x5AU, 0xB4U, 0x75U, 0xEAU, 0xC9U, 0x8FU, 0x03U, 0x06U, 0x0CU, 0x18U, 0x30U, 0x60U, 0xC0U,
+    0x9DU, 0x27U, 0x4EU, 0x9CU, 0x25U, 0x4AU, 0x94U, 0x35U, 0x6AU, 0xD4U, 0xB5U, 0x77U, 0xEEU, 0xC1U, 0x9FU, 0x23U,
+    0x46U, 0x8CU, 0x05U, 0x0AU, 0x14U, 0x28U, 0x50U, 0xA0U, 0x5DU, 0xBAU, 0x69U, 0xD2U, 0xB9U, 0x6FU, 0xDEU, 0xA1U,
+    0x5FU, 0xBEU, 0x61U, 0xC2U, 0x99U, 0x2FU, 0x5EU, 0xBCU, 0x65U, 0xCAU, 0x89U, 0x0FU, 0x1EU, 0x3CU, 0x78U, 0xF0U,
+    0xFDU, 0xE7U, 0xD3U, 0xBBU, 0x6BU, 0xD6U, 0xB1U, 0x7FU, 0xFEU, 0xE1U, 0xDFU, 0xA3U, 0x5BU, 0xB6U, 0x71U, 0xE2U,
+    0xD9U, 0xAFU, 0x43U, 0x86U, 0x11U, 0x22U, 0x44U, 0x88U, 0x0DU, 0x1AU, 0x34U, 0x68U, 0xD0U, 0xBDU, 0x67U, 0xCEU,
+    0x81U, 0x1FU, 0x3EU, 0x7CU, 0xF8U, 0xEDU, 0xC7U, 0x93U, 0x3BU, 0x76U, 0xECU, 0xC5U, 0x97U, 0x33U, 0x66U, 0xCCU,
+    0x85U, 0x17U, 0x2EU, 0x5CU, 0xB8U, 0x6DU, 0xDAU, 0xA9U, 0x4FU, 0x9EU, 0x21U, 0x42U, 0x84U, 0x15U, 0x2AU, 0x54U,
+    0xA8U, 0x4DU, 0x9AU, 0x29U, 0x52U, 0xA4U, 0x55U, 0xAAU, 0x49U, 0x92U, 0x39U, 0x72U, 0xE4U, 0xD5U, 0xB7U, 0x73U,
+    0xE6U, 0xD1U, 0xBFU, 0x63U, 0xC6U, 0x91U, 0x3FU, 0x7EU, 0xFCU, 0xE5U, 0xD7U, 0xB3U, 0x7BU, 0xF6U, 0xF1U, 0xFFU,
+    0xE3U, 0xDBU, 0xABU, 0x4BU, 0x96U, 0x31U, 0x62U, 0xC4U, 0x95U, 0x37U, 0x6EU, 0xDCU, 0xA5U, 0x57U, 0xAEU, 0x41U,
+    0x82U, 0x19U, 0x32U, 0x64U, 0xC8U, 0x8DU, 0x07U, 0x0EU, 0x1CU, 0x38U, 0x70U, 0xE0U, 0xDDU, 0xA7U, 0x53U, 0xA6U,
+    0x51U, 0xA2U, 0x59U, 0xB2U, 0x79U, 0xF2U, 0xF9U, 0xEFU, 0xC3U, 0x9BU, 0x2BU, 0x56U, 0xACU, 0x45U, 0x8AU, 0x09U,
+    0x12U, 0x24U, 0x48U, 0x90U, 0x3DU, 0x7AU, 0xF4U, 0xF5U, 0xF7U, 0xF3U, 0xFBU, 0xEBU, 0xCBU, 0x8BU, 0x0BU, 0x16U,
+    0x2CU, 0x58U, 0xB0U, 0x7DU, 0xFAU, 0xE9U, 0xCFU, 0x83U, 0x1BU, 0x36U, 0x6CU, 0xD8U, 0xADU, 0x47U, 0x8EU, 0x01U,
+    0x02U, 0x04U, 0x08U, 0x10U, 0x20U, 0x40U, 0x80U, 0x1DU, 0x3AU, 0x74U, 0xE8U, 0xCDU, 0x87U, 0x13U, 0x26U, 0x4CU,
+    0x98U, 0x2DU, 0x5AU, 0xB4U, 0x75U, 0xEAU, 0xC9U, 0x8FU, 0x03U, 0x06U, 0x0CU, 0x18U, 0x30U, 0x60U, 0xC0U, 0x9DU,
+    0x27U, 0x4EU, 0x9CU, 0x25U, 0x4AU, 0x94U, 0x35U, 0x6AU, 0xD4U, 0xB5U, 0x77U, 0xEEU, 0xC1U, 0x9FU, 0x23U, 0x46U,
+    0x8CU, 0x05U, 0x0AU, 0x14U, 0x28U, 0x50U, 0xA0U, 0x5DU, 0xBAU, 0x69U, 0xD2U, 0xB9U, 0x6FU, 0xDEU, 0xA1U, 0x5FU,
+    0xBEU, 0x61U, 0xC2U, 0x99U, 0x2FU, 0x5EU, 0xBCU, 0x65U, 0xCAU, 0x89U, 0x0FU, 0x1EU, 0x3CU, 0x78U, 0xF0U, 0xFDU,
+    0xE7U, 0xD3U, 0xBBU, 0x6BU, 0xD6U, 0xB1U, 0x7FU, 0xFEU, 0xE1U, 0xDFU, 0xA3U, 0x5BU, 0xB6U, 0x71U, 0xE2U, 0xD9U,
+    0xAFU, 0x43U, 0x86U, 0x11U, 0x22U, 0x44U, 0x88U, 0x0DU, 0x1AU, 0x34U, 0x68U, 0xD0U, 0xBDU, 0x67U, 0xCEU, 0x81U,
+    0x1FU, 0x3EU, 0x7CU, 0xF8U, 0xEDU, 0xC7U, 0x93U, 0x3BU, 0x76U, 0xECU, 0xC5U, 0x97U, 0x33U, 0x66U, 0xCCU, 0x85U,
+    0x17U, 0x2EU, 0x5CU, 0xB8U, 0x6DU, 0xDAU, 0xA9U, 0x4FU, 0x9EU, 0x21U, 0x42U, 0x84U, 0x15U, 0x2AU, 0x54U, 0xA8U,
+    0x4DU, 0x9AU, 0x29U, 0x52U, 0xA4U, 0x55U, 0xAAU, 0x49U, 0x92U, 0x39U, 0x72U, 0xE4U, 0xD5U, 0xB7U, 0x73U, 0xE6U,
+    0xD1U, 0xBFU, 0x63U, 0xC6U, 0x91U, 0x3FU, 0x7EU, 0xFCU, 0xE5U, 0xD7U, 0xB3U, 0x7BU, 0xF6U, 0xF1U, 0xFFU, 0xE3U,
+    0xDBU, 0xABU, 0x4BU, 0x96U, 0x31U, 0x62U, 0xC4U, 0x95U, 0x37U, 0x6EU, 0xDCU, 0xA5U, 0x57U, 0xAEU, 0x41U, 0x82U,
+    0x19U, 0x32U, 0x64U, 0xC8U, 0x8DU, 0x07U, 0x0EU, 0x1CU, 0x38U, 0x70U, 0xE0U, 0xDDU, 0xA7U, 0x53U, 0xA6U, 0x51U,
+    0xA2U, 0x59U, 0xB2U, 0x79U, 0xF2U, 0xF9U, 0xEFU, 0xC3U, 0x9BU, 0x2BU, 0x56U, 0xACU, 0x45U, 0x8AU, 0x09U, 0x12U,
+    0x24U, 0x48U, 0x90U, 0x3DU, 0x7AU, 0xF4U, 0xF5U, 0xF7U, 0xF3U, 0xFBU, 0xEBU, 0xCBU, 0x8BU, 0x0BU, 0x16U, 0x2CU,
+    0x58U, 0xB0U, 0x7DU, 0xFAU, 0xE9U, 0xCFU, 0x83U, 0x1BU, 0x36U, 0x6CU, 0xD8U, 0xADU, 0x47U, 0x8EU, 0x01U, 0x02U,
+};
+
+static const uint8_t k_gf_log[256] = {
+    0x00U, 0x00U, 0x01U, 0x19U, 0x02U, 0x32U, 0x1AU, 0xC6U, 0x03U, 0xDFU, 0x33U, 0xEEU, 0x1BU, 0x68U, 0xC7U, 0x4BU,
+    0x04U, 0x64U, 0xE0U, 0x0EU, 0x34U, 0x8DU, 0xEFU, 0x81U, 0x1CU, 0xC1U, 0x69U, 0xF8U, 0xC8U, 0x08U, 0x4CU, 0x71U,
+    0x05U, 0x8AU, 0x65U, 0x2FU, 0xE1U, 0x24U, 0x0FU, 0x21U, 0x35U, 0x93U, 0x8EU, 0xDAU, 0xF0U, 0x12U, 0x82U, 0x45U,
+    0x1DU, 0xB5U, 0xC2U, 0x7DU, 0x6AU, 0x27U, 0xF9U, 0xB9U, 0xC9U, 0x9AU, 0x09U, 0x78U, 0x4DU, 0xE4U, 0x72U, 0xA6U,
+    0x06U, 0xBFU, 0x8BU, 0x62U, 0x66U, 0xDDU, 0x30U, 0xFDU, 0xE2U, 0x98U, 0x25U, 0xB3U, 0x10U, 0x91U, 0x22U, 0x88U,
+    0x36U, 0xD0U, 0x94U, 0xCEU, 0x8FU, 0x96U, 0xDBU, 0xBDU, 0xF1U, 0xD2U, 0x13U, 0x5CU, 0x83U, 0x38U, 0x46U, 0x40U,
+    0x1EU, 0x42U, 0xB6U, 0xA3U, 0xC3U, 0x48U, 0x7EU, 0x6EU, 0x6BU, 0x3AU, 0x28U, 0x54U, 0xFAU, 0x85U, 0xBAU, 0x3DU,
+    0xCAU, 0x5EU, 0x9BU, 0x9FU, 0x0AU, 0x15U, 0x79U, 0x2BU, 0x4EU, 0xD4U, 0xE5U, 0xACU, 0x73U, 0xF3U, 0xA7U, 0x57U,
+    0x07U, 0x70U, 0xC0U, 0xF7U, 0x8CU, 0x80U, 0x63U, 0x0DU, 0x67U, 0x4AU, 0xDEU, 0xEDU, 0x31U, 0xC5U, 0xFEU, 0x18U,
+    0xE3U, 0xA5U, 0x99U, 0x77U, 0x26U, 0xB8U, 0xB4U, 0x7CU, 0x11U, 0x44U, 0x92U, 0xD9U, 0x23U, 0x20U, 0x89U, 0x2EU,
+    0x37U, 0x3FU, 0xD1U, 0x5BU, 0x95U, 0xBCU, 0xCFU, 0xCDU, 0x90U, 0x87U, 0x97U, 0xB2U, 0xDCU, 0xFCU, 0xBEU, 0x61U,
+    0xF2U, 0x56U, 0xD3U, 0xABU, 0x14U, 0x2AU, 0x5DU, 0x9EU, 0x84U, 0x3CU, 0x39U, 0x53U, 0x47U, 0x6DU, 0x41U, 0xA2U,
+    0x1FU, 0x2DU, 0x43U, 0xD8U, 0xB7U, 0x7BU, 0xA4U, 0x76U, 0xC4U, 0x17U, 0x49U, 0xECU, 0x7FU, 0x0CU, 0x6FU, 0xF6U,
+    0x6CU, 0xA1U, 0x3BU, 0x52U, 0x29U, 0x9DU, 0x55U, 0xAAU, 0xFBU, 0x60U, 0x86U, 0xB1U, 0xBBU, 0xCCU, 0x3EU, 0x5AU,
+    0xCBU, 0x59U, 0x5FU, 0xB0U, 0x9CU, 0xA9U, 0xA0U, 0x51U, 0x0BU, 0xF5U, 0x16U, 0xEBU, 0x7AU, 0x75U, 0x2CU, 0xD7U,
+    0x4FU, 0xAEU, 0xD5U, 0xE9U, 0xE6U, 0xE7U, 0xADU, 0xE8U, 0x74U, 0xD6U, 0xF4U, 0xEAU, 0xA8U, 0x50U, 0x58U, 0xAFU,
+};
+
+// Generator coefficients below the leading x^4 term, highest power first.
+static const uint8_t k_fec_generator[TELEMETRY_FEC_PARITY_SIZE] = {0x0FU, 0x36U, 0x78U, 0x40U};
+
+static inline uint8_t gf_mul(uint8_t a, uint8_t b) {
+  return a == 0 || b == 0 ? 0 : k_gf_exp[k_gf_log[a] + k_gf_log[b]];
+}
+
+static inline uint8_t gf_div(uint8_t a, uint8_t b) {
+  return a == 0 ? 0 : k_gf_exp[k_gf_log[a] + 255U - k_gf_log[b]];
+}
+
+// a^(log * power), for evaluating a polynomial at a fixed point.
+static inline uint8_t gf_pow(unsigned log, unsigned power) { return k_gf_exp[(log * power) % 255U]; }
+
+// One step of the systematic encoder's division LFSR.
+static inline void fec_encode_step(uint8_t* parity, uint8_t byte) {
+  const uint8_t feedback = byte ^ parity[0];
+  parity[0] = parity[1] ^ gf_mul(feedback, k_fec_generator[0]);
+  parity[1] = parity[2] ^ gf_mul(feedback, k_fec_generator[1]);
+  parity[2] = parity[3] ^ gf_mul(feedback, k_fec_generator[2]);
+  parity[3] = gf_mul(feedback, k_fec_generator[3]);
+}
+
+// Corrects up to two byte errors in `codeword` (data followed by parity) in
+// place. Returns the number of bytes repaired, or -1 when the errors are beyond
+// repair. Byte j is the coefficient of x^(length - 1 - j).
+static int fec_correct(uint8_t* codeword, size_t length) {
+  uint8_t syndromes[TELEMETRY_FEC_PARITY_SIZE];
+  bool clean = true;
+  for (unsigned i = 0; i < TELEMETRY_FEC_PARITY_SIZE; ++i) {
+    uint8_t s = 0;
+    for (size_t j = 0; j < length; ++j) {
+      s = gf_mul(s, k_gf_exp[i]) ^ codeword[j];
+    }
+    syndromes[i] = s;
+    clean = clean && s == 0;
+  }
+  if (clean) {
+    return 0;
+  }
+
+  // Berlekamp-Massey: shortest error locator lambda(x) matching the syndromes.
+  uint8_t lambda[TELEMETRY_FEC_PARITY_SIZE + 1] = {1};
+  uint8_t previous[TELEMETRY_FEC_PARITY_SIZE + 1] = {1};
+  unsigned errors = 0;
+  unsigned shift = 1;
+  uint8_t previous_discrepancy = 1;
+  for (unsigned r = 0; r < TELEMETRY_FEC_PARITY_SIZE; ++r) {
+    uint8_t discrepancy = syndromes[r];
+    for (unsigned i = 1; i <= errors; ++i) {
+      discrepancy ^= gf_mul(lambda[i], syndromes[r - i]);
+    }
+    if (discrepancy == 0) {
+      shift++;
+      continue;
+    }
+    uint8_t saved[TELEMETRY_FEC_PARITY_SIZE + 1];
+    memcpy(saved, lambda, sizeof(saved));
+    const uint8_t factor = gf_div(discrepancy, previous_discrepancy);
+    for (unsigned i = 0; i + shift <= TELEMETRY_FEC_PARITY_SIZE; ++i) {
+      lambda[i + shift] ^= gf_mul(factor, previous[i]);
+    }
+    if (2U * errors <= r) {
+      errors = r + 1U - errors;
+      memcpy(previous, saved, sizeof(previous));
+      previous_discrepancy = discrepancy;
+      shift = 1;
+    } else {
+      shift++;
+    }
+  }
+  if (errors > TELEMETRY_FEC_PARITY_SIZE / 2U) {
+    return -1;
+  }
+  for (unsigned i = errors + 1U; i <= TELEMETRY_FEC_PARITY_SIZE; ++i) {
+    if (lambda[i] != 0) {
+      return -1;
+    }
+  }
+
+  // Error evaluator omega(x) = S(x) * lambda(x) mod x^4.
+  uint8_t omega[TELEMETRY_FEC_PARITY_SIZE] = {0};
+  for (unsigned i = 0; i < TELEMETRY_FEC_PARITY_SIZE; ++i) {
+    for (unsigned j = 0; j <= i && j <= errors; ++j) {
+      omega[i] ^= gf_mul(syndromes[i - j], lambda[j]);
+    }
+  }
+
+  // Chien search for the roots X^-1 of lambda, then Forney for each magnitude:
+  // e = X * omega(X^-1) / lambda'(X^-1). With at most two errors lambda' is
+  // just lambda[1].
+  size_t positions[TELEMETRY_FEC_PARITY_SIZE / 2U];
+  uint8_t magnitudes[TELEMETRY_FEC_PARITY_SIZE / 2U];
+  unsigned found = 0;
+  for (size_t j = 0; j < length; ++j) {
+    const unsigned power = (unsigned)(length - 1U - j);
+    const unsigned inverse_log = (255U - power) % 255U;
+    uint8_t value = lambda[0];
+    for (unsigned i = 1; i <= errors; ++i) {
+      value ^= gf_mul(lambda[i], gf_pow(inverse_log, i));
+    }
+    if (value != 0) {
+      continue;
+    }
+    if (found == errors || lambda[1] == 0) {
+      return -1;
+    }
+    uint8_t evaluated = 0;
+    for (unsigned i = 0; i < TELEMETRY_FEC_PARITY_SIZE; ++i) {
+      evaluated ^= gf_mul(omega[i], gf_pow(inverse_log, i));
+    }
+    positions[found] = j;
+    magnitudes[found] = gf_mul(k_gf_exp[power], gf_div(evaluated, lambda[1]));
+    found++;
+  }
+  if (found != errors) {
+    return -1;
+  }
+
+  for (unsigned i = 0; i < found; ++i) {
+    codeword[positions[i]] ^= magnitudes[i];
+  }
+  return (int)found;
+}
+
+typedef struct {
+  size_t offset;
+  float deadband;  // changes at or below this are not sent in delta frames
+  float scale;     // quantized frames: value = value_offset + raw * scale
+  float value_offset;
+  int32_t raw_min;  // reserved for NaN; real values use raw_min + 1 .. raw_max
+  int32_t raw_max;
+} float_field_t;
+
+_Static_assert(TELEMETRY_CHANNEL_COUNT == TELEMETRY_FLOAT_FIELD_COUNT,
+               "TELEMETRY_FLOAT_FIELD_COUNT must match TELEMETRY_CHANNELS");
+
+#define RAW_MIN_I8 INT8_MIN
+#define RAW_MAX_I8 INT8_MAX
+#define RAW_MIN_I16 INT16_MIN
+#define RAW_MAX_I16 INT16_MAX
+
+// Float fields in wire order, generated from TELEMETRY_CHANNELS. Bit i of a
+// delta frame's field mask refers to entry i.
+static const float_field_t k_float_fields[TELEMETRY_FLOAT_FIELD_COUNT] = {
+#define FLOAT_FIELD_ENTRY(name, units, deadband, rate, scale, value_offset, width) \
+  {offsetof(vehicle_state_t, name), deadband, scale, value_offset, RAW_MIN_##width, RAW_MAX_##width},
+    TELEMETRY_CHANNELS(FLOAT_FIELD_ENTRY)
+#undef FLOAT_FIELD_ENTRY
+};
+
+// The local layout as announced in schema 9 descriptors.
+static const telemetry_descriptor_t k_local_descriptors[TELEMETRY_FLOAT_FIELD_COUNT] = {
+#define LOCAL_DESCRIPTOR_ENTRY(name, units, deadband, rate, scale, value_offset, width) \
+  {#name, TELEMETRY_WIDTH_##width, scale, value_offset},
+    TELEMETRY_CHANNELS(LOCAL_DESCRIPTOR_ENTRY)
+#undef LOCAL_DESCRIPTOR_ENTRY
+};
+
+// Decode destination. Plan fields for channels this build does not know point
+// at `discard`, so every wire field is stored the same way.
+typedef struct {
+  vehicle_state_t state;
+  float discard;
+} decode_target_t;
+
+// Plan for the local layout, used until descriptors announce another one. Its
+// layout_id is filled in by telemetry_decoder_init().
+static const telemetry_decode_plan_t k_local_plan = {
+    .field_count = TELEMETRY_FLOAT_FIELD_COUNT,
+    .fields =
+        {
+#define LOCAL_PLAN_ENTRY(name, units, deadband, rate, scale, value_offset, width)                          \
+  {offsetof(decode_target_t, state.name), TELEMETRY_CHANNEL_##name, RAW_MIN_##width, RAW_MAX_##width, scale, \
+   value_offset},
+            TELEMETRY_CHANNELS(LOCAL_PLAN_ENTRY)
+#undef LOCAL_PLAN_ENTRY
+        },
+};
+
+static inline float* float_field(vehicle_state_t* packet, size_t index) {
+  return (float*)((uint8_t*)packet + k_float_fields[index].offset);
+}
+
+static inline float float_field_value(const vehicle_state_t* packet, size_t index) {
+  return *(const float*)((const uint8_t*)packet + k_float_fields[index].offset);
+}
+
+// Rounds to the nearest step and saturates to the field's integer range. NaN
+// maps to the reserved raw_min so it survives a round trip.
+static int32_t quantize_field(size_t index, float value) {
+  const float_field_t* field = &k_float_fields[index];
+  if (isnan(value)) {
+    return field->raw_min;
+  }
+  const float steps = roundf((value - field->value_offset) / field->scale);
+  if (!(steps > (float)field->raw_min)) {
+    return field->raw_min + 1;
+  }
+  if (steps > (float)field->raw_max) {
+    return field->raw_max;
+  }
+  return (int32_t)steps;
+}
+
+static float dequantize_field(size_t index, int32_t raw) {
+  const float_field_t* field = &k_float_fields[index];
+  if (raw == field->raw_min) {
+    return NAN;
+  }
+  return field->value_offset + (float)raw * field->scale;
+}
+
+static inline void write_field(mpack_writer_t* writer, const vehicle_state_t* packet, size_t index,
+                               bool quantized) {
+  if (quantized) {
+    mpack_write_int(writer, quantize_field(index, float_field_value(packet, index)));
+  } else {
+    mpack_write_float(writer, float_field_value(packet, index));
+  }
+}
+
+static inline uint32_t plan_mask(const telemetry_decode_plan_t* plan) {
+  return plan->field_count >= 32U ? UINT32_MAX : (uint32_t)((1UL << plan->field_count) - 1UL);
+}
+
+static inline void store_field(decode_target_t* target, const telemetry_plan_field_t* field, float value) {
+  *(float*)((uint8_t*)target + field->offset) = value;
+}
+
+static inline float plan_dequantize(const telemetry_plan_field_t* field, int32_t raw) {
+  return raw == field->raw_min ? NAN : field->value_offset + (float)raw * field->scale;
+}
+
+static inline float read_plan_value(mpack_reader_t* reader, const telemetry_plan_field_t* field, bool quantized) {
+  if (!quantized) {
+    return mpack_expect_float_strict(reader);
+  }
+  return plan_dequantize(field, mpack_expect_int_range(reader, field->raw_min, field->raw_max));
+}
+
+static telemetry_result_t encode_msgpack(const vehicle_state_t* packet, bool quantized, uint8_t* output,
                                          size_t output_capacity, size_t* output_length) {
   mpack_writer_t writer;
   mpack_writer_init(&writer, (char*)output, output_capacity);
 
-  mpack_start_array(&writer, TELEMETRY_MSGPACK_ITEM_COUNT);
-  mpack_write_u32(&writer, TELEMETRY_SCHEMA_VERSION);
+  // Schemas 3 and 5 stay readable by every display while this build's layout
+  // is the base one; any other layout names itself.
+  const uint32_t layout_id = telemetry_local_layout_id();
+  const bool tagged = layout_id != TELEMETRY_BASE_LAYOUT_ID;
+  if (tagged) {
+    mpack_start_array(&writer, TELEMETRY_TAGGED_HEADER_ITEM_COUNT + TELEMETRY_FLOAT_FIELD_COUNT);
+    mpack_write_u32(&writer, quantized ? TELEMETRY_SCHEMA_VERSION_QUANTIZED_TAGGED : TELEMETRY_SCHEMA_VERSION_TAGGED);
+  } else {
+    mpack_start_array(&writer, TELEMETRY_MSGPACK_ITEM_COUNT);
+    mpack_write_u32(&writer, quantized ? TELEMETRY_SCHEMA_VERSION_QUANTIZED : TELEMETRY_SCHEMA_VERSION);
+  }
+  mpack_write_u32(&writer, packet->sequence);
+  mpack_write_u32(&writer, packet->timestamp_ms);
+  if (tagged) {
+    mpack_write_u32(&writer, layout_id);
+  }
+  for (size_t i = 0; i < TELEMETRY_FLOAT_FIELD_COUNT; ++i) {
+    write_field(&writer, packet, i, quantized);
+  }
+  mpack_finish_array(&writer);
+
+  const size_t bytes_written = mpack_writer_buffer_used(&writer);
+  if (mpack_writer_destroy(&writer) != mpack_ok) {
+    return TELEMETRY_RESULT_OUTPUT_TOO_SMALL;
+  }
+
+  *output_length = bytes_written;
+  return TELEMETRY_RESULT_OK;
+}
+
+static telemetry_result_t encode_delta_msgpack(const vehicle_state_t* packet, uint32_t field_mask, bool quantized,
+                                               uint8_t* output, size_t output_capacity,
+                                               size_t* output_length) {
+  uint32_t field_count = 0;
+  for (uint32_t mask = field_mask; mask != 0; mask &= mask - 1) {
+    field_count++;
+  }
+
+  mpack_writer_t writer;
+  mpack_writer_init(&writer, (char*)output, output_capacity);
+
+  mpack_start_array(&writer, TELEMETRY_DELTA_HEADER_ITEM_COUNT + field_count);
+  mpack_write_u32(&writer, quantized ? TELEMETRY_SCHEMA_VERSION_QUANTIZED_DELTA : TELEMETRY_SCHEMA_VERSION_DELTA);
   mpack_write_u32(&writer, packet->sequence);
   mpack_write_u32(&writer, packet->timestamp_ms);
-  mpack_write_float(&writer, packet->water_temp);
-  mpack_write_float(&writer, packet->oil_temp);
-  mpack_write_float(&writer, packet->oil_pressure);
-  mpack_write_float(&writer, packet->dam);
-  mpack_write_float(&writer, packet->af_learned);
-  mpack_write_float(&writer, packet->af_ratio);
-  mpack_write_float(&writer, packet->int_temp);
-  mpack_write_float(&writer, packet->fb_knock);
-  mpack_write_float(&writer, packet->af_correct);
-  mpack_write_float(&writer, packet->inj_duty);
-  mpack_write_float(&writer, packet->eth_conc);
-  mpack_write_float(&writer, packet->engine_rpm);
-  mpack_write_float(&writer, packet->throttle_pos);
-  mpack_write_float(&writer, packet->brake_pressure_bar);
-  mpack_write_float(&writer, packet->steering_angle_deg);
-  mpack_write_float(&writer, packet->oil_pressure_raw);
+  mpack_write_u32(&writer, field_mask);
+  for (size_t i = 0; i < TELEMETRY_FLOAT_FIELD_COUNT; ++i) {
+    if (field_mask & (1UL << i)) {
+      write_field(&writer, packet, i, quantized);
+    }
+  }
   mpack_finish_array(&writer);
 
   const size_t bytes_written = mpack_writer_buffer_used(&writer);
@@ -41,33 +414,448 @@ static telemetry_result_t encode_msgpack(const vehicle_state_t* packet, uint8_t*
   return TELEMETRY_RESULT_OK;
 }
 
+// Full frames run straight through the plan: one store per wire field, with
+// the float/quantized choice made once per frame. Returns false, with the
+// fields left unread, when the frame is in a layout other than `layout_id`;
+// untagged frames are in TELEMETRY_BASE_LAYOUT_ID.
+static bool read_full_fields(mpack_reader_t* reader, uint32_t item_count, bool quantized, bool tagged,
+                             const telemetry_decode_plan_t* plan, uint32_t layout_id, decode_target_t* decoded) {
+  decoded->state.sequence = mpack_expect_u32(reader);
+  decoded->state.timestamp_ms = mpack_expect_u32(reader);
+  const uint32_t frame_layout_id = tagged ? mpack_expect_u32(reader) : TELEMETRY_BASE_LAYOUT_ID;
+  if (mpack_reader_error(reader) != mpack_ok) {
+    return true;
+  }
+  if (frame_layout_id != layout_id) {
+    return false;
+  }
+  const uint32_t header_items = tagged ? TELEMETRY_TAGGED_HEADER_ITEM_COUNT : TELEMETRY_FULL_HEADER_ITEM_COUNT;
+  if (item_count != header_items + plan->field_count) {
+    mpack_reader_flag_error(reader, mpack_error_type);
+    return true;
+  }
+
+  const telemetry_plan_field_t* field = plan->fields;
+  const telemetry_plan_field_t* const end = field + plan->field_count;
+  if (quantized) {
+    for (; field != end; ++field) {
+      store_field(decoded, field,
+                  plan_dequantize(field, mpack_expect_int_range(reader, field->raw_min, field->raw_max)));
+    }
+  } else {
+    for (; field != end; ++field) {
+      store_field(decoded, field, mpack_expect_float_strict(reader));
+    }
+  }
+  for (size_t i = 0; plan->missing_mask != 0 && i < TELEMETRY_FLOAT_FIELD_COUNT; ++i) {
+    if (plan->missing_mask & (1UL << i)) {
+      *float_field(&decoded->state, i) = NAN;
+    }
+  }
+  return true;
+}
+
+static void read_delta_fields(mpack_reader_t* reader, uint32_t item_count, bool quantized,
+                              const telemetry_decode_plan_t* plan, decode_target_t* decoded) {
+  decoded->state.sequence = mpack_expect_u32(reader);
+  decoded->state.timestamp_ms = mpack_expect_u32(reader);
+  const uint32_t field_mask = mpack_expect_u32(reader);
+
+  uint32_t field_count = 0;
+  for (uint32_t mask = field_mask; mask != 0; mask &= mask - 1) {
+    field_count++;
+  }
+  if ((field_mask & ~plan_mask(plan)) != 0 || item_count != TELEMETRY_DELTA_HEADER_ITEM_COUNT + field_count) {
+    mpack_reader_flag_error(reader, mpack_error_type);
+    return;
+  }
+
+  for (size_t i = 0; i < plan->field_count; ++i) {
+    if (field_mask & (1UL << i)) {
+      const telemetry_plan_field_t* field = &plan->fields[i];
+      store_field(decoded, field, read_plan_value(reader, field, quantized));
+    }
+  }
+}
+
+// Lists the field indexes in `field_mask`, lowest bit first. Returns false if
+// the mask is empty, has bits outside `valid_mask` or selects more than
+// TELEMETRY_BATCH_MAX_CHANNELS fields.
+static bool batch_channels(uint32_t field_mask, uint32_t valid_mask, size_t* channels, size_t* channel_count) {
+  *channel_count = 0;
+  if (field_mask == 0 || (field_mask & ~valid_mask) != 0) {
+    return false;
+  }
+  for (size_t i = 0; i < 32U; ++i) {
+    if (field_mask & (1UL << i)) {
+      if (*channel_count == TELEMETRY_BATCH_MAX_CHANNELS) {
+        return false;
+      }
+      channels[(*channel_count)++] = i;
+    }
+  }
+  return true;
+}
+
+static telemetry_result_t encode_batch_msgpack(const telemetry_sample_batch_t* batch, uint32_t sequence,
+                                               uint8_t* output, size_t output_capacity, size_t* output_length) {
+  size_t channels[TELEMETRY_BATCH_MAX_CHANNELS];
+  size_t channel_count = 0;
+  if (!batch_channels(batch->field_mask, TELEMETRY_DELTA_FULL_MASK, channels, &channel_count) || batch->sample_count == 0 ||
+      batch->sample_count > TELEMETRY_BATCH_MAX_SAMPLES) {
+    return TELEMETRY_RESULT_INVALID_ARGUMENT;
+  }
+
+  mpack_writer_t writer;
+  mpack_writer_init(&writer, (char*)output, output_capacity);
+
+  mpack_start_array(&writer, TELEMETRY_BATCH_HEADER_ITEM_COUNT + batch->sample_count * (1U + channel_count));
+  mpack_write_u32(&writer, TELEMETRY_SCHEMA_VERSION_BATCH);
+  mpack_write_u32(&writer, sequence);
+  mpack_write_u32(&writer, batch->timestamp_ms[0]);
+  mpack_write_u32(&writer, batch->field_mask);
+  for (size_t s = 0; s < batch->sample_count; ++s) {
+    mpack_write_u16(&writer, (uint16_t)(s == 0 ? 0 : batch->timestamp_ms[s] - batch->timestamp_ms[s - 1]));
+    for (size_t c = 0; c < channel_count; ++c) {
+      mpack_write_int(&writer, quantize_field(channels[c], batch->values[s][c]));
+    }
+  }
+  mpack_finish_array(&writer);
+
+  const size_t bytes_written = mpack_writer_buffer_used(&writer);
+  if (mpack_writer_destroy(&writer) != mpack_ok) {
+    return TELEMETRY_RESULT_OUTPUT_TOO_SMALL;
+  }
+
+  *output_length = bytes_written;
+  return TELEMETRY_RESULT_OK;
+}
+
+// Reads a batch's samples and merges the newest one into `decoded`. The
+// batch's mask and columns are converted to local channels; columns for
+// channels this build does not know are dropped.
+static void read_batch_fields(mpack_reader_t* reader, uint32_t item_count, const telemetry_decode_plan_t* plan,
+                              decode_target_t* decoded, telemetry_sample_batch_t* batch) {
+  decoded->state.sequence = mpack_expect_u32(reader);
+  uint32_t timestamp_ms = mpack_expect_u32(reader);
+  const uint32_t wire_mask = mpack_expect_u32(reader);
+  if (mpack_reader_error(reader) != mpack_ok) {
+    return;
+  }
+
+  size_t channels[TELEMETRY_BATCH_MAX_CHANNELS];
+  size_t channel_count = 0;
+  const uint32_t sample_items = item_count - TELEMETRY_BATCH_HEADER_ITEM_COUNT;
+  if (!batch_channels(wire_mask, plan_mask(plan), channels, &channel_count) ||
+      item_count <= TELEMETRY_BATCH_HEADER_ITEM_COUNT || sample_items % (1U + channel_count) != 0 ||
+      sample_items / (1U + channel_count) > TELEMETRY_BATCH_MAX_SAMPLES) {
+    mpack_reader_flag_error(reader, mpack_error_type);
+    return;
+  }
+
+  // A reordered layout can put the local channels in the other order.
+  batch->field_mask = 0;
+  for (size_t c = 0; c < channel_count; ++c) {
+    const int channel = plan->fields[channels[c]].channel;
+    batch->field_mask |= channel >= 0 ? 1UL << channel : 0UL;
+  }
+  size_t columns[TELEMETRY_BATCH_MAX_CHANNELS];
+  for (size_t c = 0; c < channel_count; ++c) {
+    const int channel = plan->fields[channels[c]].channel;
+    columns[c] = TELEMETRY_BATCH_MAX_CHANNELS;
+    if (channel >= 0) {
+      columns[c] = 0;
+      for (uint32_t below = batch->field_mask & ((1UL << channel) - 1UL); below != 0; below &= below - 1) {
+        columns[c]++;
+      }
+    }
+  }
+
+  batch->sample_count = (uint8_t)(sample_items / (1U + channel_count));
+  float newest[TELEMETRY_BATCH_MAX_CHANNELS] = {0};
+  for (size_t s = 0; s < batch->sample_count; ++s) {
+    const uint16_t dt_ms = mpack_expect_u16(reader);
+    if (s == 0 && dt_ms != 0) {
+      mpack_reader_flag_error(reader, mpack_error_data);
+    }
+    timestamp_ms += dt_ms;
+    batch->timestamp_ms[s] = timestamp_ms;
+    for (size_t c = 0; c < channel_count; ++c) {
+      const telemetry_plan_field_t* field = &plan->fields[channels[c]];
+      newest[c] = plan_dequantize(field, mpack_expect_int_range(reader, field->raw_min, field->raw_max));
+      if (columns[c] < TELEMETRY_BATCH_MAX_CHANNELS) {
+        batch->values[s][columns[c]] = newest[c];
+      }
+    }
+  }
+
+  decoded->state.timestamp_ms = timestamp_ms;
+  for (size_t c = 0; c < channel_count; ++c) {
+    store_field(decoded, &plan->fields[channels[c]], newest[c]);
+  }
+}
+
+#define FNV1A_OFFSET_BASIS 2166136261UL
+#define FNV1A_PRIME 16777619UL
+
+static uint32_t fnv1a(uint32_t hash, const uint8_t* data, size_t length) {
+  for (size_t i = 0; i < length; ++i) {
+    hash = (hash ^ data[i]) * FNV1A_PRIME;
+  }
+  return hash;
+}
+
+static uint32_t fnv1a_u32(uint32_t hash, uint32_t value) {
+  const uint8_t bytes[4] = {(uint8_t)(value >> 24), (uint8_t)(value >> 16), (uint8_t)(value >> 8), (uint8_t)value};
+  return fnv1a(hash, bytes, sizeof(bytes));
+}
+
+static uint32_t float_bits(float value) {
+  uint32_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  return bits;
+}
+
+// Hash of one entry over its index, name (with terminator), width, scale and
+// offset, so it does not depend on byte order or struct padding.
+static uint32_t descriptor_hash(uint32_t index, const telemetry_descriptor_t* field) {
+  uint32_t hash = fnv1a_u32(FNV1A_OFFSET_BASIS, index);
+  hash = fnv1a(hash, (const uint8_t*)field->name, strlen(field->name) + 1U);
+  hash = fnv1a(hash, &field->width, 1);
+  hash = fnv1a_u32(hash, float_bits(field->scale));
+  return fnv1a_u32(hash, float_bits(field->value_offset));
+}
+
+static uint32_t layout_hash(const uint32_t* entry_hashes, size_t field_count) {
+  uint32_t hash = FNV1A_OFFSET_BASIS;
+  for (size_t i = 0; i < field_count; ++i) {
+    hash = fnv1a_u32(hash, entry_hashes[i]);
+  }
+  return hash;
+}
+
+static bool width_range(uint32_t width, int16_t* raw_min, int16_t* raw_max) {
+  switch (width) {
+    case TELEMETRY_WIDTH_I8:
+      *raw_min = RAW_MIN_I8;
+      *raw_max = RAW_MAX_I8;
+      return true;
+    case TELEMETRY_WIDTH_I16:
+      *raw_min = RAW_MIN_I16;
+      *raw_max = RAW_MAX_I16;
+      return true;
+    default:
+      return false;
+  }
+}
+
+typedef struct {
+  uint32_t layout_id;
+  uint32_t field_count;
+  uint32_t index;
+  char name[TELEMETRY_SCHEMA_NAME_MAX];
+  telemetry_descriptor_t field;
+} descriptor_frame_t;
+
+static void read_descriptor(mpack_reader_t* reader, uint32_t item_count, descriptor_frame_t* descriptor) {
+  if (item_count != TELEMETRY_DESCRIPTOR_ITEM_COUNT) {
+    mpack_reader_flag_error(reader, mpack_error_type);
+    return;
+  }
+  descriptor->layout_id = mpack_expect_u32(reader);
+  descriptor->field_count = mpack_expect_u32_range(reader, 1, TELEMETRY_SCHEMA_MAX_FIELDS);
+  descriptor->index = mpack_expect_u32(reader);
+  const size_t name_length = mpack_expect_str_buf(reader, descriptor->name, sizeof(descriptor->name) - 1U);
+  descriptor->name[name_length] = '\0';
+  descriptor->field.name = descriptor->name;
+  descriptor->field.width = mpack_expect_u8(reader);
+  descriptor->field.scale = mpack_expect_float_strict(reader);
+  descriptor->field.value_offset = mpack_expect_float_strict(reader);
+
+  int16_t raw_min;
+  int16_t raw_max;
+  if (mpack_reader_error(reader) == mpack_ok &&
+      (descriptor->index >= descriptor->field_count || name_length == 0 ||
+       memchr(descriptor->name, '\0', name_length) != NULL ||
+       !width_range(descriptor->field.width, &raw_min, &raw_max) || !(descriptor->field.scale > 0.0f) ||
+       !isfinite(descriptor->field.scale) || !isfinite(descriptor->field.value_offset))) {
+    mpack_reader_flag_error(reader, mpack_error_data);
+  }
+}
+
+// Resolves a descriptor entry to a local channel by name.
+static telemetry_plan_field_t plan_field(const telemetry_descriptor_t* field) {
+  telemetry_plan_field_t planned = {
+      .offset = offsetof(decode_target_t, discard),
+      .channel = -1,
+      .scale = field->scale,
+      .value_offset = field->value_offset,
+  };
+  width_range(field->width, &planned.raw_min, &planned.raw_max);
+  for (size_t i = 0; i < TELEMETRY_FLOAT_FIELD_COUNT; ++i) {
+    if (strcmp(k_local_descriptors[i].name, field->name) == 0) {
+      planned.offset = k_local_plan.fields[i].offset;
+      planned.channel = (int8_t)i;
+      break;
+    }
+  }
+  return planned;
+}
+
+// Collects descriptors of a layout other than the current plan and adopts it
+// once every entry has arrived and the set hashes to its layout_id.
+static void schema_on_descriptor(telemetry_schema_cache_t* schema, const descriptor_frame_t* descriptor) {
+  schema->descriptors++;
+  if (descriptor->layout_id == schema->plan.layout_id && descriptor->field_count == schema->plan.field_count) {
+    schema->pending_received = 0;
+    return;
+  }
+
+  telemetry_decode_plan_t* pending = &schema->pending;
+  if (schema->pending_received == 0 || pending->layout_id != descriptor->layout_id ||
+      pending->field_count != descriptor->field_count) {
+    pending->layout_id = descriptor->layout_id;
+    pending->field_count = descriptor->field_count;
+    schema->pending_received = 0;
+  }
+  schema->pending_frames = 0;
+  pending->fields[descriptor->index] = plan_field(&descriptor->field);
+  schema->entry_hashes[descriptor->index] = descriptor_hash(descriptor->index, &descriptor->field);
+  schema->pending_received |= 1UL << descriptor->index;
+  if (schema->pending_received != plan_mask(pending)) {
+    return;
+  }
+
+  schema->pending_received = 0;
+  if (layout_hash(schema->entry_hashes, pending->field_count) != pending->layout_id) {
+    return;
+  }
+  pending->missing_mask = TELEMETRY_DELTA_FULL_MASK;
+  uint32_t unknown = 0;
+  for (size_t i = 0; i < pending->field_count; ++i) {
+    const int channel = pending->fields[i].channel;
+    if (channel >= 0) {
+      pending->missing_mask &= ~(1UL << channel);
+    } else {
+      unknown++;
+    }
+  }
+  schema->plan = *pending;
+  schema->unknown_channels = unknown;
+  schema->plans_built++;
+  schema->need_keyframe = true;
+}
+
+// Parses a full (schema 3/5/10/11), delta (schema 4/6) or batch (schema 7) payload
+// through the plan in `schema`, or the local layout when it is NULL. Delta and
+// batch fields are merged over `base`; one with no base is validated but
+// reported as needing a keyframe. `batch`, if given, receives the batch
+// samples, or an empty batch for other frames. Control frames (schema 8) go to
+// `control`, if given, and return TELEMETRY_RESULT_CONTROL. Descriptors
+// (schema 9) update `schema`, if given, and return
+// TELEMETRY_RESULT_DESCRIPTOR. A full frame in a layout other than the plan's
+// returns TELEMETRY_RESULT_NEED_KEYFRAME, or TELEMETRY_RESULT_SCHEMA_ERROR
+// without `schema`.
 static telemetry_result_t decode_msgpack(const uint8_t* payload, size_t payload_length,
-                                         vehicle_state_t* packet) {
+                                         const vehicle_state_t* base, vehicle_state_t* packet,
+                                         telemetry_sample_batch_t* batch, telemetry_control_t* control,
+                                         telemetry_schema_cache_t* schema) {
   mpack_reader_t reader;
   mpack_reader_init_data(&reader, (const char*)payload, payload_length);
 
-  mpack_expect_array_match(&reader, TELEMETRY_MSGPACK_ITEM_COUNT);
+  const uint32_t item_count = mpack_expect_array(&reader);
   const uint32_t schema_version = mpack_expect_u32(&reader);
+  if (mpack_reader_error(&reader) == mpack_ok && (schema_version < TELEMETRY_SCHEMA_VERSION ||
+                                                  schema_version > TELEMETRY_SCHEMA_VERSION_QUANTIZED_TAGGED)) {
+    mpack_reader_destroy(&reader);
+    return TELEMETRY_RESULT_SCHEMA_ERROR;
+  }
+
+  if (schema_version == TELEMETRY_SCHEMA_VERSION_CONTROL) {
+    telemetry_control_t decoded_control = {0};
+    decoded_control.type = mpack_expect_u32(&reader);
+    decoded_control.value = mpack_expect_u32(&reader);
+    const bool time_pong = decoded_control.type == TELEMETRY_CONTROL_TIME_PONG;
+    if (item_count != (time_pong ? TELEMETRY_CONTROL_TIME_ITEM_COUNT : TELEMETRY_CONTROL_ITEM_COUNT)) {
+      mpack_reader_flag_error(&reader, mpack_error_type);
+    } else if (time_pong) {
+      decoded_control.hub_rx_us = mpack_expect_u32(&reader);
+      decoded_control.hub_tx_us = mpack_expect_u32(&reader);
+    }
+    mpack_done_array(&reader);
+    const size_t trailing_bytes = mpack_reader_remaining(&reader, NULL);
+    if (mpack_reader_destroy(&reader) != mpack_ok || trailing_bytes != 0) {
+      return TELEMETRY_RESULT_MSGPACK_ERROR;
+    }
+    if (control != NULL) {
+      *control = decoded_control;
+    }
+    return TELEMETRY_RESULT_CONTROL;
+  }
+
+  if (schema_version == TELEMETRY_SCHEMA_VERSION_DESCRIPTOR) {
+    descriptor_frame_t descriptor;
+    read_descriptor(&reader, item_count, &descriptor);
+    mpack_done_array(&reader);
+    const size_t trailing_bytes = mpack_reader_remaining(&reader, NULL);
+    if (mpack_reader_destroy(&reader) != mpack_ok || trailing_bytes != 0) {
+      return TELEMETRY_RESULT_MSGPACK_ERROR;
+    }
+    if (schema != NULL) {
+      schema_on_descriptor(schema, &descriptor);
+    }
+    return TELEMETRY_RESULT_DESCRIPTOR;
+  }
+
+  if (schema != NULL && schema->pending_received != 0) {
+    if (++schema->pending_frames <= TELEMETRY_SCHEMA_PENDING_MAX_FRAMES) {
+      // A new layout is being announced and this frame may already use it.
+      mpack_reader_destroy(&reader);
+      return TELEMETRY_RESULT_NEED_KEYFRAME;
+    }
+    // An entry of the announcement was lost. Keyframes are checked against
+    // the plan's layout, so it is safe to use until the next announcement.
+    schema->pending_received = 0;
+    schema->announcements_dropped++;
+  }
+  const telemetry_decode_plan_t* plan = schema != NULL ? &schema->plan : &k_local_plan;
+  const uint32_t layout_id = schema != NULL ? schema->plan.layout_id : telemetry_local_layout_id();
+  if (schema != NULL && schema->need_keyframe) {
+    base = NULL;
+  }
 
-  vehicle_state_t decoded = {0};
-  decoded.sequence = mpack_expect_u32(&reader);
-  decoded.timestamp_ms = mpack_expect_u32(&reader);
-  decoded.water_temp = mpack_expect_float_strict(&reader);
-  decoded.oil_temp = mpack_expect_float_strict(&reader);
-  decoded.oil_pressure = mpack_expect_float_strict(&reader);
-  decoded.dam = mpack_expect_float_strict(&reader);
-  decoded.af_learned = mpack_expect_float_strict(&reader);
-  decoded.af_ratio = mpack_expect_float_strict(&reader);
-  decoded.int_temp = mpack_expect_float_strict(&reader);
-  decoded.fb_knock = mpack_expect_float_strict(&reader);
-  decoded.af_correct = mpack_expect_float_strict(&reader);
-  decoded.inj_duty = mpack_expect_float_strict(&reader);
-  decoded.eth_conc = mpack_expect_float_strict(&reader);
-  decoded.engine_rpm = mpack_expect_float_strict(&reader);
-  decoded.throttle_pos = mpack_expect_float_strict(&reader);
-  decoded.brake_pressure_bar = mpack_expect_float_strict(&reader);
-  decoded.steering_angle_deg = mpack_expect_float_strict(&reader);
-  decoded.oil_pressure_raw = mpack_expect_float_strict(&reader);
+  const bool is_batch = schema_version == TELEMETRY_SCHEMA_VERSION_BATCH;
+  const bool delta = is_batch || schema_version == TELEMETRY_SCHEMA_VERSION_DELTA ||
+                     schema_version == TELEMETRY_SCHEMA_VERSION_QUANTIZED_DELTA;
+  const bool tagged = schema_version == TELEMETRY_SCHEMA_VERSION_TAGGED ||
+                      schema_version == TELEMETRY_SCHEMA_VERSION_QUANTIZED_TAGGED;
+  const bool quantized = schema_version == TELEMETRY_SCHEMA_VERSION_QUANTIZED ||
+                         schema_version == TELEMETRY_SCHEMA_VERSION_QUANTIZED_DELTA ||
+                         schema_version == TELEMETRY_SCHEMA_VERSION_QUANTIZED_TAGGED;
+  decode_target_t decoded = {0};
+  telemetry_sample_batch_t decoded_batch = {0};
+  if (!delta) {
+    if (!read_full_fields(&reader, item_count, quantized, tagged, plan, layout_id, &decoded)) {
+      // The hub's layout differs from the plan; decoding it would put values
+      // in the wrong channels. Wait for its descriptors.
+      mpack_reader_destroy(&reader);
+      if (schema == NULL) {
+        return TELEMETRY_RESULT_SCHEMA_ERROR;
+      }
+      schema->need_keyframe = true;
+      schema->layout_mismatches++;
+      return TELEMETRY_RESULT_NEED_KEYFRAME;
+    }
+  } else {
+    if (base != NULL) {
+      decoded.state = *base;
+    }
+    if (is_batch) {
+      read_batch_fields(&reader, item_count, plan, &decoded, &decoded_batch);
+    } else {
+      read_delta_fields(&reader, item_count, quantized, plan, &decoded);
+    }
+  }
   mpack_done_array(&reader);
 
   const size_t trailing_bytes = mpack_reader_remaining(&reader, NULL);
@@ -75,25 +863,140 @@ static telemetry_result_t decode_msgpack(const uint8_t* payload, size_t payload_
   if (error != mpack_ok || trailing_bytes != 0) {
     return TELEMETRY_RESULT_MSGPACK_ERROR;
   }
-  if (schema_version != TELEMETRY_SCHEMA_VERSION) {
-    return TELEMETRY_RESULT_SCHEMA_ERROR;
+  if (delta && base == NULL) {
+    return TELEMETRY_RESULT_NEED_KEYFRAME;
   }
 
-  *packet = decoded;
+  if (schema != NULL) {
+    schema->need_keyframe = false;
+  }
+  *packet = decoded.state;
+  if (batch != NULL) {
+    *batch = decoded_batch;
+  }
   return TELEMETRY_RESULT_OK;
 }
 
-uint16_t telemetry_crc16_ccitt_false(const uint8_t* data, size_t length) {
-  uint16_t crc = 0xFFFFU;
+uint16_t telemetry_crc16_ccitt_false_update(uint16_t crc, const uint8_t* data, size_t length) {
   for (size_t i = 0; i < length; ++i) {
-    crc ^= (uint16_t)data[i] << 8;
-    for (uint8_t bit = 0; bit < 8; ++bit) {
-      crc = (crc & 0x8000U) ? (uint16_t)((crc << 1) ^ 0x1021U) : (uint16_t)(crc << 1);
-    }
+    crc = crc16_ccitt_false_step(crc, data[i]);
   }
   return crc;
 }
 
+uint16_t telemetry_crc16_ccitt_false(const uint8_t* data, size_t length) {
+  return telemetry_crc16_ccitt_false_update(TELEMETRY_CRC16_INIT, data, length);
+}
+
+// COBS stuffing below mirrors cobs_encode() byte for byte, including the empty
+// trailing block emitted after a full 254-byte block, so both paths produce
+// identical wire frames.
+static inline void frame_writer_stuff(telemetry_frame_writer_t* writer, uint8_t byte) {
+  if (writer->write_index >= writer->capacity) {
+    writer->overflow = true;
+    return;
+  }
+
+  if (byte == 0x00) {
+    writer->output[writer->code_index] = writer->code;
+    writer->code_index = writer->write_index++;
+    writer->code = 1;
+    return;
+  }
+
+  writer->output[writer->write_index++] = byte;
+  if (++writer->code == 0xFF) {
+    writer->output[writer->code_index] = writer->code;
+    writer->code_index = writer->write_index++;
+    writer->code = 1;
+  }
+}
+
+void telemetry_frame_writer_init(telemetry_frame_writer_t* writer, uint8_t* output, size_t output_capacity) {
+  writer->output = output;
+  writer->capacity = output_capacity;
+  writer->write_index = 1;
+  writer->code_index = 0;
+  writer->code = 1;
+  writer->crc = TELEMETRY_CRC16_INIT;
+  writer->overflow = output == NULL || output_capacity == 0;
+  writer->fec = false;
+  memset(writer->parity, 0, sizeof(writer->parity));
+}
+
+void telemetry_frame_writer_set_fec(telemetry_frame_writer_t* writer, bool fec) { writer->fec = fec; }
+
+void telemetry_frame_writer_append(telemetry_frame_writer_t* writer, const uint8_t* data, size_t length) {
+  uint16_t crc = writer->crc;
+  for (size_t i = 0; i < length && !writer->overflow; ++i) {
+    // Read once: with in-place stuffing the next store may land on data[i].
+    const uint8_t byte = data[i];
+    crc = crc16_ccitt_false_step(crc, byte);
+    if (writer->fec) {
+      fec_encode_step(writer->parity, byte);
+    }
+    frame_writer_stuff(writer, byte);
+  }
+  writer->crc = crc;
+}
+
+telemetry_result_t telemetry_frame_writer_finish(telemetry_frame_writer_t* writer, size_t* output_length) {
+  if (writer == NULL || output_length == NULL) {
+    return TELEMETRY_RESULT_INVALID_ARGUMENT;
+  }
+  *output_length = 0;
+  const uint16_t crc = writer->crc;
+  const uint8_t crc_bytes[2] = {(uint8_t)(crc >> 8), (uint8_t)crc};
+  for (size_t i = 0; i < sizeof(crc_bytes) && !writer->overflow; ++i) {
+    if (writer->fec) {
+      fec_encode_step(writer->parity, crc_bytes[i]);
+    }
+    frame_writer_stuff(writer, crc_bytes[i]);
+  }
+  for (size_t i = 0; writer->fec && i < sizeof(writer->parity) && !writer->overflow; ++i) {
+    frame_writer_stuff(writer, writer->parity[i]);
+  }
+  if (writer->overflow || writer->code_index >= writer->capacity) {
+    return TELEMETRY_RESULT_OUTPUT_TOO_SMALL;
+  }
+
+  writer->output[writer->code_index] = writer->code;
+  *output_length = writer->write_index;
+  return TELEMETRY_RESULT_OK;
+}
+
+// MessagePack is serialized into the tail of the caller's buffer and stuffed
+// forward in place, so the payload is never staged on the stack. COBS grows a
+// frame by one code byte plus one per 254 bytes, and the slot starts further
+// in than that, so the writer never passes a payload byte it has not read.
+_Static_assert(TELEMETRY_COBS_FRAME_MAX_SIZE - TELEMETRY_MSGPACK_MAX_SIZE > 1U + TELEMETRY_MSGPACK_MAX_SIZE / 254U,
+               "in-place payload slot would be overwritten before it is read");
+
+static inline uint8_t* payload_slot(uint8_t* output, size_t frame_capacity) {
+  return output + frame_capacity - TELEMETRY_MSGPACK_MAX_SIZE;
+}
+
+static telemetry_result_t frame_payload(uint8_t* output, size_t frame_capacity, bool fec, const uint8_t* payload,
+                                        size_t payload_length, size_t* frame_length) {
+  telemetry_frame_writer_t writer;
+  telemetry_frame_writer_init(&writer, output, frame_capacity);
+  telemetry_frame_writer_set_fec(&writer, fec);
+  telemetry_frame_writer_append(&writer, payload, payload_length);
+  return telemetry_frame_writer_finish(&writer, frame_length);
+}
+
+static telemetry_result_t encode_frame(const vehicle_state_t* packet, uint8_t* output, size_t output_capacity,
+                                       size_t* output_length) {
+  uint8_t* payload = payload_slot(output, output_capacity);
+  size_t payload_length = 0;
+  telemetry_result_t result =
+      encode_msgpack(packet, false, payload, TELEMETRY_MSGPACK_MAX_SIZE, &payload_length);
+  if (result != TELEMETRY_RESULT_OK) {
+    return result;
+  }
+  return frame_payload(output, output_capacity, false, payload, payload_length, output_length);
+}
+
 telemetry_result_t telemetry_frame_encode(const vehicle_state_t* packet, uint8_t* output,
                                           size_t output_capacity, size_t* output_length) {
   if (packet == NULL || output == NULL || output_length == NULL) {
@@ -104,27 +1007,81 @@ telemetry_result_t telemetry_frame_encode(const vehicle_state_t* packet, uint8_t
     return TELEMETRY_RESULT_OUTPUT_TOO_SMALL;
   }
 
-  uint8_t raw_frame[TELEMETRY_RAW_FRAME_MAX_SIZE];
-  size_t payload_length = 0;
-  telemetry_result_t result =
-      encode_msgpack(packet, raw_frame, TELEMETRY_MSGPACK_MAX_SIZE, &payload_length);
+  return encode_frame(packet, output, output_capacity, output_length);
+}
+
+telemetry_result_t telemetry_frame_encode_wire(const vehicle_state_t* packet, uint8_t* output,
+                                               size_t output_capacity, size_t* output_length) {
+  if (packet == NULL || output == NULL || output_length == NULL) {
+    return TELEMETRY_RESULT_INVALID_ARGUMENT;
+  }
+  *output_length = 0;
+  if (output_capacity < TELEMETRY_WIRE_FRAME_MAX_SIZE) {
+    return TELEMETRY_RESULT_OUTPUT_TOO_SMALL;
+  }
+
+  size_t frame_length = 0;
+  telemetry_result_t result = encode_frame(packet, output, output_capacity - 1, &frame_length);
   if (result != TELEMETRY_RESULT_OK) {
     return result;
   }
 
-  const uint16_t crc = telemetry_crc16_ccitt_false(raw_frame, payload_length);
-  raw_frame[payload_length] = (uint8_t)(crc >> 8);
-  raw_frame[payload_length + 1] = (uint8_t)crc;
-
-  *output_length = cobs_encode(raw_frame, payload_length + 2, output);
+  output[frame_length++] = 0x00;
+  *output_length = frame_length;
   return TELEMETRY_RESULT_OK;
 }
 
-telemetry_result_t telemetry_frame_decode(const uint8_t* frame, size_t frame_length,
-                                          vehicle_state_t* packet) {
-  if (frame == NULL || packet == NULL || frame_length == 0) {
-    return TELEMETRY_RESULT_INVALID_ARGUMENT;
+static inline bool frame_accepted(telemetry_result_t result) {
+  return result == TELEMETRY_RESULT_OK || result == TELEMETRY_RESULT_CONTROL || result == TELEMETRY_RESULT_DESCRIPTOR ||
+         result == TELEMETRY_RESULT_NEED_KEYFRAME;
+}
+
+// Parses a de-stuffed frame of at least 3 bytes. `crc_ok` says whether the CRC
+// over the whole frame matched, i.e. whether it is valid as a frame without
+// FEC. Otherwise, or when it does not parse, the frame is retried as
+// [payload][CRC][parity]: errors are repaired in `raw` and the inner CRC must
+// then match. Both decoders go through here so they agree on every frame.
+static telemetry_result_t decode_raw_frame(uint8_t* raw, size_t raw_length, bool crc_ok, const vehicle_state_t* base,
+                                           vehicle_state_t* packet, telemetry_sample_batch_t* batch,
+                                           telemetry_control_t* control, telemetry_schema_cache_t* schema,
+                                           bool* corrected) {
+  *corrected = false;
+  telemetry_result_t result = TELEMETRY_RESULT_CRC_ERROR;
+  if (crc_ok) {
+    result = decode_msgpack(raw, raw_length - 2, base, packet, batch, control, schema);
+    if (frame_accepted(result)) {
+      return result;
+    }
+  }
+  if (raw_length < TELEMETRY_FEC_PARITY_SIZE + 3U) {
+    return result;
+  }
+
+  // An intact inner CRC means the payload needs no repair, whatever happened
+  // to the parity, so the Reed-Solomon decoder only runs on damaged frames.
+  const size_t payload_length = raw_length - TELEMETRY_FEC_PARITY_SIZE - 2U;
+  int repaired = 0;
+  if (telemetry_crc16_ccitt_false(raw, payload_length + 2U) != 0) {
+    repaired = fec_correct(raw, raw_length);
+    if (repaired <= 0 || telemetry_crc16_ccitt_false(raw, payload_length + 2U) != 0) {
+      return result;
+    }
+  }
+
+  const telemetry_result_t fec_result = decode_msgpack(raw, payload_length, base, packet, batch, control, schema);
+  if (crc_ok && !frame_accepted(fec_result)) {
+    return result;
   }
+  *corrected = repaired > 0 && (fec_result == TELEMETRY_RESULT_OK || fec_result == TELEMETRY_RESULT_CONTROL ||
+                                fec_result == TELEMETRY_RESULT_DESCRIPTOR);
+  return fec_result;
+}
+
+static telemetry_result_t decode_frame(const uint8_t* frame, size_t frame_length, const vehicle_state_t* base,
+                                       vehicle_state_t* packet, telemetry_sample_batch_t* batch,
+                                       telemetry_control_t* control, telemetry_schema_cache_t* schema,
+                                       bool* corrected) {
+  *corrected = false;
   if (frame_length > TELEMETRY_COBS_FRAME_MAX_SIZE) {
     return TELEMETRY_RESULT_FRAME_TOO_LARGE;
   }
@@ -141,11 +1098,476 @@ telemetry_result_t telemetry_frame_decode(const uint8_t* frame, size_t frame_len
   const size_t payload_length = raw_length - 2;
   const uint16_t received_crc =
       (uint16_t)(((uint16_t)raw_frame[payload_length] << 8) | raw_frame[payload_length + 1]);
-  if (telemetry_crc16_ccitt_false(raw_frame, payload_length) != received_crc) {
-    return TELEMETRY_RESULT_CRC_ERROR;
+  const bool crc_ok = telemetry_crc16_ccitt_false(raw_frame, payload_length) == received_crc;
+  return decode_raw_frame(raw_frame, raw_length, crc_ok, base, packet, batch, control, schema, corrected);
+}
+
+telemetry_result_t telemetry_frame_decode(const uint8_t* frame, size_t frame_length,
+                                          vehicle_state_t* packet) {
+  if (frame == NULL || packet == NULL || frame_length == 0) {
+    return TELEMETRY_RESULT_INVALID_ARGUMENT;
+  }
+
+  bool corrected = false;
+  return decode_frame(frame, frame_length, NULL, packet, NULL, NULL, NULL, &corrected);
+}
+
+telemetry_result_t telemetry_control_encode_wire(const telemetry_control_t* control, uint8_t* output,
+                                                 size_t output_capacity, size_t* output_length) {
+  if (control == NULL || output == NULL || output_length == NULL) {
+    return TELEMETRY_RESULT_INVALID_ARGUMENT;
+  }
+  *output_length = 0;
+  if (output_capacity < TELEMETRY_WIRE_FRAME_MAX_SIZE) {
+    return TELEMETRY_RESULT_OUTPUT_TOO_SMALL;
+  }
+
+  uint8_t* payload = payload_slot(output, output_capacity - 1);
+  mpack_writer_t mpack;
+  mpack_writer_init(&mpack, (char*)payload, TELEMETRY_MSGPACK_MAX_SIZE);
+  const bool time_pong = control->type == TELEMETRY_CONTROL_TIME_PONG;
+  mpack_start_array(&mpack, time_pong ? TELEMETRY_CONTROL_TIME_ITEM_COUNT : TELEMETRY_CONTROL_ITEM_COUNT);
+  mpack_write_u32(&mpack, TELEMETRY_SCHEMA_VERSION_CONTROL);
+  mpack_write_u32(&mpack, control->type);
+  mpack_write_u32(&mpack, control->value);
+  if (time_pong) {
+    mpack_write_u32(&mpack, control->hub_rx_us);
+    mpack_write_u32(&mpack, control->hub_tx_us);
+  }
+  mpack_finish_array(&mpack);
+  const size_t payload_length = mpack_writer_buffer_used(&mpack);
+  if (mpack_writer_destroy(&mpack) != mpack_ok) {
+    return TELEMETRY_RESULT_OUTPUT_TOO_SMALL;
+  }
+
+  size_t frame_length = 0;
+  const telemetry_result_t result =
+      frame_payload(output, output_capacity - 1, false, payload, payload_length, &frame_length);
+  if (result != TELEMETRY_RESULT_OK) {
+    return result;
+  }
+  output[frame_length++] = 0x00;
+  *output_length = frame_length;
+  return TELEMETRY_RESULT_OK;
+}
+
+const telemetry_descriptor_t* telemetry_local_descriptors(void) { return k_local_descriptors; }
+
+uint32_t telemetry_layout_id(const telemetry_descriptor_t* fields, size_t field_count) {
+  uint32_t entry_hashes[TELEMETRY_SCHEMA_MAX_FIELDS];
+  if (fields == NULL || field_count > TELEMETRY_SCHEMA_MAX_FIELDS) {
+    return 0;
+  }
+  for (size_t i = 0; i < field_count; ++i) {
+    entry_hashes[i] = descriptor_hash((uint32_t)i, &fields[i]);
+  }
+  return layout_hash(entry_hashes, field_count);
+}
+
+uint32_t telemetry_local_layout_id(void) {
+  // Every full frame carries it, and the layout is fixed at build time.
+  static uint32_t s_local_layout_id;
+  if (s_local_layout_id == 0) {
+    s_local_layout_id = telemetry_layout_id(k_local_descriptors, TELEMETRY_FLOAT_FIELD_COUNT);
+  }
+  return s_local_layout_id;
+}
+
+telemetry_result_t telemetry_descriptor_encode_wire(uint32_t layout_id, uint32_t field_count, uint32_t index,
+                                                    const telemetry_descriptor_t* field, uint8_t* output,
+                                                    size_t output_capacity, size_t* output_length) {
+  if (field == NULL || field->name == NULL || output == NULL || output_length == NULL || field_count == 0 ||
+      field_count > TELEMETRY_SCHEMA_MAX_FIELDS || index >= field_count ||
+      strlen(field->name) >= TELEMETRY_SCHEMA_NAME_MAX) {
+    return TELEMETRY_RESULT_INVALID_ARGUMENT;
+  }
+  *output_length = 0;
+  if (output_capacity < TELEMETRY_WIRE_FRAME_MAX_SIZE) {
+    return TELEMETRY_RESULT_OUTPUT_TOO_SMALL;
+  }
+
+  uint8_t* payload = payload_slot(output, output_capacity - 1);
+  mpack_writer_t mpack;
+  mpack_writer_init(&mpack, (char*)payload, TELEMETRY_MSGPACK_MAX_SIZE);
+  mpack_start_array(&mpack, TELEMETRY_DESCRIPTOR_ITEM_COUNT);
+  mpack_write_u32(&mpack, TELEMETRY_SCHEMA_VERSION_DESCRIPTOR);
+  mpack_write_u32(&mpack, layout_id);
+  mpack_write_u32(&mpack, field_count);
+  mpack_write_u32(&mpack, index);
+  mpack_write_cstr(&mpack, field->name);
+  mpack_write_u8(&mpack, field->width);
+  mpack_write_float(&mpack, field->scale);
+  mpack_write_float(&mpack, field->value_offset);
+  mpack_finish_array(&mpack);
+  const size_t payload_length = mpack_writer_buffer_used(&mpack);
+  if (mpack_writer_destroy(&mpack) != mpack_ok) {
+    return TELEMETRY_RESULT_OUTPUT_TOO_SMALL;
+  }
+
+  size_t frame_length = 0;
+  const telemetry_result_t result =
+      frame_payload(output, output_capacity - 1, false, payload, payload_length, &frame_length);
+  if (result != TELEMETRY_RESULT_OK) {
+    return result;
+  }
+  output[frame_length++] = 0x00;
+  *output_length = frame_length;
+  return TELEMETRY_RESULT_OK;
+}
+
+void telemetry_delta_encoder_init(telemetry_delta_encoder_t* encoder, uint32_t keyframe_interval) {
+  if (encoder == NULL) {
+    return;
+  }
+  memset(encoder, 0, sizeof(*encoder));
+  encoder->keyframe_interval = keyframe_interval > 0 ? keyframe_interval : 1;
+}
+
+void telemetry_delta_encoder_set_quantized(telemetry_delta_encoder_t* encoder, bool quantized) {
+  if (encoder != NULL) {
+    encoder->quantized = quantized;
+    encoder->frames_until_keyframe = 0;
+  }
+}
+
+void telemetry_delta_encoder_set_fec(telemetry_delta_encoder_t* encoder, bool fec) {
+  if (encoder != NULL) {
+    encoder->fec = fec;
+  }
+}
+
+void telemetry_delta_encoder_force_keyframe(telemetry_delta_encoder_t* encoder) {
+  if (encoder != NULL) {
+    encoder->frames_until_keyframe = 0;
+  }
+}
+
+telemetry_result_t telemetry_delta_encoder_encode_wire(telemetry_delta_encoder_t* encoder,
+                                                       const vehicle_state_t* packet, uint8_t* output,
+                                                       size_t output_capacity, size_t* output_length) {
+  return telemetry_delta_encoder_encode_fields_wire(encoder, packet, TELEMETRY_DELTA_FULL_MASK, output,
+                                                    output_capacity, output_length);
+}
+
+telemetry_result_t telemetry_delta_encoder_encode_fields_wire(telemetry_delta_encoder_t* encoder,
+                                                              const vehicle_state_t* packet, uint32_t field_mask,
+                                                              uint8_t* output, size_t output_capacity,
+                                                              size_t* output_length) {
+  if (encoder == NULL || packet == NULL || output == NULL || output_length == NULL) {
+    return TELEMETRY_RESULT_INVALID_ARGUMENT;
+  }
+  *output_length = 0;
+  if (output_capacity < TELEMETRY_WIRE_FRAME_MAX_SIZE) {
+    return TELEMETRY_RESULT_OUTPUT_TOO_SMALL;
+  }
+
+  uint32_t changed_mask = TELEMETRY_DELTA_FULL_MASK;
+  if (encoder->frames_until_keyframe > 0) {
+    changed_mask = 0;
+    for (size_t i = 0; i < TELEMETRY_FLOAT_FIELD_COUNT; ++i) {
+      if (!(field_mask & (1UL << i))) {
+        continue;
+      }
+      const float value = float_field_value(packet, i);
+      const float reference = float_field_value(&encoder->reference, i);
+      // Written so NaN compares as changed.
+      bool changed = !(fabsf(value - reference) <= k_float_fields[i].deadband);
+      if (changed && encoder->quantized) {
+        changed = quantize_field(i, value) != quantize_field(i, reference);
+      }
+      if (changed) {
+        changed_mask |= 1UL << i;
+      }
+    }
+  }
+
+  // A delta carrying every field is larger than a full frame, so send a keyframe.
+  const bool keyframe = changed_mask == TELEMETRY_DELTA_FULL_MASK;
+  uint8_t* payload = payload_slot(output, output_capacity - 1);
+  size_t payload_length = 0;
+  telemetry_result_t result =
+      keyframe ? encode_msgpack(packet, encoder->quantized, payload, TELEMETRY_MSGPACK_MAX_SIZE, &payload_length)
+               : encode_delta_msgpack(packet, changed_mask, encoder->quantized, payload, TELEMETRY_MSGPACK_MAX_SIZE,
+                                      &payload_length);
+  if (result != TELEMETRY_RESULT_OK) {
+    return result;
+  }
+
+  size_t frame_length = 0;
+  result = frame_payload(output, output_capacity - 1, encoder->fec, payload, payload_length, &frame_length);
+  if (result != TELEMETRY_RESULT_OK) {
+    return result;
+  }
+  output[frame_length++] = 0x00;
+  *output_length = frame_length;
+
+  // Remember what the display now holds, which is the rounded value when quantized.
+  for (size_t i = 0; i < TELEMETRY_FLOAT_FIELD_COUNT; ++i) {
+    if (changed_mask & (1UL << i)) {
+      const float value = float_field_value(packet, i);
+      *float_field(&encoder->reference, i) =
+          encoder->quantized ? dequantize_field(i, quantize_field(i, value)) : value;
+    }
+  }
+  encoder->frames_until_keyframe = keyframe ? encoder->keyframe_interval - 1 : encoder->frames_until_keyframe - 1;
+  return TELEMETRY_RESULT_OK;
+}
+
+bool telemetry_sample_batch_init(telemetry_sample_batch_t* batch, uint32_t field_mask) {
+  size_t channels[TELEMETRY_BATCH_MAX_CHANNELS];
+  size_t channel_count = 0;
+  if (batch == NULL || !batch_channels(field_mask, TELEMETRY_DELTA_FULL_MASK, channels, &channel_count)) {
+    return false;
+  }
+  memset(batch, 0, sizeof(*batch));
+  batch->field_mask = field_mask;
+  return true;
+}
+
+void telemetry_sample_batch_push(telemetry_sample_batch_t* batch, uint32_t timestamp_ms,
+                                 const vehicle_state_t* state) {
+  size_t channels[TELEMETRY_BATCH_MAX_CHANNELS];
+  size_t channel_count = 0;
+  if (batch == NULL || state == NULL || !batch_channels(batch->field_mask, TELEMETRY_DELTA_FULL_MASK, channels, &channel_count)) {
+    return;
+  }
+
+  if (batch->sample_count > 0 && timestamp_ms - batch->timestamp_ms[batch->sample_count - 1] > UINT16_MAX) {
+    batch->sample_count = 0;
+  }
+  if (batch->sample_count == TELEMETRY_BATCH_MAX_SAMPLES) {
+    memmove(&batch->timestamp_ms[0], &batch->timestamp_ms[1],
+            (TELEMETRY_BATCH_MAX_SAMPLES - 1) * sizeof(batch->timestamp_ms[0]));
+    memmove(&batch->values[0], &batch->values[1], (TELEMETRY_BATCH_MAX_SAMPLES - 1) * sizeof(batch->values[0]));
+    batch->sample_count--;
+  }
+
+  const size_t s = batch->sample_count++;
+  batch->timestamp_ms[s] = timestamp_ms;
+  for (size_t c = 0; c < channel_count; ++c) {
+    batch->values[s][c] = float_field_value(state, channels[c]);
+  }
+}
+
+telemetry_result_t telemetry_delta_encoder_encode_batch_wire(telemetry_delta_encoder_t* encoder,
+                                                             const telemetry_sample_batch_t* batch,
+                                                             uint32_t sequence, uint8_t* output,
+                                                             size_t output_capacity, size_t* output_length) {
+  if (encoder == NULL || batch == NULL || output == NULL || output_length == NULL) {
+    return TELEMETRY_RESULT_INVALID_ARGUMENT;
+  }
+  *output_length = 0;
+  if (output_capacity < TELEMETRY_WIRE_FRAME_MAX_SIZE) {
+    return TELEMETRY_RESULT_OUTPUT_TOO_SMALL;
+  }
+
+  uint8_t* payload = payload_slot(output, output_capacity - 1);
+  size_t payload_length = 0;
+  telemetry_result_t result =
+      encode_batch_msgpack(batch, sequence, payload, TELEMETRY_MSGPACK_MAX_SIZE, &payload_length);
+  if (result != TELEMETRY_RESULT_OK) {
+    return result;
+  }
+
+  size_t frame_length = 0;
+  result = frame_payload(output, output_capacity - 1, encoder->fec, payload, payload_length, &frame_length);
+  if (result != TELEMETRY_RESULT_OK) {
+    return result;
+  }
+  output[frame_length++] = 0x00;
+  *output_length = frame_length;
+
+  // Batch values are always quantized, so the display holds the rounded value.
+  size_t channels[TELEMETRY_BATCH_MAX_CHANNELS];
+  size_t channel_count = 0;
+  batch_channels(batch->field_mask, TELEMETRY_DELTA_FULL_MASK, channels, &channel_count);
+  for (size_t c = 0; c < channel_count; ++c) {
+    const size_t i = channels[c];
+    const float value = batch->values[batch->sample_count - 1][c];
+    *float_field(&encoder->reference, i) = dequantize_field(i, quantize_field(i, value));
+  }
+  return TELEMETRY_RESULT_OK;
+}
+
+void telemetry_decoder_init(telemetry_decoder_t* decoder) {
+  if (decoder != NULL) {
+    memset(decoder, 0, sizeof(*decoder));
+    decoder->schema.plan = k_local_plan;
+    decoder->schema.plan.layout_id = telemetry_local_layout_id();
+  }
+}
+
+telemetry_result_t telemetry_decoder_decode(telemetry_decoder_t* decoder, const uint8_t* frame,
+                                            size_t frame_length, vehicle_state_t* packet) {
+  if (decoder == NULL || frame == NULL || packet == NULL || frame_length == 0) {
+    return TELEMETRY_RESULT_INVALID_ARGUMENT;
+  }
+
+  bool corrected = false;
+  const telemetry_result_t result =
+      decode_frame(frame, frame_length, decoder->has_keyframe ? &decoder->state : NULL, &decoder->state,
+                   &decoder->batch, &decoder->control, &decoder->schema, &corrected);
+  if (corrected) {
+    decoder->fec_corrected_frames++;
+  }
+  if (result != TELEMETRY_RESULT_OK) {
+    return result;
+  }
+
+  decoder->has_keyframe = true;
+  *packet = decoder->state;
+  return TELEMETRY_RESULT_OK;
+}
+
+const telemetry_sample_batch_t* telemetry_decoder_last_batch(const telemetry_decoder_t* decoder) {
+  if (decoder == NULL || decoder->batch.sample_count == 0) {
+    return NULL;
+  }
+  return &decoder->batch;
+}
+
+const telemetry_control_t* telemetry_decoder_last_control(const telemetry_decoder_t* decoder) {
+  return decoder != NULL ? &decoder->control : NULL;
+}
+
+void telemetry_stream_decoder_init(telemetry_stream_decoder_t* stream) {
+  if (stream == NULL) {
+    return;
+  }
+  telemetry_decoder_init(&stream->decoder);
+  telemetry_stream_decoder_reset(stream);
+}
+
+void telemetry_stream_decoder_reset(telemetry_stream_decoder_t* stream) {
+  if (stream == NULL) {
+    return;
+  }
+  stream->raw_length = 0;
+  stream->encoded_length = 0;
+  stream->crc = TELEMETRY_CRC16_INIT;
+  stream->block_remaining = 0;
+  stream->zero_pending = false;
+  stream->error = TELEMETRY_RESULT_OK;
+}
+
+bool telemetry_stream_decoder_in_frame(const telemetry_stream_decoder_t* stream) {
+  return stream != NULL && stream->encoded_length > 0;
+}
+
+// Validates the frame that just ended. Running the CRC over the payload and
+// its big-endian CRC leaves a zero remainder when they match, because
+// CRC-16/CCITT-FALSE has no reflection or final XOR. FEC frames never match
+// here and are checked from the buffered raw bytes instead.
+static telemetry_result_t stream_finish_frame(telemetry_stream_decoder_t* stream, vehicle_state_t* packet) {
+  telemetry_result_t result = stream->error;
+  if (result == TELEMETRY_RESULT_OK) {
+    if (stream->block_remaining != 0) {
+      result = TELEMETRY_RESULT_COBS_ERROR;
+    } else if (stream->raw_length < 3) {
+      result = TELEMETRY_RESULT_MSGPACK_ERROR;
+    } else {
+      telemetry_decoder_t* decoder = &stream->decoder;
+      bool corrected = false;
+      result = decode_raw_frame(stream->raw, stream->raw_length, stream->crc == 0,
+                                decoder->has_keyframe ? &decoder->state : NULL, &decoder->state, &decoder->batch,
+                                &decoder->control, &decoder->schema, &corrected);
+      if (corrected) {
+        decoder->fec_corrected_frames++;
+      }
+      if (result == TELEMETRY_RESULT_OK) {
+        decoder->has_keyframe = true;
+        *packet = decoder->state;
+      }
+    }
+  }
+
+  telemetry_stream_decoder_reset(stream);
+  return result;
+}
+
+telemetry_result_t telemetry_stream_decoder_feed(telemetry_stream_decoder_t* stream, const uint8_t* data,
+                                                 size_t length, size_t* consumed, vehicle_state_t* packet) {
+  if (consumed != NULL) {
+    *consumed = 0;
+  }
+  if (stream == NULL || (data == NULL && length > 0) || consumed == NULL || packet == NULL) {
+    return TELEMETRY_RESULT_INVALID_ARGUMENT;
+  }
+
+  size_t i = 0;
+  while (i < length) {
+    if (stream->error != TELEMETRY_RESULT_OK) {
+      // Discard the rest of a bad frame.
+      const uint8_t* delimiter = memchr(data + i, 0x00, length - i);
+      if (delimiter == NULL) {
+        break;
+      }
+      i = (size_t)(delimiter - data);
+    }
+
+    if (data[i] == 0x00) {
+      i++;
+      if (stream->encoded_length == 0) {
+        continue;
+      }
+      *consumed = i;
+      return stream_finish_frame(stream, packet);
+    }
+
+    if (stream->block_remaining == 0) {
+      // COBS code byte: the previous block's implied zero belongs to the data
+      // only now that another block follows it.
+      const uint8_t code = data[i++];
+      if (++stream->encoded_length > TELEMETRY_COBS_FRAME_MAX_SIZE) {
+        stream->error = TELEMETRY_RESULT_FRAME_TOO_LARGE;
+        continue;
+      }
+      if (stream->zero_pending) {
+        if (stream->raw_length >= sizeof(stream->raw)) {
+          stream->error = TELEMETRY_RESULT_COBS_ERROR;
+          continue;
+        }
+        stream->raw[stream->raw_length++] = 0x00;
+        stream->crc = crc16_ccitt_false_step(stream->crc, 0x00);
+      }
+      stream->block_remaining = (uint8_t)(code - 1U);
+      stream->zero_pending = code < 0xFFU;
+      continue;
+    }
+
+    // Copy the run of data bytes in this block that has arrived, stopping
+    // early at a delimiter (which truncates the block).
+    size_t run = length - i < stream->block_remaining ? length - i : stream->block_remaining;
+    const uint8_t* delimiter = memchr(data + i, 0x00, run);
+    if (delimiter != NULL) {
+      run = (size_t)(delimiter - (data + i));
+    }
+    if (stream->encoded_length + run > TELEMETRY_COBS_FRAME_MAX_SIZE) {
+      stream->encoded_length = TELEMETRY_COBS_FRAME_MAX_SIZE + 1U;
+      stream->error = TELEMETRY_RESULT_FRAME_TOO_LARGE;
+      continue;
+    }
+    if (stream->raw_length + run > sizeof(stream->raw)) {
+      stream->error = TELEMETRY_RESULT_COBS_ERROR;
+      continue;
+    }
+
+    uint16_t crc = stream->crc;
+    uint8_t* raw = stream->raw + stream->raw_length;
+    for (size_t n = 0; n < run; ++n) {
+      const uint8_t byte = data[i + n];
+      raw[n] = byte;
+      crc = crc16_ccitt_false_step(crc, byte);
+    }
+    stream->crc = crc;
+    stream->raw_length += run;
+    stream->encoded_length += run;
+    stream->block_remaining = (uint8_t)(stream->block_remaining - run);
+    i += run;
   }
 
-  return decode_msgpack(raw_frame, payload_length, packet);
+  *consumed = length;
+  return TELEMETRY_RESULT_INCOMPLETE;
 }
 
 const char* telemetry_result_name(telemetry_result_t result) {
@@ -166,6 +1588,14 @@ const char* telemetry_result_name(telemetry_result_t result) {
       return "MessagePack error";
     case TELEMETRY_RESULT_SCHEMA_ERROR:
       return "schema error";
+    case TELEMETRY_RESULT_NEED_KEYFRAME:
+      return "delta frame before keyframe";
+    case TELEMETRY_RESULT_INCOMPLETE:
+      return "incomplete frame";
+    case TELEMETRY_RESULT_CONTROL:
+      return "control frame";
+    case TELEMETRY_RESULT_DESCRIPTOR:
+      return "schema descriptor";
     default:
       return "unknown error";
   }
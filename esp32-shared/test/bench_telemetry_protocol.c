@@ -0,0 +1,561 @@
+// Host benchmark for the telemetry codec.
+//
+// Encoder: compares the original framing path (bit-at-a-time CRC over a raw
+// copy, then a separate COBS pass) against the fused single-pass frame writer,
+// and times the complete hub-side encode including MessagePack.
+//
+// Decoder: feeds megabytes of a recorded-style delta stream, clean and with
+// injected corruption, through the display's previous buffer/rescan/memmove
+// receive loop and through the streaming decoder.
+//
+// FEC: decodes the same stream with and without Reed-Solomon parity after
+// injecting random bit errors at several rates, and reports the decode cost and
+// the share of frames delivered.
+//
+// Primitives: times the CRC, cobs_encode()/cobs_decode() and the public frame
+// encode/decode calls on a representative payload and on COBS worst cases (all
+// zero bytes, which make every byte its own block, and a full 254-byte block).
+//
+// Pass --csv to print one machine-readable row per result instead of the table.
+
+#define _POSIX_C_SOURCE 199309L
+
+#include <math.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "cobs.h"
+#include "telemetry_protocol.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define BENCH_HAVE_CYCLES 1
+static uint64_t read_cycles(void) { return __rdtsc(); }
+#else
+#define BENCH_HAVE_CYCLES 0
+static uint64_t read_cycles(void) { return 0; }
+#endif
+
+#define BENCH_ITERATIONS 2000000U
+
+static volatile uint32_t s_sink;
+
+static uint64_t now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+// Previous implementation, kept here as the "before" reference.
+static uint16_t bitwise_crc16_ccitt_false(const uint8_t* data, size_t length) {
+  uint16_t crc = 0xFFFFU;
+  for (size_t i = 0; i < length; ++i) {
+    crc ^= (uint16_t)data[i] << 8;
+    for (uint8_t bit = 0; bit < 8; ++bit) {
+      crc = (crc & 0x8000U) ? (uint16_t)((crc << 1) ^ 0x1021U) : (uint16_t)(crc << 1);
+    }
+  }
+  return crc;
+}
+
+static size_t legacy_frame(const uint8_t* payload, size_t payload_length, uint8_t* output) {
+  uint8_t raw_frame[TELEMETRY_RAW_FRAME_MAX_SIZE];
+  memcpy(raw_frame, payload, payload_length);
+  const uint16_t crc = bitwise_crc16_ccitt_false(raw_frame, payload_length);
+  raw_frame[payload_length] = (uint8_t)(crc >> 8);
+  raw_frame[payload_length + 1] = (uint8_t)crc;
+  return cobs_encode(raw_frame, payload_length + 2, output);
+}
+
+static size_t fused_frame(const uint8_t* payload, size_t payload_length, uint8_t* output) {
+  telemetry_frame_writer_t writer;
+  telemetry_frame_writer_init(&writer, output, TELEMETRY_COBS_FRAME_MAX_SIZE);
+  telemetry_frame_writer_append(&writer, payload, payload_length);
+  size_t length = 0;
+  telemetry_frame_writer_finish(&writer, &length);
+  return length;
+}
+
+typedef size_t (*frame_fn_t)(const uint8_t* payload, size_t payload_length, uint8_t* output);
+
+static bool s_csv = false;
+
+#define CSV_HEADER \
+  "benchmark,bytes_per_op,ops,ns_per_op,ns_per_byte,ops_per_sec,mb_per_sec,cycles_per_op,ok,rejected,corrected"
+
+// Prints a section heading in table mode; CSV output has no headings.
+static void section(const char* format, ...) {
+  if (s_csv) {
+    return;
+  }
+  va_list args;
+  va_start(args, format);
+  vprintf(format, args);
+  va_end(args);
+}
+
+// One result: `ops` operations of `bytes_per_op` bytes each took `elapsed_ns`.
+// `counts` is only given for the stream receivers.
+typedef struct {
+  uint32_t ok;
+  uint32_t rejected;
+  uint32_t corrected;  // accepted after FEC repair
+} decode_counts_t;
+
+static void report_result(const char* name, size_t bytes_per_op, uint64_t ops, uint64_t elapsed_ns,
+                          uint64_t elapsed_cycles, const decode_counts_t* counts) {
+  const double ns_per_op = (double)elapsed_ns / (double)ops;
+  const double ns_per_byte = ns_per_op / (double)bytes_per_op;
+  const double ops_per_sec = 1e9 / ns_per_op;
+  const double mb_per_sec = 1e3 / ns_per_byte;
+  const double cycles_per_op = BENCH_HAVE_CYCLES ? (double)elapsed_cycles / (double)ops : 0.0;
+  if (s_csv) {
+    printf("%s,%u,%llu,%.2f,%.3f,%.0f,%.1f,%.1f,", name, (unsigned)bytes_per_op, (unsigned long long)ops, ns_per_op,
+           ns_per_byte, ops_per_sec, mb_per_sec, cycles_per_op);
+    if (counts != NULL) {
+      printf("%u,%u,%u", (unsigned)counts->ok, (unsigned)counts->rejected, (unsigned)counts->corrected);
+    } else {
+      fputs(",,", stdout);
+    }
+    putchar('\n');
+    return;
+  }
+
+  if (counts != NULL) {
+    printf("%-26s %9.2f ns/byte %8.1f MB/s", name, ns_per_byte, mb_per_sec);
+    if (BENCH_HAVE_CYCLES) {
+      printf(" %7.1f cycles/byte", (double)elapsed_cycles / ((double)ops * (double)bytes_per_op));
+    }
+    printf("  ok=%u rejected=%u\n", (unsigned)counts->ok, (unsigned)counts->rejected);
+    return;
+  }
+  printf("%-26s %9.1f ns/op %7.2f ns/byte %10.0f ops/s", name, ns_per_op, ns_per_byte, ops_per_sec);
+  if (BENCH_HAVE_CYCLES) {
+    printf(" %9.1f cycles/op", cycles_per_op);
+  }
+  putchar('\n');
+}
+
+static void bench_framing(const char* name, frame_fn_t fn, const uint8_t* payload, size_t payload_length) {
+  uint8_t output[TELEMETRY_COBS_FRAME_MAX_SIZE];
+  const uint64_t start_ns = now_ns();
+  const uint64_t start_cycles = read_cycles();
+  for (uint32_t i = 0; i < BENCH_ITERATIONS; ++i) {
+    s_sink += (uint32_t)fn(payload, payload_length, output);
+    s_sink += output[i % 8];
+  }
+  report_result(name, payload_length, BENCH_ITERATIONS, now_ns() - start_ns, read_cycles() - start_cycles, NULL);
+}
+
+static void bench_full_encode(const vehicle_state_t* state) {
+  uint8_t wire[TELEMETRY_WIRE_FRAME_MAX_SIZE];
+  vehicle_state_t packet = *state;
+  size_t length = 0;
+  const uint64_t start_ns = now_ns();
+  const uint64_t start_cycles = read_cycles();
+  for (uint32_t i = 0; i < BENCH_ITERATIONS; ++i) {
+    packet.sequence = i;
+    telemetry_frame_encode_wire(&packet, wire, sizeof(wire), &length);
+    s_sink += (uint32_t)length;
+  }
+  report_result("encode_wire", length, BENCH_ITERATIONS, now_ns() - start_ns, read_cycles() - start_cycles,
+                NULL);
+}
+
+#define DECODE_STREAM_BYTES (4U * 1024U * 1024U)
+#define DECODE_PASSES 5U
+#define UART_READ_CHUNK 120U     // a typical uart_read_bytes() return at 115200 baud
+#define LEGACY_RX_BUFFER 512U    // CONFIG_DD_UART_BUFFER_SIZE default
+
+// Hub-style stream: deltas with periodic keyframes from a slowly varying state.
+// `frames` receives the number of frames written.
+static size_t build_stream(uint8_t* stream, size_t capacity, bool fec, uint32_t* frames) {
+  telemetry_delta_encoder_t encoder;
+  telemetry_delta_encoder_init(&encoder, 30);
+  telemetry_delta_encoder_set_fec(&encoder, fec);
+  vehicle_state_t state = {.dam = 1.0f, .af_ratio = 14.7f, .water_temp = 190.0f, .oil_temp = 210.0f};
+  size_t length = 0;
+  for (uint32_t i = 0; length + TELEMETRY_WIRE_FRAME_MAX_SIZE <= capacity; ++i) {
+    state.sequence = i;
+    state.timestamp_ms = i * 33U;
+    state.engine_rpm = 2500.0f + (float)((i * 37U) % 4000U);
+    state.throttle_pos = (float)(i % 100U);
+    state.brake_pressure_bar = (float)((i / 3U) % 40U);
+    state.steering_angle_deg = (float)((int)(i % 360U) - 180);
+    state.oil_pressure = 40.0f + (float)(i % 20U) * 0.5f;
+    state.oil_pressure_raw = state.oil_pressure + (float)(i % 3U);
+    state.water_temp = 190.0f + (float)((i / 200U) % 20U);
+    size_t frame_length = 0;
+    telemetry_delta_encoder_encode_wire(&encoder, &state, stream + length, capacity - length, &frame_length);
+    length += frame_length;
+    *frames = i + 1U;
+  }
+  return length;
+}
+
+// Bit flips, dropped bytes and spurious delimiters, about one event per 500 bytes.
+static void corrupt_stream(uint8_t* stream, size_t* length) {
+  uint32_t seed = 0xC0FFEEU;
+  size_t write = 0;
+  for (size_t read = 0; read < *length; ++read) {
+    seed = seed * 1103515245U + 12345U;
+    const uint32_t roll = (seed >> 16) % 1500U;
+    if (roll == 0) {
+      continue;
+    }
+    uint8_t byte = stream[read];
+    if (roll == 1) {
+      byte ^= (uint8_t)(1U << ((seed >> 8) & 7U));
+    } else if (roll == 2) {
+      byte = 0x00;
+    }
+    stream[write++] = byte;
+  }
+  *length = write;
+}
+
+// The display's receive loop before the streaming decoder: append, rescan from
+// the start for a delimiter, decode, memmove the remainder down.
+static void legacy_receive(const uint8_t* stream, size_t length, decode_counts_t* counts) {
+  static uint8_t rx_buf[LEGACY_RX_BUFFER];
+  size_t rx_len = 0;
+  telemetry_decoder_t decoder;
+  telemetry_decoder_init(&decoder);
+
+  for (size_t offset = 0; offset < length;) {
+    size_t chunk = length - offset < UART_READ_CHUNK ? length - offset : UART_READ_CHUNK;
+    if (chunk > sizeof(rx_buf) - rx_len) {
+      chunk = sizeof(rx_buf) - rx_len;
+    }
+    memcpy(rx_buf + rx_len, stream + offset, chunk);
+    rx_len += chunk;
+    offset += chunk;
+
+    for (;;) {
+      size_t delimiter = 0;
+      while (delimiter < rx_len && rx_buf[delimiter] != 0x00) {
+        delimiter++;
+      }
+      if (delimiter == rx_len) {
+        break;
+      }
+      if (delimiter > 0) {
+        vehicle_state_t packet;
+        if (telemetry_decoder_decode(&decoder, rx_buf, delimiter, &packet) == TELEMETRY_RESULT_OK) {
+          counts->ok++;
+          s_sink += packet.sequence;
+        } else {
+          counts->rejected++;
+        }
+      }
+      memmove(rx_buf, rx_buf + delimiter + 1, rx_len - delimiter - 1);
+      rx_len -= delimiter + 1;
+    }
+    if (rx_len == sizeof(rx_buf)) {
+      rx_len = 0;
+    }
+  }
+}
+
+static void stream_receive(const uint8_t* stream, size_t length, decode_counts_t* counts) {
+  static telemetry_stream_decoder_t decoder;
+  telemetry_stream_decoder_init(&decoder);
+
+  for (size_t offset = 0; offset < length;) {
+    const size_t chunk = length - offset < UART_READ_CHUNK ? length - offset : UART_READ_CHUNK;
+    const uint8_t* data = stream + offset;
+    size_t remaining = chunk;
+    while (remaining > 0) {
+      vehicle_state_t packet;
+      size_t consumed = 0;
+      const telemetry_result_t result = telemetry_stream_decoder_feed(&decoder, data, remaining, &consumed, &packet);
+      data += consumed;
+      remaining -= consumed;
+      if (result == TELEMETRY_RESULT_OK) {
+        counts->ok++;
+        s_sink += packet.sequence;
+      } else if (result != TELEMETRY_RESULT_INCOMPLETE) {
+        counts->rejected++;
+      }
+    }
+    offset += chunk;
+  }
+  counts->corrected = decoder.decoder.fec_corrected_frames;
+}
+
+typedef void (*receive_fn_t)(const uint8_t* stream, size_t length, decode_counts_t* counts);
+
+static decode_counts_t bench_receive(const char* name, receive_fn_t fn, const uint8_t* stream, size_t length) {
+  decode_counts_t counts = {0};
+  const uint64_t start_ns = now_ns();
+  const uint64_t start_cycles = read_cycles();
+  for (uint32_t pass = 0; pass < DECODE_PASSES; ++pass) {
+    counts = (decode_counts_t){0};
+    fn(stream, length, &counts);
+  }
+  report_result(name, length, DECODE_PASSES, now_ns() - start_ns, read_cycles() - start_cycles, &counts);
+  return counts;
+}
+
+static int bench_decode(void) {
+  uint8_t* stream = malloc(DECODE_STREAM_BYTES);
+  if (stream == NULL) {
+    fputs("out of memory\n", stderr);
+    return 1;
+  }
+  uint32_t frames = 0;
+  size_t length = build_stream(stream, DECODE_STREAM_BYTES, false, &frames);
+
+  int failures = 0;
+  for (int corrupted = 0; corrupted < 2; ++corrupted) {
+    if (corrupted) {
+      corrupt_stream(stream, &length);
+    }
+    section("decode %s stream, %u bytes x %u passes, %u-byte reads\n", corrupted ? "corrupted" : "clean",
+            (unsigned)length, (unsigned)DECODE_PASSES, (unsigned)UART_READ_CHUNK);
+    const decode_counts_t before =
+        bench_receive(corrupted ? "receive_legacy_corrupted" : "receive_legacy_clean", legacy_receive, stream, length);
+    const decode_counts_t after =
+        bench_receive(corrupted ? "receive_stream_corrupted" : "receive_stream_clean", stream_receive, stream, length);
+    if (before.ok != after.ok || before.rejected != after.rejected) {
+      fputs("decoders disagree\n", stderr);
+      failures++;
+    }
+  }
+
+  free(stream);
+  return failures;
+}
+
+#define FEC_STREAM_BYTES (1024U * 1024U)
+
+static const double k_bit_error_rates[] = {0.0, 1e-5, 1e-4, 1e-3, 3e-3};
+
+// Flips each bit independently with probability `rate`, drawing the gap to
+// the next flipped bit from a geometric distribution.
+static void inject_bit_errors(uint8_t* stream, size_t length, double rate) {
+  if (rate <= 0.0) {
+    return;
+  }
+  uint32_t seed = 0xB17E5U;
+  const double log_keep = log1p(-rate);
+  const size_t bits = length * 8U;
+  for (size_t bit = 0;; ++bit) {
+    seed = seed * 1103515245U + 12345U;
+    const double uniform = ((double)(seed >> 8) + 1.0) / 16777217.0;
+    bit += (size_t)(log(uniform) / log_keep);
+    if (bit >= bits) {
+      break;
+    }
+    stream[bit / 8U] ^= (uint8_t)(1U << (bit % 8U));
+  }
+}
+
+static int bench_fec(void) {
+  uint8_t* clean[2] = {malloc(FEC_STREAM_BYTES), malloc(FEC_STREAM_BYTES)};
+  uint8_t* noisy = malloc(FEC_STREAM_BYTES);
+  if (clean[0] == NULL || clean[1] == NULL || noisy == NULL) {
+    fputs("out of memory\n", stderr);
+    return 1;
+  }
+  size_t lengths[2];
+  uint32_t frames[2];
+  for (int fec = 0; fec < 2; ++fec) {
+    lengths[fec] = build_stream(clean[fec], FEC_STREAM_BYTES, fec != 0, &frames[fec]);
+  }
+  section("FEC, %u-byte streams, %.1f bytes/frame plain, %.1f with parity\n", (unsigned)FEC_STREAM_BYTES,
+          (double)lengths[0] / frames[0], (double)lengths[1] / frames[1]);
+
+  for (size_t r = 0; r < sizeof(k_bit_error_rates) / sizeof(k_bit_error_rates[0]); ++r) {
+    for (int fec = 0; fec < 2; ++fec) {
+      memcpy(noisy, clean[fec], lengths[fec]);
+      inject_bit_errors(noisy, lengths[fec], k_bit_error_rates[r]);
+      char name[40];
+      snprintf(name, sizeof(name), "receive_%s_ber_%.0e", fec ? "fec" : "plain", k_bit_error_rates[r]);
+      const decode_counts_t counts = bench_receive(name, stream_receive, noisy, lengths[fec]);
+      section("%26s delivered %6.2f%% of %u frames, %u repaired\n", "", 100.0 * counts.ok / frames[fec],
+              (unsigned)frames[fec], (unsigned)counts.corrected);
+    }
+  }
+
+  free(clean[0]);
+  free(clean[1]);
+  free(noisy);
+  return 0;
+}
+
+// Primitive operations, each run BENCH_ITERATIONS times over one input.
+typedef struct {
+  const uint8_t* input;
+  size_t input_length;
+  uint8_t output[512];
+  const vehicle_state_t* state;
+} primitive_ctx_t;
+
+typedef size_t (*primitive_fn_t)(primitive_ctx_t* ctx, uint32_t iteration);
+
+static size_t op_crc(primitive_ctx_t* ctx, uint32_t iteration) {
+  (void)iteration;
+  return telemetry_crc16_ccitt_false(ctx->input, ctx->input_length);
+}
+
+static size_t op_cobs_encode(primitive_ctx_t* ctx, uint32_t iteration) {
+  (void)iteration;
+  return cobs_encode(ctx->input, ctx->input_length, ctx->output);
+}
+
+static size_t op_cobs_decode(primitive_ctx_t* ctx, uint32_t iteration) {
+  (void)iteration;
+  size_t length = 0;
+  return cobs_decode(ctx->input, ctx->input_length, ctx->output, sizeof(ctx->output), &length) ? length : 0;
+}
+
+static size_t op_frame_encode(primitive_ctx_t* ctx, uint32_t iteration) {
+  vehicle_state_t packet = *ctx->state;
+  packet.sequence = iteration;
+  size_t length = 0;
+  telemetry_frame_encode(&packet, ctx->output, sizeof(ctx->output), &length);
+  return length;
+}
+
+static size_t op_frame_decode(primitive_ctx_t* ctx, uint32_t iteration) {
+  (void)iteration;
+  vehicle_state_t packet;
+  return telemetry_frame_decode(ctx->input, ctx->input_length, &packet) == TELEMETRY_RESULT_OK ? packet.sequence : 0;
+}
+
+static void bench_primitive(const char* name, primitive_fn_t fn, primitive_ctx_t* ctx, size_t bytes_per_op) {
+  const uint64_t start_ns = now_ns();
+  const uint64_t start_cycles = read_cycles();
+  for (uint32_t i = 0; i < BENCH_ITERATIONS; ++i) {
+    s_sink += (uint32_t)fn(ctx, i);
+  }
+  report_result(name, bytes_per_op, BENCH_ITERATIONS, now_ns() - start_ns, read_cycles() - start_cycles, NULL);
+}
+
+static int bench_primitives(const vehicle_state_t* state, const uint8_t* payload, size_t payload_length) {
+  static uint8_t zeros[TELEMETRY_MSGPACK_MAX_SIZE];
+  static uint8_t block[254];
+  for (size_t i = 0; i < sizeof(block); ++i) {
+    block[i] = (uint8_t)(1U + i % 255U);
+  }
+
+  const struct {
+    const char* name;
+    const uint8_t* data;
+    size_t length;
+  } inputs[] = {
+      {"payload", payload, payload_length},
+      {"zeros", zeros, sizeof(zeros)},
+      {"block254", block, sizeof(block)},
+  };
+
+  section("primitives, %u iterations\n", (unsigned)BENCH_ITERATIONS);
+  for (size_t i = 0; i < sizeof(inputs) / sizeof(inputs[0]); ++i) {
+    char name[48];
+    primitive_ctx_t ctx = {.input = inputs[i].data, .input_length = inputs[i].length};
+    snprintf(name, sizeof(name), "crc16_%s", inputs[i].name);
+    bench_primitive(name, op_crc, &ctx, inputs[i].length);
+    snprintf(name, sizeof(name), "cobs_encode_%s", inputs[i].name);
+    bench_primitive(name, op_cobs_encode, &ctx, inputs[i].length);
+
+    uint8_t encoded[512];
+    primitive_ctx_t decode_ctx = {.input = encoded};
+    decode_ctx.input_length = cobs_encode(inputs[i].data, inputs[i].length, encoded);
+    snprintf(name, sizeof(name), "cobs_decode_%s", inputs[i].name);
+    bench_primitive(name, op_cobs_decode, &decode_ctx, inputs[i].length);
+  }
+
+  uint8_t frame[TELEMETRY_COBS_FRAME_MAX_SIZE];
+  size_t frame_length = 0;
+  vehicle_state_t probe;
+  if (telemetry_frame_encode(state, frame, sizeof(frame), &frame_length) != TELEMETRY_RESULT_OK ||
+      telemetry_frame_decode(frame, frame_length, &probe) != TELEMETRY_RESULT_OK) {
+    fputs("failed to build benchmark frame\n", stderr);
+    return 1;
+  }
+  primitive_ctx_t encode_ctx = {.state = state};
+  bench_primitive("frame_encode", op_frame_encode, &encode_ctx, frame_length);
+
+  primitive_ctx_t decode_ctx = {.input = frame, .input_length = frame_length};
+  bench_primitive("frame_decode", op_frame_decode, &decode_ctx, frame_length);
+
+  // Same frame with one flipped payload bit: valid COBS, rejected at the CRC.
+  uint8_t raw[TELEMETRY_RAW_FRAME_MAX_SIZE];
+  size_t raw_length = 0;
+  cobs_decode(frame, frame_length, raw, sizeof(raw), &raw_length);
+  raw[raw_length / 2] ^= 0x01;
+  decode_ctx.input_length = cobs_encode(raw, raw_length, frame);
+  bench_primitive("frame_decode_bad_crc", op_frame_decode, &decode_ctx, decode_ctx.input_length);
+  return 0;
+}
+
+int main(int argc, char** argv) {
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "--csv") == 0) {
+      s_csv = true;
+    } else {
+      fprintf(stderr, "usage: %s [--csv]\n", argv[0]);
+      return 2;
+    }
+  }
+
+  const vehicle_state_t state = {
+      .sequence = 123456,
+      .timestamp_ms = 987654,
+      .water_temp = 195.4f,
+      .oil_temp = 231.8f,
+      .oil_pressure = 62.5f,
+      .oil_pressure_raw = 63.1f,
+      .dam = 1.0f,
+      .af_learned = -2.34f,
+      .af_ratio = 14.7f,
+      .int_temp = 88.0f,
+      .fb_knock = -1.41f,
+      .af_correct = 1.56f,
+      .inj_duty = 42.0f,
+      .eth_conc = 15.0f,
+      .engine_rpm = 4321.0f,
+      .throttle_pos = 57.0f,
+      .brake_pressure_bar = 12.0f,
+      .steering_angle_deg = -35.5f,
+  };
+
+  // Recover the MessagePack payload so both framing paths see identical input.
+  uint8_t frame[TELEMETRY_COBS_FRAME_MAX_SIZE];
+  uint8_t raw[TELEMETRY_RAW_FRAME_MAX_SIZE];
+  size_t frame_length = 0;
+  size_t raw_length = 0;
+  if (telemetry_frame_encode(&state, frame, sizeof(frame), &frame_length) != TELEMETRY_RESULT_OK ||
+      !cobs_decode(frame, frame_length, raw, sizeof(raw), &raw_length)) {
+    fputs("failed to build benchmark payload\n", stderr);
+    return 1;
+  }
+  const size_t payload_length = raw_length - 2;
+
+  if (s_csv) {
+    puts(CSV_HEADER);
+  }
+  section("payload %u bytes, %u iterations\n", (unsigned)payload_length, (unsigned)BENCH_ITERATIONS);
+  bench_framing("framing_legacy", legacy_frame, raw, payload_length);
+  bench_framing("framing_fused", fused_frame, raw, payload_length);
+  bench_full_encode(&state);
+  section("\n");
+  if (bench_primitives(&state, raw, payload_length) != 0) {
+    return 1;
+  }
+  section("\n");
+  if (bench_decode() != 0) {
+    return 1;
+  }
+  section("\n");
+  if (bench_fec() != 0) {
+    return 1;
+  }
+  return s_sink == 0xFFFFFFFFU;
+}
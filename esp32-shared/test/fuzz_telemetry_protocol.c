@@ -0,0 +1,315 @@
+// Fuzz harness for the telemetry decoders.
+//
+// Each input is treated as a raw UART byte stream and run through:
+//   - the frame decoder, split on 0x00 delimiters (telemetry_decoder_decode()),
+//   - the streaming decoder, fed in chunks whose size comes from the first byte,
+//   - a full re-encode and decode of every accepted state.
+// The two receivers must accept and reject exactly the same frames with the
+// same merged states and batches, must repair the same number of frames with
+// FEC, must never read or write out of bounds, and
+// accepted states must survive a round trip bit for bit.
+//
+// Built with -DTELEMETRY_FUZZ_LIBFUZZER and -fsanitize=fuzzer this is a
+// libFuzzer target. Otherwise main() runs a fixed number of generated inputs:
+// random bytes and hub-style streams (full, delta, quantized, batch, control
+// and descriptor frames, with or without FEC parity) with bit flips, dropped
+// bytes, stray delimiters and splices.
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "telemetry_protocol.h"
+
+#define FUZZ_MAX_INPUT 4096U
+#define FUZZ_MAX_FRAMES (FUZZ_MAX_INPUT / 2U + 1U)
+
+#define FUZZ_CHECK(cond)                                                       \
+  do {                                                                         \
+    if (!(cond)) {                                                             \
+      fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+      abort();                                                                 \
+    }                                                                          \
+  } while (0)
+
+typedef struct {
+  telemetry_result_t results[FUZZ_MAX_FRAMES];
+  vehicle_state_t packets[FUZZ_MAX_FRAMES];
+  telemetry_sample_batch_t batches[FUZZ_MAX_FRAMES];
+  telemetry_control_t controls[FUZZ_MAX_FRAMES];
+  size_t count;
+  uint32_t fec_corrected_frames;
+} fuzz_outcome_t;
+
+static fuzz_outcome_t s_frame_outcome;
+static fuzz_outcome_t s_stream_outcome;
+
+static void record(fuzz_outcome_t* outcome, telemetry_result_t result, const vehicle_state_t* packet,
+                   const telemetry_decoder_t* decoder) {
+  FUZZ_CHECK(outcome->count < FUZZ_MAX_FRAMES);
+  FUZZ_CHECK(result >= TELEMETRY_RESULT_OK && result <= TELEMETRY_RESULT_DESCRIPTOR &&
+             result != TELEMETRY_RESULT_INCOMPLETE);
+  const size_t i = outcome->count++;
+  outcome->results[i] = result;
+  memset(&outcome->packets[i], 0, sizeof(outcome->packets[i]));
+  memset(&outcome->batches[i], 0, sizeof(outcome->batches[i]));
+  memset(&outcome->controls[i], 0, sizeof(outcome->controls[i]));
+  if (result == TELEMETRY_RESULT_CONTROL) {
+    outcome->controls[i] = *telemetry_decoder_last_control(decoder);
+  }
+  if (result == TELEMETRY_RESULT_OK) {
+    outcome->packets[i] = *packet;
+    const telemetry_sample_batch_t* batch = telemetry_decoder_last_batch(decoder);
+    if (batch != NULL) {
+      FUZZ_CHECK(batch->sample_count > 0 && batch->sample_count <= TELEMETRY_BATCH_MAX_SAMPLES);
+      outcome->batches[i] = *batch;
+    }
+  }
+}
+
+static void decode_frames(const uint8_t* data, size_t size) {
+  static telemetry_decoder_t decoder;
+  telemetry_decoder_init(&decoder);
+  s_frame_outcome.count = 0;
+  size_t start = 0;
+  for (size_t i = 0; i < size; ++i) {
+    if (data[i] != 0x00) {
+      continue;
+    }
+    if (i > start) {
+      const telemetry_decoder_t before = decoder;
+      vehicle_state_t packet;
+      memset(&packet, 0xA5, sizeof(packet));
+      const vehicle_state_t sentinel = packet;
+      const telemetry_result_t result = telemetry_decoder_decode(&decoder, data + start, i - start, &packet);
+      if (result != TELEMETRY_RESULT_OK) {
+        FUZZ_CHECK(memcmp(&packet, &sentinel, sizeof(packet)) == 0);
+        FUZZ_CHECK(memcmp(&decoder.state, &before.state, sizeof(decoder.state)) == 0);
+      }
+      record(&s_frame_outcome, result, &packet, &decoder);
+    }
+    start = i + 1;
+  }
+  s_frame_outcome.fec_corrected_frames = decoder.fec_corrected_frames;
+}
+
+static void decode_stream(const uint8_t* data, size_t size, size_t chunk) {
+  static telemetry_stream_decoder_t stream;
+  telemetry_stream_decoder_init(&stream);
+  s_stream_outcome.count = 0;
+  for (size_t offset = 0; offset < size; offset += chunk) {
+    const uint8_t* next = data + offset;
+    size_t remaining = size - offset < chunk ? size - offset : chunk;
+    while (remaining > 0) {
+      vehicle_state_t packet;
+      size_t consumed = 0;
+      const telemetry_result_t result = telemetry_stream_decoder_feed(&stream, next, remaining, &consumed, &packet);
+      FUZZ_CHECK(consumed > 0 && consumed <= remaining);
+      next += consumed;
+      remaining -= consumed;
+      if (result != TELEMETRY_RESULT_INCOMPLETE) {
+        record(&s_stream_outcome, result, &packet, &stream.decoder);
+      }
+    }
+  }
+  s_stream_outcome.fec_corrected_frames = stream.decoder.fec_corrected_frames;
+}
+
+static bool batches_equal(const telemetry_sample_batch_t* a, const telemetry_sample_batch_t* b) {
+  return a->field_mask == b->field_mask && a->sample_count == b->sample_count &&
+         memcmp(a->timestamp_ms, b->timestamp_ms, sizeof(a->timestamp_ms)) == 0 &&
+         memcmp(a->values, b->values, sizeof(a->values)) == 0;
+}
+
+static void check_round_trip(const vehicle_state_t* packet) {
+  uint8_t wire[TELEMETRY_WIRE_FRAME_MAX_SIZE];
+  size_t wire_length = 0;
+  FUZZ_CHECK(telemetry_frame_encode_wire(packet, wire, sizeof(wire), &wire_length) == TELEMETRY_RESULT_OK);
+  FUZZ_CHECK(wire_length <= TELEMETRY_WIRE_FRAME_MAX_SIZE && wire[wire_length - 1] == 0x00);
+  FUZZ_CHECK(memchr(wire, 0x00, wire_length - 1) == NULL);
+  vehicle_state_t decoded;
+  FUZZ_CHECK(telemetry_frame_decode(wire, wire_length - 1, &decoded) == TELEMETRY_RESULT_OK);
+  FUZZ_CHECK(decoded.sequence == packet->sequence && decoded.timestamp_ms == packet->timestamp_ms);
+  FUZZ_CHECK(memcmp(&decoded.water_temp, &packet->water_temp, sizeof(float) * TELEMETRY_FLOAT_FIELD_COUNT) == 0);
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size);
+
+int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+  if (size == 0 || size > FUZZ_MAX_INPUT) {
+    return 0;
+  }
+
+  decode_frames(data, size);
+  decode_stream(data, size, (size_t)data[0] % 64U + 1U);
+
+  FUZZ_CHECK(s_frame_outcome.count == s_stream_outcome.count);
+  FUZZ_CHECK(s_frame_outcome.fec_corrected_frames == s_stream_outcome.fec_corrected_frames);
+  for (size_t i = 0; i < s_frame_outcome.count; ++i) {
+    FUZZ_CHECK(s_frame_outcome.results[i] == s_stream_outcome.results[i]);
+    FUZZ_CHECK(s_frame_outcome.controls[i].type == s_stream_outcome.controls[i].type &&
+               s_frame_outcome.controls[i].value == s_stream_outcome.controls[i].value &&
+               s_frame_outcome.controls[i].hub_rx_us == s_stream_outcome.controls[i].hub_rx_us &&
+               s_frame_outcome.controls[i].hub_tx_us == s_stream_outcome.controls[i].hub_tx_us);
+    if (s_frame_outcome.results[i] != TELEMETRY_RESULT_OK) {
+      continue;
+    }
+    FUZZ_CHECK(memcmp(&s_frame_outcome.packets[i], &s_stream_outcome.packets[i], sizeof(vehicle_state_t)) == 0);
+    FUZZ_CHECK(batches_equal(&s_frame_outcome.batches[i], &s_stream_outcome.batches[i]));
+    check_round_trip(&s_frame_outcome.packets[i]);
+  }
+  return 0;
+}
+
+#ifndef TELEMETRY_FUZZ_LIBFUZZER
+#define FUZZ_DEFAULT_ITERATIONS 20000U
+
+static uint32_t s_seed = 0x5EED1234U;
+
+static uint32_t next_random(void) {
+  s_seed = s_seed * 1103515245U + 12345U;
+  return s_seed >> 8;
+}
+
+// A short hub-style stream mixing every frame type the hub sends.
+static size_t build_valid_stream(uint8_t* stream, size_t capacity) {
+  telemetry_delta_encoder_t encoder;
+  telemetry_delta_encoder_init(&encoder, 1U + next_random() % 8U);
+  telemetry_delta_encoder_set_quantized(&encoder, next_random() % 2U == 0);
+  telemetry_delta_encoder_set_fec(&encoder, next_random() % 2U == 0);
+  telemetry_sample_batch_t batch;
+  telemetry_sample_batch_init(&batch, (1UL << TELEMETRY_CHANNEL_oil_pressure) |
+                                          (1UL << TELEMETRY_CHANNEL_oil_pressure_raw));
+  vehicle_state_t state = {.water_temp = 190.0f, .oil_temp = 210.0f, .dam = 1.0f, .af_ratio = 14.7f};
+
+  size_t length = 0;
+  for (uint32_t i = 0; length + 2U * TELEMETRY_WIRE_FRAME_MAX_SIZE <= capacity && i < 24U; ++i) {
+    state.sequence = i;
+    state.timestamp_ms += 20U;
+    state.engine_rpm = (float)(next_random() % 8000U);
+    state.throttle_pos = (float)(next_random() % 10000U) / 100.0f;
+    state.oil_pressure = (float)(next_random() % 10000U) / 100.0f;
+    state.oil_pressure_raw = state.oil_pressure + 0.5f;
+    state.fb_knock = next_random() % 16U == 0 ? -1.4f : 0.0f;
+    if (next_random() % 32U == 0) {
+      state.int_temp = isnan(state.int_temp) ? 80.0f : NAN;
+    }
+    telemetry_sample_batch_push(&batch, state.timestamp_ms, &state);
+
+    size_t frame_length = 0;
+    if (next_random() % 64U == 0) {
+      const telemetry_control_t pong = {.type = TELEMETRY_CONTROL_TIME_PONG,
+                                        .value = next_random(),
+                                        .hub_rx_us = next_random(),
+                                        .hub_tx_us = next_random()};
+      telemetry_control_encode_wire(&pong, stream + length, capacity - length, &frame_length);
+    } else if (next_random() % 32U == 0) {
+      const uint32_t index = next_random() % TELEMETRY_FLOAT_FIELD_COUNT;
+      telemetry_descriptor_encode_wire(telemetry_local_layout_id(), TELEMETRY_FLOAT_FIELD_COUNT, index,
+                                       &telemetry_local_descriptors()[index], stream + length, capacity - length,
+                                       &frame_length);
+    } else if (next_random() % 16U == 0) {
+      const telemetry_control_t control = {.type = 1U + next_random() % 8U, .value = next_random()};
+      telemetry_control_encode_wire(&control, stream + length, capacity - length, &frame_length);
+    } else if (next_random() % 4U == 0) {
+      telemetry_delta_encoder_encode_batch_wire(&encoder, &batch, i, stream + length, capacity - length,
+                                                &frame_length);
+      batch.sample_count = 0;
+    } else {
+      telemetry_delta_encoder_encode_wire(&encoder, &state, stream + length, capacity - length, &frame_length);
+    }
+    length += frame_length;
+  }
+  return length;
+}
+
+static size_t mutate(uint8_t* data, size_t length, size_t capacity) {
+  const uint32_t edits = 1U + next_random() % 8U;
+  for (uint32_t e = 0; e < edits && length > 0; ++e) {
+    const size_t at = next_random() % length;
+    switch (next_random() % 5U) {
+      case 0:
+        data[at] ^= (uint8_t)(1U << (next_random() % 8U));
+        break;
+      case 1:
+        memmove(data + at, data + at + 1, length - at - 1);
+        length--;
+        break;
+      case 2:
+        data[at] = 0x00;
+        break;
+      case 3:
+        if (length < capacity) {
+          memmove(data + at + 1, data + at, length - at);
+          data[at] = (uint8_t)next_random();
+          length++;
+        }
+        break;
+      default: {
+        // Splice: copy a run from elsewhere in the stream over this position.
+        const size_t from = next_random() % length;
+        size_t run = 1U + next_random() % 32U;
+        if (run > length - at) {
+          run = length - at;
+        }
+        if (run > length - from) {
+          run = length - from;
+        }
+        memmove(data + at, data + from, run);
+        break;
+      }
+    }
+  }
+  return length;
+}
+
+static int run_file(const char* path) {
+  static uint8_t data[FUZZ_MAX_INPUT];
+  FILE* file = fopen(path, "rb");
+  if (file == NULL) {
+    fprintf(stderr, "cannot open %s\n", path);
+    return 1;
+  }
+  const size_t length = fread(data, 1, sizeof(data), file);
+  fclose(file);
+  LLVMFuzzerTestOneInput(data, length);
+  return 0;
+}
+
+// Usage: fuzz_telemetry_protocol [iterations] [input files...]
+int main(int argc, char** argv) {
+  if (argc > 2) {
+    for (int i = 2; i < argc; ++i) {
+      if (run_file(argv[i]) != 0) {
+        return 1;
+      }
+    }
+    printf("telemetry fuzz replayed %d inputs\n", argc - 2);
+    return 0;
+  }
+
+  const unsigned long iterations = argc > 1 ? strtoul(argv[1], NULL, 10) : FUZZ_DEFAULT_ITERATIONS;
+  static uint8_t data[FUZZ_MAX_INPUT];
+  for (unsigned long n = 0; n < iterations; ++n) {
+    size_t length = 0;
+    if (n % 8U == 0) {
+      length = 1U + next_random() % 512U;
+      for (size_t i = 0; i < length; ++i) {
+        // Bias towards delimiters so short frames are common.
+        data[i] = next_random() % 16U == 0 ? 0x00 : (uint8_t)next_random();
+      }
+    } else {
+      length = build_valid_stream(data, sizeof(data));
+      if (n % 8U != 1) {
+        length = mutate(data, length, sizeof(data));
+      }
+    }
+    LLVMFuzzerTestOneInput(data, length);
+  }
+  printf("telemetry fuzz passed %lu inputs\n", iterations);
+  return 0;
+}
+#endif
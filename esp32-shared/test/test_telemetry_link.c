@@ -0,0 +1,272 @@
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "telemetry_link.h"
+#include "telemetry_protocol.h"
+
+// Two ends of a simulated UART. Bytes written at one rate and read at another
+// arrive as garbage, and rates in `broken_mask` corrupt every frame.
+typedef struct {
+  telemetry_link_t link;
+  telemetry_stream_decoder_t rx;
+  vehicle_state_t state;
+  uint32_t baud;
+  uint32_t valid_frames;
+} endpoint_t;
+
+typedef struct {
+  uint8_t data[4096];
+  uint32_t baud[4096];
+  size_t length;
+} pipe_t;
+
+typedef struct {
+  endpoint_t hub;
+  endpoint_t display;
+  pipe_t to_display;
+  pipe_t to_hub;
+  uint32_t broken_mask;
+  bool display_silent;
+  bool hub_sends_telemetry;
+  uint32_t now_ms;
+} sim_t;
+
+static uint8_t rate_index_of(uint32_t baud) {
+  for (uint8_t i = 0; i < TELEMETRY_LINK_RATE_COUNT; ++i) {
+    if (telemetry_link_rate_baud(i) == baud) {
+      return i;
+    }
+  }
+  return 0;
+}
+
+static void pipe_write(pipe_t* pipe, const uint8_t* data, size_t length, uint32_t baud) {
+  assert(pipe->length + length <= sizeof(pipe->data));
+  for (size_t i = 0; i < length; ++i) {
+    pipe->data[pipe->length] = data[i];
+    pipe->baud[pipe->length] = baud;
+    pipe->length++;
+  }
+}
+
+static void send_control(sim_t* sim, endpoint_t* from, const telemetry_control_t* control) {
+  uint8_t wire[TELEMETRY_WIRE_FRAME_MAX_SIZE];
+  size_t length = 0;
+  assert(telemetry_control_encode_wire(control, wire, sizeof(wire), &length) == TELEMETRY_RESULT_OK);
+  pipe_write(from == &sim->hub ? &sim->to_display : &sim->to_hub, wire, length, from->baud);
+}
+
+static void run_actions(sim_t* sim, endpoint_t* endpoint) {
+  telemetry_link_action_t action;
+  while (telemetry_link_poll(&endpoint->link, sim->now_ms, &action)) {
+    if (action.send && !(endpoint == &sim->display && sim->display_silent)) {
+      send_control(sim, endpoint, &action.control);
+    }
+    if (action.baud != 0) {
+      endpoint->baud = action.baud;
+    }
+  }
+  assert(endpoint->baud == telemetry_link_baud(&endpoint->link));
+}
+
+static void deliver(sim_t* sim, pipe_t* pipe, endpoint_t* to) {
+  for (size_t i = 0; i < pipe->length; ++i) {
+    uint8_t byte = pipe->data[i];
+    if (pipe->baud[i] != to->baud) {
+      byte = (uint8_t)(byte * 7U + 0x5AU);
+    } else if ((sim->broken_mask & (1UL << rate_index_of(to->baud))) && i % 5 == 2) {
+      byte ^= 0x10U;
+    }
+
+    size_t consumed = 0;
+    const telemetry_result_t result = telemetry_stream_decoder_feed(&to->rx, &byte, 1, &consumed, &to->state);
+    if (result == TELEMETRY_RESULT_CONTROL) {
+      telemetry_link_on_control(&to->link, telemetry_decoder_last_control(&to->rx.decoder), sim->now_ms);
+    } else if (result != TELEMETRY_RESULT_INCOMPLETE) {
+      telemetry_link_on_frame(&to->link, result, sim->now_ms);
+      to->valid_frames += result == TELEMETRY_RESULT_OK ? 1 : 0;
+    }
+    run_actions(sim, to);
+  }
+  pipe->length = 0;
+}
+
+static void sim_init(sim_t* sim, uint32_t hub_max_baud, uint32_t display_max_baud) {
+  memset(sim, 0, sizeof(*sim));
+  const telemetry_link_config_t hub_config = telemetry_link_default_config(hub_max_baud);
+  const telemetry_link_config_t display_config = telemetry_link_default_config(display_max_baud);
+  assert(telemetry_link_init(&sim->hub.link, TELEMETRY_LINK_ROLE_HUB, &hub_config, 0));
+  assert(telemetry_link_init(&sim->display.link, TELEMETRY_LINK_ROLE_DISPLAY, &display_config, 0));
+  telemetry_stream_decoder_init(&sim->hub.rx);
+  telemetry_stream_decoder_init(&sim->display.rx);
+  sim->hub.baud = TELEMETRY_LINK_BASE_BAUD;
+  sim->display.baud = TELEMETRY_LINK_BASE_BAUD;
+  sim->hub_sends_telemetry = true;
+}
+
+// Advances in 5 ms steps; the hub sends a telemetry frame every 20 ms.
+static void sim_run(sim_t* sim, uint32_t duration_ms) {
+  const uint32_t end_ms = sim->now_ms + duration_ms;
+  while (sim->now_ms < end_ms) {
+    sim->now_ms += 5;
+    if (sim->hub_sends_telemetry && sim->now_ms % 20 == 0) {
+      vehicle_state_t packet = {.sequence = sim->now_ms / 20, .timestamp_ms = sim->now_ms, .oil_pressure = 42.0f};
+      uint8_t wire[TELEMETRY_WIRE_FRAME_MAX_SIZE];
+      size_t length = 0;
+      assert(telemetry_frame_encode_wire(&packet, wire, sizeof(wire), &length) == TELEMETRY_RESULT_OK);
+      pipe_write(&sim->to_display, wire, length, sim->hub.baud);
+    }
+    run_actions(sim, &sim->hub);
+    run_actions(sim, &sim->display);
+    deliver(sim, &sim->to_display, &sim->display);
+    if (sim->display_silent) {
+      sim->to_hub.length = 0;
+    }
+    deliver(sim, &sim->to_hub, &sim->hub);
+  }
+}
+
+static void test_negotiates_highest_common_rate(void) {
+  sim_t sim;
+  sim_init(&sim, 2000000, 2000000);
+  sim_run(&sim, 200);
+  assert(telemetry_link_state(&sim.hub.link) == TELEMETRY_LINK_STATE_LINKED);
+  assert(telemetry_link_state(&sim.display.link) == TELEMETRY_LINK_STATE_LINKED);
+  assert(sim.hub.baud == 2000000 && sim.display.baud == 2000000);
+
+  // Capped by the slower side.
+  sim_init(&sim, 2000000, 921600);
+  sim_run(&sim, 200);
+  assert(telemetry_link_state(&sim.hub.link) == TELEMETRY_LINK_STATE_LINKED);
+  assert(sim.hub.baud == 921600 && sim.display.baud == 921600);
+
+  // Telemetry keeps flowing and the link stays up with keepalives.
+  const uint32_t frames_before = sim.display.valid_frames;
+  sim_run(&sim, 5000);
+  assert(sim.display.valid_frames >= frames_before + 240);
+  assert(telemetry_link_stats(&sim.hub.link)->negotiations == 1);
+  assert(telemetry_link_stats(&sim.hub.link)->fallbacks == 0);
+  assert(telemetry_link_stats(&sim.display.link)->fallbacks == 0);
+}
+
+static void test_stays_at_base_rate_without_display(void) {
+  sim_t sim;
+  sim_init(&sim, 2000000, 2000000);
+  sim.display_silent = true;
+  sim_run(&sim, 5000);
+  assert(telemetry_link_state(&sim.hub.link) == TELEMETRY_LINK_STATE_BASE);
+  assert(sim.hub.baud == TELEMETRY_LINK_BASE_BAUD);
+  assert(sim.display.valid_frames > 200);
+
+  // A display limited to the base rate is answered once and left alone.
+  sim_init(&sim, 2000000, TELEMETRY_LINK_BASE_BAUD);
+  sim_run(&sim, 5000);
+  assert(telemetry_link_state(&sim.hub.link) == TELEMETRY_LINK_STATE_BASE);
+  assert(sim.hub.link.peer_seen);
+  assert(sim.hub.baud == TELEMETRY_LINK_BASE_BAUD && sim.display.baud == TELEMETRY_LINK_BASE_BAUD);
+}
+
+static void test_broken_rate_falls_back_to_next_rate(void) {
+  sim_t sim;
+  sim_init(&sim, 2000000, 2000000);
+  sim.broken_mask = 1UL << 2;  // 2 Mbaud corrupts frames
+  sim_run(&sim, 3000);
+  assert(telemetry_link_state(&sim.hub.link) == TELEMETRY_LINK_STATE_LINKED);
+  assert(telemetry_link_state(&sim.display.link) == TELEMETRY_LINK_STATE_LINKED);
+  assert(sim.hub.baud == 921600 && sim.display.baud == 921600);
+  assert(telemetry_link_stats(&sim.hub.link)->fallbacks >= 1);
+
+  // A working link is kept; the hub only renegotiates after a fallback.
+  sim.broken_mask = 0;
+  sim_run(&sim, 62000);
+  assert(sim.hub.baud == 921600 && sim.display.baud == 921600);
+}
+
+static void test_errors_after_linking_fall_back(void) {
+  sim_t sim;
+  sim_init(&sim, 2000000, 921600);
+  sim_run(&sim, 200);
+  assert(telemetry_link_state(&sim.display.link) == TELEMETRY_LINK_STATE_LINKED);
+
+  // The display's FALLBACK notice is corrupted too; the hub follows when the
+  // keepalives stop.
+  sim.broken_mask = 1UL << 1;
+  sim_run(&sim, 1500);
+  assert(sim.hub.baud == TELEMETRY_LINK_BASE_BAUD && sim.display.baud == TELEMETRY_LINK_BASE_BAUD);
+  assert(telemetry_link_stats(&sim.display.link)->fallbacks == 1);
+  assert(telemetry_link_stats(&sim.display.link)->bad_frames >= 5);
+  assert(telemetry_link_stats(&sim.hub.link)->fallbacks == 1);
+
+  // The only faster rate is excluded, so the hub stays put through the backoff.
+  sim.broken_mask = 0;
+  sim_run(&sim, 30000);
+  assert(telemetry_link_state(&sim.hub.link) == TELEMETRY_LINK_STATE_BASE);
+  assert(sim.display.baud == TELEMETRY_LINK_BASE_BAUD);
+}
+
+static void test_display_silence_falls_back(void) {
+  sim_t sim;
+  sim_init(&sim, 2000000, 2000000);
+  sim_run(&sim, 200);
+  assert(telemetry_link_state(&sim.hub.link) == TELEMETRY_LINK_STATE_LINKED);
+
+  sim.display_silent = true;
+  sim_run(&sim, 1100);
+  assert(telemetry_link_state(&sim.hub.link) == TELEMETRY_LINK_STATE_BASE);
+  assert(sim.hub.baud == TELEMETRY_LINK_BASE_BAUD);
+
+  // The display sees only garbage after the hub leaves and follows.
+  sim_run(&sim, 1000);
+  assert(sim.display.baud == TELEMETRY_LINK_BASE_BAUD);
+}
+
+static void test_timestamps_wrap(void) {
+  telemetry_link_t link;
+  const telemetry_link_config_t config = telemetry_link_default_config(2000000);
+  const uint32_t start = UINT32_MAX - 100;
+  assert(telemetry_link_init(&link, TELEMETRY_LINK_ROLE_HUB, &config, start));
+
+  telemetry_link_action_t action;
+  assert(telemetry_link_poll(&link, start, &action));
+  assert(action.send && action.control.type == TELEMETRY_CONTROL_LINK_HELLO && action.control.value == 0x7U);
+  assert(!telemetry_link_poll(&link, start + 500, &action));
+  assert(telemetry_link_poll(&link, start + 1000, &action));
+  assert(action.control.type == TELEMETRY_CONTROL_LINK_HELLO);
+}
+
+static void test_argument_errors(void) {
+  telemetry_link_t link;
+  telemetry_link_config_t config = telemetry_link_default_config(2000000);
+  telemetry_link_action_t action;
+  assert(!telemetry_link_init(NULL, TELEMETRY_LINK_ROLE_HUB, &config, 0));
+  assert(!telemetry_link_init(&link, TELEMETRY_LINK_ROLE_HUB, NULL, 0));
+  config.error_threshold = 0;
+  assert(!telemetry_link_init(&link, TELEMETRY_LINK_ROLE_HUB, &config, 0));
+  assert(!telemetry_link_poll(NULL, 0, &action));
+  assert(telemetry_link_baud(NULL) == TELEMETRY_LINK_BASE_BAUD);
+  assert(telemetry_link_rate_baud(TELEMETRY_LINK_RATE_COUNT) == 0);
+
+  // Unsupported or out-of-range rates are ignored by the display.
+  config = telemetry_link_default_config(921600);
+  assert(telemetry_link_init(&link, TELEMETRY_LINK_ROLE_DISPLAY, &config, 0));
+  const telemetry_control_t too_fast = {.type = TELEMETRY_CONTROL_LINK_SWITCH, .value = 2};
+  const telemetry_control_t invalid = {.type = TELEMETRY_CONTROL_LINK_SWITCH, .value = 40};
+  telemetry_link_on_control(&link, &too_fast, 0);
+  telemetry_link_on_control(&link, &invalid, 0);
+  assert(!telemetry_link_poll(&link, 0, &action));
+  assert(telemetry_link_state(&link) == TELEMETRY_LINK_STATE_BASE);
+}
+
+int main(void) {
+  test_negotiates_highest_common_rate();
+  test_stays_at_base_rate_without_display();
+  test_broken_rate_falls_back_to_next_rate();
+  test_errors_after_linking_fall_back();
+  test_display_silence_falls_back();
+  test_timestamps_wrap();
+  test_argument_errors();
+  puts("telemetry link tests passed");
+  return 0;
+}
@@ -25,6 +25,86 @@ static void test_crc_check_value(void) {
   assert(telemetry_crc16_ccitt_false(input, sizeof(input) - 1) == 0x29B1U);
 }
 
+static size_t reference_frame(const uint8_t* payload, size_t payload_length, uint8_t* frame) {
+  uint8_t raw[600];
+  memcpy(raw, payload, payload_length);
+  const uint16_t crc = telemetry_crc16_ccitt_false(payload, payload_length);
+  raw[payload_length] = (uint8_t)(crc >> 8);
+  raw[payload_length + 1] = (uint8_t)crc;
+  return cobs_encode(raw, payload_length + 2, frame);
+}
+
+static void test_crc_update_matches_single_call(void) {
+  static const uint8_t input[] = "123456789";
+  uint16_t crc = telemetry_crc16_ccitt_false_update(TELEMETRY_CRC16_INIT, input, 4);
+  crc = telemetry_crc16_ccitt_false_update(crc, input + 4, sizeof(input) - 5);
+  assert(crc == 0x29B1U);
+}
+
+static void test_frame_writer_matches_reference_framing(void) {
+  uint8_t payload[520];
+  uint8_t expected[600];
+  uint8_t actual[600];
+  static const size_t lengths[] = {0, 1, 2, 252, 253, 254, 255, 300, 507, 508, 520};
+
+  for (int pattern = 0; pattern < 3; ++pattern) {
+    for (size_t i = 0; i < sizeof(payload); ++i) {
+      // all-zero, zero-free (full 254-byte COBS blocks), and mixed payloads
+      payload[i] = pattern == 0 ? 0x00 : pattern == 1 ? (uint8_t)(1 + i % 255) : (uint8_t)((i * 37) % 7);
+    }
+
+    for (size_t n = 0; n < sizeof(lengths) / sizeof(lengths[0]); ++n) {
+      const size_t length = lengths[n];
+      const size_t expected_length = reference_frame(payload, length, expected);
+
+      telemetry_frame_writer_t writer;
+      telemetry_frame_writer_init(&writer, actual, sizeof(actual));
+      // Split appends so block state has to carry across calls.
+      telemetry_frame_writer_append(&writer, payload, length / 3);
+      telemetry_frame_writer_append(&writer, payload + length / 3, length - length / 3);
+      size_t actual_length = 0;
+      assert(telemetry_frame_writer_finish(&writer, &actual_length) == TELEMETRY_RESULT_OK);
+      assert(actual_length == expected_length);
+      assert(memcmp(actual, expected, expected_length) == 0);
+    }
+  }
+}
+
+static void test_frame_writer_reports_overflow(void) {
+  static const uint8_t payload[] = {0x01, 0x00, 0x02, 0x03};
+  uint8_t expected[16];
+  const size_t expected_length = reference_frame(payload, sizeof(payload), expected);
+
+  for (size_t capacity = 0; capacity < expected_length; ++capacity) {
+    uint8_t output[16];
+    telemetry_frame_writer_t writer;
+    telemetry_frame_writer_init(&writer, output, capacity);
+    telemetry_frame_writer_append(&writer, payload, sizeof(payload));
+    size_t length = 99;
+    assert(telemetry_frame_writer_finish(&writer, &length) == TELEMETRY_RESULT_OUTPUT_TOO_SMALL);
+    assert(length == 0);
+  }
+}
+
+static void test_wire_encode_appends_delimiter(void) {
+  const vehicle_state_t input = {.sequence = 7, .timestamp_ms = 1234, .oil_pressure = 55.5f};
+  uint8_t frame[TELEMETRY_COBS_FRAME_MAX_SIZE];
+  size_t frame_length = 0;
+  assert(telemetry_frame_encode(&input, frame, sizeof(frame), &frame_length) == TELEMETRY_RESULT_OK);
+
+  uint8_t wire[TELEMETRY_WIRE_FRAME_MAX_SIZE];
+  size_t wire_length = 0;
+  assert(telemetry_frame_encode_wire(&input, wire, sizeof(wire), &wire_length) == TELEMETRY_RESULT_OK);
+  assert(wire_length == frame_length + 1);
+  assert(memcmp(wire, frame, frame_length) == 0);
+  assert(wire[frame_length] == 0x00);
+  assert(memchr(wire, 0x00, frame_length) == NULL);
+
+  assert(telemetry_frame_encode_wire(&input, wire, sizeof(wire) - 1, &wire_length) ==
+         TELEMETRY_RESULT_OUTPUT_TOO_SMALL);
+  assert(wire_length == 0);
+}
+
 static void test_round_trip(void) {
   const vehicle_state_t input = {
       .sequence = UINT32_MAX,
@@ -124,11 +204,15 @@ static void test_rejects_wrong_schema(void) {
   uint8_t raw[TELEMETRY_RAW_FRAME_MAX_SIZE];
   size_t raw_length = 0;
   assert(cobs_decode(frame, frame_length, raw, sizeof(raw), &raw_length));
-  raw[3] = TELEMETRY_SCHEMA_VERSION + 1;
+  raw[3] = TELEMETRY_SCHEMA_VERSION_QUANTIZED_TAGGED + 1;
   frame_length = rebuild_frame(raw, raw_length, frame);
 
   vehicle_state_t output = {0};
   assert(telemetry_frame_decode(frame, frame_length, &output) == TELEMETRY_RESULT_SCHEMA_ERROR);
+
+  raw[3] = TELEMETRY_SCHEMA_VERSION - 1;
+  frame_length = rebuild_frame(raw, raw_length, frame);
+  assert(telemetry_frame_decode(frame, frame_length, &output) == TELEMETRY_RESULT_SCHEMA_ERROR);
 }
 
 static void test_rejects_invalid_messagepack(void) {
@@ -171,6 +255,1098 @@ static void test_rejects_trailing_messagepack_data(void) {
   assert(telemetry_frame_decode(frame, frame_length, &output) == TELEMETRY_RESULT_MSGPACK_ERROR);
 }
 
+static vehicle_state_t delta_test_state(void) {
+  const vehicle_state_t state = {
+      .sequence = 1,
+      .timestamp_ms = 1000,
+      .water_temp = 190.0f,
+      .oil_temp = 210.0f,
+      .oil_pressure = 45.0f,
+      .oil_pressure_raw = 45.5f,
+      .dam = 1.0f,
+      .af_ratio = 14.7f,
+      .engine_rpm = 3000.0f,
+      .throttle_pos = 20.0f,
+  };
+  return state;
+}
+
+static size_t encode_delta(telemetry_delta_encoder_t* encoder, const vehicle_state_t* state, uint8_t* wire) {
+  size_t wire_length = 0;
+  assert(telemetry_delta_encoder_encode_wire(encoder, state, wire, TELEMETRY_WIRE_FRAME_MAX_SIZE, &wire_length) ==
+         TELEMETRY_RESULT_OK);
+  assert(wire_length > 1 && wire[wire_length - 1] == 0x00);
+  return wire_length - 1;
+}
+
+static void test_delta_frames_carry_only_changed_fields(void) {
+  telemetry_delta_encoder_t encoder;
+  telemetry_delta_encoder_init(&encoder, 30);
+  telemetry_decoder_t decoder;
+  telemetry_decoder_init(&decoder);
+
+  vehicle_state_t state = delta_test_state();
+  uint8_t wire[TELEMETRY_WIRE_FRAME_MAX_SIZE];
+  size_t frame_length = encode_delta(&encoder, &state, wire);
+  const size_t keyframe_length = frame_length;
+  vehicle_state_t output = {0};
+  assert(telemetry_decoder_decode(&decoder, wire, frame_length, &output) == TELEMETRY_RESULT_OK);
+  assert_packet_equal(&state, &output);
+
+  // Oil temp moves inside its deadband, RPM and throttle move outside theirs.
+  state.sequence++;
+  state.timestamp_ms += 33;
+  state.oil_temp += 0.25f;
+  state.engine_rpm = 3150.0f;
+  state.throttle_pos = 35.0f;
+  frame_length = encode_delta(&encoder, &state, wire);
+  assert(frame_length < keyframe_length / 2);
+
+  uint8_t raw[TELEMETRY_RAW_FRAME_MAX_SIZE];
+  size_t raw_length = 0;
+  assert(cobs_decode(wire, frame_length, raw, sizeof(raw), &raw_length));
+  static const uint8_t expected_payload[] = {
+      0x96, 0x04, 0x02, 0xCD, 0x04, 0x09,  // [4, seq=2, ts=1033,
+      0xCD, 0x18, 0x00,                    //  mask=RPM|throttle,
+      0xCA, 0x45, 0x44, 0xE0, 0x00,        //  3150.0,
+      0xCA, 0x42, 0x0C, 0x00, 0x00,        //  35.0]
+  };
+  assert(raw_length == sizeof(expected_payload) + 2);
+  assert(memcmp(raw, expected_payload, sizeof(expected_payload)) == 0);
+
+  assert(telemetry_decoder_decode(&decoder, wire, frame_length, &output) == TELEMETRY_RESULT_OK);
+  assert(output.sequence == state.sequence);
+  assert(output.timestamp_ms == state.timestamp_ms);
+  assert(output.engine_rpm == 3150.0f);
+  assert(output.throttle_pos == 35.0f);
+  assert(output.oil_temp == 210.0f);
+  assert(output.water_temp == 190.0f);
+
+  // Small changes accumulate against the last sent value rather than drifting.
+  state.oil_temp += 0.5f;
+  frame_length = encode_delta(&encoder, &state, wire);
+  assert(telemetry_decoder_decode(&decoder, wire, frame_length, &output) == TELEMETRY_RESULT_OK);
+  assert(output.oil_temp == state.oil_temp);
+}
+
+static void test_delta_encoder_sends_periodic_keyframes(void) {
+  telemetry_delta_encoder_t encoder;
+  telemetry_delta_encoder_init(&encoder, 3);
+  const vehicle_state_t state = delta_test_state();
+  uint8_t wire[TELEMETRY_WIRE_FRAME_MAX_SIZE];
+  uint8_t raw[TELEMETRY_RAW_FRAME_MAX_SIZE];
+
+  for (int frame = 0; frame < 7; ++frame) {
+    const size_t frame_length = encode_delta(&encoder, &state, wire);
+    size_t raw_length = 0;
+    assert(cobs_decode(wire, frame_length, raw, sizeof(raw), &raw_length));
+    const bool keyframe = raw[0] == 0xDC && raw[3] == TELEMETRY_SCHEMA_VERSION;
+    assert(keyframe == (frame % 3 == 0));
+  }
+
+  telemetry_delta_encoder_force_keyframe(&encoder);
+  const size_t frame_length = encode_delta(&encoder, &state, wire);
+  size_t raw_length = 0;
+  assert(cobs_decode(wire, frame_length, raw, sizeof(raw), &raw_length));
+  assert(raw[3] == TELEMETRY_SCHEMA_VERSION);
+}
+
+static void test_delta_encoder_sends_keyframe_when_every_field_changes(void) {
+  telemetry_delta_encoder_t encoder;
+  telemetry_delta_encoder_init(&encoder, 100);
+  vehicle_state_t state = delta_test_state();
+  uint8_t wire[TELEMETRY_WIRE_FRAME_MAX_SIZE];
+  encode_delta(&encoder, &state, wire);
+
+  float* fields = &state.water_temp;
+  for (size_t i = 0; i < TELEMETRY_FLOAT_FIELD_COUNT; ++i) {
+    fields[i] += 100.0f;
+  }
+  const size_t frame_length = encode_delta(&encoder, &state, wire);
+  uint8_t raw[TELEMETRY_RAW_FRAME_MAX_SIZE];
+  size_t raw_length = 0;
+  assert(cobs_decode(wire, frame_length, raw, sizeof(raw), &raw_length));
+  assert(raw[3] == TELEMETRY_SCHEMA_VERSION);
+}
+
+static void test_rate_groups_are_sent_as_separate_messages(void) {
+  assert((TELEMETRY_FAST_FIELD_MASK | TELEMETRY_SLOW_FIELD_MASK) == TELEMETRY_DELTA_FULL_MASK);
+  assert((TELEMETRY_FAST_FIELD_MASK & TELEMETRY_SLOW_FIELD_MASK) == 0);
+  assert(TELEMETRY_FAST_FIELD_MASK & (1UL << TELEMETRY_CHANNEL_engine_rpm));
+  assert(TELEMETRY_SLOW_FIELD_MASK & (1UL << TELEMETRY_CHANNEL_water_temp));
+
+  telemetry_delta_encoder_t encoder;
+  telemetry_delta_encoder_init(&encoder, 100);
+  telemetry_decoder_t decoder;
+  telemetry_decoder_init(&decoder);
+  vehicle_state_t state = delta_test_state();
+  uint8_t wire[TELEMETRY_WIRE_FRAME_MAX_SIZE];
+  size_t wire_length = 0;
+  vehicle_state_t output = {0};
+  assert(telemetry_delta_encoder_encode_fields_wire(&encoder, &state, TELEMETRY_FAST_FIELD_MASK, wire, sizeof(wire),
+                                                    &wire_length) == TELEMETRY_RESULT_OK);
+  assert(telemetry_decoder_decode(&decoder, wire, wire_length - 1, &output) == TELEMETRY_RESULT_OK);
+  assert_packet_equal(&state, &output);
+
+  // A fast message leaves a slow change for the slow message.
+  state.engine_rpm = 4000.0f;
+  state.water_temp = 200.0f;
+  assert(telemetry_delta_encoder_encode_fields_wire(&encoder, &state, TELEMETRY_FAST_FIELD_MASK, wire, sizeof(wire),
+                                                    &wire_length) == TELEMETRY_RESULT_OK);
+  assert(telemetry_decoder_decode(&decoder, wire, wire_length - 1, &output) == TELEMETRY_RESULT_OK);
+  assert(output.engine_rpm == 4000.0f);
+  assert(output.water_temp == 190.0f);
+
+  assert(telemetry_delta_encoder_encode_fields_wire(&encoder, &state, TELEMETRY_SLOW_FIELD_MASK, wire, sizeof(wire),
+                                                    &wire_length) == TELEMETRY_RESULT_OK);
+  assert(telemetry_decoder_decode(&decoder, wire, wire_length - 1, &output) == TELEMETRY_RESULT_OK);
+  assert_packet_equal(&state, &output);
+}
+
+typedef struct {
+  float* value;
+  float scale;
+  float min;
+  float max;
+} quantized_channel_t;
+
+static size_t encode_quantized(telemetry_delta_encoder_t* encoder, const vehicle_state_t* state, uint8_t* wire,
+                               uint8_t* raw, size_t* raw_length) {
+  const size_t frame_length = encode_delta(encoder, state, wire);
+  assert(cobs_decode(wire, frame_length, raw, TELEMETRY_RAW_FRAME_MAX_SIZE, raw_length));
+  return frame_length;
+}
+
+static void test_quantized_round_trip_precision(void) {
+  vehicle_state_t state = {.sequence = 9, .timestamp_ms = 123456};
+  const quantized_channel_t channels[] = {
+      {&state.water_temp, 0.1f, -40.0f, 300.0f},       {&state.oil_temp, 0.1f, -40.0f, 330.0f},
+      {&state.oil_pressure, 0.01f, 0.0f, 150.0f},      {&state.dam, 0.0625f, 0.0f, 1.0625f},
+      {&state.af_learned, 0.01f, -30.0f, 30.0f},       {&state.af_ratio, 0.01f, 8.0f, 25.0f},
+      {&state.int_temp, 0.1f, -40.0f, 250.0f},         {&state.fb_knock, 0.01f, -12.0f, 1.0f},
+      {&state.af_correct, 0.01f, -30.0f, 30.0f},       {&state.inj_duty, 0.01f, 0.0f, 110.0f},
+      {&state.eth_conc, 1.0f, 0.0f, 100.0f},           {&state.engine_rpm, 1.0f, 0.0f, 9000.0f},
+      {&state.throttle_pos, 0.01f, 0.0f, 100.0f},      {&state.brake_pressure_bar, 0.01f, 0.0f, 200.0f},
+      {&state.steering_angle_deg, 0.1f, -720.0f, 720.0f}, {&state.oil_pressure_raw, 0.01f, 0.0f, 150.0f},
+  };
+  assert(sizeof(channels) / sizeof(channels[0]) == TELEMETRY_FLOAT_FIELD_COUNT);
+
+  uint8_t wire[TELEMETRY_WIRE_FRAME_MAX_SIZE];
+  uint8_t raw[TELEMETRY_RAW_FRAME_MAX_SIZE];
+  for (int step = 0; step <= 1000; ++step) {
+    for (size_t i = 0; i < TELEMETRY_FLOAT_FIELD_COUNT; ++i) {
+      // Sweep each channel's range at an offset that avoids landing on exact steps.
+      const float t = (float)((step * 7 + (int)i * 131) % 1001) / 1000.0f;
+      *channels[i].value = channels[i].min + t * (channels[i].max - channels[i].min);
+    }
+
+    telemetry_delta_encoder_t encoder;
+    telemetry_delta_encoder_init(&encoder, 1);
+    telemetry_delta_encoder_set_quantized(&encoder, true);
+    size_t raw_length = 0;
+    const size_t frame_length = encode_quantized(&encoder, &state, wire, raw, &raw_length);
+    assert(raw[3] == TELEMETRY_SCHEMA_VERSION_QUANTIZED);
+    assert(raw_length - 2 <= TELEMETRY_QUANTIZED_MSGPACK_MAX_SIZE);
+
+    vehicle_state_t output = {0};
+    assert(telemetry_frame_decode(wire, frame_length, &output) == TELEMETRY_RESULT_OK);
+    assert(output.sequence == state.sequence && output.timestamp_ms == state.timestamp_ms);
+    const float* decoded = &output.water_temp;
+    for (size_t i = 0; i < TELEMETRY_FLOAT_FIELD_COUNT; ++i) {
+      const float error = fabsf(decoded[i] - *channels[i].value);
+      assert(error <= channels[i].scale * 0.5f + fabsf(*channels[i].value) * 1e-6f);
+    }
+  }
+}
+
+static void test_golden_quantized_payload(void) {
+  const vehicle_state_t state = {
+      .sequence = 1,
+      .timestamp_ms = 2,
+      .water_temp = 195.4f,
+      .oil_pressure = 62.5f,
+      .dam = 1.0f,
+      .fb_knock = -1.41f,
+      .eth_conc = 15.0f,
+      .engine_rpm = 4321.0f,
+  };
+  telemetry_delta_encoder_t encoder;
+  telemetry_delta_encoder_init(&encoder, 1);
+  telemetry_delta_encoder_set_quantized(&encoder, true);
+  uint8_t wire[TELEMETRY_WIRE_FRAME_MAX_SIZE];
+  uint8_t raw[TELEMETRY_RAW_FRAME_MAX_SIZE];
+  size_t raw_length = 0;
+  encode_quantized(&encoder, &state, wire, raw, &raw_length);
+
+  static const uint8_t expected_payload[] = {
+      0xDC, 0x00, 0x13, 0x05, 0x01, 0x02,  // array16(19), schema 5, seq 1, ts 2
+      0xCD, 0x07, 0xA2,                    // water_temp 1954 * 0.1
+      0x00,                                // oil_temp
+      0xCD, 0x18, 0x6A,                    // oil_pressure 6250 * 0.01
+      0x10,                                // dam 16 / 16
+      0x00, 0x00, 0x00,                    // af_learned, af_ratio, int_temp
+      0xD1, 0xFF, 0x73,                    // fb_knock -141 * 0.01
+      0x00, 0x00,                          // af_correct, inj_duty
+      0x0F,                                // eth_conc 15
+      0xCD, 0x10, 0xE1,                    // engine_rpm 4321
+      0x00, 0x00, 0x00, 0x00,              // throttle, brake, steering, oil_pressure_raw
+  };
+  assert(raw_length == sizeof(expected_payload) + 2);
+  assert(memcmp(raw, expected_payload, sizeof(expected_payload)) == 0);
+}
+
+static void test_quantized_saturation_nan_and_deltas(void) {
+  telemetry_delta_encoder_t encoder;
+  telemetry_delta_encoder_init(&encoder, 100);
+  telemetry_delta_encoder_set_quantized(&encoder, true);
+  telemetry_decoder_t decoder;
+  telemetry_decoder_init(&decoder);
+  uint8_t wire[TELEMETRY_WIRE_FRAME_MAX_SIZE];
+  uint8_t raw[TELEMETRY_RAW_FRAME_MAX_SIZE];
+  size_t raw_length = 0;
+
+  vehicle_state_t state = delta_test_state();
+  state.engine_rpm = 1.0e6f;
+  state.steering_angle_deg = -1.0e6f;
+  state.int_temp = NAN;
+  size_t frame_length = encode_quantized(&encoder, &state, wire, raw, &raw_length);
+  vehicle_state_t output = {0};
+  assert(telemetry_decoder_decode(&decoder, wire, frame_length, &output) == TELEMETRY_RESULT_OK);
+  assert(output.engine_rpm == 32767.0f);
+  assert(fabsf(output.steering_angle_deg - -3276.7f) < 0.01f);
+  assert(isnan(output.int_temp));
+
+  // Quantized deltas use schema 6, and changes that round to the value already
+  // sent are not repeated.
+  state.sequence++;
+  state.fb_knock = -0.004f;
+  state.throttle_pos = 55.555f;
+  frame_length = encode_quantized(&encoder, &state, wire, raw, &raw_length);
+  assert(raw[1] == TELEMETRY_SCHEMA_VERSION_QUANTIZED_DELTA);
+  assert(raw[6] == 0xCD && raw[7] == 0x10 && raw[8] == 0x00);  // mask = throttle only
+  assert(telemetry_decoder_decode(&decoder, wire, frame_length, &output) == TELEMETRY_RESULT_OK);
+  assert(fabsf(output.throttle_pos - 55.56f) < 0.001f);
+  state.throttle_pos = 55.564f;
+  encode_quantized(&encoder, &state, wire, raw, &raw_length);
+  assert(raw[6] == 0x00);  // nothing new to send
+
+  // Out-of-range integers for a field's width are rejected.
+  uint8_t bad_dam[] = {0x95, 0x06, 0x01, 0x02, 0x08, 0xCC, 0x80, 0x00, 0x00};
+  frame_length = rebuild_frame(bad_dam, sizeof(bad_dam), wire);
+  assert(telemetry_decoder_decode(&decoder, wire, frame_length, &output) == TELEMETRY_RESULT_MSGPACK_ERROR);
+}
+
+static void test_decoder_requires_keyframe_before_delta(void) {
+  telemetry_delta_encoder_t encoder;
+  telemetry_delta_encoder_init(&encoder, 30);
+  vehicle_state_t state = delta_test_state();
+  uint8_t keyframe[TELEMETRY_WIRE_FRAME_MAX_SIZE];
+  const size_t keyframe_length = encode_delta(&encoder, &state, keyframe);
+  state.engine_rpm = 5000.0f;
+  uint8_t delta[TELEMETRY_WIRE_FRAME_MAX_SIZE];
+  const size_t delta_length = encode_delta(&encoder, &state, delta);
+
+  telemetry_decoder_t decoder;
+  telemetry_decoder_init(&decoder);
+  const vehicle_state_t sentinel = {.sequence = 777};
+  vehicle_state_t output = sentinel;
+  assert(telemetry_decoder_decode(&decoder, delta, delta_length, &output) == TELEMETRY_RESULT_NEED_KEYFRAME);
+  assert(memcmp(&output, &sentinel, sizeof(output)) == 0);
+  assert(!decoder.has_keyframe);
+  assert(telemetry_frame_decode(delta, delta_length, &output) == TELEMETRY_RESULT_NEED_KEYFRAME);
+
+  assert(telemetry_decoder_decode(&decoder, keyframe, keyframe_length, &output) == TELEMETRY_RESULT_OK);
+  assert(telemetry_decoder_decode(&decoder, delta, delta_length, &output) == TELEMETRY_RESULT_OK);
+  assert(output.engine_rpm == 5000.0f);
+  assert(output.oil_temp == state.oil_temp);
+}
+
+static void test_decoder_rejects_malformed_delta(void) {
+  telemetry_decoder_t decoder;
+  telemetry_decoder_init(&decoder);
+  decoder.has_keyframe = true;
+  vehicle_state_t output = {0};
+  uint8_t frame[TELEMETRY_COBS_FRAME_MAX_SIZE];
+
+  // Mask selects two fields but only one value follows.
+  uint8_t raw[] = {0x95, 0x04, 0x01, 0x02, 0x03, 0xCA, 0x3F, 0x80, 0x00, 0x00, 0x00, 0x00};
+  size_t frame_length = rebuild_frame(raw, sizeof(raw), frame);
+  assert(telemetry_decoder_decode(&decoder, frame, frame_length, &output) == TELEMETRY_RESULT_MSGPACK_ERROR);
+
+  // Mask bit beyond the last float field.
+  uint8_t wide_mask[] = {0x95, 0x04, 0x01, 0x02, 0xCE, 0x00, 0x01, 0x00, 0x00,
+                         0xCA, 0x3F, 0x80, 0x00, 0x00, 0x00, 0x00};
+  frame_length = rebuild_frame(wide_mask, sizeof(wide_mask), frame);
+  assert(telemetry_decoder_decode(&decoder, frame, frame_length, &output) == TELEMETRY_RESULT_MSGPACK_ERROR);
+
+  // Empty delta is a valid heartbeat.
+  uint8_t heartbeat[] = {0x94, 0x04, 0x05, 0x06, 0x00, 0x00, 0x00};
+  frame_length = rebuild_frame(heartbeat, sizeof(heartbeat), frame);
+  assert(telemetry_decoder_decode(&decoder, frame, frame_length, &output) == TELEMETRY_RESULT_OK);
+  assert(output.sequence == 5 && output.timestamp_ms == 6);
+}
+
+#define OIL_BATCH_MASK \
+  ((1UL << TELEMETRY_CHANNEL_oil_pressure) | (1UL << TELEMETRY_CHANNEL_oil_pressure_raw))
+
+static void test_sample_batch_round_trip(void) {
+  telemetry_sample_batch_t batch;
+  assert(!telemetry_sample_batch_init(&batch, OIL_BATCH_MASK | 1UL));
+  assert(telemetry_sample_batch_init(&batch, OIL_BATCH_MASK));
+
+  // Ten samples into an eight-sample batch keep the newest eight.
+  vehicle_state_t sample = delta_test_state();
+  for (uint32_t i = 0; i < 10; ++i) {
+    sample.oil_pressure = 40.0f + (float)i * 0.37f;
+    sample.oil_pressure_raw = 41.0f + (float)i * 0.37f;
+    telemetry_sample_batch_push(&batch, 1000 + i * 20, &sample);
+  }
+  assert(batch.sample_count == TELEMETRY_BATCH_MAX_SAMPLES);
+  assert(batch.timestamp_ms[0] == 1040);
+
+  telemetry_delta_encoder_t encoder;
+  telemetry_delta_encoder_init(&encoder, 100);
+  telemetry_decoder_t decoder;
+  telemetry_decoder_init(&decoder);
+  const vehicle_state_t state = delta_test_state();
+  uint8_t wire[TELEMETRY_WIRE_FRAME_MAX_SIZE];
+  size_t wire_length = 0;
+  assert(telemetry_delta_encoder_encode_batch_wire(&encoder, &batch, 2, wire, sizeof(wire), &wire_length) ==
+         TELEMETRY_RESULT_OK);
+  vehicle_state_t output = {0};
+  assert(telemetry_decoder_decode(&decoder, wire, wire_length - 1, &output) == TELEMETRY_RESULT_NEED_KEYFRAME);
+
+  size_t frame_length = encode_delta(&encoder, &state, wire);
+  assert(telemetry_decoder_decode(&decoder, wire, frame_length, &output) == TELEMETRY_RESULT_OK);
+  assert(telemetry_decoder_last_batch(&decoder) == NULL);
+
+  assert(telemetry_delta_encoder_encode_batch_wire(&encoder, &batch, 2, wire, sizeof(wire), &wire_length) ==
+         TELEMETRY_RESULT_OK);
+  assert(wire_length <= TELEMETRY_WIRE_FRAME_MAX_SIZE);
+  assert(telemetry_decoder_decode(&decoder, wire, wire_length - 1, &output) == TELEMETRY_RESULT_OK);
+  const telemetry_sample_batch_t* decoded = telemetry_decoder_last_batch(&decoder);
+  assert(decoded != NULL && decoded->field_mask == OIL_BATCH_MASK);
+  assert(decoded->sample_count == TELEMETRY_BATCH_MAX_SAMPLES);
+  for (size_t i = 0; i < TELEMETRY_BATCH_MAX_SAMPLES; ++i) {
+    assert(decoded->timestamp_ms[i] == batch.timestamp_ms[i]);
+    assert(fabsf(decoded->values[i][0] - batch.values[i][0]) <= 0.005f);
+    assert(fabsf(decoded->values[i][1] - batch.values[i][1]) <= 0.005f);
+  }
+
+  // The newest sample is merged; everything else is untouched.
+  assert(output.sequence == 2 && output.timestamp_ms == 1180);
+  assert(output.oil_pressure == decoded->values[7][0]);
+  assert(output.oil_pressure_raw == decoded->values[7][1]);
+  assert(output.engine_rpm == state.engine_rpm && output.oil_temp == state.oil_temp);
+
+  // The encoder already sent those values, so the next delta leaves them out.
+  vehicle_state_t next = state;
+  next.sequence = 3;
+  next.oil_pressure = sample.oil_pressure;
+  next.oil_pressure_raw = sample.oil_pressure_raw;
+  uint8_t raw[TELEMETRY_RAW_FRAME_MAX_SIZE];
+  size_t raw_length = 0;
+  frame_length = encode_delta(&encoder, &next, wire);
+  assert(cobs_decode(wire, frame_length, raw, sizeof(raw), &raw_length));
+  assert(raw[1] == TELEMETRY_SCHEMA_VERSION_DELTA && raw[6] == 0x00);
+  assert(telemetry_decoder_decode(&decoder, wire, frame_length, &output) == TELEMETRY_RESULT_OK);
+  assert(telemetry_decoder_last_batch(&decoder) == NULL);
+
+  // A gap too long for a 16-bit time step starts the batch over.
+  telemetry_sample_batch_push(&batch, 1180 + 70000, &sample);
+  assert(batch.sample_count == 1 && batch.timestamp_ms[0] == 71180);
+}
+
+static void test_golden_batch_payload(void) {
+  telemetry_sample_batch_t batch;
+  assert(telemetry_sample_batch_init(&batch, 1UL << TELEMETRY_CHANNEL_oil_pressure));
+  vehicle_state_t sample = {.oil_pressure = 45.0f};
+  telemetry_sample_batch_push(&batch, 1000, &sample);
+  sample.oil_pressure = 45.5f;
+  telemetry_sample_batch_push(&batch, 1020, &sample);
+
+  telemetry_delta_encoder_t encoder;
+  telemetry_delta_encoder_init(&encoder, 100);
+  uint8_t wire[TELEMETRY_WIRE_FRAME_MAX_SIZE];
+  size_t wire_length = 0;
+  assert(telemetry_delta_encoder_encode_batch_wire(&encoder, &batch, 1, wire, sizeof(wire), &wire_length) ==
+         TELEMETRY_RESULT_OK);
+  uint8_t raw[TELEMETRY_RAW_FRAME_MAX_SIZE];
+  size_t raw_length = 0;
+  assert(cobs_decode(wire, wire_length - 1, raw, sizeof(raw), &raw_length));
+
+  const uint8_t expected[] = {0x98, 0x07, 0x01, 0xCD, 0x03, 0xE8, 0x04, 0x00,
+                              0xCD, 0x11, 0x94, 0x14, 0xCD, 0x11, 0xC6};
+  assert(raw_length == sizeof(expected) + 2);
+  assert(memcmp(raw, expected, sizeof(expected)) == 0);
+}
+
+static void test_decoder_rejects_malformed_batch(void) {
+  telemetry_decoder_t decoder;
+  telemetry_decoder_init(&decoder);
+  decoder.has_keyframe = true;
+  vehicle_state_t output = {0};
+  uint8_t frame[TELEMETRY_COBS_FRAME_MAX_SIZE];
+
+  // Two samples of one channel, missing the last value.
+  uint8_t short_batch[] = {0x97, 0x07, 0x01, 0x02, 0x04, 0x00, 0x01, 0x14, 0x00, 0x00};
+  size_t frame_length = rebuild_frame(short_batch, sizeof(short_batch), frame);
+  assert(telemetry_decoder_decode(&decoder, frame, frame_length, &output) == TELEMETRY_RESULT_MSGPACK_ERROR);
+
+  // More channels than a batch can carry.
+  uint8_t wide_batch[] = {0x98, 0x07, 0x01, 0x02, 0x07, 0x00, 0x01, 0x02, 0x03, 0x00, 0x00};
+  frame_length = rebuild_frame(wide_batch, sizeof(wide_batch), frame);
+  assert(telemetry_decoder_decode(&decoder, frame, frame_length, &output) == TELEMETRY_RESULT_MSGPACK_ERROR);
+
+  // The first sample's time step must be zero.
+  uint8_t bad_first_step[] = {0x96, 0x07, 0x01, 0x02, 0x04, 0x05, 0x01, 0x00, 0x00};
+  frame_length = rebuild_frame(bad_first_step, sizeof(bad_first_step), frame);
+  assert(telemetry_decoder_decode(&decoder, frame, frame_length, &output) == TELEMETRY_RESULT_MSGPACK_ERROR);
+
+  uint8_t one_sample[] = {0x96, 0x07, 0x01, 0x02, 0x04, 0x00, 0x01, 0x00, 0x00};
+  frame_length = rebuild_frame(one_sample, sizeof(one_sample), frame);
+  assert(telemetry_decoder_decode(&decoder, frame, frame_length, &output) == TELEMETRY_RESULT_OK);
+  assert(output.sequence == 1 && output.timestamp_ms == 2 && fabsf(output.oil_pressure - 0.01f) < 1e-6f);
+
+  // Stream decoders expose batches through their decoder.
+  telemetry_stream_decoder_t stream;
+  telemetry_stream_decoder_init(&stream);
+  stream.decoder.has_keyframe = true;
+  uint8_t wire[TELEMETRY_COBS_FRAME_MAX_SIZE + 1];
+  memcpy(wire, frame, frame_length);
+  wire[frame_length] = 0x00;
+  size_t consumed = 0;
+  assert(telemetry_stream_decoder_feed(&stream, wire, frame_length + 1, &consumed, &output) == TELEMETRY_RESULT_OK);
+  const telemetry_sample_batch_t* batch = telemetry_decoder_last_batch(&stream.decoder);
+  assert(batch != NULL && batch->sample_count == 1 && batch->timestamp_ms[0] == 2);
+}
+
+static void test_control_frames_bypass_telemetry_state(void) {
+  const telemetry_control_t hello = {.type = TELEMETRY_CONTROL_LINK_HELLO, .value = 0x7};
+  uint8_t wire[TELEMETRY_WIRE_FRAME_MAX_SIZE];
+  size_t wire_length = 0;
+  assert(telemetry_control_encode_wire(&hello, wire, sizeof(wire) - 1, &wire_length) ==
+         TELEMETRY_RESULT_OUTPUT_TOO_SMALL);
+  assert(telemetry_control_encode_wire(&hello, wire, sizeof(wire), &wire_length) == TELEMETRY_RESULT_OK);
+  assert(wire[wire_length - 1] == 0x00);
+
+  uint8_t raw[TELEMETRY_RAW_FRAME_MAX_SIZE];
+  size_t raw_length = 0;
+  assert(cobs_decode(wire, wire_length - 1, raw, sizeof(raw), &raw_length));
+  const uint8_t expected[] = {0x93, 0x08, 0x01, 0x07};
+  assert(raw_length == sizeof(expected) + 2 && memcmp(raw, expected, sizeof(expected)) == 0);
+
+  // Control frames decode before a keyframe and leave the state alone.
+  telemetry_decoder_t decoder;
+  telemetry_decoder_init(&decoder);
+  const vehicle_state_t sentinel = {.sequence = 42};
+  vehicle_state_t output = sentinel;
+  assert(telemetry_decoder_decode(&decoder, wire, wire_length - 1, &output) == TELEMETRY_RESULT_CONTROL);
+  assert(memcmp(&output, &sentinel, sizeof(output)) == 0 && !decoder.has_keyframe);
+  const telemetry_control_t* control = telemetry_decoder_last_control(&decoder);
+  assert(control->type == hello.type && control->value == hello.value);
+  assert(telemetry_frame_decode(wire, wire_length - 1, &output) == TELEMETRY_RESULT_CONTROL);
+
+  telemetry_stream_decoder_t stream;
+  telemetry_stream_decoder_init(&stream);
+  size_t consumed = 0;
+  assert(telemetry_stream_decoder_feed(&stream, wire, wire_length, &consumed, &output) == TELEMETRY_RESULT_CONTROL);
+  assert(consumed == wire_length);
+  assert(telemetry_decoder_last_control(&stream.decoder)->value == hello.value);
+
+  // Extra items are rejected.
+  uint8_t long_control[] = {0x94, 0x08, 0x01, 0x07, 0x00, 0x00, 0x00};
+  const size_t frame_length = rebuild_frame(long_control, sizeof(long_control), wire);
+  assert(telemetry_decoder_decode(&decoder, wire, frame_length, &output) == TELEMETRY_RESULT_MSGPACK_ERROR);
+}
+
+static void test_time_pong_carries_hub_timestamps(void) {
+  const telemetry_control_t pong = {
+      .type = TELEMETRY_CONTROL_TIME_PONG, .value = 0xDEADBEEF, .hub_rx_us = 1000, .hub_tx_us = 0xFFFFFFF0};
+  uint8_t wire[TELEMETRY_WIRE_FRAME_MAX_SIZE];
+  size_t wire_length = 0;
+  assert(telemetry_control_encode_wire(&pong, wire, sizeof(wire), &wire_length) == TELEMETRY_RESULT_OK);
+
+  telemetry_stream_decoder_t stream;
+  telemetry_stream_decoder_init(&stream);
+  vehicle_state_t output = {0};
+  size_t consumed = 0;
+  assert(telemetry_stream_decoder_feed(&stream, wire, wire_length, &consumed, &output) == TELEMETRY_RESULT_CONTROL);
+  const telemetry_control_t* control = telemetry_decoder_last_control(&stream.decoder);
+  assert(control->type == pong.type && control->value == pong.value);
+  assert(control->hub_rx_us == pong.hub_rx_us && control->hub_tx_us == pong.hub_tx_us);
+
+  // Other control types carry no timestamps, and a pong must carry both.
+  const telemetry_control_t ping = {.type = TELEMETRY_CONTROL_TIME_PING, .value = 7, .hub_rx_us = 1, .hub_tx_us = 2};
+  assert(telemetry_control_encode_wire(&ping, wire, sizeof(wire), &wire_length) == TELEMETRY_RESULT_OK);
+  assert(telemetry_stream_decoder_feed(&stream, wire, wire_length, &consumed, &output) == TELEMETRY_RESULT_CONTROL);
+  control = telemetry_decoder_last_control(&stream.decoder);
+  assert(control->value == 7 && control->hub_rx_us == 0 && control->hub_tx_us == 0);
+
+  uint8_t short_pong[] = {0x94, 0x08, 0x21, 0x07, 0x01, 0x00, 0x00};
+  const size_t frame_length = rebuild_frame(short_pong, sizeof(short_pong), wire);
+  telemetry_decoder_t decoder;
+  telemetry_decoder_init(&decoder);
+  assert(telemetry_decoder_decode(&decoder, wire, frame_length, &output) == TELEMETRY_RESULT_MSGPACK_ERROR);
+}
+
+// Hand-built data frame: MessagePack integers in a fixarray or array16, then
+// the CRC. Items outside the int16 range, such as layout ids, are written as
+// uint32. Returns the COBS frame length, without the delimiter.
+static size_t build_int_frame(const int32_t* items, size_t count, uint8_t* frame) {
+  uint8_t raw[TELEMETRY_RAW_FRAME_MAX_SIZE];
+  size_t n = 0;
+  if (count < 16) {
+    raw[n++] = (uint8_t)(0x90 | count);
+  } else {
+    raw[n++] = 0xdc;
+    raw[n++] = 0x00;
+    raw[n++] = (uint8_t)count;
+  }
+  for (size_t i = 0; i < count; ++i) {
+    if (items[i] >= -32 && items[i] < 128) {
+      raw[n++] = (uint8_t)items[i];
+    } else if (items[i] < INT16_MIN || items[i] > INT16_MAX) {
+      const uint32_t value = (uint32_t)items[i];
+      raw[n++] = 0xce;
+      raw[n++] = (uint8_t)(value >> 24);
+      raw[n++] = (uint8_t)(value >> 16);
+      raw[n++] = (uint8_t)(value >> 8);
+      raw[n++] = (uint8_t)value;
+    } else {
+      raw[n++] = 0xd1;  // int16
+      raw[n++] = (uint8_t)(items[i] >> 8);
+      raw[n++] = (uint8_t)items[i];
+    }
+  }
+  return rebuild_frame(raw, n + 2, frame);
+}
+
+static telemetry_result_t feed_descriptor(telemetry_decoder_t* decoder, uint32_t layout_id, uint32_t field_count,
+                                          uint32_t index, const telemetry_descriptor_t* field) {
+  uint8_t wire[TELEMETRY_WIRE_FRAME_MAX_SIZE];
+  size_t wire_length = 0;
+  assert(telemetry_descriptor_encode_wire(layout_id, field_count, index, field, wire, sizeof(wire), &wire_length) ==
+         TELEMETRY_RESULT_OK);
+  vehicle_state_t unused;
+  return telemetry_decoder_decode(decoder, wire, wire_length - 1, &unused);
+}
+
+static void test_local_descriptors_keep_local_plan(void) {
+  const telemetry_descriptor_t* local = telemetry_local_descriptors();
+  const uint32_t layout_id = telemetry_local_layout_id();
+  assert(layout_id == telemetry_layout_id(local, TELEMETRY_FLOAT_FIELD_COUNT));
+  assert(strcmp(local[TELEMETRY_CHANNEL_brake_pressure_bar].name, "brake_pressure_bar") == 0);
+  assert(local[TELEMETRY_CHANNEL_dam].width == TELEMETRY_WIDTH_I8);
+
+  telemetry_decoder_t decoder;
+  telemetry_decoder_init(&decoder);
+  assert(decoder.schema.plan.layout_id == layout_id);
+  const vehicle_state_t input = delta_test_state();
+  uint8_t wire[2 * TELEMETRY_WIRE_FRAME_MAX_SIZE];
+  size_t wire_length = 0;
+  assert(telemetry_frame_encode_wire(&input, wire, sizeof(wire), &wire_length) == TELEMETRY_RESULT_OK);
+  vehicle_state_t output;
+  assert(telemetry_decoder_decode(&decoder, wire, wire_length - 1, &output) == TELEMETRY_RESULT_OK);
+
+  // The hub announcing this build's own layout changes nothing.
+  for (uint32_t i = 0; i < TELEMETRY_FLOAT_FIELD_COUNT; ++i) {
+    assert(feed_descriptor(&decoder, layout_id, TELEMETRY_FLOAT_FIELD_COUNT, i, &local[i]) ==
+           TELEMETRY_RESULT_DESCRIPTOR);
+    assert(telemetry_decoder_decode(&decoder, wire, wire_length - 1, &output) == TELEMETRY_RESULT_OK);
+  }
+  assert(decoder.schema.descriptors == TELEMETRY_FLOAT_FIELD_COUNT && decoder.schema.plans_built == 0);
+  assert_packet_equal(&input, &output);
+
+  // The longest name fits, and the frame decoder validates descriptors.
+  assert(telemetry_descriptor_encode_wire(layout_id, TELEMETRY_FLOAT_FIELD_COUNT, TELEMETRY_CHANNEL_brake_pressure_bar,
+                                          &local[TELEMETRY_CHANNEL_brake_pressure_bar], wire, sizeof(wire),
+                                          &wire_length) == TELEMETRY_RESULT_OK);
+  assert(telemetry_frame_decode(wire, wire_length - 1, &output) == TELEMETRY_RESULT_DESCRIPTOR);
+  const telemetry_descriptor_t too_long = {.name = "a_channel_name_too_long_", .scale = 1.0f};
+  assert(telemetry_descriptor_encode_wire(1, 1, 0, &too_long, wire, sizeof(wire), &wire_length) ==
+         TELEMETRY_RESULT_INVALID_ARGUMENT);
+  assert(telemetry_descriptor_encode_wire(layout_id, 2, 2, &local[0], wire, sizeof(wire), &wire_length) ==
+         TELEMETRY_RESULT_INVALID_ARGUMENT);
+}
+
+static void test_decode_plan_follows_announced_layout(void) {
+  // A newer hub: channels reordered, one added, oil_temp quantized differently
+  // and most local channels gone.
+  static const telemetry_descriptor_t hub_layout[] = {
+      {"engine_rpm", TELEMETRY_WIDTH_I16, 1.0f, 0.0f},
+      {"boost_psi", TELEMETRY_WIDTH_I16, 0.1f, 0.0f},
+      {"oil_temp", TELEMETRY_WIDTH_I8, 2.0f, 100.0f},
+      {"water_temp", TELEMETRY_WIDTH_I16, 0.1f, 0.0f},
+  };
+  const uint32_t count = sizeof(hub_layout) / sizeof(hub_layout[0]);
+  const uint32_t layout_id = telemetry_layout_id(hub_layout, count);
+  assert(layout_id != telemetry_local_layout_id());
+
+  telemetry_decoder_t decoder;
+  telemetry_decoder_init(&decoder);
+  uint8_t frame[TELEMETRY_COBS_FRAME_MAX_SIZE];
+  vehicle_state_t output;
+
+  // Until every entry is in, data frames may use either layout and wait.
+  const int32_t full[] = {TELEMETRY_SCHEMA_VERSION_QUANTIZED_TAGGED, 7, 1000, (int32_t)layout_id, 3000, 55, 10, 1900};
+  const size_t full_length = build_int_frame(full, 8, frame);
+  assert(feed_descriptor(&decoder, layout_id, count, 0, &hub_layout[0]) == TELEMETRY_RESULT_DESCRIPTOR);
+  assert(telemetry_decoder_decode(&decoder, frame, full_length, &output) == TELEMETRY_RESULT_NEED_KEYFRAME);
+  assert(decoder.schema.plans_built == 0);
+
+  // Entries may arrive in any order. A set whose hash does not match its
+  // layout_id (here one entry changed) is dropped.
+  telemetry_descriptor_t tampered = hub_layout[1];
+  tampered.scale = 0.2f;
+  assert(feed_descriptor(&decoder, layout_id, count, 1, &tampered) == TELEMETRY_RESULT_DESCRIPTOR);
+  assert(feed_descriptor(&decoder, layout_id, count, 3, &hub_layout[3]) == TELEMETRY_RESULT_DESCRIPTOR);
+  assert(feed_descriptor(&decoder, layout_id, count, 2, &hub_layout[2]) == TELEMETRY_RESULT_DESCRIPTOR);
+  assert(decoder.schema.plans_built == 0 && decoder.schema.plan.layout_id == telemetry_local_layout_id());
+  for (uint32_t i = count; i-- > 0;) {
+    assert(feed_descriptor(&decoder, layout_id, count, i, &hub_layout[i]) == TELEMETRY_RESULT_DESCRIPTOR);
+  }
+  assert(decoder.schema.plans_built == 1 && decoder.schema.plan.layout_id == layout_id);
+  assert(decoder.schema.plan.field_count == count && decoder.schema.unknown_channels == 1);
+
+  // The first frame in the new layout must be a full one.
+  const int32_t delta[] = {TELEMETRY_SCHEMA_VERSION_QUANTIZED_DELTA, 8, 1020, 0x5, 3500, -5};
+  uint8_t delta_frame[TELEMETRY_COBS_FRAME_MAX_SIZE];
+  const size_t delta_length = build_int_frame(delta, 6, delta_frame);
+  assert(telemetry_decoder_decode(&decoder, delta_frame, delta_length, &output) == TELEMETRY_RESULT_NEED_KEYFRAME);
+
+  assert(telemetry_decoder_decode(&decoder, frame, full_length, &output) == TELEMETRY_RESULT_OK);
+  assert(output.sequence == 7 && output.timestamp_ms == 1000);
+  assert(output.engine_rpm == 3000.0f && output.oil_temp == 120.0f && fabsf(output.water_temp - 190.0f) < 1e-3f);
+  assert(isnan(output.af_ratio) && isnan(output.oil_pressure) && isnan(output.brake_pressure_bar));
+
+  assert(telemetry_decoder_decode(&decoder, delta_frame, delta_length, &output) == TELEMETRY_RESULT_OK);
+  assert(output.engine_rpm == 3500.0f && output.oil_temp == 90.0f && fabsf(output.water_temp - 190.0f) < 1e-3f);
+
+  // Batch columns follow local channel order: water_temp (0) before engine_rpm (11).
+  const int32_t batch[] = {TELEMETRY_SCHEMA_VERSION_BATCH, 9, 1040, 0x9, 0, 4000, 1800, 10, 4100, 1850};
+  const size_t batch_length = build_int_frame(batch, 10, frame);
+  assert(telemetry_decoder_decode(&decoder, frame, batch_length, &output) == TELEMETRY_RESULT_OK);
+  const telemetry_sample_batch_t* samples = telemetry_decoder_last_batch(&decoder);
+  assert(samples != NULL && samples->sample_count == 2);
+  assert(samples->field_mask == ((1UL << TELEMETRY_CHANNEL_water_temp) | (1UL << TELEMETRY_CHANNEL_engine_rpm)));
+  assert(fabsf(samples->values[0][0] - 180.0f) < 1e-3f && samples->values[0][1] == 4000.0f);
+  assert(fabsf(samples->values[1][0] - 185.0f) < 1e-3f && samples->values[1][1] == 4100.0f);
+  assert(samples->timestamp_ms[1] == 1050 && output.timestamp_ms == 1050 && output.engine_rpm == 4100.0f);
+
+  // Schema 5 keyframes are in the base layout and wait for its descriptors.
+  const vehicle_state_t local_state = delta_test_state();
+  uint8_t wire[TELEMETRY_WIRE_FRAME_MAX_SIZE];
+  size_t wire_length = 0;
+  assert(telemetry_frame_encode_wire(&local_state, wire, sizeof(wire), &wire_length) == TELEMETRY_RESULT_OK);
+  assert(telemetry_decoder_decode(&decoder, wire, wire_length - 1, &output) == TELEMETRY_RESULT_NEED_KEYFRAME);
+  assert(decoder.schema.layout_mismatches == 1);
+
+  // Repeats of the current layout are ignored; the local layout switches back.
+  assert(feed_descriptor(&decoder, layout_id, count, 2, &hub_layout[2]) == TELEMETRY_RESULT_DESCRIPTOR);
+  assert(decoder.schema.plans_built == 1);
+  for (uint32_t i = 0; i < TELEMETRY_FLOAT_FIELD_COUNT; ++i) {
+    assert(feed_descriptor(&decoder, telemetry_local_layout_id(), TELEMETRY_FLOAT_FIELD_COUNT, i,
+                           &telemetry_local_descriptors()[i]) == TELEMETRY_RESULT_DESCRIPTOR);
+  }
+  assert(decoder.schema.plans_built == 2 && decoder.schema.unknown_channels == 0);
+  assert(decoder.schema.plan.missing_mask == 0);
+  assert(telemetry_decoder_decode(&decoder, wire, wire_length - 1, &output) == TELEMETRY_RESULT_OK);
+  assert_packet_equal(&local_state, &output);
+}
+
+static void test_keyframe_in_unannounced_layout_waits(void) {
+  // A hub with the local channels in another order: same field count, so
+  // only the layout_id tells its frames apart.
+  telemetry_descriptor_t hub_layout[TELEMETRY_FLOAT_FIELD_COUNT];
+  memcpy(hub_layout, telemetry_local_descriptors(), sizeof(hub_layout));
+  hub_layout[TELEMETRY_CHANNEL_water_temp] = telemetry_local_descriptors()[TELEMETRY_CHANNEL_oil_temp];
+  hub_layout[TELEMETRY_CHANNEL_oil_temp] = telemetry_local_descriptors()[TELEMETRY_CHANNEL_water_temp];
+  const uint32_t layout_id = telemetry_layout_id(hub_layout, TELEMETRY_FLOAT_FIELD_COUNT);
+
+  telemetry_decoder_t decoder;
+  telemetry_decoder_init(&decoder);
+  int32_t full[TELEMETRY_TAGGED_HEADER_ITEM_COUNT + TELEMETRY_FLOAT_FIELD_COUNT] = {
+      TELEMETRY_SCHEMA_VERSION_QUANTIZED_TAGGED, 1, 100, (int32_t)layout_id};
+  full[TELEMETRY_TAGGED_HEADER_ITEM_COUNT + TELEMETRY_CHANNEL_water_temp] = 900;  // hub's oil_temp, 0.1 degF
+  uint8_t frame[TELEMETRY_COBS_FRAME_MAX_SIZE];
+  const size_t full_length = build_int_frame(full, sizeof(full) / sizeof(full[0]), frame);
+  vehicle_state_t output = {.water_temp = 1.0f};
+  assert(telemetry_decoder_decode(&decoder, frame, full_length, &output) == TELEMETRY_RESULT_NEED_KEYFRAME);
+  assert(output.water_temp == 1.0f && decoder.schema.layout_mismatches == 1);
+  assert(telemetry_frame_decode(frame, full_length, &output) == TELEMETRY_RESULT_SCHEMA_ERROR);
+
+  // This build's layout is the base one, so it sends schema 3 and 5, but a
+  // tagged frame naming it decodes the same.
+  assert(telemetry_local_layout_id() == TELEMETRY_BASE_LAYOUT_ID);
+  full[3] = (int32_t)TELEMETRY_BASE_LAYOUT_ID;
+  const size_t local_length = build_int_frame(full, sizeof(full) / sizeof(full[0]), frame);
+  assert(telemetry_frame_decode(frame, local_length, &output) == TELEMETRY_RESULT_OK);
+  assert(output.water_temp == 90.0f && output.sequence == 1 && output.timestamp_ms == 100);
+  full[3] = (int32_t)layout_id;
+  build_int_frame(full, sizeof(full) / sizeof(full[0]), frame);
+
+  // Deltas on top of an earlier local keyframe wait too.
+  const vehicle_state_t local_state = delta_test_state();
+  uint8_t wire[TELEMETRY_WIRE_FRAME_MAX_SIZE];
+  size_t wire_length = 0;
+  telemetry_decoder_init(&decoder);
+  assert(telemetry_frame_encode_wire(&local_state, wire, sizeof(wire), &wire_length) == TELEMETRY_RESULT_OK);
+  assert(telemetry_decoder_decode(&decoder, wire, wire_length - 1, &output) == TELEMETRY_RESULT_OK);
+  assert(telemetry_decoder_decode(&decoder, frame, full_length, &output) == TELEMETRY_RESULT_NEED_KEYFRAME);
+  const int32_t delta[] = {TELEMETRY_SCHEMA_VERSION_QUANTIZED_DELTA, 2, 120, 1 << TELEMETRY_CHANNEL_water_temp, 950};
+  uint8_t delta_frame[TELEMETRY_COBS_FRAME_MAX_SIZE];
+  const size_t delta_length = build_int_frame(delta, 5, delta_frame);
+  assert(telemetry_decoder_decode(&decoder, delta_frame, delta_length, &output) == TELEMETRY_RESULT_NEED_KEYFRAME);
+
+  // Once announced, the same keyframe lands in the right channels.
+  for (uint32_t i = 0; i < TELEMETRY_FLOAT_FIELD_COUNT; ++i) {
+    assert(feed_descriptor(&decoder, layout_id, TELEMETRY_FLOAT_FIELD_COUNT, i, &hub_layout[i]) ==
+           TELEMETRY_RESULT_DESCRIPTOR);
+  }
+  assert(telemetry_decoder_decode(&decoder, frame, full_length, &output) == TELEMETRY_RESULT_OK);
+  assert(output.oil_temp == 90.0f && output.water_temp == 0.0f);
+  assert(telemetry_decoder_decode(&decoder, delta_frame, delta_length, &output) == TELEMETRY_RESULT_OK);
+  assert(output.oil_temp == 95.0f && output.water_temp == 0.0f);
+}
+
+static void test_lost_descriptor_falls_back_to_current_plan(void) {
+  static const telemetry_descriptor_t hub_layout[] = {
+      {"engine_rpm", TELEMETRY_WIDTH_I16, 1.0f, 0.0f},
+      {"water_temp", TELEMETRY_WIDTH_I16, 0.1f, 0.0f},
+      {"oil_temp", TELEMETRY_WIDTH_I16, 0.1f, 0.0f},
+  };
+  const uint32_t layout_id = telemetry_layout_id(hub_layout, 3);
+  telemetry_decoder_t decoder;
+  telemetry_decoder_init(&decoder);
+
+  const vehicle_state_t local_state = delta_test_state();
+  uint8_t wire[TELEMETRY_WIRE_FRAME_MAX_SIZE];
+  size_t wire_length = 0;
+  assert(telemetry_frame_encode_wire(&local_state, wire, sizeof(wire), &wire_length) == TELEMETRY_RESULT_OK);
+  vehicle_state_t output;
+
+  // Entry 1 never arrives.
+  assert(feed_descriptor(&decoder, layout_id, 3, 0, &hub_layout[0]) == TELEMETRY_RESULT_DESCRIPTOR);
+  for (uint32_t i = 0; i < TELEMETRY_SCHEMA_PENDING_MAX_FRAMES / 2; ++i) {
+    assert(telemetry_decoder_decode(&decoder, wire, wire_length - 1, &output) == TELEMETRY_RESULT_NEED_KEYFRAME);
+  }
+  // Progress restarts the count.
+  assert(feed_descriptor(&decoder, layout_id, 3, 2, &hub_layout[2]) == TELEMETRY_RESULT_DESCRIPTOR);
+  for (uint32_t i = 0; i < TELEMETRY_SCHEMA_PENDING_MAX_FRAMES; ++i) {
+    assert(telemetry_decoder_decode(&decoder, wire, wire_length - 1, &output) == TELEMETRY_RESULT_NEED_KEYFRAME);
+  }
+  assert(decoder.schema.announcements_dropped == 0);
+
+  // Then the set is given up on and the local plan decodes again.
+  assert(telemetry_decoder_decode(&decoder, wire, wire_length - 1, &output) == TELEMETRY_RESULT_OK);
+  assert_packet_equal(&local_state, &output);
+  assert(decoder.schema.announcements_dropped == 1 && decoder.schema.pending_received == 0);
+  assert(decoder.schema.plans_built == 0);
+
+  // The next complete announcement is adopted.
+  for (uint32_t i = 0; i < 3; ++i) {
+    assert(feed_descriptor(&decoder, layout_id, 3, i, &hub_layout[i]) == TELEMETRY_RESULT_DESCRIPTOR);
+  }
+  assert(decoder.schema.plans_built == 1 && decoder.schema.plan.layout_id == layout_id);
+}
+
+static void test_decoder_rejects_malformed_descriptor(void) {
+  telemetry_decoder_t decoder;
+  telemetry_decoder_init(&decoder);
+  vehicle_state_t output;
+  uint8_t frame[TELEMETRY_COBS_FRAME_MAX_SIZE];
+
+  // [9, 1, 2, index, "x", width, scale, offset] with float32 scale/offset.
+  uint8_t raw[] = {0x98, 0x09, 0x01, 0x02, 0x00, 0xa1, 'x', 0x01, 0xca, 0x3f, 0x80, 0x00, 0x00,
+                   0xca, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
+  size_t frame_length = rebuild_frame(raw, sizeof(raw), frame);
+  assert(telemetry_decoder_decode(&decoder, frame, frame_length, &output) == TELEMETRY_RESULT_DESCRIPTOR);
+  assert(decoder.schema.pending_received == 0x1);
+
+  raw[4] = 0x02;  // index past field_count
+  frame_length = rebuild_frame(raw, sizeof(raw), frame);
+  assert(telemetry_decoder_decode(&decoder, frame, frame_length, &output) == TELEMETRY_RESULT_MSGPACK_ERROR);
+  raw[4] = 0x01;
+  raw[7] = 0x02;  // unknown width
+  frame_length = rebuild_frame(raw, sizeof(raw), frame);
+  assert(telemetry_decoder_decode(&decoder, frame, frame_length, &output) == TELEMETRY_RESULT_MSGPACK_ERROR);
+  raw[7] = 0x01;
+  raw[9] = 0xbf;  // scale -1.0
+  frame_length = rebuild_frame(raw, sizeof(raw), frame);
+  assert(telemetry_decoder_decode(&decoder, frame, frame_length, &output) == TELEMETRY_RESULT_MSGPACK_ERROR);
+  raw[9] = 0x3f;
+  raw[6] = 0x00;  // NUL inside the name
+  frame_length = rebuild_frame(raw, sizeof(raw), frame);
+  assert(telemetry_decoder_decode(&decoder, frame, frame_length, &output) == TELEMETRY_RESULT_MSGPACK_ERROR);
+  assert(decoder.schema.descriptors == 1 && decoder.schema.pending_received == 0x1);
+}
+
+static void test_golden_fec_parity(void) {
+  const uint8_t payload[] = {0x93, 0x08, 0x01, 0x07};
+  static const uint8_t expected_raw[] = {0x93, 0x08, 0x01, 0x07, 0x33, 0xF4, 0xE9, 0xAA, 0xD8, 0xC1};
+  uint8_t frame[TELEMETRY_COBS_FRAME_MAX_SIZE];
+  telemetry_frame_writer_t writer;
+  telemetry_frame_writer_init(&writer, frame, sizeof(frame));
+  telemetry_frame_writer_set_fec(&writer, true);
+  telemetry_frame_writer_append(&writer, payload, sizeof(payload));
+  size_t frame_length = 0;
+  assert(telemetry_frame_writer_finish(&writer, &frame_length) == TELEMETRY_RESULT_OK);
+
+  uint8_t raw[TELEMETRY_RAW_FRAME_MAX_SIZE];
+  size_t raw_length = 0;
+  assert(cobs_decode(frame, frame_length, raw, sizeof(raw), &raw_length));
+  assert(raw_length == sizeof(expected_raw) && memcmp(raw, expected_raw, sizeof(expected_raw)) == 0);
+
+  vehicle_state_t output;
+  assert(telemetry_frame_decode(frame, frame_length, &output) == TELEMETRY_RESULT_CONTROL);
+}
+
+// Re-stuffs `raw` and runs it through both decoders, which must agree.
+static telemetry_result_t decode_raw_both_ways(const uint8_t* raw, size_t raw_length, telemetry_decoder_t* decoder,
+                                               vehicle_state_t* output) {
+  uint8_t wire[TELEMETRY_WIRE_FRAME_MAX_SIZE];
+  const size_t frame_length = cobs_encode(raw, raw_length, wire);
+  wire[frame_length] = 0x00;
+
+  telemetry_decoder_init(decoder);
+  const telemetry_result_t result = telemetry_decoder_decode(decoder, wire, frame_length, output);
+
+  telemetry_stream_decoder_t stream;
+  telemetry_stream_decoder_init(&stream);
+  vehicle_state_t stream_output = *output;
+  size_t consumed = 0;
+  assert(telemetry_stream_decoder_feed(&stream, wire, frame_length + 1, &consumed, &stream_output) == result);
+  assert(consumed == frame_length + 1);
+  assert(memcmp(&stream_output, output, sizeof(stream_output)) == 0);
+  assert(stream.decoder.fec_corrected_frames == decoder->fec_corrected_frames);
+  return result;
+}
+
+static void test_fec_repairs_up_to_two_byte_errors(void) {
+  const vehicle_state_t input = {
+      .sequence = 1234,
+      .timestamp_ms = 56789,
+      .water_temp = 195.5f,
+      .oil_pressure = 61.25f,
+      .af_ratio = 14.7f,
+      .engine_rpm = 4321.0f,
+      .steering_angle_deg = -33.5f,
+  };
+  telemetry_delta_encoder_t encoder;
+  telemetry_delta_encoder_init(&encoder, 1);
+  telemetry_delta_encoder_set_fec(&encoder, true);
+  uint8_t wire[TELEMETRY_WIRE_FRAME_MAX_SIZE];
+  size_t wire_length = 0;
+  assert(telemetry_delta_encoder_encode_wire(&encoder, &input, wire, sizeof(wire), &wire_length) ==
+         TELEMETRY_RESULT_OK);
+  uint8_t raw[TELEMETRY_RAW_FRAME_MAX_SIZE];
+  size_t raw_length = 0;
+  assert(cobs_decode(wire, wire_length - 1, raw, sizeof(raw), &raw_length));
+
+  // An intact frame decodes without repair.
+  telemetry_decoder_t decoder;
+  vehicle_state_t output;
+  assert(decode_raw_both_ways(raw, raw_length, &decoder, &output) == TELEMETRY_RESULT_OK);
+  assert_packet_equal(&input, &output);
+  assert(decoder.fec_corrected_frames == 0);
+
+  // One error at every position, and two at every pair of positions,
+  // including the CRC and parity bytes. Damaged parity alone needs no repair.
+  for (size_t i = 0; i < raw_length; ++i) {
+    for (size_t j = i; j < raw_length; ++j) {
+      uint8_t corrupted[TELEMETRY_RAW_FRAME_MAX_SIZE];
+      memcpy(corrupted, raw, raw_length);
+      corrupted[i] ^= 0xA5;
+      if (j != i) {
+        corrupted[j] ^= (uint8_t)(0x01 | (j << 4));
+      }
+      memset(&output, 0, sizeof(output));
+      assert(decode_raw_both_ways(corrupted, raw_length, &decoder, &output) == TELEMETRY_RESULT_OK);
+      assert_packet_equal(&input, &output);
+      assert(decoder.fec_corrected_frames == (i < raw_length - TELEMETRY_FEC_PARITY_SIZE ? 1U : 0U));
+    }
+  }
+
+  // Three errors in the payload or CRC are beyond repair and leave the output
+  // alone.
+  for (size_t i = 0; i + 2 < raw_length - TELEMETRY_FEC_PARITY_SIZE; ++i) {
+    uint8_t corrupted[TELEMETRY_RAW_FRAME_MAX_SIZE];
+    memcpy(corrupted, raw, raw_length);
+    corrupted[i] ^= 0x10;
+    corrupted[i + 1] ^= 0x22;
+    corrupted[i + 2] ^= 0x03;
+    const vehicle_state_t sentinel = {.sequence = 777};
+    output = sentinel;
+    assert(decode_raw_both_ways(corrupted, raw_length, &decoder, &output) == TELEMETRY_RESULT_CRC_ERROR);
+    assert(memcmp(&output, &sentinel, sizeof(output)) == 0);
+    assert(decoder.fec_corrected_frames == 0);
+  }
+}
+
+#define STREAM_TEST_FRAMES 200
+#define STREAM_TEST_CAPACITY (STREAM_TEST_FRAMES * TELEMETRY_WIRE_FRAME_MAX_SIZE)
+
+typedef struct {
+  telemetry_result_t results[STREAM_TEST_FRAMES * 2];
+  vehicle_state_t packets[STREAM_TEST_FRAMES * 2];
+  size_t count;
+} stream_outcome_t;
+
+static size_t build_test_stream(uint8_t* stream, size_t frame_count) {
+  telemetry_delta_encoder_t encoder;
+  telemetry_delta_encoder_init(&encoder, 10);
+  vehicle_state_t state = delta_test_state();
+  size_t length = 0;
+  for (size_t i = 0; i < frame_count; ++i) {
+    state.sequence++;
+    state.timestamp_ms += 33;
+    state.engine_rpm = 3000.0f + 40.0f * (float)(i % 50);
+    state.throttle_pos = (float)(i % 100);
+    state.oil_pressure = 40.0f + (float)(i % 7);
+    length += encode_delta(&encoder, &state, stream + length) + 1;
+  }
+  return length;
+}
+
+// Splits on delimiters and decodes each frame with telemetry_decoder_decode().
+static void decode_with_frame_decoder(const uint8_t* stream, size_t length, stream_outcome_t* outcome) {
+  telemetry_decoder_t decoder;
+  telemetry_decoder_init(&decoder);
+  outcome->count = 0;
+  size_t start = 0;
+  for (size_t i = 0; i < length; ++i) {
+    if (stream[i] != 0x00) {
+      continue;
+    }
+    if (i > start) {
+      vehicle_state_t packet = {0};
+      outcome->results[outcome->count] = telemetry_decoder_decode(&decoder, stream + start, i - start, &packet);
+      outcome->packets[outcome->count++] = packet;
+    }
+    start = i + 1;
+  }
+}
+
+static void decode_with_stream_decoder(const uint8_t* stream, size_t length, size_t chunk,
+                                       stream_outcome_t* outcome) {
+  telemetry_stream_decoder_t decoder;
+  telemetry_stream_decoder_init(&decoder);
+  outcome->count = 0;
+  for (size_t offset = 0; offset < length; offset += chunk) {
+    const uint8_t* data = stream + offset;
+    size_t remaining = length - offset < chunk ? length - offset : chunk;
+    while (remaining > 0) {
+      vehicle_state_t packet = {0};
+      size_t consumed = 0;
+      const telemetry_result_t result = telemetry_stream_decoder_feed(&decoder, data, remaining, &consumed, &packet);
+      assert(consumed > 0 && consumed <= remaining);
+      data += consumed;
+      remaining -= consumed;
+      if (result != TELEMETRY_RESULT_INCOMPLETE) {
+        outcome->results[outcome->count] = result;
+        outcome->packets[outcome->count++] = packet;
+      }
+    }
+  }
+}
+
+static void assert_outcomes_equal(const stream_outcome_t* expected, const stream_outcome_t* actual) {
+  assert(expected->count == actual->count);
+  for (size_t i = 0; i < expected->count; ++i) {
+    assert(expected->results[i] == actual->results[i]);
+    if (expected->results[i] == TELEMETRY_RESULT_OK) {
+      assert_packet_equal(&expected->packets[i], &actual->packets[i]);
+    }
+  }
+}
+
+static void test_stream_decoder_matches_frame_decoder(void) {
+  static uint8_t stream[STREAM_TEST_CAPACITY];
+  static stream_outcome_t expected;
+  static stream_outcome_t actual;
+  const size_t length = build_test_stream(stream, STREAM_TEST_FRAMES);
+
+  decode_with_frame_decoder(stream, length, &expected);
+  assert(expected.count == STREAM_TEST_FRAMES);
+  static const size_t chunks[] = {1, 2, 7, 64, STREAM_TEST_CAPACITY};
+  for (size_t i = 0; i < sizeof(chunks) / sizeof(chunks[0]); ++i) {
+    decode_with_stream_decoder(stream, length, chunks[i], &actual);
+    assert_outcomes_equal(&expected, &actual);
+  }
+}
+
+static void test_stream_decoder_matches_frame_decoder_on_corrupted_stream(void) {
+  static uint8_t stream[STREAM_TEST_CAPACITY];
+  static stream_outcome_t expected;
+  static stream_outcome_t actual;
+  size_t length = build_test_stream(stream, STREAM_TEST_FRAMES);
+
+  // Flip bits, drop bytes and inject zeros at deterministic pseudo-random points.
+  uint32_t seed = 0x1234567U;
+  for (size_t i = 0; i < length; ++i) {
+    seed = seed * 1103515245U + 12345U;
+    const uint32_t roll = (seed >> 16) % 400U;
+    if (roll == 0) {
+      stream[i] ^= (uint8_t)(1U << ((seed >> 8) & 7U));
+    } else if (roll == 1) {
+      memmove(stream + i, stream + i + 1, length - i - 1);
+      length--;
+    } else if (roll == 2) {
+      stream[i] = 0x00;
+    }
+  }
+
+  decode_with_frame_decoder(stream, length, &expected);
+  size_t rejected = 0;
+  for (size_t i = 0; i < expected.count; ++i) {
+    rejected += expected.results[i] != TELEMETRY_RESULT_OK;
+  }
+  assert(rejected > 0 && rejected < expected.count);
+  decode_with_stream_decoder(stream, length, 1, &actual);
+  assert_outcomes_equal(&expected, &actual);
+  decode_with_stream_decoder(stream, length, 37, &actual);
+  assert_outcomes_equal(&expected, &actual);
+}
+
+static void test_stream_decoder_rejects_oversized_frame_and_recovers(void) {
+  telemetry_stream_decoder_t decoder;
+  telemetry_stream_decoder_init(&decoder);
+  vehicle_state_t packet = {0};
+  size_t consumed = 0;
+
+  uint8_t garbage[TELEMETRY_COBS_FRAME_MAX_SIZE * 3];
+  memset(garbage, 0x55, sizeof(garbage));
+  assert(telemetry_stream_decoder_feed(&decoder, garbage, sizeof(garbage), &consumed, &packet) ==
+         TELEMETRY_RESULT_INCOMPLETE);
+  assert(consumed == sizeof(garbage));
+  assert(telemetry_stream_decoder_in_frame(&decoder));
+
+  const vehicle_state_t state = delta_test_state();
+  uint8_t wire[TELEMETRY_WIRE_FRAME_MAX_SIZE + 1];
+  wire[0] = 0x00;  // terminates the garbage
+  size_t wire_length = 0;
+  assert(telemetry_frame_encode_wire(&state, wire + 1, TELEMETRY_WIRE_FRAME_MAX_SIZE, &wire_length) ==
+         TELEMETRY_RESULT_OK);
+  assert(telemetry_stream_decoder_feed(&decoder, wire, wire_length + 1, &consumed, &packet) ==
+         TELEMETRY_RESULT_FRAME_TOO_LARGE);
+  assert(consumed == 1);
+  assert(!telemetry_stream_decoder_in_frame(&decoder));
+  assert(telemetry_stream_decoder_feed(&decoder, wire + 1, wire_length, &consumed, &packet) ==
+         TELEMETRY_RESULT_OK);
+  assert(consumed == wire_length);
+  assert_packet_equal(&state, &packet);
+
+  // A reset discards a partial frame so the next delimiter completes nothing.
+  assert(telemetry_stream_decoder_feed(&decoder, wire + 1, wire_length / 2, &consumed, &packet) ==
+         TELEMETRY_RESULT_INCOMPLETE);
+  telemetry_stream_decoder_reset(&decoder);
+  const uint8_t delimiter = 0x00;
+  assert(telemetry_stream_decoder_feed(&decoder, &delimiter, 1, &consumed, &packet) ==
+         TELEMETRY_RESULT_INCOMPLETE);
+  assert(telemetry_stream_decoder_feed(NULL, wire, 1, &consumed, &packet) == TELEMETRY_RESULT_INVALID_ARGUMENT);
+}
+
 static void test_argument_and_size_errors(void) {
   const vehicle_state_t input = {0};
   uint8_t frame[TELEMETRY_COBS_FRAME_MAX_SIZE];
@@ -188,12 +1364,40 @@ static void test_argument_and_size_errors(void) {
 
 int main(void) {
   test_crc_check_value();
+  test_crc_update_matches_single_call();
+  test_frame_writer_matches_reference_framing();
+  test_frame_writer_reports_overflow();
+  test_wire_encode_appends_delimiter();
   test_round_trip();
   test_golden_messagepack_payload();
   test_rejects_corruption_without_modifying_destination();
   test_rejects_wrong_schema();
   test_rejects_invalid_messagepack();
   test_rejects_trailing_messagepack_data();
+  test_delta_frames_carry_only_changed_fields();
+  test_delta_encoder_sends_periodic_keyframes();
+  test_delta_encoder_sends_keyframe_when_every_field_changes();
+  test_rate_groups_are_sent_as_separate_messages();
+  test_quantized_round_trip_precision();
+  test_golden_quantized_payload();
+  test_quantized_saturation_nan_and_deltas();
+  test_decoder_requires_keyframe_before_delta();
+  test_decoder_rejects_malformed_delta();
+  test_sample_batch_round_trip();
+  test_golden_batch_payload();
+  test_decoder_rejects_malformed_batch();
+  test_control_frames_bypass_telemetry_state();
+  test_time_pong_carries_hub_timestamps();
+  test_local_descriptors_keep_local_plan();
+  test_decode_plan_follows_announced_layout();
+  test_keyframe_in_unannounced_layout_waits();
+  test_lost_descriptor_falls_back_to_current_plan();
+  test_decoder_rejects_malformed_descriptor();
+  test_golden_fec_parity();
+  test_fec_repairs_up_to_two_byte_errors();
+  test_stream_decoder_matches_frame_decoder();
+  test_stream_decoder_matches_frame_decoder_on_corrupted_stream();
+  test_stream_decoder_rejects_oversized_frame_and_recovers();
   test_argument_and_size_errors();
   puts("telemetry protocol tests passed");
   return 0;
@@ -0,0 +1,224 @@
+"""
+generates the hub's SSM parameter table (ssm_param_table.{c,h}) from the
+`ecu` section of known-addresses.yaml.
+
+each expression is turned into `raw * scale + offset`; one-byte parameters
+whose expression isn't affine get a 256-entry lookup table instead. the hub
+build runs this whenever the yaml changes, see esp-data-hub-2/main/CMakeLists.txt.
+"""
+
+import argparse
+import math
+import os
+import re
+import struct
+import sys
+
+from typing import Callable, Dict, List, Optional, Tuple, TypedDict
+
+import yaml
+
+TYPES = {
+    "uint": "SSM_PARAM_TYPE_UINT",
+    "int": "SSM_PARAM_TYPE_INT",
+    "float": "SSM_PARAM_TYPE_FLOAT",
+}
+
+# identifiers ssm_param.h already uses under the SSM_PARAM_ prefix
+RESERVED_IDS = {"SSM_PARAM_COUNT", "SSM_PARAM_MAX_LENGTH"}
+
+HEADER_COMMENT = "// Generated by scripts/subaru-decode/gen_ssm_params.py from known-addresses.yaml; do not edit.\n"
+
+
+class Param(TypedDict):
+    id: str
+    name: str
+    unit: str
+    address: int
+    length: int
+    little_endian: bool
+    type: str
+    scale: float
+    offset: float
+    lut: Optional[List[float]]
+
+
+def param_id(name: str) -> str:
+    return "SSM_PARAM_" + re.sub(r"[^A-Z0-9]+", "_", name.upper()).strip("_")
+
+
+def compile_expr(expr: str, where: str) -> Callable[[float], float]:
+    code = compile(str(expr), where, "eval")
+
+    def evaluate(x: float) -> float:
+        return float(eval(code, {"__builtins__": {}}, {"x": x}))
+
+    return evaluate
+
+
+def raw_range(kind: str, length: int) -> Tuple[float, float]:
+    bits = 8 * length
+    if kind == "int":
+        return -(2 ** (bits - 1)), 2 ** (bits - 1) - 1
+    if kind == "float":
+        return -1.0e6, 1.0e6
+    return 0, 2**bits - 1
+
+
+# fits value = raw * scale + offset, or returns None if the expression isn't affine
+def fit_affine(evaluate: Callable[[float], float], kind: str, length: int) -> Optional[Tuple[float, float]]:
+    lo, hi = raw_range(kind, length)
+    offset = evaluate(0)
+    scale = evaluate(1) - offset
+    samples = {lo, hi, 2, 3, 7, (lo + hi) // 2, -1 if lo < 0 else 100}
+    for x in samples:
+        expected = x * scale + offset
+        if not math.isclose(evaluate(x), expected, rel_tol=1e-9, abs_tol=1e-9):
+            return None
+    return scale, offset
+
+
+def load_params(yaml_path: str) -> List[Param]:
+    with open(yaml_path, "r", encoding="utf-8") as f:
+        reference = yaml.safe_load(f)
+
+    params: List[Param] = []
+    seen: Dict[str, int] = {}
+    for address, info in (reference.get("ecu") or {}).items():
+        where = f"{yaml_path}: {address:#08x}"
+        name = str(info["name"])
+        length = int(info.get("length", 1))
+        kind = str(info.get("type", "uint"))
+        endian = str(info.get("endian", "big"))
+        value = info.get("value") or {}
+
+        if kind not in TYPES:
+            raise ValueError(f"{where}: unknown type {kind!r}")
+        if not 1 <= length <= 4 or (kind == "float" and length != 4):
+            raise ValueError(f"{where}: bad length {length} for {kind}")
+        if endian not in ("big", "little"):
+            raise ValueError(f"{where}: unknown endian {endian!r}")
+        if not 0 <= address <= 0xFFFFFF:
+            raise ValueError(f"{where}: address is not 24-bit")
+
+        ident = param_id(name)
+        if ident in RESERVED_IDS or ident.startswith("SSM_PARAM_TYPE_"):
+            raise ValueError(f"{where}: name {name!r} clashes with {ident}")
+        if ident in seen:
+            raise ValueError(f"{where}: {ident} already used by {seen[ident]:#08x}")
+        seen[ident] = address
+
+        evaluate = compile_expr(value.get("expr", "x"), where)
+        fit = fit_affine(evaluate, kind, length)
+        lut: Optional[List[float]] = None
+        if fit is None:
+            if length != 1 or kind == "float":
+                raise ValueError(f"{where}: expression is not affine and too wide for a lookup table")
+            lut = [evaluate(raw if kind == "uint" else struct.unpack("b", bytes([raw]))[0]) for raw in range(256)]
+            fit = (1.0, 0.0)
+
+        params.append(
+            Param(
+                id=ident,
+                name=name,
+                unit=str(value.get("unit", "")),
+                address=address,
+                length=length,
+                little_endian=endian == "little",
+                type=TYPES[kind],
+                scale=fit[0],
+                offset=fit[1],
+                lut=lut,
+            )
+        )
+    return params
+
+
+def c_string(text: str) -> str:
+    return '"' + text.replace("\\", "\\\\").replace('"', '\\"') + '"'
+
+
+def c_float(value: float) -> str:
+    if not math.isfinite(value):
+        raise ValueError(f"{value} has no C float literal")
+    # shortest literal that gives the same single-precision value on the hub
+    single = struct.pack("f", value)
+    for digits in range(1, 10):
+        shortest = float(f"{value:.{digits}g}")
+        if struct.pack("f", shortest) == single:
+            break
+    return repr(shortest) + "f"
+
+
+def render_header(params: List[Param]) -> str:
+    lines = [HEADER_COMMENT, "#pragma once\n", "\n", '#include "ssm_param.h"\n', "\n", "typedef enum {\n"]
+    width = max((len(param["id"]) for param in params), default=0) + 1
+    for param in params:
+        lines.append(f"  {param['id'] + ',':<{width}}  // 0x{param['address']:06X}\n")
+    lines += [
+        "  SSM_PARAM_COUNT,\n",
+        "} ssm_param_id_t;\n",
+        "\n",
+        "extern const ssm_param_t k_ssm_params[SSM_PARAM_COUNT];\n",
+    ]
+    return "".join(lines)
+
+
+def render_source(params: List[Param]) -> str:
+    lines = [HEADER_COMMENT, '#include "ssm_param_table.h"\n']
+    for param in params:
+        if param["lut"] is None:
+            continue
+        lines += ["\n", f"static const float k_lut_{param['id'].lower()}[256] = {{\n"]
+        values = [c_float(v) for v in param["lut"]]
+        for i in range(0, 256, 8):
+            lines.append("    " + ", ".join(values[i : i + 8]) + ",\n")
+        lines.append("};\n")
+
+    lines += ["\n", "// clang-format off\n", "const ssm_param_t k_ssm_params[SSM_PARAM_COUNT] = {\n"]
+    for param in params:
+        fields = [
+            f".name = {c_string(param['name'])}",
+            f".unit = {c_string(param['unit'])}",
+            f".address = 0x{param['address']:06X}",
+            f".length = {param['length']}",
+        ]
+        conversion = [f".type = {param['type']}"]
+        if param["little_endian"]:
+            conversion.append(".little_endian = true")
+        if param["lut"] is not None:
+            conversion.append(f".lut = k_lut_{param['id'].lower()}")
+        else:
+            conversion += [f".scale = {c_float(param['scale'])}", f".offset = {c_float(param['offset'])}"]
+        lines += [
+            f"    [{param['id']}] = {{{', '.join(fields)},\n",
+            f"        {', '.join(conversion)}}},\n",
+        ]
+    lines += ["};\n", "// clang-format on\n"]
+    return "".join(lines)
+
+
+def write_text(path: str, text: str) -> None:
+    with open(path, "w", encoding="utf-8", newline="\n") as f:
+        f.write(text)
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(description="Generate the hub's SSM parameter table")
+    parser.add_argument("yaml", help="path to known-addresses.yaml")
+    parser.add_argument("--out-dir", "-o", required=True, help="directory for ssm_param_table.{c,h}")
+    args = parser.parse_args()
+
+    try:
+        params = load_params(args.yaml)
+    except (KeyError, ValueError, SyntaxError, TypeError, ZeroDivisionError) as e:
+        print(f"gen_ssm_params: {e}", file=sys.stderr)
+        return 1
+
+    write_text(os.path.join(args.out_dir, "ssm_param_table.h"), render_header(params))
+    write_text(os.path.join(args.out_dir, "ssm_param_table.c"), render_source(params))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())